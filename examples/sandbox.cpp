@@ -15,10 +15,18 @@
 //  You should have received a copy of the GNU General Public License
 //  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <swanson/access-profile.hpp>
+#include <swanson/cpu.hpp>
 #include <swanson/exception.hpp>
 #include <swanson/elf.hpp>
+#include <swanson/memory-map.hpp>
 #include <swanson/process.hpp>
+#include <swanson/syscall-stats.hpp>
+#include <swanson/syscalls.hpp>
+#include <swanson/thread-pool.hpp>
+#include <swanson/world-lock.hpp>
 
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -30,12 +38,76 @@ namespace {
 
 void PrintHelp() {
 	std::cout << "Usage: sandbox [options] <executable> [args]" << std::endl;
+	std::cout << "       sandbox [options] --restore PATH" << std::endl;
 	std::cout << std::endl;
 	std::cout << "Options:" << std::endl;
-	std::cout << "\t-h, --help : Print this help message." << std::endl;
+	std::cout << "\t-h, --help                : Print this help message." << std::endl;
+	std::cout << "\t--checkpoint PATH         : Write checkpoints of the process to PATH." << std::endl;
+	std::cout << "\t--checkpoint-interval N   : Take a checkpoint every N instructions." << std::endl;
+	std::cout << "\t--heatmap PATH            : Write a page access heatmap to PATH on exit." << std::endl;
+	std::cout << "\t--persistent N            : Run the process N times, rolling it back after each run." << std::endl;
+	std::cout << "\t--restore PATH            : Resume the process saved at PATH." << std::endl;
+	std::cout << "\t--sample-interval N       : Count one in N memory accesses for the heatmap." << std::endl;
+	std::cout << "\t--syscall-stats           : Print the count and latency of each system call on exit." << std::endl;
+	std::cout << "\t--threads N               : Run guest threads on N host threads." << std::endl;
 }
 
-void Run(int argc, const char **argv) {
+/// The path to write checkpoints to.
+/// If this is empty, checkpoints are not taken.
+std::string checkpointPath;
+
+/// The number of instructions, per thread,
+/// to run between checkpoints.
+uint32_t checkpointInterval = 1000000;
+
+/// The path of a checkpoint to resume
+/// from, instead of loading an executable.
+std::string restorePath;
+
+/// The number of host threads to run
+/// guest threads on. If this is zero, guest
+/// threads run on the main thread.
+uint32_t threadCount = 0;
+
+/// The path to write the heatmap to.
+/// If this is empty, profiling is disabled.
+std::string heatmapPath;
+
+/// One in this many memory accesses is
+/// counted, when profiling is enabled.
+uint32_t sampleInterval = 1;
+
+/// The number of times to run the process
+/// in persistent mode. If this is zero, the
+/// process runs once, without rolling back.
+uint32_t persistentRuns = 0;
+
+/// Whether or not to print the system
+/// call statistics once the process exits.
+bool printSyscallStats = false;
+
+/// Prints the count and latency of each
+/// kind of system call that was made.
+void PrintSyscallStats(const swanson::SyscallStats &stats) {
+
+	std::cout << "System call   Calls        Total (ns)   p50 (ns)   p99 (ns)" << std::endl;
+
+	for (uint32_t type = 0; type < swanson::syscalls::tableSize; type++) {
+
+		auto calls = stats.GetCallCount(type);
+		if (calls == 0)
+			continue;
+
+		std::cout << std::dec << std::setfill(' ');
+		std::cout << std::setw(11) << type << "   ";
+		std::cout << std::setw(10) << calls << "   ";
+		std::cout << std::setw(12) << stats.GetTotalTime(type) << "   ";
+		std::cout << std::setw(8) << stats.GetPercentile(type, 50) << "   ";
+		std::cout << std::setw(8) << stats.GetPercentile(type, 99) << std::endl;
+	}
+}
+
+void Load(swanson::Process &process, int argc, const char **argv) {
 
 	if (argc < 1) {
 		throw swanson::Exception("No executable specified.");
@@ -52,18 +124,145 @@ void Run(int argc, const char **argv) {
 		throw swanson::Exception("Failed to decode ELF file.");
 	}
 
+	process.Load(elfFile);
+}
+
+void Restore(swanson::Process &process) {
+
+	std::ifstream file(restorePath, std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		throw swanson::Exception("Failed to open checkpoint.");
+	}
+
+	process.Restore(file);
+}
+
+/// Runs the process over and over, rolling it back
+/// in between instead of loading it again. The process
+/// is captured once it's loaded, or at the point where
+/// it first calls snapshot. The call returns one in the
+/// runs that start from it, and zero in the run that
+/// made it.
+void RunPersistent(swanson::Process &process) {
+
+	bool captured = false;
+
+	process.SetSnapshotHandler([&captured](swanson::Process &process, swanson::CPU &cpu) {
+
+		if (captured)
+			return;
+
+		swanson::WorldStop worldStop(process.GetWorldLock(), true);
+
+		cpu.SetRegister(2, 1);
+		process.Capture();
+		cpu.SetRegister(2, 0);
+
+		captured = true;
+	});
+
+	process.Capture();
+
+	uint32_t failures = 0;
+
+	uint64_t restoredPages = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t run = 0; run < persistentRuns; run++) {
+
+		while (!process.Exited())
+			process.Step(100);
+
+		if (process.GetExitCode() != 0)
+			failures++;
+
+		restoredPages += process.Rollback();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	process.SetSnapshotHandler(nullptr);
+
+	std::cout << "Ran " << persistentRuns << " times, " << failures << " with a non-zero exit code." << std::endl;
+	std::cout << "Restored " << restoredPages << " pages in total." << std::endl;
+
+	if (elapsed.count() > 0)
+		std::cout << "Runs per second: " << (uint64_t) (persistentRuns / elapsed.count()) << std::endl;
+}
+
+void Run(int argc, const char **argv) {
+
 	swanson::Process process;
 
-	process.Load(elfFile);
+	if (threadCount > 0)
+		process.SetThreadPool(std::make_shared<swanson::ThreadPool>(threadCount));
+
+	if (restorePath.empty())
+		Load(process, argc, argv);
+	else
+		Restore(process);
+
+	auto syscallStats = std::make_shared<swanson::SyscallStats>();
+
+	if (printSyscallStats)
+		process.SetSyscallStats(syscallStats);
+
+	if (persistentRuns > 0) {
+		RunPersistent(process);
+		if (printSyscallStats)
+			PrintSyscallStats(*syscallStats);
+		return;
+	}
+
+	// The first checkpoint is a full image,
+	// and the ones after it are appended to
+	// it with only the pages that changed.
+
+	std::ofstream checkpointFile;
+
+	if (!checkpointPath.empty()) {
+		checkpointFile.open(checkpointPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!checkpointFile.good())
+			throw swanson::Exception("Failed to open checkpoint file.");
+		process.SaveCheckpoint(checkpointFile, true);
+		checkpointFile.flush();
+	}
+
+	uint32_t stepsSinceCheckpoint = 0;
+
+	std::shared_ptr<swanson::AccessProfile> profile;
+
+	if (!heatmapPath.empty()) {
+		profile = std::make_shared<swanson::AccessProfile>();
+		profile->SetSampleInterval(sampleInterval);
+		process.GetMemoryMap()->SetProfile(profile);
+	}
 
 	while (!process.Exited()) {
 		process.Step(100);
+		if (profile != nullptr)
+			profile->EndWindow();
+		stepsSinceCheckpoint += 100;
+		if (checkpointFile.is_open() && (stepsSinceCheckpoint >= checkpointInterval)) {
+			process.SaveCheckpoint(checkpointFile, false);
+			checkpointFile.flush();
+			stepsSinceCheckpoint = 0;
+		}
+	}
+
+	if (profile != nullptr) {
+		std::ofstream heatmapFile(heatmapPath);
+		profile->Report(*process.GetMemoryMap(), heatmapFile);
 	}
 
 	std::cout << "Process exited with code, ";
 	std::cout << std::hex << std::setfill('0') << std::setw(8);
 	std::cout << process.GetExitCode();
 	std::cout << std::endl;
+
+	if (printSyscallStats)
+		PrintSyscallStats(*syscallStats);
 }
 
 } // namespace
@@ -82,6 +281,50 @@ int main(int argc, const char **argv) {
 		 || (std::strcmp(argv[argi], "-h") == 0)) {
 			PrintHelp();
 			return EXIT_FAILURE;
+		} else if (std::strcmp(argv[argi], "--checkpoint") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Checkpoint path not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			checkpointPath = argv[++argi];
+		} else if (std::strcmp(argv[argi], "--checkpoint-interval") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Checkpoint interval not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			checkpointInterval = (uint32_t) std::strtoul(argv[++argi], nullptr, 10);
+		} else if (std::strcmp(argv[argi], "--restore") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Checkpoint path not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			restorePath = argv[++argi];
+		} else if (std::strcmp(argv[argi], "--heatmap") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Heatmap path not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			heatmapPath = argv[++argi];
+		} else if (std::strcmp(argv[argi], "--persistent") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Run count not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			persistentRuns = (uint32_t) std::strtoul(argv[++argi], nullptr, 10);
+		} else if (std::strcmp(argv[argi], "--sample-interval") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Sample interval not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			sampleInterval = (uint32_t) std::strtoul(argv[++argi], nullptr, 10);
+		} else if (std::strcmp(argv[argi], "--syscall-stats") == 0) {
+			printSyscallStats = true;
+		} else if (std::strcmp(argv[argi], "--threads") == 0) {
+			if ((argi + 1) >= argc) {
+				std::cerr << "Thread count not given." << std::endl;
+				return EXIT_FAILURE;
+			}
+			threadCount = (uint32_t) std::strtoul(argv[++argi], nullptr, 10);
 		} else if (argv[argi][0] == '-') {
 			std::cerr << "Unknown option '" << argv[argi] << "'" << std::endl;
 			return EXIT_FAILURE;
@@ -90,10 +333,19 @@ int main(int argc, const char **argv) {
 		}
 	}
 
+	// Checkpoints and rollbacks both rely on
+	// the dirty flags of memory, and a heatmap
+	// would only cover the first run.
+
+	if ((persistentRuns > 0) && (!checkpointPath.empty() || !heatmapPath.empty())) {
+		std::cerr << "Persistent mode can't be used with checkpoints or heatmaps." << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	try {
 		Run(argc - argi, &argv[argi]);
 	} catch (const swanson::Exception &exception) {
-		std::cerr << argv[argi] << ": ";
+		std::cerr << ((argi < argc) ? argv[argi] : argv[0]) << ": ";
 		std::cerr << exception.What() << std::endl;
 		return EXIT_FAILURE;
 	}
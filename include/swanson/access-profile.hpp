@@ -0,0 +1,154 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_ACCESS_PROFILE_HPP
+#define SWANSON_ACCESS_PROFILE_HPP
+
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class MemoryMap;
+class MemorySection;
+
+/// The kinds of memory accesses
+/// that are counted by a profile.
+enum class AccessType {
+	/// A data read.
+	Read,
+	/// A data write.
+	Write,
+	/// An instruction fetch.
+	Execute
+};
+
+/// The number of accesses counted
+/// on a single page of guest memory.
+class PageHeat final {
+public:
+	/// The address of the page.
+	uint32_t address;
+	/// The number of reads counted.
+	uint64_t reads;
+	/// The number of writes counted.
+	uint64_t writes;
+	/// The number of instruction
+	/// fetches counted.
+	uint64_t executes;
+	/// The last window that the
+	/// page was accessed in.
+	uint64_t lastWindow;
+	/// Default constructor
+	PageHeat() noexcept : address(0), reads(0), writes(0), executes(0), lastWindow(0) { }
+	/// Get the total number of accesses counted.
+	/// @returns The total number of accesses.
+	uint64_t GetTotal() const noexcept { return reads + writes + executes; }
+};
+
+/// Counts memory accesses for each page of a
+/// memory map. Accesses may be sampled, so that
+/// only one in every few accesses is counted, to
+/// keep the cost of profiling low. The number of
+/// distinct pages touched is also kept for windows
+/// of accesses, as an estimate of the working set.
+class AccessProfile final {
+	/// The access counts, indexed by page number.
+	std::unordered_map<uint32_t, PageHeat> pages;
+	/// The number of pages touched in each
+	/// of the windows that have ended.
+	std::vector<uint64_t> workingSets;
+	/// One in this many accesses is counted.
+	uint32_t sampleInterval;
+	/// The number of accesses left
+	/// until the next sample.
+	uint32_t sampleCountdown;
+	/// The number of accesses in a window,
+	/// or zero if windows are ended by hand.
+	uint64_t windowLength;
+	/// The number of accesses made
+	/// in the current window.
+	uint64_t windowAccesses;
+	/// The index of the current window.
+	/// The first window has an index of one.
+	uint64_t window;
+	/// The number of distinct pages touched
+	/// in the current window.
+	uint64_t workingSet;
+public:
+	/// The size of a page, in bytes.
+	static constexpr uint32_t pageSize = 0x1000;
+	/// Default constructor
+	AccessProfile() noexcept;
+	/// Default deconstructor
+	~AccessProfile() { }
+	/// End the current window and start
+	/// counting the working set of a new one.
+	void EndWindow();
+	/// Get the access counts of the pages in
+	/// a memory section that have been touched.
+	/// @param section The section to get the counts for.
+	/// @returns The access counts, ordered by address.
+	std::vector<PageHeat> GetHeatmap(const MemorySection &section) const;
+	/// Get the number of distinct pages touched
+	/// in each of the windows that have ended.
+	/// @returns The working set of each window.
+	const auto &GetWorkingSets() const noexcept { return workingSets; }
+	/// Get the number of distinct pages
+	/// touched in the current window.
+	/// @returns The current working set.
+	auto GetWorkingSet() const noexcept { return workingSet; }
+	/// Get the sample interval.
+	/// @returns The sample interval.
+	auto GetSampleInterval() const noexcept { return sampleInterval; }
+	/// Count a memory access. This is called by
+	/// the memory map for every access made to it.
+	/// @param addr The address that was accessed.
+	/// @param type The type of access.
+	void Record(uint32_t addr, AccessType type) {
+		if (--sampleCountdown == 0)
+			Sample(addr, type);
+		if ((windowLength != 0) && (++windowAccesses >= windowLength))
+			EndWindow();
+	}
+	/// Write the heatmap of every section in a
+	/// memory map, followed by the working set of
+	/// each window, as comma separated values.
+	/// @param memoryMap The memory map that was profiled.
+	/// @param output The stream to write the report to.
+	void Report(const MemoryMap &memoryMap, std::ostream &output) const;
+	/// Set the number of accesses for each sample.
+	/// @param interval One in this many accesses is
+	/// counted. An interval of one counts every access.
+	void SetSampleInterval(uint32_t interval) noexcept;
+	/// Set the number of accesses in a window.
+	/// @param length The number of accesses in
+	/// a window, or zero to end windows by hand.
+	void SetWindowLength(uint64_t length) noexcept { windowLength = length; }
+protected:
+	/// Count a sampled memory access.
+	/// @param addr The address that was accessed.
+	/// @param type The type of access.
+	void Sample(uint32_t addr, AccessType type);
+};
+
+} // namespace swanson
+
+#endif // SWANSON_ACCESS_PROFILE_HPP
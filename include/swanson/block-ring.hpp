@@ -0,0 +1,128 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_BLOCK_RING_HPP
+#define SWANSON_BLOCK_RING_HPP
+
+#include <swanson/process.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class MemoryMap;
+class Stream;
+
+/// A block device that guests drive through
+/// a ring of requests in their own memory, instead
+/// of a system call for each transfer. The guest
+/// queues any number of sector reads and writes,
+/// then makes one block ring call to have them all
+/// served. The data is copied straight between the
+/// disk and guest memory. The layout of the ring is
+/// described along with @ref syscalls::block_ring.
+class BlockRing final {
+public:
+	/// The most bytes of buffers that a batch
+	/// copies. A ring with more waiting than this
+	/// is served over more than one call.
+	static constexpr uint32_t maxBatchSize = 0x1000000;
+	/// The requests of a ring, copied out of guest
+	/// memory so that they may be served by a host
+	/// thread that the guest doesn't wait for. It's
+	/// defined in the source file.
+	struct Batch;
+private:
+	/// The disk that requests are served from.
+	std::shared_ptr<Stream> disk;
+	/// Held while requests are served, since
+	/// they move the position of the disk.
+	std::mutex mutex;
+	/// Whether or not write requests are refused.
+	bool readOnly;
+public:
+	/// Make a system call handler that serves the
+	/// rings of a set of devices. The first argument
+	/// of the call is the index of the device. If the
+	/// process has I/O workers, the requests are copied
+	/// with @ref Prepare and served on them, while the
+	/// calling thread is blocked.
+	/// @param devices The devices that may be used.
+	/// @returns The system call handler.
+	static Process::SyscallHandler MakeHandler(std::vector<std::shared_ptr<BlockRing>> devices);
+	/// Constructs a new block ring device.
+	/// @param disk_ The disk to serve requests from.
+	/// @param readOnly_ If true, write requests complete
+	/// with the read-only error. Read-only devices may be
+	/// shared by the kernels of several tenants.
+	BlockRing(std::shared_ptr<Stream> disk_, bool readOnly_ = false) noexcept;
+	/// Write the results of a batch back to the ring
+	/// and to the buffers of its reads. Requests whose
+	/// buffers were unmapped in the meantime complete
+	/// with the fault error. This is called by a thread
+	/// of the process, inside of the world lock.
+	/// @param memoryMap The memory map of the ring.
+	/// @param batch The batch that was served.
+	/// @returns The number of requests served, or the
+	/// result of an error if the ring can't be accessed.
+	uint32_t Finish(MemoryMap &memoryMap, const Batch &batch);
+	/// Get the disk that requests are served from.
+	/// @returns The disk of the device.
+	const auto &GetDisk() const noexcept { return disk; }
+	/// Indicates whether or not write
+	/// requests are refused.
+	/// @returns True if the device is read-only.
+	auto IsReadOnly() const noexcept { return readOnly; }
+	/// Copy the requests of a ring that were submitted
+	/// and aren't yet completed, along with the data
+	/// that they write. This is called by the thread
+	/// that submitted them, so that the memory layout
+	/// can't change while the ring is read. Requests
+	/// that can't be served get their error now.
+	/// @param memoryMap The memory map of the ring.
+	/// @param address The guest address of the ring.
+	/// @param result Set to the result of an error, if
+	/// the ring itself isn't valid or can't be accessed.
+	/// @returns The batch, or nullptr on an error.
+	std::shared_ptr<Batch> Prepare(MemoryMap &memoryMap, uint32_t address, uint32_t &result);
+	/// Serve every request of a ring that was
+	/// submitted and isn't yet completed. Requests
+	/// whose buffers can't be accessed complete with
+	/// the fault error, and those that the disk fails
+	/// complete with the I/O error. The thread that
+	/// submitted them must not run until this returns.
+	/// @param memoryMap The memory map that the
+	/// ring and its buffers are in.
+	/// @param address The guest address of the ring.
+	/// @returns The number of requests served, or
+	/// the result of an error if the ring itself
+	/// is not valid or can't be accessed.
+	uint32_t Serve(MemoryMap &memoryMap, uint32_t address);
+	/// Serve the requests of a batch against the
+	/// disk, using only host memory. This may be
+	/// called from any host thread.
+	/// @param batch The batch to serve.
+	void Transfer(Batch &batch);
+};
+
+} // namespace swanson
+
+#endif // SWANSON_BLOCK_RING_HPP
@@ -0,0 +1,203 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_CONSOLE_HPP
+#define SWANSON_CONSOLE_HPP
+
+#include <swanson/stream.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class ConsoleStream;
+
+/// The host side of the standard streams of
+/// the guest processes. Each process writes to
+/// buffers of its own, which are handed to a host
+/// thread once they're full (or once a line ends,
+/// depending on the mode.) The thread writes them
+/// to the host, gathering what's queued for each
+/// file descriptor into one call. This keeps the
+/// threads that run guests from waiting on the
+/// host's terminal or pipes, and keeps the output
+/// of one process together.
+class Console final : public std::enable_shared_from_this<Console> {
+public:
+	/// Determines when the buffer
+	/// of a stream is written out.
+	enum class Mode {
+		/// Every write is passed on
+		/// to the host as it's made.
+		Unbuffered,
+		/// The buffer is written out at the
+		/// end of each line, or when it's full.
+		Line,
+		/// The buffer is only written
+		/// out when it's full.
+		Block
+	};
+	/// The size of a stream buffer. Buffers
+	/// are written out once they reach it.
+	static constexpr uint64_t blockSize = 0x1000;
+protected:
+	/// Data that's ready to be
+	/// written to the host.
+	class Chunk final {
+	public:
+		/// The host file descriptor
+		/// to write the data to.
+		int fd;
+		/// The data to write.
+		std::vector<unsigned char> data;
+	};
+	/// Guards the members below.
+	std::mutex mutex;
+	/// Signaled when a chunk is queued,
+	/// or when the console is stopping.
+	std::condition_variable chunkReady;
+	/// Signaled when the queue
+	/// has been written out.
+	std::condition_variable drained;
+	/// The chunks that are waiting
+	/// to be written, in order.
+	std::deque<Chunk> chunks;
+	/// The mode given to the streams
+	/// opened for each host file descriptor.
+	std::map<int, Mode> modes;
+	/// The streams that have been opened,
+	/// so that they may all be flushed.
+	std::vector<std::weak_ptr<ConsoleStream>> streams;
+	/// Set while the host thread is
+	/// writing chunks out of the queue.
+	bool writing;
+	/// Set when the console is destroyed.
+	bool stopping;
+	/// The host thread that writes
+	/// the chunks out.
+	std::thread writer;
+public:
+	/// Starts the host thread. Standard output
+	/// is line buffered and standard error is
+	/// unbuffered, until changed with @ref SetMode.
+	Console();
+	/// Writes out the chunks that were
+	/// queued, then joins the host thread.
+	/// Streams that are still open should
+	/// be flushed before this is called.
+	~Console();
+	/// Consoles may not be copied.
+	Console(const Console &) = delete;
+	/// Consoles may not be copied.
+	Console &operator = (const Console &) = delete;
+	/// Write out the buffers of all the
+	/// streams, then wait for the host
+	/// thread to write them.
+	void Flush();
+	/// Open a stream that writes to
+	/// a host file descriptor.
+	/// @param fd The host file descriptor.
+	/// @returns The new stream. It's given the
+	/// mode that's set for the file descriptor.
+	std::shared_ptr<ConsoleStream> Open(int fd);
+	/// Set the mode of the streams that are
+	/// opened for a host file descriptor
+	/// afterwards.
+	/// @param fd The host file descriptor.
+	/// @param mode The mode of the streams.
+	void SetMode(int fd, Mode mode);
+	/// Queue data to be written to the host.
+	/// This is what the streams call when
+	/// their buffers are written out.
+	/// @param fd The host file descriptor.
+	/// @param data The data to write.
+	void Submit(int fd, std::vector<unsigned char> data);
+	/// Wait until the host thread has written
+	/// everything that's been queued. Buffers
+	/// that haven't been handed over aren't written.
+	void Wait();
+protected:
+	/// Write chunks until the console stops.
+	void Work();
+	/// Write a batch of chunks to the host.
+	/// Consecutive chunks for the same file
+	/// descriptor are written with one call.
+	/// @param batch The chunks to write.
+	static void WriteChunks(std::deque<Chunk> &batch);
+};
+
+/// A stream that writes to the host
+/// through a @ref Console. The stream
+/// keeps a buffer, which is handed to the
+/// console according to the stream's mode.
+/// Data written to one stream stays in order.
+class ConsoleStream final : public Stream {
+	/// The console that the buffer
+	/// is handed to.
+	std::shared_ptr<Console> console;
+	/// The host file descriptor.
+	int fd;
+	/// When the buffer is written out.
+	Console::Mode mode;
+	/// Guards the buffer, since a stream
+	/// may be shared by several processes.
+	std::mutex mutex;
+	/// The data that hasn't been
+	/// handed to the console yet.
+	std::vector<unsigned char> buffer;
+public:
+	/// Constructs the stream.
+	/// @param console_ The console that
+	/// the data is handed to.
+	/// @param fd_ The host file descriptor.
+	/// @param mode_ When the buffer is written out.
+	ConsoleStream(std::shared_ptr<Console> console_, int fd_, Console::Mode mode_);
+	/// Flushes the buffer.
+	~ConsoleStream();
+	/// Hand the buffer to the console.
+	void Flush() override;
+	/// Get the host file descriptor
+	/// that the stream writes to.
+	/// @returns The host file descriptor.
+	auto GetFD() const noexcept { return fd; }
+	/// Get the mode of the stream.
+	/// @returns The mode of the stream.
+	auto GetMode() const noexcept { return mode; }
+	/// Console streams may not be read.
+	/// This throws an exception.
+	void Read(void *buf, uint64_t bufSize) override;
+	/// Console streams have no position.
+	/// This throws an exception.
+	void SetPosition(uint64_t position) override;
+	/// Add data to the buffer, and hand the
+	/// buffer to the console if the mode says so.
+	/// @param buf The data to write.
+	/// @param bufSize The number of bytes to write.
+	void Write(const void *buf, uint64_t bufSize) override;
+};
+
+} // namespace swanson
+
+#endif // SWANSON_CONSOLE_HPP
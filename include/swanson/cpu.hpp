@@ -18,6 +18,7 @@
 #ifndef SWANSON_CPU_HPP
 #define SWANSON_CPU_HPP
 
+#include <atomic>
 #include <memory>
 
 #include <cstdint>
@@ -37,12 +38,17 @@ class CPU final {
 	std::shared_ptr<InterruptHandler> interruptHandler;
 	/// General-purpose registers.
 	uint32_t regs[18];
-	/// Special-purpose registers.
-	uint32_t sregs[256];
+	/// Special-purpose registers. Few programs
+	/// use them, so they're only allocated once
+	/// one is set to something other than zero.
+	std::unique_ptr<uint32_t[]> sregs;
 	/// Condition register
 	uint32_t condition;
 	/// Instruction counter.
 	uintmax_t instructionCount;
+	/// Set when the current call to
+	/// @ref Step should return early.
+	std::atomic<bool> yielding;
 public:
 	/// Default constructor
 	CPU() noexcept;
@@ -61,6 +67,15 @@ public:
 	/// @param index The index of the register.
 	/// @returns The value of the specified register.
 	uint32_t GetRegister(uint32_t index) const noexcept;
+	/// Get the value of a special-purpose register.
+	/// There are 256 special-purpose registers.
+	/// @param index The index of the register.
+	/// @returns The value of the specified register.
+	uint32_t GetSpecialRegister(uint8_t index) const noexcept { return sregs ? sregs[index] : 0; }
+	/// Get the number of instructions that
+	/// the CPU has executed.
+	/// @returns The instruction count.
+	auto GetInstructionCount() const noexcept { return instructionCount; }
 	/// Get the current frame pointer address.
 	/// @returns The current frame pointer address.
 	auto GetFramePointer() const noexcept { return regs[0]; }
@@ -91,6 +106,15 @@ public:
 	/// @param index The index of the register.
 	/// @param value The value to assign the register.
 	void SetRegister(uint32_t index, uint32_t value) noexcept;
+	/// Set the value of a special-purpose register.
+	/// @param index The index of the register.
+	/// @param value The value to assign the register.
+	void SetSpecialRegister(uint8_t index, uint32_t value);
+	/// Set the number of instructions that the
+	/// CPU has executed. This is used when a
+	/// CPU is restored from a checkpoint.
+	/// @param count The new instruction count.
+	void SetInstructionCount(uintmax_t count) noexcept { instructionCount = count; }
 	/// Set the stack pointer address. This should be an address
 	/// that may be read from or written to.
 	/// @param addr The new address of the stack pointer.
@@ -108,9 +132,19 @@ public:
 	/// @param interruptHandler_ The new interrupt handler.
 	void SetInterruptHandler(std::shared_ptr<InterruptHandler> interruptHandler_) noexcept;
 	/// Execute a certain number of instructions.
+	/// System calls don't end the call, unless
+	/// the interrupt handler calls @ref Yield.
 	/// @param steps The number of instructions
 	/// to execute.
-	void Step(uint32_t steps);
+	/// @returns The number of instructions
+	/// that were executed.
+	uint32_t Step(uint32_t steps);
+	/// End the current call to @ref Step once the
+	/// instruction that's executing is finished.
+	/// This may be called from any host thread. If
+	/// the CPU isn't running, the next call to
+	/// @ref Step returns without executing anything.
+	void Yield() noexcept { yielding.store(true, std::memory_order_relaxed); }
 protected:
 	/// Handle a bad instruction.
 	void HandleBadInstruction();
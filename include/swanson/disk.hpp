@@ -54,19 +54,25 @@ public:
 	/// with the disk data.
 	/// @param bufSize The number of
 	/// bytes to read from the disk.
-	void Read(void *buf, uint64_t bufSize);
+	void Read(void *buf, uint64_t bufSize) override;
+	/// Read data from the disk, stopping
+	/// at the end of the disk file.
+	/// @param buf The buffer to put the data in.
+	/// @param bufSize The most bytes to read.
+	/// @returns The number of bytes read.
+	uint64_t ReadSome(void *buf, uint64_t bufSize) override;
 	/// Set the position of the next
 	/// read or write operation.
 	/// @param pos The position of
 	/// the next IO operation.
-	void SetPosition(uint64_t pos);
+	void SetPosition(uint64_t pos) override;
 	/// Write data to the disk, at the
 	/// current disk position.
 	/// @param buf The buffer containing
 	/// the data to write to disk.
 	/// @param bufSize The number of bytes
 	/// to write to the disk.
-	void Write(const void *buf, uint64_t bufSize);
+	void Write(const void *buf, uint64_t bufSize) override;
 };
 
 } // namespace swanson
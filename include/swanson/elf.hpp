@@ -152,6 +152,9 @@ public:
 	/// Get the entry point of the ELF executable.
 	/// @returns The 32-bit address of the entry point.
 	auto GetEntryPoint() const noexcept { return entryPoint; }
+	/// Set the entry point of the ELF executable.
+	/// @param entryPoint_ The 32-bit address of the entry point.
+	void SetEntryPoint(uint32_t entryPoint_) noexcept { entryPoint = entryPoint_; }
 	/// Get the number of segments in the file.
 	/// @returns The number of segments in the file.
 	auto GetSegmentCount() { return segments.size(); }
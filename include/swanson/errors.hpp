@@ -0,0 +1,101 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_ERRORS_HPP
+#define SWANSON_ERRORS_HPP
+
+#include <cstdint>
+
+/// Error numbers returned by system calls.
+/// A system call that fails returns the negated
+/// error number in the first return register.
+namespace swanson::errors {
+
+/// Operation not permitted.
+constexpr uint32_t perm = 1;
+
+/// No such file or directory.
+constexpr uint32_t noent = 2;
+
+/// Input/output error.
+constexpr uint32_t io = 5;
+
+/// Argument list too long.
+constexpr uint32_t toobig = 7;
+
+/// Exec format error.
+constexpr uint32_t noexec = 8;
+
+/// Bad file descriptor.
+constexpr uint32_t badf = 9;
+
+/// Resource temporarily unavailable.
+constexpr uint32_t again = 11;
+
+/// Out of memory.
+constexpr uint32_t nomem = 12;
+
+/// Permission denied.
+constexpr uint32_t acces = 13;
+
+/// Bad address.
+constexpr uint32_t fault = 14;
+
+/// File exists.
+constexpr uint32_t exist = 17;
+
+/// No such device.
+constexpr uint32_t nodev = 19;
+
+/// Invalid argument.
+constexpr uint32_t inval = 22;
+
+/// Illegal seek.
+constexpr uint32_t spipe = 29;
+
+/// Read-only file system.
+constexpr uint32_t rofs = 30;
+
+/// Broken pipe.
+constexpr uint32_t pipe = 32;
+
+/// Function not implemented.
+constexpr uint32_t nosys = 38;
+
+/// Value too large for defined data type.
+constexpr uint32_t overflow = 75;
+
+/// Convert an error number into the value
+/// that a failed system call returns.
+/// @param error The error number.
+/// @returns The negated error number.
+constexpr uint32_t ToResult(uint32_t error) noexcept {
+	return (uint32_t) -((int32_t) error);
+}
+
+/// Indicates whether or not the result of a
+/// system call is an error. As on Linux, the
+/// results from -4095 to -1 are errors.
+/// @param result The result of the system call.
+/// @returns True if the result is an error.
+constexpr bool IsError(uint32_t result) noexcept {
+	return result >= ToResult(4095);
+}
+
+} // namespace swanson::errors
+
+#endif // SWANSON_ERRORS_HPP
@@ -0,0 +1,180 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_HOST_MAPPING_HPP
+#define SWANSON_HOST_MAPPING_HPP
+
+#include <memory>
+#include <string>
+
+#include <cstdint>
+
+namespace swanson {
+
+/// A region of host memory that a memory
+/// section may view without owning. This is
+/// either a host memory mapping of a file, or
+/// a buffer that belongs to some other object
+/// (like a file in a ram file system.)
+class HostMapping final {
+	/// The first byte of the region.
+	unsigned char *data;
+	/// The number of bytes in the region.
+	uint32_t size;
+	/// The number of bytes that the region
+	/// may grow to without moving.
+	uint32_t capacity;
+	/// The number of bytes that have been
+	/// made accessible by the host. Only
+	/// reserved regions commit memory lazily.
+	uint64_t committedSize;
+	/// The number of bytes that were mapped
+	/// with the host. This is zero if the
+	/// region was not mapped by this class.
+	uint64_t mappedSize;
+	/// Whether or not the host allows the
+	/// region to be written to.
+	bool writable;
+	/// Whether or not writes to the region
+	/// are visible to other users of the
+	/// underlying object.
+	bool shared;
+	/// Keeps the owner of a borrowed
+	/// buffer alive for as long as the
+	/// mapping exists.
+	std::shared_ptr<void> owner;
+public:
+	/// Map a file from the host file system.
+	/// @param path The path of the file on the host.
+	/// @param offset The offset of the file to start
+	/// the mapping at. This must be a multiple of the
+	/// host page size.
+	/// @param size The number of bytes to map.
+	/// @param writable Whether or not the mapping
+	/// may be written to.
+	/// @param shared If true, writes are carried through
+	/// to the file. If false, writes are private to the
+	/// mapping.
+	/// @returns The new mapping.
+	static std::shared_ptr<HostMapping> MapFile(const std::string &path,
+	                                            uint64_t offset,
+	                                            uint32_t size,
+	                                            bool writable,
+	                                            bool shared);
+	/// Map a file from the host privately, into a
+	/// region that may grow in place like one made
+	/// by @ref Reserve. Writes are never carried
+	/// through to the file. The file must cover
+	/// every host page that the mapping touches.
+	/// @param path The path of the file on the host.
+	/// @param offset The offset of the file to start
+	/// the mapping at. This must be a multiple of the
+	/// host page size.
+	/// @param size The number of bytes to map.
+	/// @param capacity The largest size that the
+	/// region may grow to. The part past the file
+	/// data reads as zeros.
+	/// @returns The new mapping.
+	static std::shared_ptr<HostMapping> MapFilePrivate(const std::string &path,
+	                                                   uint64_t offset,
+	                                                   uint32_t size,
+	                                                   uint32_t capacity);
+	/// Map zero-filled memory from the host.
+	/// @param size The number of bytes to map.
+	/// @returns The new mapping.
+	static std::shared_ptr<HostMapping> MapAnonymous(uint32_t size);
+	/// Reserve a range of host addresses that
+	/// may grow in place. Host memory is only
+	/// committed as the region grows, so the
+	/// reservation itself costs address space only.
+	/// @param capacity The largest size that
+	/// the region may grow to.
+	/// @returns The new mapping, with a size of zero.
+	static std::shared_ptr<HostMapping> Reserve(uint32_t capacity);
+	/// Create a mapping of a buffer that is
+	/// owned by another object. No data is copied.
+	/// @param data The buffer to view.
+	/// @param size The number of bytes in the buffer.
+	/// @param writable Whether or not the buffer
+	/// may be written to.
+	/// @param owner The object that owns the buffer.
+	/// It's kept alive until the mapping is released.
+	/// @returns The new mapping.
+	static std::shared_ptr<HostMapping> Borrow(void *data,
+	                                           uint32_t size,
+	                                           bool writable,
+	                                           std::shared_ptr<void> owner);
+	/// Get the size of a host page. File
+	/// mappings start at multiples of it.
+	/// @returns The host page size, in bytes.
+	static uint32_t GetPageSize() noexcept;
+	/// Default constructor
+	HostMapping() noexcept;
+	/// Releases the host mapping, if
+	/// the region was mapped by this class.
+	~HostMapping();
+	/// Mappings refer to a unique
+	/// region and may not be copied.
+	HostMapping(const HostMapping &) = delete;
+	/// Mappings refer to a unique
+	/// region and may not be copied.
+	HostMapping &operator = (const HostMapping &) = delete;
+	/// Indicates whether or not the host memory
+	/// of the region may be released with @ref Discard.
+	/// This is only the case for private, writable
+	/// regions that were mapped by this class.
+	/// @returns True if the region may be discarded.
+	bool CanDiscard() const noexcept;
+	/// Release the host memory of part of the
+	/// region. The range reads as zeros (or as
+	/// the mapped file) afterwards, until it's
+	/// written to again.
+	/// @param offset The offset of the range. This
+	/// must be a multiple of the host page size.
+	/// @param length The number of bytes to release.
+	/// This must be a multiple of the host page size.
+	/// @returns True if the memory was released.
+	bool Discard(uint32_t offset, uint32_t length) noexcept;
+	/// Get a pointer to the first byte of the region.
+	/// @returns A pointer to the region.
+	auto GetData() const noexcept { return data; }
+	/// Get the number of bytes in the region.
+	/// @returns The size of the region.
+	auto GetSize() const noexcept { return size; }
+	/// Get the number of bytes that the
+	/// region may grow to without moving.
+	/// @returns The capacity of the region.
+	auto GetCapacity() const noexcept { return capacity; }
+	/// Grow or shrink the region in place.
+	/// Only reserved regions may grow, and
+	/// they may not grow past their capacity.
+	/// The address of the region never changes.
+	/// @param size_ The new size of the region.
+	void Resize(uint32_t size_);
+	/// Indicates whether or not the region
+	/// may be written to by the host.
+	/// @returns True if the region is writable.
+	auto IsWritable() const noexcept { return writable; }
+	/// Indicates whether or not writes to the
+	/// region are shared with the underlying object.
+	/// @returns True if the region is shared.
+	auto IsShared() const noexcept { return shared; }
+};
+
+} // namespace swanson
+
+#endif // SWANSON_HOST_MAPPING_HPP
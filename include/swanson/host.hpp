@@ -0,0 +1,149 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_HOST_HPP
+#define SWANSON_HOST_HPP
+
+#include <swanson/exit-code.hpp>
+
+#include "fs/ramfs/fs.h"
+
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class BlockRing;
+class Disk;
+class ImageCache;
+class Kernel;
+class Scheduler;
+class SchedulerEvent;
+
+/// Runs the kernels of many tenants in one host
+/// process. The kernels share what never changes
+/// once it's loaded: the decoded initial ram file
+/// system, the decoded ELF images and read-only disks.
+/// Their processes all run on one scheduler, so the
+/// host threads are shared too. Each kernel keeps its
+/// own processes, memory limits, system call counters
+/// and CPU time, and a tenant that faults doesn't
+/// stop the others.
+class Host final {
+	/// A kernel and what became of it.
+	class Tenant final {
+	public:
+		/// The kernel of the tenant.
+		std::shared_ptr<Kernel> kernel;
+		/// Set while the first process
+		/// of the kernel is running.
+		bool running;
+		/// The exit code of @ref Kernel::Start,
+		/// if the kernel couldn't be started.
+		ExitCode exitCode;
+		/// The exception that the first process
+		/// of the kernel threw, if it faulted.
+		std::exception_ptr fault;
+	};
+	/// Runs the processes of every tenant.
+	std::shared_ptr<Scheduler> scheduler;
+	/// The decoded images, shared by every tenant.
+	std::shared_ptr<ImageCache> imageCache;
+	/// The initial ram file system given to
+	/// new tenants, or nullptr if none was loaded.
+	std::shared_ptr<const ramfs> initramfs;
+	/// The read-only block ring devices
+	/// that are given to new tenants.
+	std::vector<std::shared_ptr<BlockRing>> blockRings;
+	/// The tenants, in the order they were added.
+	std::vector<Tenant> tenants;
+public:
+	/// Start the host threads that
+	/// run the processes of the tenants.
+	/// @param workerCount The number of host threads.
+	/// If this is zero, one is started for each core.
+	Host(unsigned int workerCount = 0);
+	/// Stops the host threads. The kernels are
+	/// released once nothing else refers to them.
+	~Host();
+	/// Hosts may not be copied.
+	Host(const Host &) = delete;
+	/// Hosts may not be copied.
+	Host &operator = (const Host &) = delete;
+	/// Add a disk that tenants may only read from.
+	/// Tenants added afterwards get its block ring
+	/// device, and share it with each other.
+	/// @param disk The disk to add.
+	void AddDisk(std::shared_ptr<Disk> disk);
+	/// Add a tenant. Its kernel is given the shared
+	/// resources of the host, and may be configured
+	/// further (with a root file system, memory limits
+	/// and so on) before @ref Run is called. Its
+	/// scheduler must not be changed.
+	/// @returns The kernel of the tenant.
+	std::shared_ptr<Kernel> AddTenant();
+	/// Get the exception that the first process
+	/// of a tenant threw, if it faulted.
+	/// @param index The index of the tenant.
+	/// @returns The exception, or nullptr if
+	/// the process didn't fault.
+	std::exception_ptr GetFault(size_t index) const;
+	/// Get the image cache that
+	/// the tenants share.
+	/// @returns The image cache.
+	const auto &GetImageCache() const noexcept { return imageCache; }
+	/// Get the kernel of a tenant.
+	/// @param index The index of the tenant.
+	/// @returns The kernel of the tenant.
+	std::shared_ptr<Kernel> GetKernel(size_t index) const;
+	/// Get the scheduler that runs
+	/// the processes of the tenants.
+	/// @returns The scheduler.
+	const auto &GetScheduler() const noexcept { return scheduler; }
+	/// Get the number of tenants.
+	/// @returns The number of tenants.
+	auto GetTenantCount() const noexcept { return tenants.size(); }
+	/// Decode the initial ram file system once,
+	/// for every tenant that's added afterwards.
+	/// @param addr The address of the ramdisk data.
+	/// @param size The number of bytes contained by
+	/// the ramdisk.
+	void LoadInitRamfs(const void *addr, uintmax_t size);
+	/// Start every tenant, and run them until the
+	/// first process of each one has exited. A tenant
+	/// is stopped once its first process exits, and
+	/// the processes that it has left are killed.
+	/// @returns The number of tenants that couldn't
+	/// be started or whose first process faulted.
+	size_t Run();
+protected:
+	/// Pass an event of the scheduler
+	/// on to the tenant that it's for.
+	/// @param event The event to pass on.
+	void Dispatch(const SchedulerEvent &event);
+	/// Indicates whether or not any tenant
+	/// still has processes to wait for.
+	/// @returns True if a tenant has processes.
+	bool HasLiveTenants() const noexcept;
+};
+
+} // namespace swanson
+
+#endif // SWANSON_HOST_HPP
@@ -105,11 +105,12 @@ public:
 	std::shared_ptr<vfs::Directory> GetRoot() override;
 	/// Open a file on the host system.
 	/// @param path The path of the file on the host system.
+	/// @param mode The mode to open the file in.
 	/// @param stream The pointer that will be assigned the stream
 	/// that will write to and read from the file on the host system.
 	/// @returns The exit code most similar to that
 	/// of the system call.
-	ExitCode OpenFile(const std::string &path, std::shared_ptr<Stream> &stream) override;
+	ExitCode OpenFile(const std::string &path, uint32_t mode, std::shared_ptr<Stream> &stream) override;
 	/// @param path The path on the host system of
 	/// the new root directory.
 	void SetRoot(const std::string &path);
@@ -0,0 +1,99 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_IMAGE_CACHE_HPP
+#define SWANSON_IMAGE_CACHE_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <cstdint>
+
+namespace swanson {
+
+class Stream;
+
+namespace elf {
+
+class File;
+
+} // namespace elf
+
+/// Decoded ELF images, shared by every process
+/// that runs the same binary. An image is keyed
+/// by its path and a hash of its contents, so a
+/// binary that's replaced on disk is decoded again
+/// while one that isn't is only decoded once.
+/// Images are never modified after they're
+/// decoded, so their read-only segments may be
+/// viewed by processes without being copied.
+class ImageCache final {
+	/// An image that was decoded
+	/// from a particular path.
+	class Entry final {
+	public:
+		/// The hash of the file contents.
+		uint64_t hash;
+		/// The number of bytes that were hashed.
+		uint64_t size;
+		/// The decoded image.
+		std::shared_ptr<const elf::File> image;
+	};
+	/// Guards the entries, since
+	/// processes exec concurrently.
+	std::mutex mutex;
+	/// The most recent image of each path.
+	std::map<std::string, Entry> entries;
+	/// The number of loads that were
+	/// served by a cached image.
+	uint64_t hitCount;
+	/// The number of loads that
+	/// had to decode the file.
+	uint64_t missCount;
+public:
+	/// Constructs an empty cache.
+	ImageCache() noexcept;
+	/// Get the image of an ELF file. The file is
+	/// read and hashed, but only decoded if the
+	/// path has no image with the same contents.
+	/// @param path The path that the file was
+	/// opened from.
+	/// @param stream The contents of the file.
+	/// @returns The image of the file, or nullptr
+	/// if the file isn't a valid ELF file.
+	std::shared_ptr<const elf::File> Load(const std::string &path, Stream &stream);
+	/// Drop every image. Processes that
+	/// are running an image keep it alive.
+	void Clear();
+	/// Get the number of loads that
+	/// were served by a cached image.
+	/// @returns The number of cache hits.
+	uint64_t GetHitCount();
+	/// Get the number of loads
+	/// that decoded their file.
+	/// @returns The number of cache misses.
+	uint64_t GetMissCount();
+	/// Get the number of cached images.
+	/// @returns The number of images.
+	size_t GetSize();
+};
+
+} // namespace swanson
+
+#endif /* SWANSON_IMAGE_CACHE_HPP */
@@ -0,0 +1,97 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_IO_WORKERS_HPP
+#define SWANSON_IO_WORKERS_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swanson {
+
+/// A pool of host threads that run the I/O of
+/// guest system calls, so that the host threads
+/// running guests don't wait on the host. Each job
+/// is submitted with a key, which is usually the
+/// stream that it uses. Jobs with the same key run
+/// one at a time, in the order they were submitted,
+/// and jobs with different keys run at once.
+class IOWorkers final {
+	/// A job that is ready to run.
+	class Job final {
+	public:
+		/// The key that the job was submitted with.
+		const void *key;
+		/// The function to call.
+		std::function<void()> function;
+	};
+	/// The host threads of the pool.
+	std::vector<std::thread> workers;
+	/// Guards the queues below.
+	std::mutex mutex;
+	/// Signaled when a job is ready,
+	/// or when the pool is stopping.
+	std::condition_variable jobReady;
+	/// Signaled when the pool runs
+	/// out of jobs.
+	std::condition_variable idle;
+	/// The jobs that are ready to run.
+	std::deque<Job> jobs;
+	/// The keys that have a job queued or running,
+	/// along with the jobs that wait behind it.
+	std::map<const void *, std::deque<std::function<void()>>> busyKeys;
+	/// Set when the pool is destroyed.
+	bool stopping;
+public:
+	/// Start the host threads of the pool.
+	/// @param workerCount The number of host
+	/// threads. If this is zero, one thread is
+	/// started for each core.
+	IOWorkers(unsigned int workerCount = 0);
+	/// Finishes the jobs that were submitted,
+	/// then stops and joins the host threads.
+	~IOWorkers();
+	/// I/O workers may not be copied.
+	IOWorkers(const IOWorkers &) = delete;
+	/// I/O workers may not be copied.
+	IOWorkers &operator = (const IOWorkers &) = delete;
+	/// Get the number of host threads in the pool.
+	/// @returns The number of worker threads.
+	auto GetWorkerCount() const noexcept { return workers.size(); }
+	/// Submit a job to the pool. The job is
+	/// expected to report its own errors, so
+	/// exceptions that it throws are dropped.
+	/// @param key The key of the job. It runs
+	/// after the jobs submitted with the same key.
+	/// @param function The function to call.
+	void Submit(const void *key, std::function<void()> function);
+	/// Wait until every job that was
+	/// submitted has finished.
+	void Wait();
+protected:
+	/// Run jobs until the pool stops.
+	void Work();
+};
+
+} // namespace swanson
+
+#endif // SWANSON_IO_WORKERS_HPP
@@ -21,18 +21,32 @@
 #include <swanson/disk.hpp>
 #include <swanson/exit-code.hpp>
 #include <swanson/interrupt-handler.hpp>
+#include <swanson/process-table.hpp>
 #include <swanson/vfs.hpp>
+#include <swanson/wait-queue.hpp>
 
 #include "fs/ramfs/fs.h"
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <cstdint>
 
 namespace swanson {
 
+class CPU;
+class BlockRing;
+class ImageCache;
+class Console;
+class IOWorkers;
+class PageCompressor;
 class Process;
+class Scheduler;
+class SchedulerEvent;
+class SyscallStats;
+class ThreadPool;
 
 /// The kernel, encapsulated into a single
 /// class. There are no global variables, just
@@ -40,18 +54,92 @@ class Process;
 class Kernel final {
 	/// The disks known by the kernel.
 	std::vector<std::shared_ptr<Disk>> disks;
-	/// The array of processes.
-	std::vector<std::shared_ptr<Process>> processes;
-	/// The initial ram file system.
-	ramfs initramfs;
+	/// The block ring devices, in the order
+	/// that they were added. Each disk gets one
+	/// of its own, and a host may add devices
+	/// that are shared with other kernels.
+	std::vector<std::shared_ptr<BlockRing>> blockRings;
+	/// The processes, indexed by process ID.
+	ProcessTable processes;
+	/// The initial ram file system. It's never
+	/// modified once it's decoded, so it may be
+	/// shared by kernels that load the same data.
+	std::shared_ptr<const ramfs> initramfs;
+	/// The nanoseconds that the host spent
+	/// running processes that were removed.
+	uint64_t removedCPUTime;
 	/// The root file system.
 	std::shared_ptr<vfs::FS> root_fs;
+	/// The decoded programs, shared by the
+	/// processes that run the same binary.
+	std::shared_ptr<ImageCache> imageCache;
+	/// Counts the system calls made by
+	/// all of the processes.
+	std::shared_ptr<SyscallStats> syscallStats;
+	/// The soft memory limit given
+	/// to new processes.
+	uint64_t softMemoryLimit;
+	/// The hard memory limit given
+	/// to new processes.
+	uint64_t hardMemoryLimit;
+	/// Compresses the idle pages of the
+	/// processes, if page compression is enabled.
+	std::shared_ptr<PageCompressor> pageCompressor;
+	/// The host threads that the threads
+	/// of each process are run on.
+	std::shared_ptr<ThreadPool> threadPool;
+	/// The host threads that the I/O of
+	/// system calls is given to, if any.
+	std::shared_ptr<IOWorkers> ioWorkers;
+	/// Buffers the standard output and error
+	/// of the processes, if it's set.
+	std::shared_ptr<Console> console;
+	/// Runs the processes started by
+	/// @ref Main on the host threads.
+	std::shared_ptr<Scheduler> scheduler;
+	/// The number of instructions, per thread,
+	/// that the scheduler had run at the last
+	/// check for a page compressor sweep.
+	uint64_t sweepStepCount;
+	/// The first process, which @ref Main
+	/// runs until it exits. It's either started
+	/// from '/bin/init' or restored from a snapshot.
+	std::shared_ptr<Process> init;
+	/// The path that snapshots are written to when
+	/// a process asks for one, or an empty string if
+	/// processes may not ask for snapshots.
+	std::string snapshotPath;
+	/// Guards the snapshot requests, and
+	/// the queue that their threads wait on.
+	std::mutex snapshotMutex;
+	/// The threads that asked for a snapshot
+	/// wait on this until it's written.
+	WaitQueue snapshotQueue;
+	/// The CPUs of the threads that asked for
+	/// a snapshot, in the order that they asked.
+	std::vector<CPU *> snapshotRequests;
 public:
 	/// Default constructor.
-	Kernel() noexcept;
+	Kernel();
 	/// Default deconstructor.
 	~Kernel();
+	/// Decode an initial ram file system, so that
+	/// it may be given to several kernels with
+	/// @ref SetInitRamfs.
+	/// @param addr The address of the ramdisk data.
+	/// @param size The number of bytes contained by
+	/// the ramdisk.
+	/// @returns The decoded file system.
+	static std::shared_ptr<const ramfs> DecodeInitRamfs(const void *addr, uintmax_t size);
+	/// Add a block ring device. Processes that are
+	/// started afterwards may use it through the block
+	/// ring system call, at the next device index.
+	/// @param blockRing The device to add. It may
+	/// be shared with other kernels.
+	void AddBlockRing(std::shared_ptr<BlockRing> blockRing);
 	/// Add a disk to the kernel's disk array.
+	/// Processes that are started afterwards may
+	/// use it through the block ring system call.
 	/// @param disk The disk to add to the kernel.
 	void AddDisk(std::shared_ptr<Disk> disk);
 	/// Loads the initial ramdisk.
@@ -59,19 +147,156 @@ public:
 	/// @param size The number of bytes contained by
 	/// the ramdisk.
 	void LoadInitRamfs(const void *addr, uintmax_t size);
-	/// The kernel's entry point.
+	/// Get the time that the host has spent running
+	/// the processes of the kernel, including the
+	/// ones that have been removed.
+	/// @returns The time, in nanoseconds.
+	uint64_t GetCPUTime() const noexcept;
+	/// Get the image cache that the
+	/// processes load programs from.
+	/// @returns The image cache.
+	const auto &GetImageCache() const noexcept { return imageCache; }
+	/// Get the initial ram file system.
+	/// @returns The initial ram file system.
+	const auto &GetInitRamfs() const noexcept { return initramfs; }
+	/// Get the number of processes that
+	/// haven't exited or faulted.
+	/// @returns The number of live processes.
+	auto GetLiveCount() const noexcept { return processes.GetLiveCount(); }
+	/// Get the counters of the system calls made
+	/// by the processes. They may be read while
+	/// the processes are running.
+	/// @returns The system call statistics.
+	auto GetSyscallStats() const noexcept { return syscallStats; }
+	/// Handle a process that exited or faulted on
+	/// the scheduler, by removing it. Faults are
+	/// given the ID of the process first.
+	/// @param event The event of the process.
+	/// It must be for a process of this kernel.
+	/// @returns True if the process was the first
+	/// process, which the kernel runs until.
+	bool HandleEvent(const SchedulerEvent &event);
+	/// Restore the processes and the initial ram
+	/// file system from a snapshot, written by
+	/// @ref SaveSnapshot. The memory of the processes
+	/// is mapped from the file, so little is read up
+	/// front, and @ref Main resumes the processes
+	/// instead of starting '/bin/init'. Processes are
+	/// given new IDs, in the order they were saved.
+	/// This must be called before any process is
+	/// started, and the file must not change while
+	/// the processes use it.
+	/// @param path The path of the snapshot file.
+	void LoadSnapshot(const std::string &path);
+	/// The kernel's entry point. This starts
+	/// '/bin/init' on the scheduler and runs until
+	/// it exits. Other processes that exit or fault
+	/// are removed without stopping the rest.
 	/// @returns The exit code of the kernel.
 	/// This value is used to determine whether
 	/// the host program should return succesfully
 	/// or not.
 	ExitCode Main();
+	/// Indicates whether or not a process
+	/// was started by this kernel and
+	/// hasn't been removed yet.
+	/// @param process The process to check.
+	/// @returns True if the process belongs
+	/// to the kernel.
+	bool Owns(const Process &process) const noexcept;
+	/// Do the work that waits on the scheduler,
+	/// like page compressor sweeps and the snapshots
+	/// that processes asked for. @ref Main calls this
+	/// every so often, and so should anything else
+	/// that waits on the scheduler's events.
+	void Poll();
+	/// Write a snapshot of the processes and the
+	/// initial ram file system to a file. Threads,
+	/// memory and scheduling parameters are saved,
+	/// but open streams aren't. This must not be
+	/// called while processes are running.
+	/// @param path The path of the snapshot file.
+	void SaveSnapshot(const std::string &path);
+	/// Set the console that the standard output
+	/// and error of new processes is written to.
+	/// Each process is given streams of its own,
+	/// so that its output is buffered separately.
+	/// @param console_ The new console, or nullptr
+	/// to write to the host's streams directly.
+	void SetConsole(std::shared_ptr<Console> console_) noexcept;
+	/// Set the image cache that the processes load
+	/// programs from. Kernels may share one, since
+	/// the images are never modified.
+	/// @param imageCache_ The new image cache.
+	void SetImageCache(std::shared_ptr<ImageCache> imageCache_) noexcept;
+	/// Set the initial ram file system, decoded
+	/// by @ref DecodeInitRamfs, instead of decoding
+	/// it again with @ref LoadInitRamfs.
+	/// @param initramfs_ The initial ram file system.
+	void SetInitRamfs(std::shared_ptr<const ramfs> initramfs_) noexcept;
+	/// Set the host threads that the I/O of system
+	/// calls is given to. A thread that waits on I/O
+	/// is blocked, so that other processes run in the
+	/// meantime. This only affects processes that are
+	/// started afterwards.
+	/// @param ioWorkers_ The new I/O workers, or nullptr
+	/// to do I/O on the threads that make the calls.
+	void SetIOWorkers(std::shared_ptr<IOWorkers> ioWorkers_) noexcept;
+	/// Set the memory limits given to new processes.
+	/// See @ref Process::SetMemoryLimits for details.
+	/// @param softLimit The soft limit, in bytes,
+	/// or zero for no soft limit.
+	/// @param hardLimit The hard limit, in bytes,
+	/// or zero for no hard limit.
+	void SetMemoryLimits(uint64_t softLimit, uint64_t hardLimit) noexcept;
+	/// Set the page compressor used to compress
+	/// the idle pages of the processes. It's swept
+	/// over every process at its sweep interval.
+	/// @param pageCompressor_ The new page compressor,
+	/// or nullptr to disable page compression.
+	void SetPageCompressor(std::shared_ptr<PageCompressor> pageCompressor_) noexcept;
+	/// Set the host threads that the threads of
+	/// each process are run on. This only affects
+	/// processes that are started afterwards.
+	/// @param threadPool_ The new thread pool, or
+	/// nullptr to run threads on the calling thread.
+	void SetThreadPool(std::shared_ptr<ThreadPool> threadPool_) noexcept;
+	/// Set the scheduler that runs the processes
+	/// started by @ref Main. If none is set, one is
+	/// made with a host thread for each core.
+	/// @param scheduler_ The new scheduler.
+	void SetScheduler(std::shared_ptr<Scheduler> scheduler_) noexcept;
+	/// Set the path that snapshots are written to,
+	/// when a process asks for one with the snapshot
+	/// system call. This only affects processes that
+	/// are started afterwards.
+	/// @param path The path of the snapshot file, or
+	/// an empty string to not allow snapshots.
+	void SetSnapshotPath(const std::string &path);
 	/// Set the root file system.
 	/// This is also the file system that the
 	/// kernel will will search for '/sbin/init' for.
 	/// @param root_fs_ The new root file system.
 	void SetRootFS(std::shared_ptr<vfs::FS> root_fs_);
-	/// Run the processes for a specified
-	/// number of instructions per thread.
+	/// Start '/bin/init', unless processes were
+	/// restored from a snapshot, and add the processes
+	/// to the scheduler without waiting on it. Events
+	/// of the processes are then passed to @ref
+	/// HandleEvent by whatever waits on the scheduler.
+	/// @ref Main calls this first.
+	/// @returns @ref ExitCode::Success if the
+	/// processes were started.
+	ExitCode Start();
+	/// Kill the live processes, so that the
+	/// scheduler reports them as having exited.
+	/// This is used when the kernel is done, but
+	/// the scheduler keeps running for others.
+	void Stop();
+	/// Run the live processes for a specified
+	/// number of instructions per thread, one
+	/// after another on the calling thread.
+	/// Processes that exit are removed. This
+	/// must not be used while @ref Main is running.
 	/// @param steps The instructions per
 	/// thread to run in each process.
 	void Step(uint32_t steps);
@@ -79,9 +304,32 @@ protected:
 	/// Add a process to the kernel.
 	/// The process should be loaded
 	/// with an ELF file before calling
-	/// this function.
+	/// this function. It's given the root
+	/// file system and the image cache, for
+	/// the programs that it execs, and the
+	/// system call statistics.
 	/// @param process The process to add.
 	void AddProcess(std::shared_ptr<Process> &process);
+	/// Called, on the thread of a process, when
+	/// it asks for a snapshot. The thread is blocked
+	/// until @ref TakeSnapshot writes the snapshot.
+	/// @param process The process asking for the snapshot.
+	/// @param cpu The CPU of the thread asking for it.
+	void RequestSnapshot(Process &process, CPU &cpu);
+	/// Write a snapshot, if one was asked for since
+	/// the last one, and wake the threads that asked.
+	/// The scheduler is paused while it's written.
+	void TakeSnapshot();
+	/// Remove a process that exited or faulted
+	/// from the kernel. Processes have no parent
+	/// to wait on them yet, so they're reaped
+	/// right away, which frees their memory.
+	/// @param process The process to remove.
+	void RemoveProcess(const std::shared_ptr<Process> &process);
+	/// Sweep the page compressor over the
+	/// processes, if a sweep is due. The
+	/// scheduler is paused during the sweep.
+	void SweepScheduled();
 };
 
 } // namespace swanson
@@ -0,0 +1,50 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_LZ_HPP
+#define SWANSON_LZ_HPP
+
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson::lz {
+
+/// Compress a buffer with a fast LZ77 codec.
+/// The output is a series of sequences, each
+/// made of a run of literal bytes followed by
+/// a match that copies earlier output. It's
+/// meant for pages of memory, where speed
+/// matters more than the compression ratio.
+/// @param src The data to compress.
+/// @param size The number of bytes to compress.
+/// @returns The compressed data.
+std::vector<unsigned char> Compress(const void *src, uint32_t size);
+
+/// Decompress a buffer made by @ref Compress.
+/// An exception is thrown if the data is not
+/// valid or does not decompress to exactly
+/// the size of the destination.
+/// @param src The compressed data.
+/// @param srcSize The number of compressed bytes.
+/// @param dst The buffer to decompress to.
+/// @param dstSize The size of the original data.
+void Decompress(const void *src, uint32_t srcSize, void *dst, uint32_t dstSize);
+
+} // namespace swanson::lz
+
+#endif // SWANSON_LZ_HPP
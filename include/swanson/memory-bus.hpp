@@ -19,10 +19,26 @@
 #ifndef SWANSON_MEMORY_BUS_HPP
 #define SWANSON_MEMORY_BUS_HPP
 
+#include <vector>
+
 #include <cstdint>
 
 namespace swanson {
 
+/// A contiguous range of host memory
+/// that backs part of a guest address range.
+class HostSpan final {
+public:
+	/// The guest address of the span.
+	uint32_t address;
+	/// The host memory of the span.
+	unsigned char *data;
+	/// The number of bytes in the span.
+	uint32_t size;
+	/// Default constructor
+	HostSpan() noexcept : address(0), data(nullptr), size(0) { }
+};
+
 /// The interface between the CPU and
 /// the memory manager.
 class MemoryBus {
@@ -51,6 +67,37 @@ public:
 	/// @param addr The address of the instruction.
 	/// @returns The executable code from memory.
 	virtual uint32_t Exec32(uint32_t addr) const = 0;
+	/// Get the host memory that backs a range of
+	/// guest memory, for reading. The range is split
+	/// into one span for each section it crosses. The
+	/// read permission of the whole range is checked
+	/// up front, and the spans must not be written to.
+	/// The spans are invalidated when the memory
+	/// layout changes.
+	/// @param addr The start of the guest range.
+	/// @param size The number of bytes in the range.
+	/// @returns The spans that make up the range.
+	virtual std::vector<HostSpan> GetReadSpans(uint32_t addr, uint32_t size) const = 0;
+	/// Get the host memory that backs a range of
+	/// guest memory, for writing. The write permission
+	/// of the whole range is checked up front and the
+	/// range is counted as written to.
+	/// @param addr The start of the guest range.
+	/// @param size The number of bytes in the range.
+	/// @returns The spans that make up the range.
+	virtual std::vector<HostSpan> GetWriteSpans(uint32_t addr, uint32_t size) = 0;
+	/// Read a block of memory. Nothing is read if
+	/// any part of the block can't be read from.
+	/// @param addr The guest address of the block.
+	/// @param buf The buffer to copy the block to.
+	/// @param size The number of bytes to read.
+	virtual void ReadBlock(uint32_t addr, void *buf, uint32_t size) const = 0;
+	/// Write a block of memory. Nothing is written
+	/// if any part of the block can't be written to.
+	/// @param addr The guest address of the block.
+	/// @param buf The data to copy to the block.
+	/// @param size The number of bytes to write.
+	virtual void WriteBlock(uint32_t addr, const void *buf, uint32_t size) = 0;
 	/// Write a 32-bit value to the memory bus.
 	/// @param addr The address to write the 32-bit value to.
 	/// @param value The value to write to the memory bus.
@@ -0,0 +1,57 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_MEMORY_LIMIT_HPP
+#define SWANSON_MEMORY_LIMIT_HPP
+
+#include <swanson/exception.hpp>
+
+#include <cstdint>
+
+namespace swanson {
+
+/// Thrown when memory is committed past
+/// the hard limit of a memory map.
+class MemoryLimit final : public Exception {
+	/// The number of bytes that would
+	/// have been committed.
+	uint64_t requested;
+	/// The hard limit that would
+	/// have been exceeded.
+	uint64_t limit;
+public:
+	/// Default constructor.
+	/// @param requested_ The number of bytes that
+	/// would have been committed.
+	/// @param limit_ The hard limit.
+	MemoryLimit(uint64_t requested_, uint64_t limit_) noexcept
+		: Exception("Memory limit exceeded."), requested(requested_), limit(limit_) { }
+	/// Default deconstructor.
+	~MemoryLimit() { }
+	/// Get the number of bytes that
+	/// would have been committed.
+	/// @returns The requested number of bytes.
+	auto GetRequested() const noexcept { return requested; }
+	/// Get the hard limit that would
+	/// have been exceeded.
+	/// @returns The hard limit.
+	auto GetLimit() const noexcept { return limit; }
+};
+
+} // namespace swanson
+
+#endif // SWANSON_MEMORY_LIMIT_HPP
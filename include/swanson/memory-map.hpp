@@ -26,21 +26,64 @@
 
 namespace swanson {
 
+class AccessProfile;
 class MemorySection;
 
+enum class AccessType;
+class MemoryUsage;
+
 /// The memory map of a process.
+/// Memory may be accessed by several threads
+/// at once, and aligned 32-bit accesses are
+/// atomic. Changes to the layout of the map,
+/// such as adding, removing or resizing sections,
+/// must only be made while no other thread is
+/// accessing it (see @ref WorldLock).
 class MemoryMap final : public MemoryBus {
 	/// Sections of the memory map,
 	/// since it is not continuous.
 	std::vector<std::shared_ptr<MemorySection>> sections;
+	/// Counts the memory used by the sections.
+	std::shared_ptr<MemoryUsage> usage;
+	/// Counts the accesses made to each page,
+	/// if profiling is enabled.
+	std::shared_ptr<AccessProfile> profile;
 public:
-	/// Default deconstructor
-	~MemoryMap() { }
+	/// Default constructor
+	MemoryMap();
+	/// Releases the sections from
+	/// the memory usage.
+	~MemoryMap();
 	/// Get the total number of bytes that may
 	/// be contained by the memory map.
 	/// @returns The number of bytes that may
 	/// be contained by the memory map.
 	uint32_t GetSize() const noexcept;
+	/// Get the access profile of the memory map.
+	/// @returns The access profile, or nullptr
+	/// if profiling is not enabled.
+	auto GetProfile() const noexcept { return profile; }
+	/// Get the host memory that backs a range
+	/// of guest memory, for reading.
+	/// @param addr The start of the guest range.
+	/// @param size The number of bytes in the range.
+	/// @returns One span for each section in the range.
+	std::vector<HostSpan> GetReadSpans(uint32_t addr, uint32_t size) const;
+	/// Get the host memory that backs a range
+	/// of guest memory, for writing.
+	/// @param addr The start of the guest range.
+	/// @param size The number of bytes in the range.
+	/// @returns One span for each section in the range.
+	std::vector<HostSpan> GetWriteSpans(uint32_t addr, uint32_t size);
+	/// Get the memory usage of the memory map.
+	/// Its counters may be read from any thread.
+	/// @returns The memory usage of the memory map.
+	std::shared_ptr<MemoryUsage> GetUsage() const noexcept { return usage; }
+	/// Read a block of memory.
+	/// @param addr The guest address of the block.
+	/// @param buf The buffer to copy the block to.
+	/// @param size The number of bytes to read.
+	void ReadBlock(uint32_t addr, void *buf, uint32_t size) const;
 	/// Read a 32-bit value from memory.
 	/// @param addr The address to read from.
 	/// @returns The value from memory.
@@ -67,6 +110,11 @@ public:
 	/// of the instruction.
 	/// @returns The 16-bit instruction component.
 	uint16_t Exec16(uint32_t addr) const;
+	/// Write a block of memory.
+	/// @param addr The guest address of the block.
+	/// @param buf The data to copy to the block.
+	/// @param size The number of bytes to write.
+	void WriteBlock(uint32_t addr, const void *buf, uint32_t size);
 	/// Write a 32-bit value to the memory map.
 	/// The section that contains this address must
 	/// have write permissions for this function to
@@ -89,6 +137,8 @@ public:
 	/// @param value The value to write to the memory map.
 	void Write8(uint32_t addr, uint8_t value);
 	/// Add a memory section to the memory map.
+	/// A @ref MemoryLimit exception is thrown if the
+	/// section would exceed the hard memory limit.
 	/// @param memorySection The memory section to add.
 	void AddSection(std::shared_ptr<MemorySection> &memorySection);
 	/// Find an available address to accommodate a
@@ -98,6 +148,50 @@ public:
 	/// should accommodate.
 	/// @returns A pointer to the newly formed memory section.
 	std::shared_ptr<MemorySection> AddSection(uint32_t size);
+	/// Find an address that can accommodate a
+	/// specified amount of memory without overlapping
+	/// any of the existing sections.
+	/// @param size The number of bytes to accommodate.
+	/// @returns An address aligned to 0x2000 bytes.
+	uint32_t FindAddress(uint32_t size) const;
+	/// Find the section that contains an address.
+	/// @param addr The address to search for.
+	/// @returns The section containing the address,
+	/// or nullptr if no section contains it.
+	std::shared_ptr<MemorySection> FindSection(uint32_t addr) const;
+	/// Determine if a range of memory overlaps
+	/// with any of the sections in the memory map,
+	/// including the range they may grow into.
+	/// @param addr The start of the range.
+	/// @param size The number of bytes in the range.
+	/// @returns True if the range overlaps with a section.
+	bool Overlaps(uint32_t addr, uint32_t size) const noexcept;
+	/// Set the access profile of the memory map.
+	/// Every access made to the memory map is
+	/// recorded by the profile.
+	/// @param profile_ The new access profile, or
+	/// nullptr to disable profiling.
+	void SetProfile(std::shared_ptr<AccessProfile> profile_) noexcept { profile = profile_; }
+	/// Get the beginning section iterator.
+	/// Used for loops.
+	/// @returns The beginning iterator.
+	auto begin() const noexcept { return sections.begin(); }
+	/// Get the ending section iterator.
+	/// Used for loops.
+	/// @returns The ending iterator.
+	auto end() const noexcept { return sections.end(); }
+	/// Remove a section from the memory map.
+	/// @param section The section to remove.
+	/// @returns True if the section was removed,
+	/// false if it was not part of the memory map.
+	bool RemoveSection(const std::shared_ptr<MemorySection> &section);
+protected:
+	/// Record an access to each page of
+	/// a range, if profiling is enabled.
+	/// @param addr The start of the range.
+	/// @param size The number of bytes in the range.
+	/// @param type The type of access.
+	void RecordRange(uint32_t addr, uint32_t size, AccessType type) const;
 };
 
 } // namespace swanson
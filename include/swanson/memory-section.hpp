@@ -19,12 +19,19 @@
 #ifndef SWANSON_MEMORY_SECTION_HPP
 #define SWANSON_MEMORY_SECTION_HPP
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <cstdint>
 
 namespace swanson {
 
+class CompressionStats;
+class HostMapping;
+class MemoryUsage;
+
 /// A section of memory in the
 /// memory map.
 class MemorySection final {
@@ -41,16 +48,81 @@ class MemorySection final {
 	/// of memory is executable.
 	bool executePermission;
 	/// The bytes of memory associated
-	/// with the memory section.
+	/// with the memory section, if the
+	/// section owns its memory.
 	std::vector<unsigned char> bytes;
+	/// The host memory that the section
+	/// views, if the section does not own
+	/// its memory.
+	std::shared_ptr<HostMapping> mapping;
+	/// Points to the first byte of the
+	/// section, either in @ref bytes or
+	/// in @ref mapping.
+	unsigned char *data;
+	/// The number of bytes in the section.
+	uint32_t size;
+	/// Counts the memory of the section, if
+	/// it's part of a memory map.
+	std::shared_ptr<MemoryUsage> usage;
+	/// One flag for each page of the section,
+	/// which is set when the page is written to.
+	/// They're packed into words that may be
+	/// set by several guest threads at once.
+	std::unique_ptr<std::atomic<uint64_t>[]> dirtyWords;
+	/// The number of pages that the
+	/// dirty flags cover.
+	uint32_t dirtyPageCount;
+	/// The number of dirty flags that are set.
+	std::atomic<uint32_t> dirtyCount;
+	/// Set when the section is accessed, and
+	/// cleared when the section is swept.
+	mutable std::atomic<bool> accessed;
+	/// The number of sweeps in a row that
+	/// found the section not accessed.
+	uint32_t idleSweeps;
+	/// The first page that hasn't been looked
+	/// at for compression since the section
+	/// was last accessed.
+	uint32_t compressCursor;
+	/// The compressed contents of each page,
+	/// which are empty for pages that aren't
+	/// compressed. Pages are decompressed when
+	/// they're accessed, even for reading.
+	mutable std::vector<std::vector<unsigned char>> compressedPages;
+	/// The number of pages that are compressed.
+	mutable std::atomic<uint32_t> compressedCount;
+	/// Held while a page is decompressed, since
+	/// several guest threads may touch it at once.
+	mutable std::mutex compressionMutex;
+	/// Counts the pages that are compressed
+	/// and decompressed.
+	std::shared_ptr<CompressionStats> compressionStats;
 public:
+	/// The number of bytes covered
+	/// by each dirty flag.
+	static constexpr uint32_t pageSize = 0x1000;
 	/// Default constructor.
 	MemorySection() noexcept : address(0x00),
 	                           readPermission(true),
 	                           writePermission(true),
-	                           executePermission(false) { }
-	/// Default deconstructor.
-	~MemorySection() { }
+	                           executePermission(false),
+	                           data(nullptr),
+	                           size(0),
+	                           dirtyPageCount(0),
+	                           dirtyCount(0),
+	                           accessed(false),
+	                           idleSweeps(0),
+	                           compressCursor(0),
+	                           compressedCount(0) { }
+	/// Releases the section from the
+	/// memory usage that counts it.
+	~MemorySection();
+	/// Sections refer to their own
+	/// storage and may not be copied.
+	MemorySection(const MemorySection &) = delete;
+	/// Sections refer to their own
+	/// storage and may not be copied.
+	MemorySection &operator = (const MemorySection &) = delete;
 	/// Get the address of the memory section.
 	/// @returns The address of the memory section.
 	auto GetAddress() const noexcept { return address; }
@@ -58,7 +130,87 @@ public:
 	/// the memory section.
 	/// @returns The number of bytes occupied
 	/// by the memory section.
-	auto GetSize() const noexcept { return bytes.size(); }
+	auto GetSize() const noexcept { return size; }
+	/// Get a pointer to the first byte of the
+	/// section. Any compressed pages are
+	/// decompressed first. The pointer is
+	/// invalidated when the section is
+	/// resized or mapped.
+	/// @returns A pointer to the section data.
+	const unsigned char *GetData() const;
+	/// Compress pages of the section and release
+	/// their host memory. This is only done for
+	/// sections that view a private host mapping,
+	/// since other memory can't be released.
+	/// Pages that don't compress well are skipped.
+	/// @param maxPages The largest number of
+	/// pages to compress.
+	/// @param stats Counts the pages that are
+	/// compressed and decompressed.
+	/// @returns The number of pages compressed.
+	uint32_t Compress(uint32_t maxPages, std::shared_ptr<CompressionStats> stats);
+	/// Decompress every compressed page.
+	void Decompress() const;
+	/// Get the number of pages that
+	/// are currently compressed.
+	/// @returns The number of compressed pages.
+	uint32_t GetCompressedPages() const noexcept { return compressedCount.load(std::memory_order_relaxed); }
+	/// Update the idle count of the section.
+	/// The count is reset if the section was
+	/// accessed since the last sweep.
+	/// @returns The number of sweeps in a row
+	/// that found the section not accessed.
+	uint32_t Sweep() noexcept;
+	/// Get the offsets of the pages that were
+	/// written to since the dirty flags were last
+	/// cleared. Pages that the section grew into
+	/// count as written to.
+	/// @returns The offsets of the dirty pages,
+	/// in ascending order.
+	std::vector<uint32_t> GetDirtyPages() const;
+	/// Indicates whether or not the page at
+	/// an offset has been written to since the
+	/// dirty flags were last cleared.
+	/// @param offset The offset of the page
+	/// within the section.
+	/// @returns True if the page is dirty.
+	bool IsDirty(uint32_t offset) const noexcept;
+	/// Clear the dirty flag of every page.
+	/// This is done after a checkpoint is taken.
+	void ClearDirtyPages() noexcept;
+	/// Get the number of bytes that the section
+	/// may grow to without moving in host memory.
+	/// Memory maps keep this range free of other
+	/// sections, so that the section may grow into it.
+	/// @returns The capacity of the section.
+	uint32_t GetCapacity() const noexcept;
+	/// Get the host mapping that the section
+	/// views, if it does not own its memory.
+	/// @returns The host mapping of the section,
+	/// or nullptr if the section owns its memory.
+	auto GetMapping() const noexcept { return mapping; }
+	/// Indicates whether or not the section
+	/// owns the memory that it contains.
+	/// @returns True if the section owns its
+	/// memory, false if it views a host mapping.
+	bool OwnsBytes() const noexcept { return mapping == nullptr; }
+	/// Indicates whether or not the memory of the
+	/// section is shared with others.
+	/// @returns True if the section views a shared
+	/// host mapping.
+	bool IsShared() const noexcept;
+	/// Indicates whether or not read operations
+	/// are allowed in this section.
+	/// @returns True if reading is allowed.
+	auto ReadAllowed() const noexcept { return readPermission; }
+	/// Indicates whether or not write operations
+	/// are allowed in this section.
+	/// @returns True if writing is allowed.
+	auto WriteAllowed() const noexcept { return writePermission; }
+	/// Indicates whether or not this section
+	/// may be executed.
+	/// @returns True if execution is allowed.
+	auto ExecuteAllowed() const noexcept { return executePermission; }
 	/// Indicate whether or not read
 	/// operations may occur at this section.
 	/// @param state True if read operations are
@@ -66,9 +218,11 @@ public:
 	void AllowRead(bool state) { readPermission = state; }
 	/// Indicate whether or not write
 	/// operations may occur at this section.
+	/// An exception is thrown if write operations
+	/// are enabled on a read-only host mapping.
 	/// @param state True if write operations are
 	/// allowed, false if they are not.
-	void AllowWrite(bool state) { writePermission = state; }
+	void AllowWrite(bool state);
 	/// Indicate whether or not execute
 	/// permissions may occur at this section.
 	/// @param state True if memory may be executed
@@ -80,7 +234,25 @@ public:
 	void CopyData(const void *data, uint32_t size);
 	/// Copy data to the memory section.
 	/// @param bytes_ The data to copy to the section.
-	void CopyData(const std::vector<unsigned char> &bytes_) { bytes = bytes_; }
+	void CopyData(const std::vector<unsigned char> &bytes_);
+	/// Copy data into part of the memory section,
+	/// without resizing it. Permissions are not
+	/// checked, since this is done by the host.
+	/// @param offset The offset within the section
+	/// to copy the data to.
+	/// @param data The data to copy to the section.
+	/// @param size The number of bytes to copy.
+	void CopyData(uint32_t offset, const void *data, uint32_t size);
+	/// Copy data into part of the memory section,
+	/// like @ref CopyData, without marking its pages
+	/// as dirty. This is for data that the host keeps
+	/// up to date, which doesn't need to be recorded
+	/// by checkpoints or restored by rollbacks.
+	/// @param offset The offset within the section
+	/// to copy the data to.
+	/// @param data The data to copy to the section.
+	/// @param size The number of bytes to copy.
+	void OverwriteData(uint32_t offset, const void *data, uint32_t size);
 	/// Determine if an address exists
 	/// within this memory section.
 	/// @param addr The address to check for.
@@ -103,6 +275,21 @@ public:
 	/// @returns The 8-bit value at the
 	/// specified address.
 	uint8_t Read8(uint32_t addr) const;
+	/// Get a host pointer to a range of the
+	/// section, for reading. The read permission
+	/// is checked once for the whole range.
+	/// @param addr The address of the range.
+	/// @param length The number of bytes in the range.
+	/// @returns A pointer to the first byte of the range.
+	const unsigned char *GetReadSpan(uint32_t addr, uint32_t length) const;
+	/// Get a host pointer to a range of the
+	/// section, for writing. The write permission
+	/// is checked once for the whole range, and
+	/// its pages are marked as dirty.
+	/// @param addr The address of the range.
+	/// @param length The number of bytes in the range.
+	/// @returns A pointer to the first byte of the range.
+	unsigned char *GetWriteSpan(uint32_t addr, uint32_t length);
 	/// Fetch a 32-bit component of an instruction.
 	/// The section must have execute permission for this
 	/// function to work without throwing an exception.
@@ -133,13 +320,32 @@ public:
 	/// @param addr The address to write the value at.
 	/// @param value The value to write to the section.
 	void Write8(uint32_t addr, uint8_t value);
+	/// View a region of host memory instead
+	/// of the memory owned by the section. The
+	/// section takes the size of the mapping and
+	/// any memory it owned is released.
+	/// @param mapping_ The host memory to view.
+	void Map(std::shared_ptr<HostMapping> mapping_);
 	/// Resize the section of memory.
+	/// If the section is counted by a memory
+	/// usage, it may not grow past the hard limit.
 	/// Care should be taken that it
 	/// does not overlap with the other
 	/// sections of memory in the memory map.
-	/// @param size The new size of the
+	/// Sections that view a host mapping may
+	/// not grow past the capacity of the mapping,
+	/// but grow in place without copying.
+	/// @param size_ The new size of the
 	/// memory section.
-	void Resize(uint32_t size);
+	void Resize(uint32_t size_);
+	/// Set the memory usage that counts the
+	/// memory of this section. The section is
+	/// released from the previous memory usage.
+	/// This is done by the memory map that the
+	/// section is added to.
+	/// @param usage_ The new memory usage, which
+	/// may be nullptr.
+	void SetUsage(std::shared_ptr<MemoryUsage> usage_);
 	/// Set the virtual address of the
 	/// memory section. Care should be
 	/// taken that this address does not
@@ -149,6 +355,53 @@ public:
 	/// @param addr The new virtual address
 	/// of the memory section.
 	void SetAddress(uint32_t addr) noexcept;
+protected:
+	/// Note an access to a range of the section,
+	/// and decompress the pages in the range.
+	/// @param offset The offset of the range.
+	/// @param length The number of bytes in the range.
+	void Touch(uint32_t offset, uint32_t length) const {
+		if (!accessed.load(std::memory_order_relaxed))
+			accessed.store(true, std::memory_order_relaxed);
+		if (compressedCount.load(std::memory_order_acquire) != 0)
+			DecompressRange(offset, length);
+	}
+	/// Decompress the pages that
+	/// a range of the section covers.
+	/// @param offset The offset of the range.
+	/// @param length The number of bytes in the range.
+	void DecompressRange(uint32_t offset, uint32_t length) const;
+	/// Release the compressed pages without
+	/// decompressing them. This is done when the
+	/// contents of the section are replaced.
+	void DropCompressed() noexcept;
+	/// Set the dirty flags of the pages
+	/// that a range of the section covers.
+	/// @param offset The offset of the range.
+	/// @param length The number of bytes in the range.
+	void MarkDirty(uint32_t offset, uint32_t length) noexcept {
+		auto last = (offset + length - 1) / pageSize;
+		for (auto page = offset / pageSize; page <= last; page++) {
+			// The flag is usually set already,
+			// so it's read before it's written.
+			auto &word = dirtyWords[page / 64];
+			auto bit = ((uint64_t) 1) << (page % 64);
+			if ((word.load(std::memory_order_relaxed) & bit) != 0)
+				continue;
+			if ((word.fetch_or(bit, std::memory_order_relaxed) & bit) == 0)
+				dirtyCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	/// Resize the dirty flags to cover
+	/// a new section size. This is called
+	/// before the section size is changed.
+	/// @param size_ The new size of the section.
+	void ResizeDirtyPages(uint32_t size_);
+	/// Resize the storage of the section,
+	/// without changing the size that the
+	/// section reports.
+	/// @param size_ The new size of the storage.
+	void ResizeStorage(uint32_t size_);
 };
 
 } // namespace swanson
@@ -0,0 +1,121 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_MEMORY_USAGE_HPP
+#define SWANSON_MEMORY_USAGE_HPP
+
+#include <atomic>
+
+#include <cstdint>
+
+namespace swanson {
+
+/// Keeps count of the guest memory used by
+/// a memory map, and enforces limits on it.
+/// The counters are updated as sections are
+/// added, removed and resized, and they may be
+/// read from any thread without locking.
+class MemoryUsage final {
+	/// The number of bytes in all of
+	/// the sections of the memory map.
+	std::atomic<uint64_t> committed;
+	/// The number of bytes held in memory
+	/// that is private to the memory map. They
+	/// are committed, and may not be touched yet.
+	std::atomic<uint64_t> privateBytes;
+	/// The number of bytes viewed through
+	/// memory that is shared with others.
+	std::atomic<uint64_t> shared;
+	/// The number of committed bytes past which
+	/// the memory map is reported as over its
+	/// limit. Zero means there is no soft limit.
+	std::atomic<uint64_t> softLimit;
+	/// The number of committed bytes that
+	/// may not be exceeded. Zero means there
+	/// is no hard limit.
+	std::atomic<uint64_t> hardLimit;
+	/// The number of times that the soft
+	/// limit has been crossed.
+	std::atomic<uint64_t> softLimitCount;
+public:
+	/// Default constructor
+	MemoryUsage() noexcept;
+	/// Default deconstructor
+	~MemoryUsage() { }
+	/// Determine if a number of bytes may be
+	/// committed without exceeding the hard limit.
+	/// @param bytes The number of bytes to commit.
+	/// @returns True if the bytes may be committed.
+	bool CanCommit(uint64_t bytes) const noexcept;
+	/// Count bytes that were committed to the
+	/// memory map. An exception is thrown, and
+	/// nothing is counted, if this would exceed
+	/// the hard limit.
+	/// @param bytes The number of bytes committed.
+	/// @param isShared Whether or not the bytes
+	/// are held in shared memory.
+	void Commit(uint64_t bytes, bool isShared);
+	/// Count bytes that were released
+	/// from the memory map.
+	/// @param bytes The number of bytes released.
+	/// @param isShared Whether or not the bytes
+	/// were held in shared memory.
+	void Release(uint64_t bytes, bool isShared) noexcept;
+	/// Get the number of bytes in all of
+	/// the sections of the memory map.
+	/// @returns The number of committed bytes.
+	uint64_t GetCommitted() const noexcept { return committed.load(std::memory_order_relaxed); }
+	/// Get the number of bytes held in memory
+	/// that is private to the memory map.
+	/// @returns The number of private bytes.
+	uint64_t GetPrivate() const noexcept { return privateBytes.load(std::memory_order_relaxed); }
+	/// Get the number of bytes viewed through
+	/// memory that is shared with others.
+	/// @returns The number of shared bytes.
+	uint64_t GetShared() const noexcept { return shared.load(std::memory_order_relaxed); }
+	/// Get the soft limit.
+	/// @returns The soft limit, or zero if
+	/// there is no soft limit.
+	uint64_t GetSoftLimit() const noexcept { return softLimit.load(std::memory_order_relaxed); }
+	/// Get the hard limit.
+	/// @returns The hard limit, or zero if
+	/// there is no hard limit.
+	uint64_t GetHardLimit() const noexcept { return hardLimit.load(std::memory_order_relaxed); }
+	/// Get the number of times that the
+	/// soft limit has been crossed.
+	/// @returns The number of times the
+	/// soft limit was crossed.
+	uint64_t GetSoftLimitCount() const noexcept { return softLimitCount.load(std::memory_order_relaxed); }
+	/// Indicates whether or not the committed
+	/// memory is over the soft limit.
+	/// @returns True if the soft limit is exceeded.
+	bool OverSoftLimit() const noexcept;
+	/// Set the soft limit. Crossing the soft
+	/// limit does not fail any allocations.
+	/// @param limit The new soft limit, or
+	/// zero to remove the soft limit.
+	void SetSoftLimit(uint64_t limit) noexcept { softLimit.store(limit, std::memory_order_relaxed); }
+	/// Set the hard limit. Allocations that
+	/// would cross the hard limit fail.
+	/// @param limit The new hard limit, or
+	/// zero to remove the hard limit.
+	void SetHardLimit(uint64_t limit) noexcept { hardLimit.store(limit, std::memory_order_relaxed); }
+};
+
+} // namespace swanson
+
+#endif // SWANSON_MEMORY_USAGE_HPP
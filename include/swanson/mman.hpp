@@ -0,0 +1,55 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_MMAN_HPP
+#define SWANSON_MMAN_HPP
+
+#include <cstdint>
+
+/// Constants used by the memory
+/// mapping system calls.
+namespace swanson::mman {
+
+/// The size of a guest page.
+constexpr uint32_t page_size = 0x1000;
+
+/// Pages may be read.
+constexpr uint32_t prot_read = 0x01;
+
+/// Pages may be written.
+constexpr uint32_t prot_write = 0x02;
+
+/// Pages may be executed.
+constexpr uint32_t prot_exec = 0x04;
+
+/// Writes are shared with other
+/// mappings of the same file.
+constexpr uint32_t map_shared = 0x01;
+
+/// Writes are private to the mapping.
+constexpr uint32_t map_private = 0x02;
+
+/// The mapping must be placed
+/// at the address given.
+constexpr uint32_t map_fixed = 0x10;
+
+/// The mapping is not backed by a file.
+constexpr uint32_t map_anonymous = 0x20;
+
+} // namespace swanson::mman
+
+#endif // SWANSON_MMAN_HPP
@@ -0,0 +1,192 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_PAGE_COMPRESSOR_HPP
+#define SWANSON_PAGE_COMPRESSOR_HPP
+
+#include <atomic>
+#include <memory>
+
+#include <cstdint>
+
+namespace swanson {
+
+class MemoryMap;
+
+/// Counts the pages compressed by a page
+/// compressor and the cost of decompressing
+/// them again. Sections update the counters as
+/// pages are decompressed on access, and they
+/// may be read from any thread without locking.
+class CompressionStats final {
+	/// The number of pages compressed.
+	std::atomic<uint64_t> compressedPages;
+	/// The number of pages decompressed.
+	std::atomic<uint64_t> decompressedPages;
+	/// The number of pages that did not
+	/// compress well enough to be kept.
+	std::atomic<uint64_t> rejectedPages;
+	/// The number of bytes in the
+	/// pages that were compressed.
+	std::atomic<uint64_t> originalBytes;
+	/// The number of bytes that the
+	/// pages were compressed to.
+	std::atomic<uint64_t> packedBytes;
+	/// The number of compressed bytes
+	/// currently held by sections.
+	std::atomic<uint64_t> storedBytes;
+	/// The total time spent decompressing
+	/// pages, in nanoseconds.
+	std::atomic<uint64_t> decompressTime;
+	/// The longest time spent decompressing
+	/// a single page, in nanoseconds.
+	std::atomic<uint64_t> maxDecompressTime;
+public:
+	/// Default constructor
+	CompressionStats() noexcept;
+	/// Count a page that was compressed.
+	/// @param size The size of the page.
+	/// @param packedSize The compressed size of the page.
+	void CountCompressed(uint32_t size, uint32_t packedSize) noexcept;
+	/// Count a page that was decompressed.
+	/// @param packedSize The compressed size of the page.
+	/// @param time The time it took, in nanoseconds.
+	void CountDecompressed(uint32_t packedSize, uint64_t time) noexcept;
+	/// Count a compressed page that was
+	/// released without being decompressed.
+	/// @param packedSize The compressed size of the page.
+	void CountDropped(uint32_t packedSize) noexcept;
+	/// Count a page that did not compress
+	/// well enough to be kept.
+	void CountRejected() noexcept { rejectedPages.fetch_add(1, std::memory_order_relaxed); }
+	/// Get the number of pages compressed.
+	/// @returns The number of compressed pages.
+	uint64_t GetCompressedPages() const noexcept { return compressedPages.load(std::memory_order_relaxed); }
+	/// Get the number of pages decompressed.
+	/// @returns The number of decompressed pages.
+	uint64_t GetDecompressedPages() const noexcept { return decompressedPages.load(std::memory_order_relaxed); }
+	/// Get the number of pages that did not
+	/// compress well enough to be kept.
+	/// @returns The number of rejected pages.
+	uint64_t GetRejectedPages() const noexcept { return rejectedPages.load(std::memory_order_relaxed); }
+	/// Get the number of compressed bytes
+	/// currently held by sections.
+	/// @returns The number of stored bytes.
+	uint64_t GetStoredBytes() const noexcept { return storedBytes.load(std::memory_order_relaxed); }
+	/// Get the ratio of the size of the pages
+	/// compressed to the size they were
+	/// compressed to.
+	/// @returns The compression ratio, or zero
+	/// if no pages were compressed.
+	double GetRatio() const noexcept;
+	/// Get the average time spent
+	/// decompressing a page.
+	/// @returns The average time, in nanoseconds.
+	uint64_t GetAverageDecompressTime() const noexcept;
+	/// Get the longest time spent
+	/// decompressing a single page.
+	/// @returns The longest time, in nanoseconds.
+	uint64_t GetMaxDecompressTime() const noexcept { return maxDecompressTime.load(std::memory_order_relaxed); }
+};
+
+/// Compresses the pages of sections that
+/// have not been accessed for a number of
+/// sweeps. The host memory of the compressed
+/// pages is released, and a page is decompressed
+/// in place the first time it's accessed again.
+class PageCompressor final {
+	/// Counts the pages compressed
+	/// by the page compressor.
+	std::shared_ptr<CompressionStats> stats;
+	/// The number of sweeps that a section
+	/// must go without being accessed before
+	/// its pages are compressed.
+	uint32_t idleThreshold;
+	/// The largest number of pages that
+	/// may be compressed in one sweep.
+	uint32_t pageBudget;
+	/// The number of pages that may still
+	/// be compressed in the current sweep.
+	uint32_t pagesLeft;
+	/// The largest number of compressed bytes
+	/// that may be held. Zero means no limit.
+	uint64_t storeBudget;
+	/// The number of instructions, per
+	/// thread, to run between sweeps.
+	uint64_t sweepInterval;
+	/// The number of instructions run
+	/// since the last sweep.
+	uint64_t sinceSweep;
+public:
+	/// Default constructor
+	PageCompressor();
+	/// Count instructions run by the processes,
+	/// to determine when the next sweep is due.
+	/// @param steps The number of instructions
+	/// run on each thread.
+	/// @returns True if a sweep is due.
+	bool Advance(uint32_t steps) noexcept;
+	/// Start a new sweep. This resets the
+	/// number of pages that may be compressed.
+	void BeginSweep() noexcept { pagesLeft = pageBudget; }
+	/// Get the statistics of the compressor.
+	/// @returns The compression statistics.
+	auto GetStats() const noexcept { return stats; }
+	/// Get the number of idle sweeps after
+	/// which a section is compressed.
+	/// @returns The idle threshold.
+	auto GetIdleThreshold() const noexcept { return idleThreshold; }
+	/// Get the largest number of pages
+	/// compressed in a single sweep.
+	/// @returns The page budget.
+	auto GetPageBudget() const noexcept { return pageBudget; }
+	/// Get the largest number of compressed
+	/// bytes that may be held.
+	/// @returns The store budget, or zero if
+	/// there is no limit.
+	auto GetStoreBudget() const noexcept { return storeBudget; }
+	/// Set the number of idle sweeps after
+	/// which a section is compressed.
+	/// @param sweeps The new idle threshold.
+	void SetIdleThreshold(uint32_t sweeps) noexcept { idleThreshold = sweeps; }
+	/// Set the largest number of pages that
+	/// are compressed in a single sweep. This
+	/// bounds the time that a sweep takes.
+	/// @param pages The new page budget.
+	void SetPageBudget(uint32_t pages) noexcept { pageBudget = pages; }
+	/// Set the largest number of compressed
+	/// bytes that may be held. No more pages are
+	/// compressed once this has been reached.
+	/// @param bytes The new store budget, or
+	/// zero for no limit.
+	void SetStoreBudget(uint64_t bytes) noexcept { storeBudget = bytes; }
+	/// Set the number of instructions, per
+	/// thread, to run between sweeps.
+	/// @param steps The new sweep interval.
+	void SetSweepInterval(uint64_t steps) noexcept { sweepInterval = steps; }
+	/// Sweep the sections of a memory map.
+	/// The idle count of each section is updated,
+	/// and the sections that have been idle for
+	/// long enough are compressed, within the budgets.
+	/// @param memoryMap The memory map to sweep.
+	/// @returns The number of pages compressed.
+	uint32_t Sweep(MemoryMap &memoryMap);
+};
+
+} // namespace swanson
+
+#endif // SWANSON_PAGE_COMPRESSOR_HPP
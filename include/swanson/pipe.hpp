@@ -0,0 +1,230 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_PIPE_HPP
+#define SWANSON_PIPE_HPP
+
+#include <swanson/stream.hpp>
+#include <swanson/wait-queue.hpp>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class CPU;
+class HostSpan;
+class MemoryMap;
+class PipeEnd;
+class Process;
+class Thread;
+
+/// A buffer that one process writes to and
+/// another reads from. If a reader is waiting when
+/// data is written, the data is handed to the reader,
+/// which copies it to its own memory when it resumes.
+/// Otherwise, it's kept in a ring buffer until it's read.
+/// Threads that have to wait are blocked, so that the
+/// scheduler runs other processes in the meantime.
+class Pipe final {
+public:
+	/// The number of bytes that the ring
+	/// buffer of a pipe may hold.
+	static constexpr uint32_t capacity = 0x10000;
+private:
+	/// A thread that waits for data.
+	class Reader final {
+	public:
+		/// The process of the thread.
+		std::weak_ptr<Process> process;
+		/// The thread that made the read call.
+		Thread *thread;
+		/// The guest address of the buffer.
+		uint32_t address;
+		/// The number of bytes that may be read.
+		uint32_t size;
+		/// The queue that the thread waits on.
+		std::shared_ptr<WaitQueue> waitQueue;
+		/// The generation of the process when
+		/// the thread started waiting.
+		uint32_t generation;
+	};
+	/// Guards the state of the pipe.
+	std::mutex mutex;
+	/// The data that was written
+	/// and not yet read.
+	std::vector<unsigned char> buffer;
+	/// The offset of the first
+	/// byte to read in the buffer.
+	uint32_t readOffset;
+	/// The number of bytes in the buffer.
+	uint32_t used;
+	/// The threads that wait for data, in
+	/// the order that they started waiting.
+	/// There are only any while the buffer is empty.
+	std::deque<Reader> readers;
+	/// The threads that wait for
+	/// room in the buffer.
+	WaitQueue writeQueue;
+	/// The number of read ends that are open.
+	uint32_t readEnds;
+	/// The number of write ends that are open.
+	uint32_t writeEnds;
+public:
+	/// Create a pipe.
+	/// @returns The read end and the
+	/// write end of the pipe, in that order.
+	static std::pair<std::shared_ptr<PipeEnd>, std::shared_ptr<PipeEnd>> Create();
+	/// Default constructor. The pipe starts
+	/// with one read end and one write end.
+	Pipe();
+	/// Close one of the ends of the pipe. Once all
+	/// of the write ends are closed, waiting readers
+	/// read the end of the file. Once all of the read
+	/// ends are closed, writes fail with the broken
+	/// pipe error.
+	/// @param writeEnd Whether or not the
+	/// end is a write end.
+	void Close(bool writeEnd);
+	/// Read from the pipe on behalf of a system call.
+	/// If there's no data, and there are write ends
+	/// open, the thread is blocked and the result is
+	/// put in its first return register once data is
+	/// written. The process must have been created
+	/// with std::make_shared.
+	/// @param process The process that made the call.
+	/// @param cpu The CPU of the calling thread.
+	/// @param memoryMap The memory map of the process.
+	/// @param address The guest address to read to.
+	/// @param size The most bytes to read.
+	/// @param mayBlock If false, the call fails with
+	/// the try again error instead of blocking.
+	/// @param result Set to the result of the call,
+	/// if it finished.
+	/// @returns False if the thread was blocked.
+	bool Read(Process &process,
+	          CPU &cpu,
+	          MemoryMap &memoryMap,
+	          uint32_t address,
+	          uint32_t size,
+	          bool mayBlock,
+	          uint32_t &result);
+	/// Read data from the pipe for the host.
+	/// @param buf The buffer to read to.
+	/// @param bufSize The most bytes to read.
+	/// @returns The number of bytes read, which
+	/// is zero if the pipe is empty.
+	uint64_t ReadSome(void *buf, uint64_t bufSize);
+	/// Write to the pipe on behalf of a system call.
+	/// As much data is written as there is room for.
+	/// If there's no room at all, the thread is blocked
+	/// and the call is made again once it's woken.
+	/// @param process The process that made the call.
+	/// @param cpu The CPU of the calling thread.
+	/// @param memoryMap The memory map of the process.
+	/// @param address The guest address of the data.
+	/// @param size The number of bytes to write.
+	/// @param mayBlock If false, the call fails with
+	/// the try again error instead of blocking.
+	/// @param result Set to the result of the call,
+	/// if it finished.
+	/// @returns False if the thread was blocked.
+	bool Write(Process &process,
+	           CPU &cpu,
+	           MemoryMap &memoryMap,
+	           uint32_t address,
+	           uint32_t size,
+	           bool mayBlock,
+	           uint32_t &result);
+	/// Write data to the pipe for the host.
+	/// @param buf The data to write.
+	/// @param bufSize The number of bytes to write.
+	/// @returns The number of bytes written, which
+	/// is less than requested if the pipe is full.
+	uint64_t WriteSome(const void *buf, uint64_t bufSize);
+protected:
+	/// Read from the buffer into host memory. The
+	/// mutex must be held, and the spans must not
+	/// be larger than the data in the buffer.
+	/// @param spans The host memory to read to.
+	/// @returns The number of bytes read.
+	uint32_t ReadSpans(const std::vector<HostSpan> &spans);
+	/// Write host memory to the waiting readers,
+	/// and then to the buffer. The mutex must be held.
+	/// The memory of readers isn't written here, since
+	/// it may only be changed inside their world lock.
+	/// @param spans The host memory to write.
+	/// @param wakes Given the queues to wake
+	/// once the mutex is released.
+	/// @returns The number of bytes written.
+	uint32_t WriteSpans(const std::vector<HostSpan> &spans,
+	                    std::vector<std::shared_ptr<WaitQueue>> &wakes);
+};
+
+/// One end of a pipe, as it's
+/// opened by a process.
+class PipeEnd final : public Stream {
+	/// The pipe that the end belongs to.
+	std::shared_ptr<Pipe> pipe;
+	/// Whether or not the end is written to.
+	bool writeEnd;
+public:
+	/// Constructs a new pipe end.
+	/// @param pipe_ The pipe of the end.
+	/// @param writeEnd_ Whether or not
+	/// the end is written to.
+	PipeEnd(std::shared_ptr<Pipe> pipe_, bool writeEnd_) noexcept : pipe(pipe_), writeEnd(writeEnd_) { }
+	/// Closes the end of the pipe.
+	~PipeEnd();
+	/// Get the pipe of the end.
+	/// @returns The pipe.
+	const auto &GetPipe() const noexcept { return pipe; }
+	/// Indicates whether or not
+	/// the end is written to.
+	/// @returns True for a write end.
+	bool IsWriteEnd() const noexcept { return writeEnd; }
+	/// Read data that's in the pipe. An
+	/// exception is thrown if there isn't
+	/// enough of it, or if this is a write end.
+	/// @param buf The buffer to read to.
+	/// @param bufSize The number of bytes to read.
+	void Read(void *buf, uint64_t bufSize) override;
+	/// Read the data that's in the pipe. An
+	/// exception is thrown if this is a write end.
+	/// @param buf The buffer to read to.
+	/// @param bufSize The most bytes to read.
+	/// @returns The number of bytes read.
+	uint64_t ReadSome(void *buf, uint64_t bufSize) override;
+	/// Pipes have no position, so this
+	/// throws an exception.
+	void SetPosition(uint64_t) override;
+	/// Write data to the pipe. An exception
+	/// is thrown if it doesn't fit, or if
+	/// this is a read end.
+	/// @param buf The data to write.
+	/// @param bufSize The number of bytes to write.
+	void Write(const void *buf, uint64_t bufSize) override;
+};
+
+} // namespace swanson
+
+#endif // SWANSON_PIPE_HPP
@@ -0,0 +1,109 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_PROCESS_TABLE_HPP
+#define SWANSON_PROCESS_TABLE_HPP
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class Process;
+
+/// The processes known by the kernel, indexed
+/// by process ID. A process is live until it
+/// exits, after which it's kept as a zombie
+/// (so that its exit code may still be read)
+/// until it's reaped. Reaping drops the table's
+/// reference to the process, which releases its
+/// memory, and frees its ID to be used again.
+class ProcessTable final {
+	/// An entry of the table.
+	class Slot final {
+	public:
+		/// The process that has the ID of
+		/// the slot, or nullptr if it's free.
+		std::shared_ptr<Process> process;
+		/// The index of the process in the live
+		/// array, or @ref notLive if it exited.
+		size_t liveIndex;
+	};
+	/// The live index of a process
+	/// that isn't live.
+	static constexpr size_t notLive = SIZE_MAX;
+	/// The slots, indexed by process ID. The
+	/// first slot is never used, since zero isn't
+	/// a valid process ID. Slots are only added
+	/// as IDs are used for the first time.
+	std::vector<Slot> slots;
+	/// The live processes, in no particular order.
+	std::vector<std::shared_ptr<Process>> live;
+	/// The IDs that were freed by reaping. They're
+	/// used again, in the order that they were freed,
+	/// before any new slot is added, so the table only
+	/// grows to the most processes that it held at once.
+	std::deque<int> freeIDs;
+	/// The largest ID that may be used.
+	int maxID;
+public:
+	/// Constructs an empty process table.
+	/// @param maxID_ The largest process ID.
+	ProcessTable(int maxID_ = 4194304);
+	/// Add a process to the table, and give it
+	/// an ID. An exception is thrown if every
+	/// ID is used.
+	/// @param process The process to add.
+	/// @returns The ID of the process.
+	int Add(std::shared_ptr<Process> process);
+	/// Get the live processes, for iterating.
+	/// @returns The beginning iterator.
+	auto begin() const noexcept { return live.begin(); }
+	/// Get the live processes, for iterating.
+	/// @returns The ending iterator.
+	auto end() const noexcept { return live.end(); }
+	/// Mark a process as exited. It's removed
+	/// from the live processes, but keeps its ID
+	/// until it's reaped.
+	/// @param id The ID of the process.
+	/// @returns True if a live process had the ID.
+	bool Exit(int id);
+	/// Find a process, live or not, by its ID.
+	/// @param id The ID of the process.
+	/// @returns The process, or nullptr if
+	/// no process has the ID.
+	std::shared_ptr<Process> Find(int id) const noexcept;
+	/// Get the number of live processes.
+	/// @returns The number of live processes.
+	auto GetLiveCount() const noexcept { return live.size(); }
+	/// Get the number of processes in the
+	/// table, including ones that exited.
+	/// @returns The number of processes.
+	size_t GetCount() const noexcept;
+	/// Remove a process from the table, whether
+	/// it exited or not, and free its ID.
+	/// @param id The ID of the process.
+	/// @returns True if a process had the ID.
+	bool Reap(int id);
+};
+
+} // namespace swanson
+
+#endif // SWANSON_PROCESS_TABLE_HPP
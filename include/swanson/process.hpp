@@ -19,7 +19,15 @@
 #ifndef SWANSON_PROCESS_HPP
 #define SWANSON_PROCESS_HPP
 
+#include <swanson/world-lock.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <cstdint>
@@ -39,31 +47,149 @@ class FS;
 
 } // namespace vfs
 
+class CPU;
+class ImageCache;
+class IOWorkers;
 class Thread;
 class MemoryMap;
 class MemorySection;
 class InterruptHandler;
+class MemoryUsage;
 class Path;
+class Stream;
+class SyscallStats;
+class ThreadPool;
+class WaitQueue;
+
 /// A running process. It consists
 /// of threads, a memory map, a working
 /// directory, and a root directory.
-class Process final {
+class Process final : public std::enable_shared_from_this<Process> {
+public:
+	/// The weight of a process that
+	/// has an ordinary share of time.
+	static constexpr uint32_t defaultWeight = 1024;
+	/// A function that handles a system call. It's
+	/// given the memory map of the process, so that it
+	/// doesn't have to take a reference to it. The
+	/// result is put in the first argument register.
+	using SyscallHandler = std::function<void(Process &, CPU &, MemoryMap &)>;
+	/// Finishes a system call whose I/O ran on a
+	/// worker, by writing what it produced to guest
+	/// memory. It's called by the thread that made the
+	/// call, inside of the world lock, and returns the
+	/// result of the call.
+	using IOFinisher = std::function<uint32_t(MemoryMap &)>;
+private:
+	/// The state that a process is
+	/// rolled back to. It's defined in
+	/// the source file.
+	struct CaptureState;
+	/// I/O that finished on a worker, and that
+	/// waits to be delivered to its thread.
+	struct IOCompletion final {
+		/// The thread that made the system call.
+		Thread *thread;
+		/// Writes the results of the call.
+		IOFinisher finisher;
+	};
 	/// Used to read from and write to memory.
 	std::shared_ptr<MemoryMap> memoryMap;
 	/// Contains the command line arguments to
 	/// the process.
 	std::shared_ptr<MemorySection> argumentSection;
+	/// The section that the program break
+	/// moves within. It's reserved up front,
+	/// so that it grows without moving.
+	std::shared_ptr<MemorySection> heapSection;
+	/// The read only page that the time is
+	/// published in, or nullptr if the process
+	/// doesn't have one.
+	std::shared_ptr<MemorySection> timeSection;
+	/// Sections created by calls to mmap.
+	std::vector<std::shared_ptr<MemorySection>> mappings;
 	/// A pointer to the internally defined
 	/// interrupt handler.
 	std::shared_ptr<InterruptHandler> interruptHandler;
 	/// The array of threads currently used
 	/// by the process.
 	std::vector<std::shared_ptr<Thread>> threads;
+	/// The host threads that the threads of the
+	/// process run on. If this is nullptr, they
+	/// run one after another on the calling thread.
+	std::shared_ptr<ThreadPool> threadPool;
+	/// Entered by each thread while it runs,
+	/// and stopped to change the memory layout.
+	WorldLock worldLock;
+	/// Held while a system call is handled,
+	/// since they change the state of the process.
+	std::mutex syscallMutex;
+	/// Guards the parked flag and the wake handler,
+	/// so that a thread that's woken while the
+	/// process is being parked isn't missed.
+	std::mutex wakeMutex;
+	/// Set while the process is off of the run
+	/// queues, because all of its threads are blocked.
+	bool parked;
+	/// Called when a thread of a parked process
+	/// is woken, to put the process back on a
+	/// run queue.
+	std::function<void()> wakeHandler;
 	/// The array of process IDs that were
 	/// started by this process.
 	std::vector<int> childProcesses;
+	/// The streams opened by the process,
+	/// indexed by file descriptor.
+	std::vector<std::shared_ptr<Stream>> streams;
 	/// A pointer to the root file system.
 	std::shared_ptr<vfs::FS> root_fs;
+	/// Called by the snapshot system call, to
+	/// ask the kernel for a snapshot. If this is
+	/// empty, the call isn't supported.
+	std::function<void(Process &, CPU &)> snapshotHandler;
+	/// The state recorded by @ref Capture, or
+	/// nullptr if the process hasn't been captured.
+	std::unique_ptr<CaptureState> captureState;
+	/// System call handlers registered by the host,
+	/// indexed by system call number. They take the
+	/// place of the built in handlers.
+	std::vector<SyscallHandler> syscallHandlers;
+	/// Counts the system calls that the process
+	/// makes, or nullptr if they aren't counted.
+	std::shared_ptr<SyscallStats> syscallStats;
+	/// The host threads that the I/O of system
+	/// calls runs on. If this is nullptr, the I/O
+	/// runs on the thread that made the call.
+	std::shared_ptr<IOWorkers> ioWorkers;
+	/// Guards the finished I/O.
+	std::mutex ioMutex;
+	/// I/O that finished on a worker, which is
+	/// delivered before its thread runs again.
+	std::vector<IOCompletion> ioCompletions;
+	/// The number of finished I/O waiting to be
+	/// delivered. It's checked before each slice,
+	/// so the mutex is only taken if there's any.
+	std::atomic<uint32_t> ioPending;
+	/// The number of jobs given to the I/O
+	/// workers that haven't finished. It's
+	/// guarded by the I/O mutex.
+	uint32_t ioInFlight;
+	/// Notified once the last job
+	/// on the I/O workers finishes.
+	std::condition_variable ioDrained;
+	/// Counts the calls to @ref Rollback. Waits
+	/// and I/O are tagged with it when they start,
+	/// so that the ones left over from a run that
+	/// was rolled back are dropped. It's changed
+	/// with the I/O mutex held.
+	std::atomic<uint32_t> generation;
+	/// The host time spent running the
+	/// process, in nanoseconds.
+	std::atomic<uint64_t> cpuTime;
+	/// The images that execve loads programs
+	/// from. If this is nullptr, each call to
+	/// execve decodes its program again.
+	std::shared_ptr<ImageCache> imageCache;
 	/// The current working directory
 	/// of the process.
 	std::shared_ptr<Path> cwd;
@@ -72,34 +198,215 @@ class Process final {
 	/// The entry point of the process.
 	uint32_t entryPoint;
 	/// A flag that is set to true when
-	/// the processes has exited.
-	bool exited;
+	/// the processes has exited. It's atomic
+	/// since the host may kill the process
+	/// while one of its threads is running.
+	std::atomic<bool> exited;
 	/// The exit code of the process. This
 	/// field is only valid if the exit flag
 	/// is set to true.
 	int32_t exitCode;
+	/// The scheduling priority. Runnable processes
+	/// with a higher priority are always run first.
+	int priority;
+	/// The share of instructions that the process
+	/// gets, relative to processes of the same priority.
+	uint32_t weight;
+	/// The number of instructions, per thread, in
+	/// each slice. Zero means the scheduler's default.
+	uint32_t quantum;
 	/// The default stack size to use when
 	/// creating threads.
 	uint32_t defaultStackSize;
+	/// The largest size that the heap
+	/// may grow to.
+	uint32_t maxHeapSize;
+	/// The end of the memory occupied by
+	/// the loaded ELF segments.
+	uint32_t loadEnd;
 public:
 	/// Default constructor
 	Process();
 	/// Default deconstructor
-	~Process() { }
-	/// Exit the process.
+	~Process();
+	/// Add a section created by a call to mmap.
+	/// The section is added to the memory map.
+	/// @param section The section to add.
+	void AddMapping(std::shared_ptr<MemorySection> section);
+	/// Add an open stream to the process.
+	/// @param stream The stream to add.
+	/// @returns The file descriptor that the
+	/// process uses to refer to the stream.
+	int32_t AddStream(std::shared_ptr<Stream> stream);
+	/// Block the thread that a CPU belongs to on a
+	/// wait queue. This is called by system calls
+	/// that have to wait for something. The slice
+	/// of the thread ends, and it isn't run again
+	/// until it's woken. The lock that guards what's
+	/// being waited on should be held while calling
+	/// this, and while waking the queue, so that a
+	/// wake can't be missed. The process must have
+	/// been created with std::make_shared.
+	/// @param cpu The CPU of the thread to block.
+	/// @param waitQueue The wait queue to block on.
+	void Block(CPU &cpu, WaitQueue &waitQueue);
+	/// Indicates whether or not a system call may
+	/// give its I/O to @ref SubmitIO. This isn't the
+	/// case if the process has no I/O workers, or while
+	/// a batch of calls is run, since each result of a
+	/// batch is written as soon as the call returns.
+	/// @returns True if I/O may be submitted.
+	bool CanOffloadIO() const noexcept;
+	/// Cancel @ref Park, if the process is parked.
+	/// The wake handler isn't called.
+	void CancelPark();
+	/// Finish the system call of a blocked thread,
+	/// from outside of it. The result and any data
+	/// are delivered before the thread runs again,
+	/// so it should be woken afterwards. This may be
+	/// called from any host thread.
+	/// @param thread The thread that made the call.
+	/// @param result The result of the call.
+	/// @param address The guest address to copy
+	/// the data to.
+	/// @param data The data to copy.
+	/// @param generation The value of @ref GetGeneration
+	/// when the thread blocked. If the process has been
+	/// rolled back since, the call is dropped.
+	void CompleteIO(Thread *thread,
+	                uint32_t result,
+	                uint32_t address,
+	                std::vector<unsigned char> data,
+	                uint32_t generation);
+	/// Finish the system call of a blocked thread,
+	/// from outside of it, with a function that writes
+	/// the results to guest memory before the thread
+	/// runs again. This may be called from any host thread.
+	/// @param thread The thread that made the call.
+	/// @param finisher Writes the results of the call.
+	/// @param generation The value of @ref GetGeneration
+	/// when the thread blocked.
+	void CompleteIO(Thread *thread, IOFinisher finisher, uint32_t generation);
+	/// Record the state of the process, so that
+	/// it may be returned to with @ref Rollback. A
+	/// copy is kept of every page that isn't zeroed,
+	/// along with the position of each open stream,
+	/// and the dirty flags of each section are cleared.
+	/// None of the threads may be blocked.
+	/// Since checkpoints clear the dirty flags too, they
+	/// shouldn't be taken while a capture is held. The
+	/// process must not be running, unless this is
+	/// called by a system call with the world stopped.
+	void Capture();
+	/// Exit the process. Buffered
+	/// output is flushed.
 	/// @param exitCode_ The exit code assign
 	/// after the process has exited.
 	void Exit(int exitCode_);
+	/// Replace the program that the process
+	/// is running, as the execve call does. The
+	/// memory of the process is released, and the
+	/// thread that the CPU belongs to starts the
+	/// image from its entry point, with a new stack.
+	/// Open streams are kept. The process must
+	/// only have the one thread. The new image is
+	/// checked against the layout and the memory
+	/// limits before the old memory is released.
+	/// @param image The image to run. It's kept
+	/// alive while the process uses it.
+	/// @param args The command line arguments.
+	/// @param cpu The CPU of the calling thread.
+	/// @returns Zero on success. Otherwise, the
+	/// error number of the reason that the image
+	/// can't be run, in which case nothing is changed.
+	uint32_t Exec(std::shared_ptr<const elf::File> image,
+	              const std::vector<std::string> &args,
+	              CPU &cpu);
+	/// Find a system call handler that was
+	/// registered with @ref SetSyscallHandler.
+	/// @param type The system call number.
+	/// @returns The handler, or nullptr if none was
+	/// registered for the number.
+	const SyscallHandler *FindSyscallHandler(uint32_t type) const noexcept;
+	/// Find the thread that a CPU belongs to.
+	/// @param cpu The CPU of the thread.
+	/// @returns The thread, or nullptr if the
+	/// CPU isn't one of the process's threads.
+	Thread *FindThread(const CPU &cpu) const noexcept;
+	/// Write out the data that the open streams
+	/// have buffered. This is done when the process
+	/// exits, and by the kernel when a process is
+	/// removed, so that output isn't lost on a crash.
+	void FlushStreams();
 	/// Indicates whether or not the function
 	/// has exited.
 	/// @returns True if the process has exited,
 	/// false if it has not.
 	bool Exited() const noexcept { return exited; }
+	/// Indicates whether or not the process
+	/// has been captured with @ref Capture.
+	/// @returns True if there's a capture to roll back to.
+	bool HasCapture() const noexcept { return captureState != nullptr; }
 	/// Get the default stack size.
 	/// The default stack size is the size
 	/// used to create the stack for a new thread.
 	/// @returns The default stack size.
 	auto GetDefaultStackSize() const noexcept { return defaultStackSize; }
+	/// Get the number of times that the process
+	/// has been rolled back. What a thread waits on
+	/// is tagged with it, so that waits from before a
+	/// rollback can be told apart and dropped. This
+	/// may be read from any thread.
+	/// @returns The generation of the process.
+	uint32_t GetGeneration() const noexcept { return generation.load(std::memory_order_acquire); }
+	/// Get the host time spent running the
+	/// process. This may be read from any thread.
+	/// @returns The time, in nanoseconds.
+	uint64_t GetCPUTime() const noexcept { return cpuTime.load(std::memory_order_relaxed); }
+	/// Get the number of instructions that the
+	/// threads of the process have executed. This
+	/// must not be called while the process runs.
+	/// @returns The number of instructions executed.
+	uint64_t GetInstructionCount() const noexcept;
+	/// Get a thread of the process.
+	/// @param index The index of the thread.
+	/// @returns The thread, or nullptr if
+	/// the index is out of range.
+	std::shared_ptr<Thread> GetThread(size_t index) const;
+	/// Get the number of threads in the process.
+	/// @returns The number of threads.
+	auto GetThreadCount() const noexcept { return threads.size(); }
+	/// Get the largest size that the heap may grow to.
+	/// @returns The maximum heap size.
+	auto GetMaxHeapSize() const noexcept { return maxHeapSize; }
+	/// Get the memory usage of the process.
+	/// Its counters may be read from any thread.
+	/// @returns The memory usage of the process.
+	std::shared_ptr<MemoryUsage> GetMemoryUsage() const noexcept;
+	/// Get the host threads that the I/O
+	/// of system calls runs on.
+	/// @returns The I/O workers, or nullptr if I/O
+	/// runs on the threads that make the calls.
+	const auto &GetIOWorkers() const noexcept { return ioWorkers; }
+	/// Get the images that execve loads programs from.
+	/// @returns The image cache, or nullptr if
+	/// the process doesn't have one.
+	auto GetImageCache() const noexcept { return imageCache; }
+	/// Get the scheduling priority of the process.
+	/// @returns The priority of the process.
+	auto GetPriority() const noexcept { return priority; }
+	/// Get the number of instructions, per thread,
+	/// that the process runs in each slice.
+	/// @returns The quantum of the process, or zero
+	/// if it uses the scheduler's default.
+	auto GetQuantum() const noexcept { return quantum; }
+	/// Get the scheduling weight of the process.
+	/// @returns The weight of the process.
+	auto GetWeight() const noexcept { return weight; }
+	/// Get the current program break. This
+	/// is the end of the process heap.
+	/// @returns The address of the program break.
+	uint32_t GetProgramBreak() const noexcept;
 	/// Get the exit code (if the process is executed.)
 	/// @returns The exit code of the process.
 	/// If the process has not exited, this function
@@ -107,31 +414,343 @@ public:
 	int32_t GetExitCode() const noexcept { return exitCode; }
 	/// Get the processes memory map.
 	/// @returns The memory map of the process.
-	std::shared_ptr<MemoryMap> GetMemoryMap();
-	/// Kill the process.
+	const std::shared_ptr<MemoryMap> &GetMemoryMap() noexcept { return memoryMap; }
+	/// Get the root file system of the process.
+	/// @returns The root file system, or nullptr
+	/// if the process doesn't have one.
+	auto GetRootFS() const noexcept { return root_fs; }
+	/// Get the mutex that is held while a system
+	/// call is handled. Threads park in the world
+	/// lock while they wait for it.
+	/// @returns The system call mutex.
+	std::mutex &GetSyscallMutex() noexcept { return syscallMutex; }
+	/// Get the world lock of the process. It's
+	/// stopped to change the memory layout while
+	/// threads may be running.
+	/// @returns The world lock of the process.
+	WorldLock &GetWorldLock() noexcept { return worldLock; }
+	/// Get the counters of the system calls
+	/// made by the process.
+	/// @returns The system call statistics, or
+	/// nullptr if calls aren't counted.
+	const auto &GetSyscallStats() const noexcept { return syscallStats; }
+	/// Get a stream opened by the process.
+	/// @param fd The file descriptor of the stream.
+	/// @returns The stream, or nullptr if the
+	/// file descriptor is not open.
+	std::shared_ptr<Stream> GetStream(uint32_t fd) const;
+	/// Indicates whether or not the process has a
+	/// thread that may run. A process that exited
+	/// has no runnable threads.
+	/// @returns True if a thread may run.
+	bool IsRunnable() const noexcept;
+	/// Kill the process. It's marked as having
+	/// exited, its threads are told to stop, and
+	/// it's woken if it was parked, so that the
+	/// scheduler runs it once more and reports it.
+	/// This may be called from any host thread.
 	void Kill();
+	/// Take the process off of the run queues,
+	/// unless a thread was woken since it last
+	/// ran. This is called by the scheduler.
+	/// @param wakeHandler_ Called, once, when a
+	/// thread of the parked process is woken.
+	/// @returns True if the process was parked, false
+	/// if it has a runnable thread or was killed.
+	bool Park(std::function<void()> wakeHandler_);
+	/// End the slice that the threads of the
+	/// process are running, once their current
+	/// instructions finish. This may be called from
+	/// any host thread. If the process isn't running,
+	/// its next slice ends right away.
+	void Preempt() noexcept;
 	/// Load an ELF file into the process.
+	/// A @ref MemoryLimit exception is thrown,
+	/// before anything is loaded, if the file
+	/// would exceed the hard memory limit.
 	/// @param file The ELF file to load.
 	void Load(const elf::File &file);
+	/// Load a cached ELF image into the process.
+	/// Segments that can't be written to view the
+	/// image instead of being copied, so they're
+	/// shared by every process loaded from it.
+	/// Like the other overload, nothing is loaded
+	/// if the image would exceed the hard limit.
+	/// @param image The image to load. It's kept
+	/// alive while the process uses it.
+	void Load(std::shared_ptr<const elf::File> image);
 	/// Load an ELF segment into the process.
 	/// @param segment The segment to load.
 	void Load(const elf::Segment &segment);
+	/// Map the time page at @ref syscalls::time_page,
+	/// if it isn't mapped already. It's kept across
+	/// execve, and updated before each slice.
+	void MapTimePage();
+	/// Remove a section that was created by a
+	/// call to mmap. Only whole mappings may
+	/// be removed.
+	/// @param addr The address of the mapping.
+	/// @param size The size of the mapping,
+	/// rounded up to a multiple of the page size.
+	/// @returns True if the mapping was removed,
+	/// false if no mapping matched.
+	bool RemoveMapping(uint32_t addr, uint32_t size);
+	/// Remove a stream from the process.
+	/// @param fd The file descriptor of the stream.
+	/// @returns True if the stream was removed,
+	/// false if the file descriptor was not open.
+	bool RemoveStream(uint32_t fd);
+	/// Ask for a snapshot of the kernel, on behalf of
+	/// the snapshot system call. The snapshot handler
+	/// is expected to block the calling thread until
+	/// the snapshot is written.
+	/// @param cpu The CPU of the calling thread.
+	/// @returns False if the process has no
+	/// snapshot handler.
+	bool RequestSnapshot(CPU &cpu);
+	/// Restore the process from a checkpoint.
+	/// The checkpoint records are applied in order,
+	/// until the end of the stream is reached. The
+	/// first record must be a full image.
+	/// @param stream The stream to read the
+	/// checkpoint records from.
+	void Restore(std::istream &stream);
+	/// Restore the process from a record of a kernel
+	/// snapshot, written by @ref SaveSnapshot. Memory
+	/// sections are mapped privately from the snapshot
+	/// file, so their pages are only read as they're
+	/// touched. Everything the process had is replaced.
+	/// @param stream The stream to read the record from.
+	/// @param path The path of the snapshot file.
+	void RestoreSnapshot(std::istream &stream, const std::string &path);
+	/// Write a record of the process to a kernel
+	/// snapshot. The contents of each memory section
+	/// go to the data stream, at a multiple of the host
+	/// page size so that they may be mapped back, and
+	/// the record refers to them by offset. Zeroed pages
+	/// are skipped over, leaving holes in the file. Open
+	/// streams aren't saved, and threads that are blocked
+	/// are restored awake. The process must not be running.
+	/// @param stream The stream to write the record to.
+	/// @param data The stream to write the memory to.
+	/// It's the snapshot file, so it must be seekable.
+	void SaveSnapshot(std::ostream &stream, std::ostream &data);
+	/// Write a checkpoint record of the process.
+	/// This contains the state of each thread and
+	/// the layout of each memory section. A full
+	/// record contains every page of memory, while
+	/// an incremental one contains only the pages
+	/// written to since the last checkpoint.
+	/// @param stream The stream to write the record to.
+	/// @param full Whether or not to write a full image.
+	void SaveCheckpoint(std::ostream &stream, bool full);
+	/// Return the process to the state recorded by
+	/// @ref Capture. Only the pages written to since
+	/// the capture (or the last rollback) are copied
+	/// back. Threads, registers, sections, the program
+	/// break and open streams (with their positions)
+	/// are all put back, and the exit flag is cleared.
+	/// I/O on the workers is waited for first, and
+	/// what's left of the run is dropped: finished I/O
+	/// that wasn't delivered, and the waits of blocked
+	/// threads. The process must not be running. An
+	/// exception is thrown if it hasn't been captured.
+	/// @returns The number of pages copied back.
+	uint32_t Rollback();
 	/// Set the default stack size.
 	/// @param size The new default stack size.
 	void SetDefaultStackSize(uint32_t size) noexcept { defaultStackSize = size; }
+	/// Set the limits on the memory committed
+	/// by the process. Memory allocations that
+	/// would exceed the hard limit fail, while
+	/// crossing the soft limit is only counted.
+	/// @param softLimit The soft limit, in bytes,
+	/// or zero for no soft limit.
+	/// @param hardLimit The hard limit, in bytes,
+	/// or zero for no hard limit.
+	void SetMemoryLimits(uint64_t softLimit, uint64_t hardLimit) noexcept;
+	/// Set the largest size that the heap may grow
+	/// to. This only has an effect if it's called
+	/// before an ELF file is loaded.
+	/// @param size The new maximum heap size.
+	void SetMaxHeapSize(uint32_t size) noexcept { maxHeapSize = size; }
+	/// Move the program break. The heap grows in
+	/// place, so this doesn't copy the heap.
+	/// @param addr The new address of the program break.
+	/// @returns True if the program break was moved,
+	/// false if the address is outside of the heap or
+	/// the hard memory limit would be exceeded.
+	bool SetProgramBreak(uint32_t addr);
+	/// Get the ID of the process.
+	/// @returns The ID of the process.
+	int GetID() const noexcept { return id; }
 	/// Set the ID of the process.
 	/// @param id_ The new ID of the process.
 	void SetID(int id_) { id = id_; }
+	/// Set the scheduling priority of the process.
+	/// The scheduler always runs the runnable process
+	/// with the highest priority first, so a process
+	/// that never blocks starves those below it.
+	/// @param priority_ The new priority. Zero is
+	/// the priority of an ordinary process.
+	void SetPriority(int priority_) noexcept { priority = priority_; }
+	/// Set the number of instructions, per
+	/// thread, that the process runs in each slice.
+	/// @param quantum_ The new quantum, or zero
+	/// to use the scheduler's default.
+	void SetQuantum(uint32_t quantum_) noexcept { quantum = quantum_; }
+	/// Set the scheduling weight of the process.
+	/// Among processes of the same priority, each
+	/// runs a number of instructions in proportion
+	/// to its weight.
+	/// @param weight_ The new weight. A weight of
+	/// zero is treated as a weight of one.
+	void SetWeight(uint32_t weight_) noexcept { weight = (weight_ > 0) ? weight_ : 1; }
 	/// Set the root file system for the process.
 	/// @param root_fs_ The new root file system.
 	void SetRootFS(std::shared_ptr<vfs::FS> root_fs_);
+	/// Set the function that the snapshot system
+	/// call asks the kernel for a snapshot with.
+	/// @param snapshotHandler_ The new snapshot handler.
+	void SetSnapshotHandler(std::function<void(Process &, CPU &)> snapshotHandler_);
+	/// Open a stream at a specific file descriptor,
+	/// replacing any stream that's open there. This is
+	/// how the host connects the standard streams of a
+	/// process to something other than its own.
+	/// @param fd The file descriptor of the stream.
+	/// @param stream The stream to open.
+	void SetStream(uint32_t fd, std::shared_ptr<Stream> stream);
+	/// Set the host threads that the I/O of system
+	/// calls runs on. While a thread waits on its I/O
+	/// it's blocked, so the others keep running.
+	/// @param ioWorkers_ The new I/O workers, or
+	/// nullptr to run I/O on the calling threads.
+	void SetIOWorkers(std::shared_ptr<IOWorkers> ioWorkers_) noexcept;
+	/// Set the images that execve loads programs from.
+	/// @param imageCache_ The new image cache.
+	void SetImageCache(std::shared_ptr<ImageCache> imageCache_) noexcept;
+	/// Register a handler for a system call. It takes
+	/// the place of the built in handler, if there is
+	/// one, so the host may add system calls of its own
+	/// or change how existing ones behave. Handlers are
+	/// called with the system call mutex held.
+	/// @param type The system call number. An exception
+	/// is thrown if it isn't less than @ref syscalls::tableSize.
+	/// @param handler The new handler, or an empty
+	/// function to go back to the built in handler.
+	void SetSyscallHandler(uint32_t type, SyscallHandler handler);
+	/// Set the counters that the system calls made
+	/// by the process are recorded in. Several processes
+	/// may share the same counters.
+	/// @param syscallStats_ The system call statistics,
+	/// or nullptr to stop counting calls.
+	void SetSyscallStats(std::shared_ptr<SyscallStats> syscallStats_) noexcept;
+	/// Set the host threads that the threads of
+	/// the process run on. Threads only run on the
+	/// pool if the memory map is not being profiled.
+	/// @param threadPool_ The new thread pool, or
+	/// nullptr to run the threads one after another.
+	void SetThreadPool(std::shared_ptr<ThreadPool> threadPool_) noexcept;
+	/// Run a stream operation on the I/O workers,
+	/// on behalf of a system call. The thread that
+	/// the CPU belongs to is blocked until it's done.
+	/// Then any data the operation returns is copied
+	/// to guest memory and the result is put in its
+	/// first return register, before it runs again.
+	/// Operations on the same stream run in order. The
+	/// stream shouldn't be used by the calling thread
+	/// while the operation may be running. The process
+	/// must have been created with std::make_shared,
+	/// and must have I/O workers.
+	/// @param cpu The CPU of the calling thread.
+	/// @param stream The stream that's operated on.
+	/// @param address The guest address to copy
+	/// the returned data to.
+	/// @param operation Called on an I/O worker. It
+	/// returns the result of the system call, and may
+	/// fill in the data to copy to guest memory. If it
+	/// throws an exception, the call fails with an
+	/// I/O error.
+	void SubmitIO(CPU &cpu,
+	              std::shared_ptr<Stream> stream,
+	              uint32_t address,
+	              std::function<uint32_t(std::vector<unsigned char> &)> operation);
+	/// Run a stream operation on the I/O workers,
+	/// like the other overload, for calls that write
+	/// more than one buffer of guest memory. Guest
+	/// memory may change while the operation runs, so
+	/// it must only use host memory. What it writes
+	/// back is done by the function it returns.
+	/// @param cpu The CPU of the calling thread.
+	/// @param stream The stream that's operated on.
+	/// @param operation Called on an I/O worker. It
+	/// returns the function that finishes the call.
+	/// If it throws an exception, the call fails
+	/// with an I/O error.
+	void SubmitIO(CPU &cpu,
+	              std::shared_ptr<Stream> stream,
+	              std::function<IOFinisher()> operation);
 	/// Allow each of the threads in the
 	/// process to run for a specified number
-	/// of instructions.
+	/// of instructions. Blocked threads don't run.
 	/// @param steps The number of instructions
 	/// to execute on each thread.
-	void Step(uint32_t steps);
+	/// @returns The number of instructions
+	/// executed by all of the threads.
+	uint64_t Step(uint32_t steps);
+	/// Wake a blocked thread of the process. If
+	/// the process is parked, its wake handler is
+	/// called. This may be called from any host thread.
+	/// @param thread The thread to wake.
+	/// @param generation The value of @ref GetGeneration
+	/// when the thread blocked.
+	/// @returns False if the process has been rolled
+	/// back since, in which case nothing is done.
+	bool Wake(Thread &thread, uint32_t generation);
 protected:
+	/// Reserve the heap section, just
+	/// past the loaded ELF segments.
+	void CreateHeap();
+	/// Deliver the finished I/O of a thread, if
+	/// there is any. This is done inside of the
+	/// world lock, before the thread runs.
+	/// @param thread The thread to deliver to.
+	void DeliverIO(Thread &thread);
+	/// Map a new stack for a thread, and
+	/// point the stack pointer at its top.
+	/// @param thread The thread to give the stack.
+	void CreateStack(Thread &thread);
+	/// Throw a @ref MemoryLimit exception if
+	/// the segments of an ELF file would exceed
+	/// the hard memory limit.
+	/// @param file The file to check.
+	void CheckLoadSize(const elf::File &file);
+	/// Load the segments of a cached image.
+	/// Read-only segments view the image, and
+	/// the rest are copied.
+	/// @param image The image to load.
+	void LoadImage(const std::shared_ptr<const elf::File> &image);
+	/// Apply one checkpoint record to the process.
+	/// @param stream The stream to read the record from.
+	/// @param first Whether or not this is the first
+	/// record of the checkpoint.
+	void RestoreRecord(std::istream &stream, bool first);
+	/// Run each thread that isn't blocked
+	/// for a number of instructions.
+	/// @param steps The number of instructions
+	/// to execute on each thread.
+	/// @returns The number of instructions
+	/// executed by all of the threads.
+	uint64_t RunThreads(uint32_t steps);
+	/// Run a thread for a number of instructions,
+	/// inside of the world lock.
+	/// @param threadID The index of the thread.
+	/// @param steps The number of instructions to run.
+	/// @returns The number of instructions executed.
+	uint32_t StepThread(size_t threadID, uint32_t steps);
+	/// Write the current time and the accounting
+	/// of the process to the time page.
+	void UpdateTimePage();
 	/// Add a thread to the process.
 	/// @param thread The thread to add.
 	void AddThread(std::shared_ptr<Thread> &thread);
@@ -0,0 +1,295 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_SCHEDULER_HPP
+#define SWANSON_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+namespace swanson {
+
+class Process;
+
+/// The types of events that the
+/// scheduler reports to the kernel.
+enum class SchedulerEventType {
+	/// The process called exit.
+	Exited,
+	/// The process threw an exception,
+	/// like a segfault or a bad instruction.
+	Faulted
+};
+
+/// Something that happened to a process
+/// while the scheduler was running it. The
+/// process is no longer scheduled afterwards.
+class SchedulerEvent final {
+public:
+	/// What happened to the process.
+	SchedulerEventType type;
+	/// The process that the event is for.
+	std::shared_ptr<Process> process;
+	/// The exception that the process
+	/// threw, if it faulted.
+	std::exception_ptr fault;
+};
+
+/// Runs processes on a group of host threads.
+/// Each host thread has its own run queue, and
+/// runs the processes on it for a slice of
+/// instructions at a time. A host thread that
+/// runs out of processes steals them from the
+/// other run queues. Processes that exit or
+/// fault are taken off the run queues and
+/// reported with @ref WaitEvent, so that they
+/// don't stop any of the other processes.
+///
+/// The process with the highest priority runs
+/// first. Processes of the same priority share
+/// time by the instructions that they execute:
+/// each one has a virtual time, which grows by
+/// the instructions it executes divided by its
+/// weight, and the one with the least virtual
+/// time runs next.
+///
+/// A process whose threads are all blocked is
+/// parked off of the run queues, and is queued
+/// again when one of its threads is woken. Host
+/// threads with nothing to run sleep until a
+/// process is queued, so idle processes cost
+/// no host time.
+class Scheduler final {
+	/// A process on a run queue.
+	class Entry final {
+	public:
+		/// The process to run.
+		std::shared_ptr<Process> process;
+		/// The instructions executed by the process,
+		/// scaled by the inverse of its weight.
+		uint64_t virtualTime;
+		/// The priority of the process,
+		/// when it was queued.
+		int priority;
+		/// The order that the process was queued
+		/// in, so that ties are run in turn.
+		uint64_t sequence;
+	};
+	/// Orders entries by the
+	/// order that they run in.
+	class EntryOrder final {
+	public:
+		/// Compare two entries.
+		/// @param a The first entry.
+		/// @param b The second entry.
+		/// @returns True if the first
+		/// entry runs before the second.
+		bool operator () (const Entry &a, const Entry &b) const noexcept {
+			if (a.priority != b.priority)
+				return a.priority > b.priority;
+			else if (a.virtualTime != b.virtualTime)
+				return a.virtualTime < b.virtualTime;
+			else
+				return a.sequence < b.sequence;
+		}
+	};
+	/// The processes waiting
+	/// for a host thread.
+	class RunQueue final {
+	public:
+		/// Guards the members below.
+		std::mutex mutex;
+		/// The processes, in the order
+		/// that they're run in.
+		std::set<Entry, EntryOrder> entries;
+		/// The virtual time of the last process
+		/// taken from the queue. Processes that are
+		/// added or stolen start from this time.
+		uint64_t minVirtualTime;
+		/// The process that the host thread
+		/// is running, or nullptr if it isn't.
+		std::shared_ptr<Process> current;
+		/// The priority of the current process.
+		int currentPriority;
+		/// Default constructor
+		RunQueue() noexcept : minVirtualTime(0), currentPriority(0) { }
+	};
+	/// The run queues, one
+	/// for each host thread.
+	std::vector<std::unique_ptr<RunQueue>> runQueues;
+	/// The host threads.
+	std::vector<std::thread> workers;
+	/// Guards the events, and is held
+	/// by threads to wait on the signals.
+	std::mutex mutex;
+	/// Signaled when a process is queued,
+	/// when the scheduler is resumed or
+	/// when it's stopping.
+	std::condition_variable workQueued;
+	/// Signaled when an event is reported.
+	std::condition_variable eventQueued;
+	/// Signaled when a paused scheduler
+	/// has no slices left running.
+	std::condition_variable slicesDone;
+	/// The events that haven't
+	/// been waited on yet.
+	std::deque<SchedulerEvent> events;
+	/// The entries of the parked processes,
+	/// kept for when they're woken.
+	std::map<Process *, Entry> parkedEntries;
+	/// The number of processes on
+	/// all of the run queues.
+	std::atomic<size_t> queued;
+	/// The number of host threads
+	/// that are running a slice, or
+	/// are about to take a process.
+	std::atomic<size_t> running;
+	/// The number of host threads
+	/// waiting for a process.
+	std::atomic<size_t> idle;
+	/// The run queue that the next
+	/// added process is placed on.
+	std::atomic<size_t> nextQueue;
+	/// The sequence number of the
+	/// next entry that's queued.
+	std::atomic<uint64_t> nextSequence;
+	/// The number of instructions, per thread,
+	/// in the slices of processes that don't
+	/// have a quantum of their own.
+	std::atomic<uint32_t> sliceSteps;
+	/// The number of instructions
+	/// executed by all of the slices.
+	std::atomic<uint64_t> stepCount;
+	/// Set while the scheduler is paused.
+	std::atomic<bool> paused;
+	/// Set when the scheduler is destroyed.
+	std::atomic<bool> stopping;
+public:
+	/// Start the host threads of the scheduler.
+	/// @param workerCount The number of host threads.
+	/// If this is zero, one is started for each core.
+	Scheduler(unsigned int workerCount = 0);
+	/// Stops and joins the host threads. The
+	/// slices that are running are finished first.
+	~Scheduler();
+	/// Schedulers may not be copied.
+	Scheduler(const Scheduler &) = delete;
+	/// Schedulers may not be copied.
+	Scheduler &operator = (const Scheduler &) = delete;
+	/// Add a process to be run. It's placed on
+	/// the run queues in turn, and is run until it
+	/// exits or faults. The process must not be
+	/// stepped by anything else while it's scheduled.
+	/// If it has a higher priority than the process
+	/// running on its queue, that process is preempted.
+	/// @param process The process to add.
+	void Add(std::shared_ptr<Process> process);
+	/// Get the number of processes that are
+	/// parked, because all of their threads
+	/// are blocked.
+	/// @returns The number of parked processes.
+	size_t GetParkedCount();
+	/// Get the number of host threads.
+	/// @returns The number of host threads.
+	auto GetWorkerCount() const noexcept { return workers.size(); }
+	/// Get the number of instructions, per thread,
+	/// that each slice runs a process for, unless
+	/// the process has a quantum of its own.
+	/// @returns The number of instructions in a slice.
+	uint32_t GetSliceSteps() const noexcept { return sliceSteps; }
+	/// Get the number of instructions that
+	/// have been executed by all of the slices
+	/// since the scheduler was started.
+	/// @returns The number of instructions executed.
+	uint64_t GetStepCount() const noexcept { return stepCount; }
+	/// Stop taking processes off of the run
+	/// queues, and wait for the slices that are
+	/// running to finish. None of the scheduled
+	/// processes are running once this returns.
+	void Pause();
+	/// Continue running processes,
+	/// after the scheduler was paused.
+	void Resume();
+	/// Set the number of instructions, per thread,
+	/// that each slice runs a process for, unless
+	/// the process has a quantum of its own.
+	/// @param steps The number of instructions in a slice.
+	void SetSliceSteps(uint32_t steps) noexcept { sliceSteps = steps; }
+	/// Wait for a process to exit or fault.
+	/// @param event Receives the event.
+	void WaitEvent(SchedulerEvent &event);
+	/// Wait for a process to exit or fault.
+	/// @param event Receives the event.
+	/// @param timeout The longest time to wait.
+	/// @returns True if an event was received,
+	/// false if the time ran out first.
+	bool WaitEvent(SchedulerEvent &event, std::chrono::milliseconds timeout);
+protected:
+	/// Run processes until the scheduler stops.
+	/// @param index The index of the host thread.
+	void Work(size_t index);
+	/// Queue a process on a run queue, and
+	/// preempt the process that the queue's
+	/// host thread is running if it has a
+	/// lower priority.
+	/// @param runQueue The run queue.
+	/// @param entry The entry of the process.
+	/// @returns The number of entries on the queue.
+	size_t Queue(RunQueue &runQueue, Entry &&entry);
+	/// Take the next process to run, from
+	/// the thread's own run queue if it has
+	/// any, or from the others if it doesn't.
+	/// @param index The index of the host thread.
+	/// @param entry Receives the entry of the process.
+	/// @returns True if a process was taken.
+	bool Take(size_t index, Entry &entry);
+	/// Run a process for a slice, then either
+	/// queue it again or report what happened to it.
+	/// @param index The index of the host thread.
+	/// @param entry The entry of the process.
+	void RunSlice(size_t index, Entry &entry);
+	/// Park a process whose threads are all
+	/// blocked, or queue it again if one of them
+	/// was woken since it ran.
+	/// @param index The index of the host thread.
+	/// @param entry The entry of the process.
+	void Park(size_t index, Entry &&entry);
+	/// Queue a parked process again, after
+	/// one of its threads was woken.
+	/// @param process The parked process.
+	void Unpark(Process *process);
+	/// Report an event to the kernel.
+	/// @param event The event to report.
+	void Report(SchedulerEvent &&event);
+	/// Wake an idle host thread, if there is one.
+	void WakeIdle();
+};
+
+} // namespace swanson
+
+#endif // SWANSON_SCHEDULER_HPP
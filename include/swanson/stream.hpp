@@ -18,10 +18,14 @@
 #ifndef SWANSON_STREAM_HPP
 #define SWANSON_STREAM_HPP
 
+#include <memory>
+
 #include <cstdint>
 
 namespace swanson {
 
+class HostMapping;
+
 /// An arbitrary stream. This is
 /// the Linux equivalent of a character
 /// device.
@@ -37,10 +41,51 @@ public:
 	/// @param buf The buffer to put the data into.
 	/// @param bufSize The number of bytes to read.
 	virtual void Read(void *buf, uint64_t bufSize) = 0;
+	/// Write out data that the stream has
+	/// buffered. The default implementation
+	/// does nothing, since most streams
+	/// don't buffer.
+	virtual void Flush();
+	/// Reads as much data as is available, up to
+	/// the size of a buffer. This is what the read
+	/// system call uses, since it has to report how
+	/// much was read. The default implementation
+	/// calls @ref Read and reports the whole buffer.
+	/// @param buf The buffer to put the data into.
+	/// @param bufSize The most bytes to read.
+	/// @returns The number of bytes read.
+	virtual uint64_t ReadSome(void *buf, uint64_t bufSize);
+	/// Get the position of the stream. The
+	/// default implementation throws an
+	/// exception, for streams without one.
+	/// @returns The position of the stream.
+	virtual uint64_t GetPosition();
+	/// Get the size of the stream. The
+	/// default implementation throws an
+	/// exception, for streams without one.
+	/// @returns The number of bytes in the stream.
+	virtual uint64_t GetSize();
 	/// Set the position of the stream.
 	/// @param position The new position
 	/// of the stream.
 	virtual void SetPosition(uint64_t position) = 0;
+	/// Map part of the stream into host memory,
+	/// so that it may be viewed without copying.
+	/// Streams that can't be mapped return nullptr,
+	/// which is what the default implementation does.
+	/// @param offset The offset of the stream to
+	/// start the mapping at.
+	/// @param size The number of bytes to map.
+	/// @param writable Whether or not the mapping
+	/// may be written to.
+	/// @param shared Whether or not writes to the
+	/// mapping should be carried through to the stream.
+	/// @returns The host mapping, or nullptr if the
+	/// stream can't be mapped.
+	virtual std::shared_ptr<HostMapping> Map(uint64_t offset,
+	                                         uint32_t size,
+	                                         bool writable,
+	                                         bool shared);
 	/// Decode a 64-bit, big-endian number
 	/// from the stream.
 	/// @param n The variable to assign the
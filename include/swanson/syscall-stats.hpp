@@ -0,0 +1,107 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_SYSCALL_STATS_HPP
+#define SWANSON_SYSCALL_STATS_HPP
+
+#include <swanson/syscalls.hpp>
+
+#include <atomic>
+
+#include <cstdint>
+
+namespace swanson {
+
+/// Counts the system calls made by processes,
+/// and how long each kind takes to handle. The
+/// latencies of each kind are kept in a histogram
+/// of power of two buckets. The counters are
+/// updated as calls are handled, and they may be
+/// read from any thread without locking.
+class SyscallStats final {
+public:
+	/// The number of buckets in each histogram.
+	/// Bucket zero counts calls that took less than
+	/// two nanoseconds, bucket N counts calls that
+	/// took from 2^N up to 2^(N+1) nanoseconds, and
+	/// the last bucket counts everything longer.
+	static constexpr uint32_t bucketCount = 32;
+private:
+	/// The counters of one kind of system call.
+	struct Entry final {
+		/// The number of calls handled.
+		std::atomic<uint64_t> calls;
+		/// The time spent handling them,
+		/// in nanoseconds.
+		std::atomic<uint64_t> totalTime;
+		/// The number of calls that fall
+		/// into each latency bucket.
+		std::atomic<uint64_t> buckets[bucketCount];
+	};
+	/// The counters of each system call,
+	/// indexed by system call number.
+	Entry entries[syscalls::tableSize];
+public:
+	/// Default constructor
+	SyscallStats() noexcept;
+	/// Default deconstructor
+	~SyscallStats() { }
+	/// Get the bucket of the histogram that
+	/// a latency is counted in.
+	/// @param nanoseconds The latency of a call.
+	/// @returns The index of the bucket.
+	static uint32_t GetBucket(uint64_t nanoseconds) noexcept;
+	/// Get the number of calls of a kind
+	/// that have been handled.
+	/// @param type The system call number.
+	/// @returns The number of calls, or zero
+	/// if the number is out of range.
+	uint64_t GetCallCount(uint32_t type) const noexcept;
+	/// Get the number of calls of a kind
+	/// that fall into a latency bucket.
+	/// @param type The system call number.
+	/// @param bucket The index of the bucket.
+	/// @returns The number of calls in the bucket,
+	/// or zero if either index is out of range.
+	uint64_t GetBucketCount(uint32_t type, uint32_t bucket) const noexcept;
+	/// Get the time spent handling
+	/// calls of a kind.
+	/// @param type The system call number.
+	/// @returns The total time, in nanoseconds.
+	uint64_t GetTotalTime(uint32_t type) const noexcept;
+	/// Estimate a percentile of the latency of
+	/// a kind of call, from its histogram. The
+	/// estimate is the upper bound of the bucket
+	/// that the percentile falls into.
+	/// @param type The system call number.
+	/// @param percentile The percentile, from
+	/// zero to one hundred.
+	/// @returns The estimated latency, in nanoseconds,
+	/// or zero if no calls of the kind were handled.
+	uint64_t GetPercentile(uint32_t type, double percentile) const noexcept;
+	/// Count a call that was handled.
+	/// @param type The system call number.
+	/// Calls that are out of range aren't counted.
+	/// @param nanoseconds The time it took to handle.
+	void Record(uint32_t type, uint64_t nanoseconds) noexcept;
+	/// Set every counter back to zero.
+	void Reset() noexcept;
+};
+
+} // namespace swanson
+
+#endif // SWANSON_SYSCALL_STATS_HPP
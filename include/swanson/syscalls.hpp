@@ -18,30 +18,109 @@
 #ifndef SWANSON_SYSCALLS_HPP
 #define SWANSON_SYSCALLS_HPP
 
+#include <cstdint>
+
 namespace swanson {
 
 namespace syscalls {
 
 constexpr uint32_t exit = 1;
 
+/// Opens a file of the root file system. The first
+/// argument is the address of the path, the second
+/// is a set of flags and the third (the permissions
+/// of a new file) is ignored. The flags have the
+/// values that newlib uses. The call returns the
+/// lowest file descriptor that's free, past the
+/// standard streams.
 constexpr uint32_t open = 2;
 
+/// The access mode bits of the open flags.
+constexpr uint32_t open_access_mask = 0x03;
+
+/// The access mode of a file opened for reading.
+constexpr uint32_t open_read_only = 0x00;
+
+/// The access mode of a file opened for writing.
+constexpr uint32_t open_write_only = 0x01;
+
+/// The access mode of a file opened
+/// for both reading and writing.
+constexpr uint32_t open_read_write = 0x02;
+
+/// An open flag. Writes go to the end of the file.
+constexpr uint32_t open_append = 0x0008;
+
+/// An open flag. The file is
+/// created if it doesn't exist.
+constexpr uint32_t open_create = 0x0200;
+
+/// An open flag. A file opened
+/// for writing is truncated.
+constexpr uint32_t open_truncate = 0x0400;
+
+/// An open flag. Along with @ref open_create,
+/// the call fails if the file already exists.
+constexpr uint32_t open_exclusive = 0x0800;
+
 constexpr uint32_t close = 3;
 
 constexpr uint32_t read = 4;
 
 constexpr uint32_t write = 5;
 
+/// Sets the position of an open file. The first
+/// argument is the file descriptor, the second is
+/// the signed offset and the third says what the
+/// offset is from. The call returns the new position.
+/// Pipes and the console can't be seeked.
 constexpr uint32_t lseek = 6;
 
+/// An lseek origin. The offset is
+/// from the start of the file.
+constexpr uint32_t seek_set = 0;
+
+/// An lseek origin. The offset is
+/// from the current position.
+constexpr uint32_t seek_cur = 1;
+
+/// An lseek origin. The offset is
+/// from the end of the file.
+constexpr uint32_t seek_end = 2;
+
 constexpr uint32_t unlink = 7;
 
 constexpr uint32_t getpid = 8;
 
 constexpr uint32_t kill = 9;
 
+/// Describes an open file. The first argument is
+/// the file descriptor and the second is the address
+/// of @ref stat_words words, which are set to the file
+/// type and permission bits, the 64-bit size (high word
+/// first) and the preferred size of a read or write.
 constexpr uint32_t fstat = 10;
 
+/// The number of 32-bit words that fstat writes.
+constexpr uint32_t stat_words = 4;
+
+/// The file type bits of the stat mode.
+constexpr uint32_t stat_type_mask = 0170000;
+
+/// The stat mode type of a pipe.
+constexpr uint32_t stat_type_fifo = 0010000;
+
+/// The stat mode type of a character
+/// device, like the console.
+constexpr uint32_t stat_type_character = 0020000;
+
+/// The stat mode type of a regular file.
+constexpr uint32_t stat_type_regular = 0100000;
+
+/// The preferred size of a read or write,
+/// as reported by fstat.
+constexpr uint32_t stat_block_size = 0x10000;
+
 constexpr uint32_t sbrk = 11;
 
 constexpr uint32_t chdir = 14;
@@ -58,6 +137,10 @@ constexpr uint32_t gettimeofday = 19;
 
 constexpr uint32_t times = 20;
 
+/// The number of clock ticks per second
+/// in the values returned by times.
+constexpr uint32_t times_ticks_per_second = 100;
+
 constexpr uint32_t link = 21;
 
 constexpr uint32_t execve = 22;
@@ -66,6 +149,132 @@ constexpr uint32_t fork = 23;
 
 constexpr uint32_t wait = 24;
 
+constexpr uint32_t mmap = 25;
+
+constexpr uint32_t munmap = 26;
+
+constexpr uint32_t mprotect = 27;
+
+/// Specific to Swanson. Asks the kernel to write
+/// a snapshot of itself, once the calling process
+/// is ready to be resumed from one. The call returns
+/// zero once the snapshot is written, and one in the
+/// processes that are restored from it.
+constexpr uint32_t snapshot = 28;
+
+/// Specific to Swanson. Runs an array of system
+/// calls with one trap. The first argument is the
+/// address of the array, the second is the number
+/// of calls in it and the third is a set of flags.
+/// Each call is described by @ref batch_entry_words
+/// words: the system call number, its six arguments
+/// and a word that its result is written to. The
+/// calls are run in order, and the batch returns
+/// the number that were run. It stops early if the
+/// process exits or the thread blocks, and returns
+/// the fault error if the array can't be accessed.
+/// Calls that replace or stop the thread (execve,
+/// fork, snapshot and batch itself) fail with the
+/// invalid argument error inside of a batch.
+constexpr uint32_t batch = 29;
+
+/// A flag of the batch call. The batch
+/// stops after the first call that fails.
+constexpr uint32_t batch_stop_on_error = 0x01;
+
+/// The number of 32-bit words that
+/// describe each call of a batch.
+constexpr uint32_t batch_entry_words = 8;
+
+/// The most calls that one batch may run.
+constexpr uint32_t batch_max = 4096;
+
+/// Specific to Swanson. Serves the requests that
+/// are queued in a block ring. The first argument
+/// is the index of the disk, and the second is the
+/// address of the ring. A ring starts with @ref
+/// block_ring_header_words words: the number of
+/// entries, the number of requests submitted so far
+/// and the number completed so far. The guest fills
+/// in the entry after the last submitted one and
+/// then increments the submitted count, and the
+/// kernel increments the completed count as each
+/// request is done. Both counts wrap, and an index
+/// is taken modulo the number of entries. Each entry
+/// is @ref block_ring_entry_words words: the operation,
+/// the first sector, the number of sectors, the buffer
+/// address and a word that the status is written to.
+/// The call returns the number of requests served.
+constexpr uint32_t block_ring = 30;
+
+/// The operation of a block ring entry
+/// that reads sectors into its buffer.
+constexpr uint32_t block_ring_read = 0;
+
+/// The operation of a block ring entry
+/// that writes its buffer to sectors.
+constexpr uint32_t block_ring_write = 1;
+
+/// The number of 32-bit words
+/// at the start of a block ring.
+constexpr uint32_t block_ring_header_words = 3;
+
+/// The number of 32-bit words that
+/// describe each request of a block ring.
+constexpr uint32_t block_ring_entry_words = 5;
+
+/// The most entries that a block ring may have.
+constexpr uint32_t block_ring_max = 4096;
+
+/// The number of bytes in a sector.
+constexpr uint32_t block_ring_sector_size = 512;
+
+/// Creates a pipe. The first argument is the
+/// address of two words, which are set to the
+/// descriptor of the read end and the descriptor
+/// of the write end. Reads wait until there's data
+/// and writes wait until there's room, except in a
+/// batch, where they fail with the try again error.
+constexpr uint32_t pipe = 31;
+
+/// Specific to Swanson. The address of a read only
+/// page that the kernel maps into each process. It's
+/// updated before each slice that the process runs,
+/// so that guests may read the time with ordinary
+/// loads instead of making a system call. The time
+/// only moves between slices. Each field is stored
+/// in guest byte order, and the 64-bit fields are
+/// stored with their high word first.
+constexpr uint32_t time_page = 0xffffe000;
+
+/// The offset, in the time page, of the
+/// seconds since the epoch.
+constexpr uint32_t time_page_seconds = 0;
+
+/// The offset, in the time page, of the
+/// microseconds within the current second.
+constexpr uint32_t time_page_microseconds = 4;
+
+/// The offset, in the time page, of the
+/// 64-bit number of instructions that the
+/// process has executed.
+constexpr uint32_t time_page_instructions = 8;
+
+/// The offset, in the time page, of the
+/// 64-bit number of microseconds that the
+/// host has spent running the process.
+constexpr uint32_t time_page_cpu_time = 16;
+
+/// The number of bytes of the
+/// time page that are used.
+constexpr uint32_t time_page_size = 24;
+
+/// The size of the tables that system calls are
+/// dispatched through. Every system call number,
+/// including those registered by the host, must
+/// be less than this.
+constexpr uint32_t tableSize = 64;
+
 } // namespace syscalls
 
 } // namespace swanson
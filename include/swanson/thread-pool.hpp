@@ -0,0 +1,104 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_THREAD_POOL_HPP
+#define SWANSON_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swanson {
+
+/// A pool of host threads that
+/// guest threads are run on.
+class ThreadPool final {
+	/// A group of tasks that a
+	/// caller waits on together.
+	class Batch final {
+	public:
+		/// The number of tasks
+		/// that haven't finished.
+		size_t remaining;
+		/// The first exception thrown
+		/// by a task in the batch.
+		std::exception_ptr error;
+	};
+	/// A task, along with the
+	/// batch that it belongs to.
+	class Task final {
+	public:
+		/// The function to call.
+		std::function<void()> function;
+		/// The batch of the task.
+		Batch *batch;
+	};
+	/// The host threads of the pool.
+	std::vector<std::thread> workers;
+	/// Guards the task queue and batches.
+	std::mutex mutex;
+	/// Signaled when a task is queued,
+	/// or when the pool is stopping.
+	std::condition_variable taskQueued;
+	/// Signaled when a task finishes.
+	std::condition_variable taskDone;
+	/// The tasks waiting for a thread.
+	std::deque<Task> tasks;
+	/// Set when the pool is destroyed.
+	bool stopping;
+public:
+	/// Start the host threads of the pool.
+	/// @param workerCount The number of host
+	/// threads. If this is zero, one thread is
+	/// started for each core, less one for the
+	/// thread that calls @ref Run.
+	ThreadPool(unsigned int workerCount = 0);
+	/// Stops and joins the host threads.
+	~ThreadPool();
+	/// Thread pools may not be copied.
+	ThreadPool(const ThreadPool &) = delete;
+	/// Thread pools may not be copied.
+	ThreadPool &operator = (const ThreadPool &) = delete;
+	/// Get the number of host threads in the pool.
+	/// @returns The number of host threads.
+	auto GetWorkerCount() const noexcept { return workers.size(); }
+	/// Run a group of tasks and wait for them to
+	/// finish. The calling thread runs tasks too,
+	/// so this may be called from within a task.
+	/// If any task throws an exception, the first
+	/// one is thrown again once all tasks finish.
+	/// @param functions The tasks to run.
+	void Run(std::vector<std::function<void()>> &functions);
+protected:
+	/// Run tasks until the pool stops.
+	void Work();
+	/// Run a task and mark it as finished.
+	/// The mutex must be held by the lock,
+	/// and it's released while the task runs.
+	/// @param task The task to run.
+	/// @param lock The lock of the mutex.
+	void RunTask(Task &task, std::unique_lock<std::mutex> &lock);
+};
+
+} // namespace swanson
+
+#endif // SWANSON_THREAD_POOL_HPP
@@ -18,11 +18,15 @@
 #ifndef SWANSON_THREAD_HPP
 #define SWANSON_THREAD_HPP
 
+#include <swanson/cpu.hpp>
+
+#include <atomic>
 #include <memory>
 
+#include <cstdint>
+
 namespace swanson {
 
-class CPU;
 class MemoryBus;
 class InterruptHandler;
 
@@ -32,13 +36,35 @@ class InterruptHandler;
 class Thread {
 	/// The CPU responsible for
 	/// executing the thread
-	/// instructions.
-	std::shared_ptr<CPU> cpu;
+	/// instructions. It's kept in the
+	/// thread, rather than allocated
+	/// on its own.
+	CPU cpu;
+	/// Set while the thread is waiting on
+	/// something, like a wait queue.
+	std::atomic<bool> blocked;
 public:
 	/// Default constructor
 	Thread() noexcept;
 	/// Default deconstructor
 	~Thread() { }
+	/// Get the CPU that executes the thread.
+	/// This may be used to save or restore
+	/// the state of the thread.
+	/// @returns The CPU of the thread.
+	CPU *GetCPU() noexcept { return &cpu; }
+	/// Get the CPU that executes the thread.
+	/// @returns The CPU of the thread.
+	const CPU *GetCPU() const noexcept { return &cpu; }
+	/// Indicates whether or not the thread is
+	/// waiting on something. Blocked threads
+	/// aren't run by their process.
+	/// @returns True if the thread is blocked.
+	bool IsBlocked() const noexcept { return blocked; }
+	/// Set whether or not the thread is
+	/// waiting on something.
+	/// @param blocked_ True if the thread is blocked.
+	void SetBlocked(bool blocked_) noexcept { blocked = blocked_; }
 	/// Set the CPU instruction pointer address.
 	/// @param addr The new address of the
 	/// instruction pointer.
@@ -66,7 +92,9 @@ public:
 	/// on the thread.
 	/// @param steps The number of instructions
 	/// to execute.
-	void Step(uint32_t steps);
+	/// @returns The number of instructions
+	/// that were executed.
+	uint32_t Step(uint32_t steps);
 };
 
 } // namespace swanson
@@ -25,15 +25,37 @@
 
 namespace swanson::tmpfs {
 
+/// The contents of a temporary file.
+class FileData final {
+public:
+	/// The bytes of the file. Past the size
+	/// of the file, they're zero unless a
+	/// mapping wrote to them.
+	std::unique_ptr<unsigned char[]> bytes;
+	/// The number of bytes in the file.
+	uint64_t size = 0;
+	/// The number of bytes allocated. It's a
+	/// multiple of the page size, so that the
+	/// last page of the file may be mapped.
+	uint64_t capacity = 0;
+	/// Set once the file is mapped. Mappings view
+	/// the bytes in place, so they aren't moved after
+	/// that, and the file only grows within its capacity.
+	bool mapped = false;
+};
+
 /// A temporary file.
 class File final : public vfs::File {
 	/// Information regarding the file.
 	std::shared_ptr<vfs::Info> info;
-	/// The file data.
-	std::vector<unsigned char> data;
+	/// The file data. It's shared with the
+	/// streams and mappings of the file, so that
+	/// they remain valid after the file is removed.
+	std::shared_ptr<FileData> data;
 public:
 	/// Default constructor
-	File() : info(std::make_shared<vfs::Info>()) { }
+	File() : info(std::make_shared<vfs::Info>()),
+	         data(std::make_shared<FileData>()) { }
 	/// Default deconstructor
 	~File() { }
 	/// Get information regarding the file.
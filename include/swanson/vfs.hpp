@@ -23,6 +23,8 @@
 #include <string>
 #include <memory>
 
+#include <cstdint>
+
 namespace swanson {
 
 class Disk;
@@ -72,6 +74,14 @@ constexpr uint32_t append = 0x04;
 /// the file.
 constexpr uint32_t notrunc = 0x08;
 
+/// Create the file if it
+/// doesn't exist yet.
+constexpr uint32_t create = 0x10;
+
+/// Along with @ref create, fail
+/// if the file already exists.
+constexpr uint32_t exclusive = 0x20;
+
 } // namespace modes
 
 /// A virtual file system file.
@@ -161,12 +171,14 @@ public:
 	virtual ExitCode CreateDirectory(const std::string &path) = 0;
 	/// Open a file from the file system.
 	/// @param path The path of the file to open.
+	/// @param mode The mode to open the file in.
+	/// This is a combination of the values in @ref modes.
 	/// @param stream If the file can be opened, this pointer
 	/// will be assigned a stream class for read and write
 	/// operations for the file.
 	/// @returns The exit code most similar to that
 	/// of the system call.
-	virtual ExitCode OpenFile(const std::string &path, std::shared_ptr<Stream> &stream) = 0;
+	virtual ExitCode OpenFile(const std::string &path, uint32_t mode, std::shared_ptr<Stream> &stream) = 0;
 };
 
 } // namespace vfs
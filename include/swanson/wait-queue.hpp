@@ -0,0 +1,79 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_WAIT_QUEUE_HPP
+#define SWANSON_WAIT_QUEUE_HPP
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <cstdint>
+
+namespace swanson {
+
+class Process;
+class Thread;
+
+/// A list of guest threads that are waiting
+/// on something, like data to read or a child
+/// process to exit. Threads are added by
+/// @ref Process::Block, and are run again once
+/// they're woken.
+class WaitQueue final {
+	/// A thread on the wait queue.
+	class Waiter final {
+	public:
+		/// The process of the thread.
+		std::weak_ptr<Process> process;
+		/// The thread that's waiting.
+		std::weak_ptr<Thread> thread;
+		/// The generation of the process
+		/// when the thread started waiting.
+		uint32_t generation;
+	};
+	/// Guards the waiters.
+	std::mutex mutex;
+	/// The waiting threads, in
+	/// the order that they blocked.
+	std::deque<Waiter> waiters;
+public:
+	/// Add a thread to the wait queue. The
+	/// thread should already be marked as blocked.
+	/// @param process The process of the thread.
+	/// @param thread The thread that's waiting.
+	/// @param generation The generation of the process.
+	/// If the process is rolled back before the thread is
+	/// woken, the thread is skipped.
+	void Add(std::weak_ptr<Process> process, std::weak_ptr<Thread> thread, uint32_t generation);
+	/// Indicates whether or not any
+	/// threads are waiting on the queue.
+	/// @returns True if the queue is empty.
+	bool IsEmpty();
+	/// Wake the thread that has waited on the
+	/// queue the longest. Threads that were rolled
+	/// back while waiting are skipped.
+	/// @returns True if a thread was woken.
+	bool Wake();
+	/// Wake all of the threads
+	/// waiting on the queue.
+	void WakeAll();
+};
+
+} // namespace swanson
+
+#endif // SWANSON_WAIT_QUEUE_HPP
@@ -0,0 +1,100 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_WORLD_LOCK_HPP
+#define SWANSON_WORLD_LOCK_HPP
+
+#include <condition_variable>
+#include <mutex>
+
+namespace swanson {
+
+/// Coordinates the guest threads of a process
+/// that run on separate host threads. Threads
+/// enter the world lock for each slice that they
+/// run, and a thread that changes the memory
+/// layout stops the world first. Stopping waits
+/// for the other threads to either finish their
+/// slice or park, which they do while they
+/// wait on something (like another system call)
+/// without touching guest memory.
+class WorldLock final {
+	/// Guards the counters below.
+	std::mutex mutex;
+	/// Signaled when the counters change.
+	std::condition_variable changed;
+	/// The number of threads in a slice.
+	unsigned int running;
+	/// The number of running threads
+	/// that are parked.
+	unsigned int parked;
+	/// Whether or not a thread has
+	/// stopped the world.
+	bool stopped;
+public:
+	/// Default constructor
+	WorldLock() noexcept : running(0), parked(0), stopped(false) { }
+	/// Enter the world lock, before running a
+	/// slice. This waits until the world isn't stopped.
+	void Enter();
+	/// Leave the world lock, after running a slice.
+	void Leave();
+	/// Park the calling thread, which must
+	/// have entered, before it waits on something.
+	/// It must not access guest memory until
+	/// @ref Unpark is called.
+	void Park();
+	/// Unpark the calling thread. This waits
+	/// until the world isn't stopped.
+	void Unpark();
+	/// Stop the world. This waits until every
+	/// other thread has left or parked. The calling
+	/// thread may or may not have entered.
+	/// @param entered Whether or not the calling
+	/// thread has entered the world lock.
+	void Stop(bool entered);
+	/// Let the other threads continue, after
+	/// the world has been stopped.
+	void Resume();
+};
+
+/// Stops the world for as long
+/// as it exists.
+class WorldStop final {
+	/// The world lock that is stopped.
+	WorldLock &worldLock;
+public:
+	/// Stop the world.
+	/// @param worldLock_ The world lock to stop.
+	/// @param entered Whether or not the calling
+	/// thread has entered the world lock.
+	WorldStop(WorldLock &worldLock_, bool entered) : worldLock(worldLock_) {
+		worldLock.Stop(entered);
+	}
+	/// Resume the world.
+	~WorldStop() {
+		worldLock.Resume();
+	}
+	/// World stops may not be copied.
+	WorldStop(const WorldStop &) = delete;
+	/// World stops may not be copied.
+	WorldStop &operator = (const WorldStop &) = delete;
+};
+
+} // namespace swanson
+
+#endif // SWANSON_WORLD_LOCK_HPP
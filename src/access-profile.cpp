@@ -0,0 +1,128 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/access-profile.hpp>
+
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+
+#include <algorithm>
+
+namespace swanson {
+
+AccessProfile::AccessProfile() noexcept {
+	sampleInterval = 1;
+	sampleCountdown = 1;
+	windowLength = 0;
+	windowAccesses = 0;
+	window = 1;
+	workingSet = 0;
+}
+
+void AccessProfile::EndWindow() {
+	workingSets.emplace_back(workingSet);
+	workingSet = 0;
+	windowAccesses = 0;
+	window++;
+}
+
+std::vector<PageHeat> AccessProfile::GetHeatmap(const MemorySection &section) const {
+
+	std::vector<PageHeat> heatmap;
+
+	uint64_t start = section.GetAddress() / pageSize;
+	uint64_t end = (((uint64_t) section.GetAddress()) + section.GetSize() + (pageSize - 1)) / pageSize;
+
+	// Iterate whichever is smaller, the
+	// pages of the section or the pages
+	// that were touched.
+
+	if ((end - start) < pages.size()) {
+		for (auto page = start; page < end; page++) {
+			auto it = pages.find((uint32_t) page);
+			if (it != pages.end())
+				heatmap.emplace_back(it->second);
+		}
+	} else {
+		for (const auto &entry : pages) {
+			if ((entry.first >= start) && (entry.first < end))
+				heatmap.emplace_back(entry.second);
+		}
+		std::sort(heatmap.begin(), heatmap.end(), [](const PageHeat &a, const PageHeat &b) {
+			return a.address < b.address;
+		});
+	}
+
+	return heatmap;
+}
+
+void AccessProfile::Report(const MemoryMap &memoryMap, std::ostream &output) const {
+
+	output << "section,page,reads,writes,executes" << std::endl;
+
+	for (const auto &section : memoryMap) {
+		for (const auto &page : GetHeatmap(*section)) {
+			output << section->GetAddress() << ',';
+			output << page.address << ',';
+			output << page.reads << ',';
+			output << page.writes << ',';
+			output << page.executes << std::endl;
+		}
+	}
+
+	output << std::endl;
+	output << "window,pages" << std::endl;
+
+	uint64_t index = 1;
+
+	for (auto pageCount : workingSets)
+		output << index++ << ',' << pageCount << std::endl;
+
+	output << index << ',' << workingSet << std::endl;
+}
+
+void AccessProfile::SetSampleInterval(uint32_t interval) noexcept {
+
+	if (interval == 0)
+		interval = 1;
+
+	sampleInterval = interval;
+	sampleCountdown = interval;
+}
+
+void AccessProfile::Sample(uint32_t addr, AccessType type) {
+
+	sampleCountdown = sampleInterval;
+
+	auto &page = pages[addr / pageSize];
+
+	page.address = addr - (addr % pageSize);
+
+	if (type == AccessType::Read)
+		page.reads++;
+	else if (type == AccessType::Write)
+		page.writes++;
+	else
+		page.executes++;
+
+	if (page.lastWindow != window) {
+		page.lastWindow = window;
+		workingSet++;
+	}
+}
+
+} // namespace swanson
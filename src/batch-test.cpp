@@ -0,0 +1,193 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "batch-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/process.hpp>
+#include <swanson/syscall-stats.hpp>
+#include <swanson/syscalls.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the calls
+/// that the batch runs.
+constexpr uint32_t batchAddress = 0x20000;
+
+/// Written to the result of each call
+/// beforehand, to see which ones ran.
+constexpr uint32_t notRun = 0xa5a5a5a5;
+
+/// One call of a batch.
+struct Call final {
+	uint32_t type;
+	uint32_t args[6];
+};
+
+/// Makes a process that runs a batch, and
+/// then exits with the result of the batch.
+auto MakeProcess(uint32_t addr, const std::vector<Call> &calls, uint32_t flags) {
+
+	auto count = (uint32_t) calls.size();
+
+	const std::vector<unsigned char> code {
+		0x01, 0x20, (unsigned char) (addr >> 24), (unsigned char) (addr >> 16), (unsigned char) (addr >> 8), (unsigned char) addr, /* ldi.l $r0, addr */
+		0x01, 0x30, 0x00, 0x00, 0x00, (unsigned char) count, /* ldi.l $r1, count */
+		0x01, 0x40, 0x00, 0x00, 0x00, (unsigned char) flags, /* ldi.l $r2, flags */
+		0x30, 0x00, 0x00, 0x00, 0x00, 0x1d, /* swi batch */
+		0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+	};
+
+	auto process = MakeTestProcess(code, batchAddress, 0x1000);
+
+	auto memoryMap = process->GetMemoryMap();
+
+	for (uint32_t i = 0; i < count; i++) {
+		auto entry = batchAddress + (i * syscalls::batch_entry_words * 4);
+		memoryMap->Write32(entry, calls[i].type);
+		for (uint32_t arg = 0; arg < 6; arg++)
+			memoryMap->Write32(entry + ((arg + 1) * 4), calls[i].args[arg]);
+		memoryMap->Write32(entry + 28, notRun);
+	}
+
+	return process;
+}
+
+auto Run(Process &process) {
+
+	while (!process.Exited())
+		process.Step(100);
+
+	return (uint32_t) process.GetExitCode();
+}
+
+uint32_t GetResult(Process &process, uint32_t index) {
+	return process.GetMemoryMap()->Read32(batchAddress + (index * syscalls::batch_entry_words * 4) + 28);
+}
+
+void TestRunAll() {
+
+	std::vector<Call> calls {
+		{ syscalls::sbrk, { 0x10 } },
+		{ syscalls::close, { 99 } },
+		{ syscalls::write, { 1, batchAddress, 0 } },
+		{ syscalls::sbrk, { 0x10 } }
+	};
+
+	auto process = MakeProcess(batchAddress, calls, 0);
+
+	auto stats = std::make_shared<SyscallStats>();
+	process->SetSyscallStats(stats);
+
+	auto heapStart = process->GetProgramBreak();
+
+	assert(Run(*process) == 4);
+
+	assert(GetResult(*process, 0) == heapStart);
+	assert(GetResult(*process, 1) == errors::ToResult(errors::badf));
+	assert(GetResult(*process, 2) == 0);
+	assert(GetResult(*process, 3) == (heapStart + 0x10));
+	assert(process->GetProgramBreak() == (heapStart + 0x20));
+
+	/* the count and flags are put back */
+	auto cpu = process->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(3) == 4);
+	assert(cpu->GetRegister(4) == 0);
+
+	/* each call is counted, as
+	 * well as the batch itself */
+	assert(stats->GetCallCount(syscalls::batch) == 1);
+	assert(stats->GetCallCount(syscalls::sbrk) == 2);
+	assert(stats->GetCallCount(syscalls::close) == 1);
+}
+
+void TestStopOnError() {
+
+	std::vector<Call> calls {
+		{ syscalls::sbrk, { 0x10 } },
+		{ syscalls::close, { 99 } },
+		{ syscalls::sbrk, { 0x10 } }
+	};
+
+	auto process = MakeProcess(batchAddress, calls, syscalls::batch_stop_on_error);
+
+	auto heapStart = process->GetProgramBreak();
+
+	assert(Run(*process) == 2);
+
+	assert(GetResult(*process, 1) == errors::ToResult(errors::badf));
+	assert(GetResult(*process, 2) == notRun);
+	assert(process->GetProgramBreak() == (heapStart + 0x10));
+}
+
+void TestRefused() {
+
+	std::vector<Call> calls {
+		{ syscalls::execve, { 0 } },
+		{ syscalls::batch, { batchAddress, 1 } },
+		{ 50, { } },
+		{ syscalls::exit, { 7 } },
+		{ syscalls::sbrk, { 0x10 } }
+	};
+
+	auto process = MakeProcess(batchAddress, calls, 0);
+
+	/* the batch stops once the
+	 * process exits */
+	assert(Run(*process) == 7);
+
+	assert(GetResult(*process, 0) == errors::ToResult(errors::inval));
+	assert(GetResult(*process, 1) == errors::ToResult(errors::inval));
+	assert(GetResult(*process, 2) == errors::ToResult(errors::nosys));
+	assert(GetResult(*process, 3) == 7);
+	assert(GetResult(*process, 4) == notRun);
+}
+
+void TestFault() {
+
+	std::vector<Call> calls {
+		{ syscalls::sbrk, { 0x10 } }
+	};
+
+	auto process = MakeProcess(0x40000000, calls, 0);
+	assert(Run(*process) == errors::ToResult(errors::fault));
+
+	process = MakeProcess(batchAddress, calls, 0x80);
+	assert(Run(*process) == errors::ToResult(errors::inval));
+}
+
+} // namespace
+
+void TestBatch() {
+	TestRunAll();
+	TestStopOnError();
+	TestRefused();
+	TestFault();
+}
+
+} // namespace swanson::tests
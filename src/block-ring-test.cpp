@@ -0,0 +1,277 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "block-ring-test.hpp"
+
+#include <swanson/block-ring.hpp>
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/io-workers.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/process.hpp>
+#include <swanson/syscalls.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the ring.
+constexpr uint32_t ringAddress = 0x20000;
+
+/// The buffer that is written to the disk.
+constexpr uint32_t writeBuffer = 0x20200;
+
+/// The buffer that the disk is read into.
+constexpr uint32_t readBuffer = 0x20400;
+
+/// Serves the ring of device zero and
+/// exits with the result of the call.
+const std::vector<unsigned char> ringProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x01, 0x30, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r1, 0x20000 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x1e, /* swi block_ring */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+auto MakeProcess(std::shared_ptr<BlockRing> device) {
+
+	auto process = MakeTestProcess(ringProgram, ringAddress, 0x1000);
+
+	std::vector<std::shared_ptr<BlockRing>> devices;
+	if (device != nullptr)
+		devices.emplace_back(device);
+
+	process->SetSyscallHandler(syscalls::block_ring, BlockRing::MakeHandler(devices));
+
+	return process;
+}
+
+/// Write an entry of the ring.
+void SetEntry(MemoryMap &memoryMap, uint32_t index, uint32_t operation, uint32_t sector, uint32_t count, uint32_t buffer) {
+	auto entry = ringAddress + (syscalls::block_ring_header_words * 4) + (index * syscalls::block_ring_entry_words * 4);
+	memoryMap.Write32(entry, operation);
+	memoryMap.Write32(entry + 4, sector);
+	memoryMap.Write32(entry + 8, count);
+	memoryMap.Write32(entry + 12, buffer);
+	memoryMap.Write32(entry + 16, 0xffffffff);
+}
+
+/// Get the status of an entry of the ring.
+uint32_t GetStatus(MemoryMap &memoryMap, uint32_t index) {
+	auto entry = ringAddress + (syscalls::block_ring_header_words * 4) + (index * syscalls::block_ring_entry_words * 4);
+	return memoryMap.Read32(entry + 16);
+}
+
+/// Queue requests that wrap around the end
+/// of a ring with four entries: a write, a
+/// read of what was written before, and a
+/// read into memory that isn't mapped.
+void QueueRequests(MemoryMap &memoryMap) {
+
+	memoryMap.Write32(ringAddress, 4);
+	memoryMap.Write32(ringAddress + 4, 9);
+	memoryMap.Write32(ringAddress + 8, 6);
+
+	SetEntry(memoryMap, 2, syscalls::block_ring_write, 5, 2, writeBuffer);
+	SetEntry(memoryMap, 3, syscalls::block_ring_read, 2, 1, readBuffer);
+	SetEntry(memoryMap, 0, syscalls::block_ring_read, 2, 1, 0x90000000);
+
+	std::vector<unsigned char> pattern(1024, 'w');
+	memoryMap.WriteBlock(writeBuffer, pattern.data(), pattern.size());
+}
+
+/// Check the disk and memory
+/// after the requests are served.
+void CheckRequests(Process &process, const MemoryStream &disk) {
+
+	auto &memoryMap = *process.GetMemoryMap();
+
+	assert(process.GetExitCode() == 3);
+	assert(memoryMap.Read32(ringAddress + 8) == 9);
+
+	assert(GetStatus(memoryMap, 2) == 0);
+	assert(GetStatus(memoryMap, 3) == 0);
+	assert(GetStatus(memoryMap, 0) == errors::ToResult(errors::fault));
+
+	assert(disk.GetData().size() == (7 * 512));
+	assert(disk.GetData()[(5 * 512)] == 'w');
+	assert(disk.GetData()[(7 * 512) - 1] == 'w');
+
+	assert(memoryMap.Read8(readBuffer) == 'd');
+	assert(memoryMap.Read8(readBuffer + 511) == 'd');
+}
+
+auto MakeDisk() {
+	return std::make_shared<MemoryStream>(std::vector<unsigned char>(3 * 512, 'd'));
+}
+
+void TestInline() {
+
+	auto disk = MakeDisk();
+
+	auto process = MakeProcess(std::make_shared<BlockRing>(disk));
+
+	QueueRequests(*process->GetMemoryMap());
+
+	while (!process->Exited())
+		process->Step(100);
+
+	CheckRequests(*process, *disk);
+}
+
+void TestOffload() {
+
+	auto disk = MakeDisk();
+
+	auto process = MakeProcess(std::make_shared<BlockRing>(disk));
+
+	auto workers = std::make_shared<IOWorkers>(2);
+	process->SetIOWorkers(workers);
+
+	QueueRequests(*process->GetMemoryMap());
+
+	auto steps = 0;
+
+	while (!process->Exited()) {
+		process->Step(100);
+		workers->Wait();
+		assert(++steps < 10);
+	}
+
+	CheckRequests(*process, *disk);
+}
+
+void TestMutate() {
+
+	constexpr uint32_t mappingAddress = 0x100000;
+
+	/* the disk holds its reads until it's
+	 * released, so they stay in flight */
+	auto disk = MakeDisk();
+	disk->Hold();
+
+	auto process = MakeProcess(std::make_shared<BlockRing>(disk));
+
+	auto workers = std::make_shared<IOWorkers>(1);
+	process->SetIOWorkers(workers);
+
+	auto &memoryMap = *process->GetMemoryMap();
+
+	auto mapping = std::make_shared<MemorySection>();
+	mapping->SetAddress(mappingAddress);
+	mapping->Resize(0x1000);
+	process->AddMapping(mapping);
+
+	memoryMap.Write32(ringAddress, 2);
+	memoryMap.Write32(ringAddress + 4, 2);
+	SetEntry(memoryMap, 0, syscalls::block_ring_read, 0, 1, mappingAddress);
+	SetEntry(memoryMap, 1, syscalls::block_ring_read, 1, 1, readBuffer);
+
+	process->Step(3);
+
+	while (!disk->IsReading())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	/* the guest rewrites the ring and
+	 * unmaps a buffer while the reads
+	 * are in flight */
+	for (uint32_t i = 0; i < 100; i++) {
+		SetEntry(memoryMap, i % 2, i, i, i, 0x90000000);
+		memoryMap.Write8(readBuffer, 'x');
+	}
+
+	assert(process->RemoveMapping(mappingAddress, 0x1000));
+
+	disk->Release();
+
+	auto steps = 0;
+
+	while (!process->Exited()) {
+		process->Step(100);
+		workers->Wait();
+		assert(++steps < 10);
+	}
+
+	/* the requests are served as they
+	 * were submitted, and the read into
+	 * the buffer that's gone faults */
+	assert(process->GetExitCode() == 2);
+	assert(memoryMap.Read32(ringAddress + 8) == 2);
+	assert(GetStatus(memoryMap, 0) == errors::ToResult(errors::fault));
+	assert(GetStatus(memoryMap, 1) == 0);
+	assert(memoryMap.Read8(readBuffer) == 'd');
+	assert(memoryMap.Read8(readBuffer + 511) == 'd');
+}
+
+void TestErrors() {
+
+	/* sectors past the end of the disk read as zeros */
+	auto disk = std::make_shared<MemoryStream>();
+	auto process = MakeProcess(std::make_shared<BlockRing>(disk));
+	auto &memoryMap = *process->GetMemoryMap();
+	memoryMap.Write32(ringAddress, 1);
+	memoryMap.Write32(ringAddress + 4, 1);
+	SetEntry(memoryMap, 0, syscalls::block_ring_read, 8, 1, readBuffer);
+	memoryMap.Write8(readBuffer, 'x');
+	while (!process->Exited())
+		process->Step(100);
+	assert(process->GetExitCode() == 1);
+	assert(GetStatus(memoryMap, 0) == 0);
+	assert(memoryMap.Read8(readBuffer) == 0);
+
+	/* read-only devices refuse writes */
+	process = MakeProcess(std::make_shared<BlockRing>(disk, true));
+	process->GetMemoryMap()->Write32(ringAddress, 1);
+	process->GetMemoryMap()->Write32(ringAddress + 4, 1);
+	SetEntry(*process->GetMemoryMap(), 0, syscalls::block_ring_write, 0, 1, readBuffer);
+	while (!process->Exited())
+		process->Step(100);
+	assert(GetStatus(*process->GetMemoryMap(), 0) == errors::ToResult(errors::rofs));
+
+	/* more requests submitted than fit in the ring */
+	process = MakeProcess(std::make_shared<BlockRing>(disk));
+	process->GetMemoryMap()->Write32(ringAddress, 2);
+	process->GetMemoryMap()->Write32(ringAddress + 4, 3);
+	process->Step(3);
+	assert(process->GetThread(0)->GetCPU()->GetRegister(2) == errors::ToResult(errors::inval));
+
+	/* devices that don't exist */
+	process = MakeProcess(nullptr);
+	process->Step(3);
+	assert(process->GetThread(0)->GetCPU()->GetRegister(2) == errors::ToResult(errors::nodev));
+}
+
+} // namespace
+
+void TestBlockRing() {
+	TestInline();
+	TestOffload();
+	TestMutate();
+	TestErrors();
+}
+
+} // namespace swanson::tests
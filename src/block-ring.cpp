@@ -0,0 +1,383 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/block-ring.hpp>
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/segfault.hpp>
+#include <swanson/stream.hpp>
+#include <swanson/syscalls.hpp>
+
+#include <cstring>
+
+namespace swanson {
+
+struct BlockRing::Batch final {
+	/// A request of a batch.
+	struct Request final {
+		/// The guest address of the entry.
+		uint32_t entry;
+		/// The operation of the request.
+		uint32_t operation;
+		/// The first sector of the request.
+		uint32_t sector;
+		/// The guest address of the buffer.
+		uint32_t buffer;
+		/// The status of the request. Requests
+		/// that failed before they were served
+		/// aren't served.
+		uint32_t status;
+		/// The data that's written, or
+		/// that was read from the disk.
+		std::vector<unsigned char> data;
+	};
+	/// The guest address of the ring.
+	uint32_t address;
+	/// The completed count of the ring,
+	/// before the batch was served.
+	uint32_t completed;
+	/// The requests, in ring order.
+	std::vector<Request> requests;
+};
+
+namespace {
+
+/// The fields of a ring entry.
+struct Entry final {
+	uint32_t operation;
+	uint32_t sector;
+	uint32_t buffer;
+	uint32_t size;
+};
+
+/// Read an entry of a ring and check that
+/// it may be served. The buffer isn't checked.
+/// @returns Zero, or the status of the request.
+uint32_t ReadEntry(MemoryMap &memoryMap, bool readOnly, uint32_t address, Entry &entry) {
+
+	entry.operation = memoryMap.Read32(address);
+	entry.sector = memoryMap.Read32(address + 4);
+	auto sectorCount = memoryMap.Read32(address + 8);
+	entry.buffer = memoryMap.Read32(address + 12);
+
+	if (readOnly && (entry.operation == syscalls::block_ring_write))
+		return errors::ToResult(errors::rofs);
+
+	if ((entry.operation != syscalls::block_ring_read)
+	 && (entry.operation != syscalls::block_ring_write))
+		return errors::ToResult(errors::inval);
+
+	uint64_t size = (uint64_t) sectorCount * syscalls::block_ring_sector_size;
+	if (size > UINT32_MAX)
+		return errors::ToResult(errors::inval);
+
+	entry.size = (uint32_t) size;
+
+	return 0;
+}
+
+/// Read the header of a ring, and
+/// find the requests that are waiting.
+/// @returns Zero, or the result of an error.
+uint32_t ReadHeader(MemoryMap &memoryMap, uint32_t address, uint32_t &entryCount, uint32_t &completed, uint32_t &pending) {
+
+	entryCount = memoryMap.Read32(address);
+	auto submitted = memoryMap.Read32(address + 4);
+	completed = memoryMap.Read32(address + 8);
+
+	if ((entryCount == 0) || (entryCount > syscalls::block_ring_max))
+		return errors::ToResult(errors::inval);
+
+	// The counts wrap, so their difference
+	// is the number of requests waiting.
+	pending = submitted - completed;
+	if (pending > entryCount)
+		return errors::ToResult(errors::inval);
+
+	return 0;
+}
+
+/// Get the guest address of an entry of a ring.
+uint32_t GetEntryAddress(uint32_t address, uint32_t entryCount, uint32_t completed) noexcept {
+	auto index = (completed % entryCount);
+	return address + (syscalls::block_ring_header_words * 4) + (index * syscalls::block_ring_entry_words * 4);
+}
+
+/// Serve one request of a ring,
+/// straight into guest memory.
+/// @returns The status of the request.
+uint32_t ServeEntry(Stream &disk, bool readOnly, MemoryMap &memoryMap, uint32_t address) {
+
+	Entry entry;
+
+	auto status = ReadEntry(memoryMap, readOnly, address, entry);
+	if (status != 0)
+		return status;
+
+	auto isWrite = (entry.operation == syscalls::block_ring_write);
+
+	std::vector<HostSpan> spans;
+
+	try {
+		if (isWrite)
+			spans = memoryMap.GetReadSpans(entry.buffer, entry.size);
+		else
+			spans = memoryMap.GetWriteSpans(entry.buffer, entry.size);
+	} catch (const Segfault &) {
+		return errors::ToResult(errors::fault);
+	}
+
+	try {
+
+		disk.SetPosition((uint64_t) entry.sector * syscalls::block_ring_sector_size);
+
+		for (const auto &span : spans) {
+			if (isWrite) {
+				disk.Write(span.data, span.size);
+				continue;
+			}
+			// Sectors past the end of
+			// the disk file read as zeros.
+			auto readSize = disk.ReadSome(span.data, span.size);
+			if (readSize < span.size)
+				std::memset(span.data + readSize, 0, span.size - readSize);
+		}
+
+	} catch (...) {
+		return errors::ToResult(errors::io);
+	}
+
+	return 0;
+}
+
+} // namespace
+
+Process::SyscallHandler BlockRing::MakeHandler(std::vector<std::shared_ptr<BlockRing>> devices) {
+	return [devices](Process &process, CPU &cpu, MemoryMap &memoryMap) {
+
+		auto index = cpu.GetRegister(2);
+		auto address = cpu.GetRegister(3);
+
+		if (index >= devices.size()) {
+			cpu.SetRegister(2, errors::ToResult(errors::nodev));
+			return;
+		}
+
+		auto device = devices[index];
+
+		if (process.CanOffloadIO()) {
+
+			// The worker never touches guest memory,
+			// which may change while it runs. The ring is
+			// copied now, and the results are written back
+			// by this thread before it runs again.
+
+			uint32_t result = 0;
+
+			auto batch = device->Prepare(memoryMap, address, result);
+			if (batch == nullptr) {
+				cpu.SetRegister(2, result);
+				return;
+			}
+
+			process.SubmitIO(cpu, device->GetDisk(), [device, batch]() -> Process::IOFinisher {
+				device->Transfer(*batch);
+				return [device, batch](MemoryMap &memoryMap) {
+					return device->Finish(memoryMap, *batch);
+				};
+			});
+
+			return;
+		}
+
+		cpu.SetRegister(2, device->Serve(memoryMap, address));
+	};
+}
+
+BlockRing::BlockRing(std::shared_ptr<Stream> disk_, bool readOnly_) noexcept : disk(disk_), readOnly(readOnly_) {
+
+}
+
+uint32_t BlockRing::Finish(MemoryMap &memoryMap, const Batch &batch) {
+
+	auto completed = batch.completed;
+
+	uint32_t served = 0;
+
+	try {
+
+		for (const auto &request : batch.requests) {
+
+			auto status = request.status;
+
+			if ((status == 0) && (request.operation == syscalls::block_ring_read)) {
+				try {
+					memoryMap.WriteBlock(request.buffer, request.data.data(), request.data.size());
+				} catch (const Segfault &) {
+					status = errors::ToResult(errors::fault);
+				}
+			}
+
+			memoryMap.Write32(request.entry + 16, status);
+
+			memoryMap.Write32(batch.address + 8, ++completed);
+
+			served++;
+		}
+
+	} catch (const Segfault &) {
+		return errors::ToResult(errors::fault);
+	}
+
+	return served;
+}
+
+std::shared_ptr<BlockRing::Batch> BlockRing::Prepare(MemoryMap &memoryMap, uint32_t address, uint32_t &result) {
+
+	auto batch = std::make_shared<Batch>();
+	batch->address = address;
+
+	uint64_t batchSize = 0;
+
+	try {
+
+		uint32_t entryCount = 0;
+		uint32_t pending = 0;
+
+		result = ReadHeader(memoryMap, address, entryCount, batch->completed, pending);
+		if (result != 0)
+			return nullptr;
+
+		for (uint32_t i = 0; i < pending; i++) {
+
+			Batch::Request request;
+			request.entry = GetEntryAddress(address, entryCount, batch->completed + i);
+
+			Entry entry;
+
+			request.status = ReadEntry(memoryMap, readOnly, request.entry, entry);
+			request.operation = entry.operation;
+			request.sector = entry.sector;
+			request.buffer = entry.buffer;
+
+			// The buffer is checked now, which also
+			// bounds what's copied by the memory that
+			// the guest has. The rest of a large batch
+			// waits for the next call.
+
+			if (request.status == 0) {
+
+				if ((batchSize + entry.size) > maxBatchSize) {
+					if (!batch->requests.empty())
+						break;
+				}
+
+				try {
+					if (entry.operation == syscalls::block_ring_write) {
+						request.data.resize(entry.size);
+						memoryMap.ReadBlock(entry.buffer, request.data.data(), entry.size);
+					} else {
+						memoryMap.GetWriteSpans(entry.buffer, entry.size);
+						request.data.resize(entry.size);
+					}
+				} catch (const Segfault &) {
+					request.status = errors::ToResult(errors::fault);
+					request.data.clear();
+				}
+
+				batchSize += request.data.size();
+			}
+
+			batch->requests.emplace_back(std::move(request));
+		}
+
+	} catch (const Segfault &) {
+		result = errors::ToResult(errors::fault);
+		return nullptr;
+	}
+
+	return batch;
+}
+
+uint32_t BlockRing::Serve(MemoryMap &memoryMap, uint32_t address) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	uint32_t served = 0;
+
+	try {
+
+		uint32_t entryCount = 0;
+		uint32_t completed = 0;
+		uint32_t pending = 0;
+
+		auto result = ReadHeader(memoryMap, address, entryCount, completed, pending);
+		if (result != 0)
+			return result;
+
+		for (; served < pending; served++) {
+
+			auto entry = GetEntryAddress(address, entryCount, completed);
+
+			memoryMap.Write32(entry + 16, ServeEntry(*disk, readOnly, memoryMap, entry));
+
+			// The count is updated as each request
+			// completes, so that the guest sees what
+			// was done even if a later entry faults.
+			memoryMap.Write32(address + 8, ++completed);
+		}
+
+	} catch (const Segfault &) {
+		return errors::ToResult(errors::fault);
+	}
+
+	return served;
+}
+
+void BlockRing::Transfer(Batch &batch) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (auto &request : batch.requests) {
+
+		if (request.status != 0)
+			continue;
+
+		try {
+
+			disk->SetPosition((uint64_t) request.sector * syscalls::block_ring_sector_size);
+
+			if (request.operation == syscalls::block_ring_write) {
+				disk->Write(request.data.data(), request.data.size());
+				continue;
+			}
+
+			// Sectors past the end of
+			// the disk file read as zeros.
+			auto readSize = disk->ReadSome(request.data.data(), request.data.size());
+			if (readSize < request.data.size())
+				std::memset(request.data.data() + readSize, 0, request.data.size() - readSize);
+
+		} catch (...) {
+			request.status = errors::ToResult(errors::io);
+		}
+	}
+}
+
+} // namespace swanson
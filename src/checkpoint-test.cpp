@@ -0,0 +1,226 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "checkpoint-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/process.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the data
+/// that the program writes to.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// The address of the mapping that's
+/// added between the two checkpoints.
+constexpr uint32_t mappingAddress = 0x100000;
+
+/// Writes to the first page of the data,
+/// then to the second page, then jumps to
+/// itself forever.
+const std::vector<unsigned char> checkpointProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x11, /* ldi.l $r0, 0x11 */
+	0x09, 0x20, 0x00, 0x02, 0x00, 0x00, /* sta.l 0x20000, $r0 */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x22, /* ldi.l $r1, 0x22 */
+	0x09, 0x30, 0x00, 0x02, 0x10, 0x00, /* sta.l 0x21000, $r1 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x33, /* ldi.l $r2, 0x33 */
+	0x1a, 0x00, 0x00, 0x01, 0x00, 0x1e  /* jmpa 0x1001e */
+};
+
+/// Restore a process from checkpoint records.
+std::shared_ptr<Process> Restore(const std::string &records) {
+	auto process = std::make_shared<Process>();
+	std::istringstream stream(records);
+	process->Restore(stream);
+	return process;
+}
+
+/// Check that a restored process has the threads,
+/// the section layout and the memory of another.
+void CheckSame(Process &expected, Process &actual) {
+
+	assert(actual.GetThreadCount() == expected.GetThreadCount());
+
+	for (size_t i = 0; i < expected.GetThreadCount(); i++) {
+
+		auto expectedCPU = expected.GetThread(i)->GetCPU();
+		auto actualCPU = actual.GetThread(i)->GetCPU();
+
+		for (uint32_t reg = 0; reg < 18; reg++)
+			assert(actualCPU->GetRegister(reg) == expectedCPU->GetRegister(reg));
+
+		for (uint32_t reg = 0; reg < 256; reg++)
+			assert(actualCPU->GetSpecialRegister(reg) == expectedCPU->GetSpecialRegister(reg));
+
+		assert(actualCPU->GetCondition() == expectedCPU->GetCondition());
+		assert(actualCPU->GetInstructionPointer() == expectedCPU->GetInstructionPointer());
+	}
+
+	auto expectedMap = expected.GetMemoryMap();
+	auto actualMap = actual.GetMemoryMap();
+
+	assert(std::distance(actualMap->begin(), actualMap->end()) == std::distance(expectedMap->begin(), expectedMap->end()));
+
+	for (auto &section : *expectedMap) {
+
+		/* the heap may be empty, so sections
+		 * are found by where they start */
+		auto it = std::find_if(actualMap->begin(), actualMap->end(), [&section](const auto &other) {
+			return other->GetAddress() == section->GetAddress();
+		});
+		assert(it != actualMap->end());
+
+		auto &restored = *it;
+		assert(restored->GetSize() == section->GetSize());
+		assert(restored->ReadAllowed() == section->ReadAllowed());
+		assert(restored->WriteAllowed() == section->WriteAllowed());
+		assert(restored->ExecuteAllowed() == section->ExecuteAllowed());
+		assert(std::memcmp(restored->GetData(), section->GetData(), section->GetSize()) == 0);
+	}
+
+	assert(actual.GetProgramBreak() == expected.GetProgramBreak());
+}
+
+void TestRoundTrip() {
+
+	auto process = MakeTestProcess(checkpointProgram, dataAddress, 0x2000);
+
+	auto memoryMap = process->GetMemoryMap();
+	auto cpu = process->GetThread(0)->GetCPU();
+
+	process->Step(2);
+	assert(memoryMap->Read32(dataAddress) == 0x11);
+
+	std::ostringstream full;
+	process->SaveCheckpoint(full, true);
+
+	CheckSame(*process, *Restore(full.str()));
+
+	/* the registers, the memory and
+	 * the layout change after the
+	 * full checkpoint */
+	process->Step(3);
+	assert(memoryMap->Read32(dataAddress + 0x1000) == 0x22);
+	cpu->SetSpecialRegister(4, 0x5678);
+	cpu->SetCondition(3);
+
+	auto heapStart = process->GetProgramBreak();
+	assert(process->SetProgramBreak(heapStart + 0x2000));
+	memoryMap->Write32(heapStart + 0x1ffc, 0xdeadbeef);
+
+	auto mapping = std::make_shared<MemorySection>();
+	mapping->SetAddress(mappingAddress);
+	mapping->Resize(0x1000);
+	mapping->CopyData("mapped", 6);
+	mapping->AllowRead(true);
+	mapping->AllowWrite(false);
+	process->AddMapping(mapping);
+
+	std::ostringstream incremental;
+	process->SaveCheckpoint(incremental, false);
+
+	auto restored = Restore(full.str() + incremental.str());
+	CheckSame(*process, *restored);
+
+	auto restoredMap = restored->GetMemoryMap();
+	assert(restoredMap->Read32(dataAddress) == 0x11);
+	assert(restoredMap->Read32(dataAddress + 0x1000) == 0x22);
+	assert(restoredMap->Read32(heapStart + 0x1ffc) == 0xdeadbeef);
+	assert(!restoredMap->FindSection(mappingAddress)->WriteAllowed());
+
+	/* the restored process runs on */
+	auto restoredCPU = restored->GetThread(0)->GetCPU();
+	assert(restoredCPU->GetRegister(4) == 0x33);
+	restored->Step(1);
+	assert(restoredCPU->GetInstructionPointer() == (codeAddress + 0x1e));
+}
+
+void TestCorrupt() {
+
+	auto process = MakeTestProcess(checkpointProgram, dataAddress, 0x2000);
+	process->Step(2);
+
+	std::ostringstream full;
+	process->SaveCheckpoint(full, true);
+
+	/* nothing was written since, so the
+	 * incremental record has no pages */
+	std::ostringstream incremental;
+	process->SaveCheckpoint(incremental, false);
+	assert(incremental.str().size() < full.str().size());
+
+	auto expectFailure = [](const std::string &records) {
+		auto failed = false;
+		try {
+			Restore(records);
+		} catch (const Exception &) {
+			failed = true;
+		}
+		assert(failed);
+	};
+
+	/* an empty checkpoint, and one
+	 * cut off anywhere in the record */
+	auto records = full.str();
+	for (size_t size = 0; size < records.size(); size += 61)
+		expectFailure(records.substr(0, size));
+
+	expectFailure(records.substr(0, records.size() - 1));
+
+	/* a record that isn't a checkpoint */
+	auto badMagic = records;
+	badMagic[0] ^= 0xff;
+	expectFailure(badMagic);
+
+	/* a record of another version */
+	auto badVersion = records;
+	badVersion[4] ^= 0xff;
+	expectFailure(badVersion);
+
+	/* an incremental record on its own */
+	expectFailure(incremental.str());
+
+	/* a bad record after a good one */
+	expectFailure(records + badMagic);
+}
+
+} // namespace
+
+void TestCheckpoint() {
+	TestRoundTrip();
+	TestCorrupt();
+}
+
+} // namespace swanson::tests
@@ -0,0 +1,202 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "console-test.hpp"
+
+#include <swanson/console.hpp>
+#include <swanson/elf.hpp>
+#include <swanson/process.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the
+/// text that's written.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// The text that the program writes.
+const std::string text = "ab\ncd";
+
+/// Writes the text to standard
+/// output, then exits.
+const std::vector<unsigned char> writeProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r0, 1 */
+	0x01, 0x30, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r1, 0x20000 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x05, /* ldi.l $r2, 5 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x05, /* swi write */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// A host pipe that the
+/// console writes to.
+class HostPipe final {
+public:
+	/// The read end.
+	int readFD;
+	/// The write end.
+	int writeFD;
+	HostPipe() {
+		int fds[2];
+		assert(pipe(fds) == 0);
+		readFD = fds[0];
+		writeFD = fds[1];
+		fcntl(readFD, F_SETFL, fcntl(readFD, F_GETFL) | O_NONBLOCK);
+	}
+	~HostPipe() {
+		close(readFD);
+		close(writeFD);
+	}
+	/// Read what's been written so far.
+	std::string ReadAll() {
+		std::string str;
+		char buf[256];
+		for (;;) {
+			auto result = read(readFD, buf, sizeof(buf));
+			if (result <= 0)
+				break;
+			str.append(buf, result);
+		}
+		return str;
+	}
+};
+
+void TestLine() {
+
+	HostPipe hostPipe;
+
+	auto console = std::make_shared<Console>();
+	console->SetMode(hostPipe.writeFD, Console::Mode::Line);
+
+	auto stream = console->Open(hostPipe.writeFD);
+	assert(stream->GetMode() == Console::Mode::Line);
+
+	stream->Write("ab", 2);
+	console->Wait();
+	assert(hostPipe.ReadAll().empty());
+
+	stream->Write("c\nd", 3);
+	console->Wait();
+	assert(hostPipe.ReadAll() == "abc\n");
+
+	/* a full buffer is written
+	 * without the end of a line */
+	std::string line(Console::blockSize, 'x');
+	stream->Write(line.data(), line.size());
+	console->Wait();
+	assert(hostPipe.ReadAll() == ("d" + line));
+
+	stream->Write("e", 1);
+	console->Flush();
+	assert(hostPipe.ReadAll() == "e");
+}
+
+void TestBlock() {
+
+	HostPipe hostPipe;
+
+	auto console = std::make_shared<Console>();
+
+	/* streams of unknown descriptors
+	 * are block buffered */
+	auto stream = console->Open(hostPipe.writeFD);
+	assert(stream->GetMode() == Console::Mode::Block);
+
+	std::string block(Console::blockSize - 1, 'y');
+	stream->Write(block.data(), block.size());
+	stream->Write("\n", 1);
+	console->Wait();
+	assert(hostPipe.ReadAll() == (block + "\n"));
+
+	stream->Write("z\n", 2);
+	console->Wait();
+	assert(hostPipe.ReadAll().empty());
+
+	/* closing the stream flushes it */
+	stream.reset();
+	console->Wait();
+	assert(hostPipe.ReadAll() == "z\n");
+}
+
+void TestUnbuffered() {
+
+	HostPipe hostPipe;
+
+	auto console = std::make_shared<Console>();
+	console->SetMode(hostPipe.writeFD, Console::Mode::Unbuffered);
+
+	auto first = console->Open(hostPipe.writeFD);
+	auto second = console->Open(hostPipe.writeFD);
+
+	first->Write("a", 1);
+	second->Write("b", 1);
+	first->Write("c", 1);
+	console->Wait();
+	assert(hostPipe.ReadAll() == "abc");
+}
+
+void TestProcess() {
+
+	HostPipe hostPipe;
+
+	auto console = std::make_shared<Console>();
+	console->SetMode(hostPipe.writeFD, Console::Mode::Line);
+
+	auto image = MakeTestImage(writeProgram, dataAddress, 0x1000);
+	auto data = *std::next(image.begin());
+	data->AllowWrite(false);
+	std::memcpy(data->GetData(), text.data(), text.size());
+
+	auto process = MakeTestProcess(image);
+	process->SetStream(1, console->Open(hostPipe.writeFD));
+
+	/* the end of the line is written */
+	process->Step(4);
+	console->Wait();
+	assert(hostPipe.ReadAll() == "ab\n");
+
+	/* the rest is written on exit */
+	while (!process->Exited())
+		process->Step(100);
+
+	console->Wait();
+	assert(hostPipe.ReadAll() == "cd");
+}
+
+} // namespace
+
+void TestConsole() {
+	TestLine();
+	TestBlock();
+	TestUnbuffered();
+	TestProcess();
+}
+
+} // namespace swanson::tests
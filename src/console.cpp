@@ -0,0 +1,299 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/console.hpp>
+
+#include <swanson/exception.hpp>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif /* _WIN32 */
+
+#include <algorithm>
+
+#include <cerrno>
+
+namespace swanson {
+
+namespace {
+
+/// The most chunks that are
+/// gathered into one write.
+constexpr size_t maxGather = 64;
+
+#ifdef _WIN32
+
+/// Write a buffer to a host file
+/// descriptor, for hosts without writev.
+void WriteAll(int fd, const unsigned char *data, size_t size) {
+	while (size > 0) {
+		auto result = _write(fd, data, (unsigned int) size);
+		if (result < 0)
+			return;
+		data += result;
+		size -= result;
+	}
+}
+
+#endif /* _WIN32 */
+
+} // namespace
+
+Console::Console() : writing(false), stopping(false) {
+	modes[1] = Mode::Line;
+	modes[2] = Mode::Unbuffered;
+	writer = std::thread([this] { Work(); });
+}
+
+Console::~Console() {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	chunkReady.notify_all();
+
+	writer.join();
+}
+
+void Console::Flush() {
+
+	std::vector<std::shared_ptr<ConsoleStream>> openStreams;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (auto &stream : streams) {
+			auto openStream = stream.lock();
+			if (openStream != nullptr)
+				openStreams.emplace_back(openStream);
+		}
+	}
+
+	for (auto &stream : openStreams)
+		stream->Flush();
+
+	Wait();
+}
+
+std::shared_ptr<ConsoleStream> Console::Open(int fd) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto mode = Mode::Block;
+
+	auto it = modes.find(fd);
+	if (it != modes.end())
+		mode = it->second;
+
+	auto stream = std::make_shared<ConsoleStream>(shared_from_this(), fd, mode);
+
+	// Streams of processes that have
+	// been reaped are dropped here.
+
+	streams.erase(std::remove_if(streams.begin(), streams.end(), [](const std::weak_ptr<ConsoleStream> &s) {
+		return s.expired();
+	}), streams.end());
+
+	streams.emplace_back(stream);
+
+	return stream;
+}
+
+void Console::SetMode(int fd, Mode mode) {
+	std::unique_lock<std::mutex> lock(mutex);
+	modes[fd] = mode;
+}
+
+void Console::Submit(int fd, std::vector<unsigned char> data) {
+
+	if (data.empty())
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		Chunk chunk;
+		chunk.fd = fd;
+		chunk.data = std::move(data);
+		chunks.emplace_back(std::move(chunk));
+	}
+
+	chunkReady.notify_one();
+}
+
+void Console::Wait() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	drained.wait(lock, [this] { return chunks.empty() && !writing; });
+}
+
+void Console::Work() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+
+		chunkReady.wait(lock, [this] { return stopping || !chunks.empty(); });
+
+		if (chunks.empty()) {
+			// Only reached when stopping.
+			return;
+		}
+
+		std::deque<Chunk> batch;
+		batch.swap(chunks);
+
+		writing = true;
+
+		lock.unlock();
+
+		WriteChunks(batch);
+
+		lock.lock();
+
+		writing = false;
+
+		if (chunks.empty())
+			drained.notify_all();
+	}
+}
+
+void Console::WriteChunks(std::deque<Chunk> &batch) {
+
+	auto it = batch.begin();
+
+	while (it != batch.end()) {
+
+		auto fd = it->fd;
+
+#ifndef _WIN32
+
+		std::vector<struct iovec> iov;
+
+		while ((it != batch.end()) && (it->fd == fd) && (iov.size() < maxGather)) {
+			struct iovec entry;
+			entry.iov_base = it->data.data();
+			entry.iov_len = it->data.size();
+			iov.emplace_back(entry);
+			it++;
+		}
+
+		// Short writes leave the rest of the
+		// vector to be written by the next call.
+
+		size_t first = 0;
+
+		while (first < iov.size()) {
+
+			auto result = writev(fd, &iov[first], (int) (iov.size() - first));
+			if (result < 0) {
+				if (errno == EINTR)
+					continue;
+				// There's nobody to report the
+				// error to, so the data is dropped.
+				break;
+			}
+
+			size_t written = result;
+
+			while ((first < iov.size()) && (written >= iov[first].iov_len)) {
+				written -= iov[first].iov_len;
+				first++;
+			}
+
+			if (first < iov.size()) {
+				iov[first].iov_base = ((unsigned char *) iov[first].iov_base) + written;
+				iov[first].iov_len -= written;
+			}
+		}
+#else
+		(void) maxGather;
+		WriteAll(fd, it->data.data(), it->data.size());
+		it++;
+#endif
+	}
+}
+
+ConsoleStream::ConsoleStream(std::shared_ptr<Console> console_, int fd_, Console::Mode mode_)
+	: console(console_), fd(fd_), mode(mode_) {
+
+}
+
+ConsoleStream::~ConsoleStream() {
+	Flush();
+}
+
+void ConsoleStream::Flush() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	std::vector<unsigned char> data;
+	data.swap(buffer);
+
+	console->Submit(fd, std::move(data));
+}
+
+void ConsoleStream::Read(void *, uint64_t) {
+	throw Exception("Console streams may not be read.");
+}
+
+void ConsoleStream::SetPosition(uint64_t) {
+	throw Exception("Console streams have no position.");
+}
+
+void ConsoleStream::Write(const void *buf, uint64_t bufSize) {
+
+	auto data = (const unsigned char *) buf;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	buffer.insert(buffer.end(), data, data + bufSize);
+
+	// The console is handed whole buffers,
+	// and the stream starts a new one, so
+	// nothing is copied a second time.
+
+	size_t handOff = 0;
+
+	if ((mode == Console::Mode::Unbuffered) || (buffer.size() >= Console::blockSize)) {
+		handOff = buffer.size();
+	} else if (mode == Console::Mode::Line) {
+		for (size_t i = buffer.size(); i > (buffer.size() - bufSize); i--) {
+			if (buffer[i - 1] == '\n') {
+				handOff = i;
+				break;
+			}
+		}
+	}
+
+	if (handOff == 0)
+		return;
+
+	std::vector<unsigned char> rest(buffer.begin() + handOff, buffer.end());
+	buffer.resize(handOff);
+
+	console->Submit(fd, std::move(buffer));
+
+	buffer = std::move(rest);
+}
+
+} // namespace swanson
@@ -67,6 +67,9 @@ public:
 	void SetRegister(uint32_t index, uint32_t value) noexcept {
 		cpu->SetRegister(index, value);
 	}
+	void SetSpecialRegister(uint8_t index, uint32_t value) {
+		cpu->SetSpecialRegister(index, value);
+	}
 	void SetFramePointer(uint32_t addr) noexcept {
 		cpu->SetFramePointer(addr);
 	}
@@ -94,8 +97,11 @@ public:
 	bool CheckMemory(uint32_t address, uint32_t value) const {
 		return memoryMap->Read32(address) == value;
 	}
-	void Run(unsigned int steps = 1) {
-		cpu->Step(steps);
+	auto Run(unsigned int steps = 1) {
+		return cpu->Step(steps);
+	}
+	void Yield() noexcept {
+		cpu->Yield();
 	}
 };
 
@@ -520,6 +526,29 @@ void TestMisc() {
 	test2.SetRegister(5, 0xfc);
 	test2.Run();
 	assert(test2.CheckRegister(4, 0xfffffffc));
+
+	// gsr, before and after a
+	// special register is set
+	Test test3;
+	test3.SetCodeBytes({ 0xa3, 0x05, 0xa4, 0x05 });
+	test3.SetRegister(3, 1);
+	test3.Run();
+	assert(test3.CheckRegister(3, 0));
+	test3.SetSpecialRegister(5, 0x1234);
+	test3.Run();
+	assert(test3.CheckRegister(4, 0x1234));
+}
+
+void TestYield() {
+
+	Test test;
+	test.SetCodeBytes({ 0x1a, 0x00, 0x00, 0x00, 0x00, 0x00 /* jmpa 0x00 */ });
+
+	// a yield outside of a step
+	// ends the next one, and only it
+	test.Yield();
+	assert(test.Run(10) == 0);
+	assert(test.Run(10) == 10);
 }
 
 } // namespace
@@ -537,6 +566,7 @@ void TestCPU() {
 	TestLoadImmediate();
 	TestLoadOffset();
 	TestPushPop();
+	TestYield();
 }
 
 } // namespace swanson::tests
@@ -60,9 +60,9 @@ namespace swanson {
 
 CPU::CPU() noexcept {
 	std::memset(regs, 0, sizeof(regs));
-	std::memset(sregs, 0, sizeof(sregs));
 	condition = conditions::eq;
 	instructionCount = 0;
+	yielding = false;
 }
 
 uint32_t CPU::GetRegister(uint32_t index) const noexcept {
@@ -77,13 +77,39 @@ void CPU::SetRegister(uint32_t index, uint32_t value) noexcept {
 		regs[index] = value;
 }
 
-void CPU::Step(uint32_t steps) {
-	for (decltype(steps) i = 0; i < steps; i++) {
+void CPU::SetSpecialRegister(uint8_t index, uint32_t value) {
+
+	if (sregs == nullptr) {
+		if (value == 0)
+			return;
+		sregs.reset(new uint32_t[256]());
+	}
+
+	sregs[index] = value;
+}
+
+uint32_t CPU::Step(uint32_t steps) {
+
+	decltype(steps) i = 0;
+
+	while (i < steps) {
+
+		// The flag is only cleared when it's
+		// acted on. A yield that comes in after
+		// the last check ends the next call instead.
+
+		if (yielding.load(std::memory_order_relaxed)
+		 && yielding.exchange(false, std::memory_order_relaxed))
+			break;
+
 		auto continuationFlag = StepOnce();
 		if (!continuationFlag)
 			break;
 		instructionCount++;
+		i++;
 	}
+
+	return i;
 }
 
 void CPU::SetMemoryBus(std::shared_ptr<MemoryBus> memoryBus_) noexcept {
@@ -206,7 +232,7 @@ bool CPU::StepOnce() {
 		return true;
 	case 0x0a:
 		a = (inst & 0x0f00) >> 0x08;
-		regs[a] = sregs[inst & 0xff];
+		regs[a] = GetSpecialRegister(inst & 0xff);
 		SetInstructionPointer(instructionPointer + 2);
 		return true;
 	default:
@@ -507,9 +533,12 @@ bool CPU::StepOnce() {
 		break;
 	case 0x30: /* swi */
 		immediate = memoryBus.Exec32(instructionPointer + 2);
-		HandleInterrupt(immediate);
+		// The handler may move the instruction
+		// pointer (like execve does), so it's
+		// advanced before the handler is called.
 		SetInstructionPointer(instructionPointer + 6);
-		return false;
+		HandleInterrupt(immediate);
+		return true;
 	case 0x2e: /* xor */
 		a = get_a(inst);
 		b = get_b(inst);
@@ -69,7 +69,22 @@ void Disk::Read(void *buf, uint64_t bufSize) {
 	file.read((char *) buf, bufSize);
 }
 
+uint64_t Disk::ReadSome(void *buf, uint64_t bufSize) {
+
+	file.read((char *) buf, bufSize);
+
+	auto readSize = (uint64_t) file.gcount();
+
+	// Reaching the end of the file
+	// isn't an error for the caller.
+	if (file.eof())
+		file.clear();
+
+	return readSize;
+}
+
 void Disk::SetPosition(uint64_t pos) {
+	file.clear();
 	file.seekp(pos);
 }
 
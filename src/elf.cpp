@@ -74,6 +74,12 @@ void Segment::Resize(uint64_t size) {
 	if (tmp == nullptr)
 		throw Exception("Failed to allocate memory.");
 
+	// The part of a segment past its file
+	// data is zero-filled memory (like .bss).
+
+	if (size > dataSize)
+		std::memset(((unsigned char *) tmp) + dataSize, 0, size - dataSize);
+
 	data = tmp;
 	dataSize = size;
 }
@@ -0,0 +1,258 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "file-syscalls-test.hpp"
+
+#include <swanson/elf.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/hostfs.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/process.hpp>
+#include <swanson/syscalls.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the path
+/// of the file that's opened.
+constexpr uint32_t pathAddress = 0x20000;
+
+/// The address of the path of
+/// a file that doesn't exist.
+constexpr uint32_t missingAddress = 0x20020;
+
+/// The address of the
+/// data that's written.
+constexpr uint32_t textAddress = 0x20040;
+
+/// The address of the buffer
+/// that the file is read into.
+constexpr uint32_t bufferAddress = 0x20100;
+
+/// The address that fstat
+/// writes its record to.
+constexpr uint32_t statAddress = 0x20200;
+
+/// The address that the result
+/// of each call is stored at.
+constexpr uint32_t resultAddress = 0x20300;
+
+/// Creates a file, writes to it, seeks
+/// back and reads part of it, describes
+/// it, then closes it.
+const std::vector<unsigned char> fileProgram {
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r0, pathAddress */
+	0x01, 0x30, 0x00, 0x00, 0x06, 0x02, /* ldi.l $r1, O_RDWR | O_CREAT | O_TRUNC */
+	0x01, 0x40, 0x00, 0x00, 0x01, 0xa4, /* ldi.l $r2, 0644 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x02, /* swi open */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x00, /* sta.l resultAddress, $r0 */
+	0x01, 0x30, 0x00, 0x02, 0x00, 0x40, /* ldi.l $r1, textAddress */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x05, /* ldi.l $r2, 5 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x05, /* swi write */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x04, /* sta.l resultAddress + 4, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r1, 1 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r2, seek_set */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x06, /* swi lseek */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x08, /* sta.l resultAddress + 8, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x01, 0x30, 0x00, 0x02, 0x01, 0x00, /* ldi.l $r1, bufferAddress */
+	0x01, 0x40, 0x00, 0x00, 0x01, 0x00, /* ldi.l $r2, 0x100 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x0c, /* sta.l resultAddress + 12, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x01, 0x30, 0x00, 0x02, 0x02, 0x00, /* ldi.l $r1, statAddress */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x0a, /* swi fstat */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x10, /* sta.l resultAddress + 16, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x01, 0x30, 0xff, 0xff, 0xff, 0xfe, /* ldi.l $r1, -2 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x02, /* ldi.l $r2, seek_end */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x06, /* swi lseek */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x14, /* sta.l resultAddress + 20, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x03, /* swi close */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x18, /* sta.l resultAddress + 24, $r0 */
+	0x08, 0x20, 0x00, 0x02, 0x03, 0x00, /* lda.l $r0, resultAddress */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x03, /* swi close */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x1c, /* sta.l resultAddress + 28, $r0 */
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x20, /* ldi.l $r0, missingAddress */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r1, O_RDONLY */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x02, /* swi open */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x20, /* sta.l resultAddress + 32, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r0, 1 */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r1, 0 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r2, seek_set */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x06, /* swi lseek */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x24, /* sta.l resultAddress + 36, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Reads three bytes of descriptor three, maps
+/// its first eight bytes, which are shorter than
+/// the mapping, and reads three more bytes. Then it
+/// makes a fixed mapping that would wrap past the
+/// end of memory.
+const std::vector<unsigned char> mmapProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r0, 3 */
+	0x01, 0x30, 0x00, 0x02, 0x01, 0x00, /* ldi.l $r1, bufferAddress */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r2, 3 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x01, 0x30, 0x00, 0x00, 0x20, 0x00, /* ldi.l $r1, 0x2000 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r2, prot_read */
+	0x01, 0x50, 0x00, 0x00, 0x00, 0x02, /* ldi.l $r3, map_private */
+	0x01, 0x60, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r4, 3 */
+	0x01, 0x70, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r5, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x19, /* swi mmap */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x00, /* sta.l resultAddress, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r0, 3 */
+	0x01, 0x30, 0x00, 0x02, 0x01, 0x04, /* ldi.l $r1, bufferAddress + 4 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r2, 3 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x01, 0x20, 0xff, 0xff, 0xf0, 0x00, /* ldi.l $r0, 0xfffff000 */
+	0x01, 0x30, 0x00, 0x00, 0x20, 0x00, /* ldi.l $r1, 0x2000 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r2, prot_read */
+	0x01, 0x50, 0x00, 0x00, 0x00, 0x32, /* ldi.l $r3, map_private | map_fixed | map_anonymous */
+	0x01, 0x60, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r4, 0 */
+	0x01, 0x70, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r5, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x19, /* swi mmap */
+	0x09, 0x20, 0x00, 0x02, 0x03, 0x04, /* sta.l resultAddress + 4, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Writes a string into a segment.
+void PutString(elf::Segment &segment, uint32_t address, const std::string &str) {
+	std::memcpy((unsigned char *) segment.GetData() + (address - pathAddress), str.c_str(), str.size() + 1);
+}
+
+void TestHostFS() {
+
+	auto root = std_fs::temp_directory_path() / ("swanson-file-test-" + std::to_string(getpid()));
+
+	std_fs::create_directories(root);
+
+	auto image = MakeTestImage(fileProgram, pathAddress, 0x1000);
+	auto data = *std::next(image.begin());
+	PutString(*data, pathAddress, "/file.txt");
+	PutString(*data, missingAddress, "/missing.txt");
+	PutString(*data, textAddress, "hello");
+
+	auto process = MakeTestProcess(image);
+	process->SetRootFS(hostfs::FS::Create(root.string()));
+
+	while (!process->Exited())
+		process->Step(100);
+
+	assert(process->GetExitCode() == 0);
+
+	auto &memoryMap = *process->GetMemoryMap();
+
+	/* open, write, lseek and read */
+	assert(memoryMap.Read32(resultAddress) == 3);
+	assert(memoryMap.Read32(resultAddress + 4) == 5);
+	assert(memoryMap.Read32(resultAddress + 8) == 1);
+	assert(memoryMap.Read32(resultAddress + 12) == 4);
+
+	char buffer[5];
+	memoryMap.ReadBlock(bufferAddress, buffer, 4);
+	buffer[4] = 0;
+	assert(std::strcmp(buffer, "ello") == 0);
+
+	/* fstat */
+	assert(memoryMap.Read32(resultAddress + 16) == 0);
+	auto mode = memoryMap.Read32(statAddress);
+	assert((mode & syscalls::stat_type_mask) == syscalls::stat_type_regular);
+	assert(memoryMap.Read32(statAddress + 4) == 0);
+	assert(memoryMap.Read32(statAddress + 8) == 5);
+
+	/* lseek from the end */
+	assert(memoryMap.Read32(resultAddress + 20) == 3);
+
+	/* close, then close again */
+	assert(memoryMap.Read32(resultAddress + 24) == 0);
+	assert(memoryMap.Read32(resultAddress + 28) == errors::ToResult(errors::badf));
+
+	/* open a missing file */
+	assert(memoryMap.Read32(resultAddress + 32) == errors::ToResult(errors::noent));
+
+	/* seek the console */
+	assert(memoryMap.Read32(resultAddress + 36) == errors::ToResult(errors::spipe));
+
+	/* the data reached the host */
+	std::ifstream hostFile((root / "file.txt").string());
+	std::string contents;
+	std::getline(hostFile, contents);
+	assert(contents == "hello");
+
+	std_fs::remove_all(root);
+}
+
+void TestMmap() {
+
+	auto process = MakeTestProcess(mmapProgram, pathAddress, 0x1000);
+
+	/* the stream can't be mapped */
+	process->SetStream(3, std::make_shared<MemoryStream>(std::string("contents")));
+
+	while (!process->Exited())
+		process->Step(100);
+
+	assert(process->GetExitCode() == 0);
+
+	auto &memoryMap = *process->GetMemoryMap();
+
+	/* the part past the end of the stream is zero */
+	auto addr = memoryMap.Read32(resultAddress);
+	assert(!errors::IsError(addr));
+
+	char buffer[12];
+	memoryMap.ReadBlock(addr, buffer, sizeof(buffer));
+	assert(std::memcmp(buffer, "contents\0\0\0\0", sizeof(buffer)) == 0);
+	assert(memoryMap.Read32(addr + 0x1ffc) == 0);
+
+	/* and the offset of the stream
+	 * isn't moved by mapping it */
+	memoryMap.ReadBlock(bufferAddress, buffer, 7);
+	assert(std::memcmp(buffer, "con\0ten", 7) == 0);
+
+	/* fixed mappings may not wrap */
+	assert(memoryMap.Read32(resultAddress + 4) == errors::ToResult(errors::inval));
+}
+
+} // namespace
+
+void TestFileSyscalls() {
+	TestHostFS();
+	TestMmap();
+}
+
+} // namespace swanson::tests
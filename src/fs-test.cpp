@@ -17,10 +17,15 @@
 
 #include "fs-test.hpp"
 
+#include <swanson/host-mapping.hpp>
+#include <swanson/stream.hpp>
 #include <swanson/tmpfs.hpp>
 
 #include "assert.h"
 
+#include <cstring>
+#include <vector>
+
 namespace {
 
 void TestVFS(swanson::vfs::Directory &root) {
@@ -38,12 +43,51 @@ void TestTmpFS() {
 	TestVFS(root);
 }
 
+void TestTmpFileMap() {
+
+	swanson::tmpfs::File file;
+
+	auto stream = file.Open(swanson::vfs::modes::read | swanson::vfs::modes::write);
+
+	stream->Write("hello", 5);
+	assert(stream->GetSize() == 5);
+
+	/* a mapping longer than the file
+	 * views it, and reads zeros past
+	 * its end */
+	auto mapping = stream->Map(0, 0x2000, false, false);
+	assert(mapping != nullptr);
+	assert(std::memcmp(mapping->GetData(), "hello", 5) == 0);
+	assert(mapping->GetData()[5] == 0);
+	assert(mapping->GetData()[0x1fff] == 0);
+	assert(stream->GetSize() == 5);
+
+	/* the bytes are shared with the file */
+	stream->SetPosition(0);
+	stream->Write("j", 1);
+	assert(mapping->GetData()[0] == 'j');
+
+	/* and the file grows into the
+	 * mapping without moving */
+	stream->SetPosition(5);
+	stream->Write(" world", 6);
+	assert(stream->GetSize() == 11);
+	assert(std::memcmp(mapping->GetData(), "jello world", 11) == 0);
+
+	/* but not past what was allocated */
+	std::vector<unsigned char> large(0x3000, 'x');
+	stream->Write(large.data(), large.size());
+	assert(stream->GetSize() == 0x2000);
+	assert(mapping->GetData()[0x1fff] == 'x');
+}
+
 } // namespace
 
 namespace swanson::tests {
 
 void TestFS() {
 	TestTmpFS();
+	TestTmpFileMap();
 }
 
 } // namespace swanson::tests
@@ -0,0 +1,326 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/host-mapping.hpp>
+
+#include <swanson/exception.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include <cstdlib>
+
+namespace swanson {
+
+HostMapping::HostMapping() noexcept {
+	data = nullptr;
+	size = 0;
+	capacity = 0;
+	committedSize = 0;
+	mappedSize = 0;
+	writable = false;
+	shared = false;
+}
+
+HostMapping::~HostMapping() {
+#ifndef _WIN32
+	if (mappedSize > 0)
+		munmap(data, mappedSize);
+#else
+	if (mappedSize > 0)
+		std::free(data);
+#endif
+}
+
+std::shared_ptr<HostMapping> HostMapping::MapFile(const std::string &path,
+                                                  uint64_t offset,
+                                                  uint32_t size,
+                                                  bool writable,
+                                                  bool shared) {
+#ifndef _WIN32
+
+	if (size == 0)
+		throw Exception("Host mappings may not be empty.");
+
+	auto pageSize = (uint64_t) sysconf(_SC_PAGESIZE);
+	if ((offset % pageSize) != 0)
+		throw Exception("Host mapping offset is not page aligned.");
+
+	auto fd = open(path.c_str(), (writable && shared) ? O_RDWR : O_RDONLY);
+	if (fd < 0)
+		throw Exception("Failed to open file for mapping.");
+
+	struct stat fileInfo;
+	if (fstat(fd, &fileInfo) != 0) {
+		close(fd);
+		throw Exception("Failed to get size of mapped file.");
+	}
+
+	// Pages past the end of the file would
+	// raise SIGBUS on the host when touched, so
+	// the region is reserved as zero-filled
+	// memory first and the file is placed over
+	// the part of it that the file can back.
+
+	auto prot = PROT_READ | (writable ? PROT_WRITE : 0);
+
+	auto addr = mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED) {
+		close(fd);
+		throw Exception("Failed to reserve host memory for mapping.");
+	}
+
+	uint64_t fileSize = fileInfo.st_size;
+	uint64_t backedSize = 0;
+	if (fileSize > offset)
+		backedSize = fileSize - offset;
+	if (backedSize > size)
+		backedSize = size;
+
+	if (backedSize > 0) {
+		auto flags = MAP_FIXED | (shared ? MAP_SHARED : MAP_PRIVATE);
+		if (mmap(addr, backedSize, prot, flags, fd, (off_t) offset) == MAP_FAILED) {
+			munmap(addr, size);
+			close(fd);
+			throw Exception("Failed to map file from host.");
+		}
+	}
+
+	// The mapping keeps a reference to the
+	// file, so the descriptor isn't needed.
+	close(fd);
+
+	auto mapping = std::make_shared<HostMapping>();
+	mapping->data = (unsigned char *) addr;
+	mapping->size = size;
+	mapping->capacity = size;
+	mapping->committedSize = size;
+	mapping->mappedSize = size;
+	mapping->writable = writable;
+	mapping->shared = shared;
+	return mapping;
+#else
+	(void) path;
+	(void) offset;
+	(void) size;
+	(void) writable;
+	(void) shared;
+	throw Exception("File mappings are not supported on this platform.");
+#endif
+}
+
+std::shared_ptr<HostMapping> HostMapping::MapFilePrivate(const std::string &path,
+                                                         uint64_t offset,
+                                                         uint32_t size,
+                                                         uint32_t capacity) {
+#ifndef _WIN32
+
+	if ((capacity == 0) || (size > capacity))
+		throw Exception("Host mapping capacity is not valid.");
+
+	uint64_t pageSize = GetPageSize();
+	if ((offset % pageSize) != 0)
+		throw Exception("Host mapping offset is not page aligned.");
+
+	auto fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw Exception("Failed to open file for mapping.");
+
+	struct stat fileInfo;
+	if (fstat(fd, &fileInfo) != 0) {
+		close(fd);
+		throw Exception("Failed to get size of mapped file.");
+	}
+
+	// The file is placed over whole pages at the
+	// start of a reservation, and the rest of the
+	// reservation is committed as the region grows.
+
+	uint64_t committed = ((size + (pageSize - 1)) / pageSize) * pageSize;
+	if (committed > capacity)
+		committed = capacity;
+
+	if ((offset + committed) > (uint64_t) fileInfo.st_size) {
+		close(fd);
+		throw Exception("Mapped file is too small.");
+	}
+
+	auto addr = mmap(nullptr, capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (addr == MAP_FAILED) {
+		close(fd);
+		throw Exception("Failed to reserve host memory for mapping.");
+	}
+
+	if (committed > 0) {
+		auto flags = MAP_FIXED | MAP_PRIVATE;
+		if (mmap(addr, committed, PROT_READ | PROT_WRITE, flags, fd, (off_t) offset) == MAP_FAILED) {
+			munmap(addr, capacity);
+			close(fd);
+			throw Exception("Failed to map file from host.");
+		}
+	}
+
+	close(fd);
+
+	auto mapping = std::make_shared<HostMapping>();
+	mapping->data = (unsigned char *) addr;
+	mapping->size = size;
+	mapping->capacity = capacity;
+	mapping->committedSize = committed;
+	mapping->mappedSize = capacity;
+	mapping->writable = true;
+	mapping->shared = false;
+	return mapping;
+#else
+	(void) path;
+	(void) offset;
+	(void) size;
+	(void) capacity;
+	throw Exception("File mappings are not supported on this platform.");
+#endif
+}
+
+std::shared_ptr<HostMapping> HostMapping::MapAnonymous(uint32_t size) {
+
+	if (size == 0)
+		throw Exception("Host mappings may not be empty.");
+
+#ifndef _WIN32
+	auto addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED)
+		throw Exception("Failed to map memory from host.");
+#else
+	auto addr = std::calloc(size, 1);
+	if (addr == nullptr)
+		throw Exception("Failed to allocate memory.");
+#endif
+
+	auto mapping = std::make_shared<HostMapping>();
+	mapping->data = (unsigned char *) addr;
+	mapping->size = size;
+	mapping->capacity = size;
+	mapping->committedSize = size;
+	mapping->mappedSize = size;
+	mapping->writable = true;
+	mapping->shared = false;
+	return mapping;
+}
+
+std::shared_ptr<HostMapping> HostMapping::Reserve(uint32_t capacity) {
+
+	if (capacity == 0)
+		throw Exception("Host mappings may not be empty.");
+
+#ifndef _WIN32
+	auto addr = mmap(nullptr, capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (addr == MAP_FAILED)
+		throw Exception("Failed to reserve memory from host.");
+	uint64_t committed = 0;
+#else
+	auto addr = std::calloc(capacity, 1);
+	if (addr == nullptr)
+		throw Exception("Failed to allocate memory.");
+	uint64_t committed = capacity;
+#endif
+
+	auto mapping = std::make_shared<HostMapping>();
+	mapping->data = (unsigned char *) addr;
+	mapping->size = 0;
+	mapping->capacity = capacity;
+	mapping->committedSize = committed;
+	mapping->mappedSize = capacity;
+	mapping->writable = true;
+	mapping->shared = false;
+	return mapping;
+}
+
+uint32_t HostMapping::GetPageSize() noexcept {
+#ifndef _WIN32
+	return (uint32_t) sysconf(_SC_PAGESIZE);
+#else
+	return 4096;
+#endif
+}
+
+bool HostMapping::CanDiscard() const noexcept {
+	return (mappedSize > 0) && writable && !shared;
+}
+
+bool HostMapping::Discard(uint32_t offset, uint32_t length) noexcept {
+
+	if (!CanDiscard() || (offset > size) || (length > (size - offset)))
+		return false;
+
+#ifndef _WIN32
+	uint64_t pageSize = sysconf(_SC_PAGESIZE);
+	if (((offset % pageSize) != 0) || ((length % pageSize) != 0))
+		return false;
+
+	return madvise(data + offset, length, MADV_DONTNEED) == 0;
+#else
+	return false;
+#endif
+}
+
+void HostMapping::Resize(uint32_t size_) {
+
+	if (size_ > capacity)
+		throw Exception("Host mapping cannot grow past its capacity.");
+
+#ifndef _WIN32
+	if (size_ > committedSize) {
+
+		// Commit whole host pages, so that
+		// small increments don't each need
+		// a call to the host.
+
+		uint64_t pageSize = sysconf(_SC_PAGESIZE);
+		uint64_t commitEnd = ((size_ + (pageSize - 1)) / pageSize) * pageSize;
+		if (commitEnd > capacity)
+			commitEnd = capacity;
+
+		if (mprotect(data + committedSize, commitEnd - committedSize, PROT_READ | PROT_WRITE) != 0)
+			throw Exception("Failed to commit host memory.");
+
+		committedSize = commitEnd;
+	}
+#endif
+
+	size = size_;
+}
+
+std::shared_ptr<HostMapping> HostMapping::Borrow(void *data,
+                                                 uint32_t size,
+                                                 bool writable,
+                                                 std::shared_ptr<void> owner) {
+
+	auto mapping = std::make_shared<HostMapping>();
+	mapping->data = (unsigned char *) data;
+	mapping->size = size;
+	mapping->capacity = size;
+	mapping->committedSize = size;
+	mapping->writable = writable;
+	mapping->shared = true;
+	mapping->owner = owner;
+	return mapping;
+}
+
+} // namespace swanson
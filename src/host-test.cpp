@@ -0,0 +1,204 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "host-test.hpp"
+
+#include <swanson/host.hpp>
+#include <swanson/image-cache.hpp>
+#include <swanson/kernel.hpp>
+#include <swanson/process.hpp>
+#include <swanson/scheduler.hpp>
+#include <swanson/syscall-stats.hpp>
+#include <swanson/syscalls.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the data
+/// of the test programs.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// Exits with a code of zero.
+const std::vector<unsigned char> exitProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Loads from memory that isn't mapped.
+const std::vector<unsigned char> faultProgram {
+	0x08, 0x20, 0x00, 0x00, 0x00, 0x00 /* lda.l $r0, 0 */
+};
+
+/// Makes a pipe and reads from it, which
+/// blocks forever since the process holds
+/// the write end too.
+const std::vector<unsigned char> blockProgram {
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r0, 0x20000 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x1f, /* swi pipe */
+	0x08, 0x20, 0x00, 0x02, 0x00, 0x00, /* lda.l $r0, 0x20000 */
+	0x01, 0x30, 0x00, 0x02, 0x01, 0x00, /* ldi.l $r1, 0x20100 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x01, /* ldi.l $r2, 1 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Wrap code in a big-endian ELF file
+/// with one segment, at @ref codeAddress.
+std::vector<unsigned char> MakeELF(const std::vector<unsigned char> &code) {
+
+	constexpr uint32_t headerSize = 0x34;
+	constexpr uint32_t phSize = 0x20;
+
+	std::vector<unsigned char> data(headerSize + phSize);
+
+	auto store16 = [&data](uint32_t offset, uint16_t value) {
+		data[offset + 0] = (unsigned char) (value >> 8);
+		data[offset + 1] = (unsigned char) value;
+	};
+
+	auto store32 = [&data](uint32_t offset, uint32_t value) {
+		data[offset + 0] = (unsigned char) (value >> 24);
+		data[offset + 1] = (unsigned char) (value >> 16);
+		data[offset + 2] = (unsigned char) (value >> 8);
+		data[offset + 3] = (unsigned char) value;
+	};
+
+	data[0] = 0x7f;
+	data[1] = 'E';
+	data[2] = 'L';
+	data[3] = 'F';
+	data[4] = 1; /* 32-bit */
+	data[5] = 2; /* big-endian */
+	data[6] = 1; /* version */
+	store16(0x10, 2); /* executable */
+	store16(0x12, 0xdf); /* moxie */
+	store32(0x14, 1); /* version */
+	store32(0x18, codeAddress); /* entry point */
+	store32(0x1c, headerSize); /* program headers */
+	store16(0x28, headerSize);
+	store16(0x2a, phSize);
+	store16(0x2c, 1);
+
+	store32(headerSize + 0x00, 1); /* load */
+	store32(headerSize + 0x04, headerSize + phSize);
+	store32(headerSize + 0x08, codeAddress);
+	store32(headerSize + 0x0c, codeAddress);
+	store32(headerSize + 0x10, code.size());
+	store32(headerSize + 0x14, code.size());
+	store32(headerSize + 0x18, 5); /* read and execute */
+	store32(headerSize + 0x1c, 4);
+
+	data.insert(data.end(), code.begin(), code.end());
+
+	return data;
+}
+
+/// Make a file system with one
+/// file, '/bin/init', that runs code.
+std::shared_ptr<MemoryFS> MakeFS(const std::vector<unsigned char> &code) {
+	auto fs = std::make_shared<MemoryFS>();
+	fs->files["/bin/init"] = MakeELF(code);
+	return fs;
+}
+
+void TestTenants() {
+
+	Host host(2);
+
+	auto fs = MakeFS(exitProgram);
+
+	host.AddTenant()->SetRootFS(fs);
+	host.AddTenant()->SetRootFS(fs);
+	host.AddTenant()->SetRootFS(MakeFS(faultProgram));
+	assert(host.GetTenantCount() == 3);
+
+	/* only the faulting tenant fails */
+	assert(host.Run() == 1);
+	assert(host.GetFault(0) == nullptr);
+	assert(host.GetFault(1) == nullptr);
+	assert(host.GetFault(2) != nullptr);
+
+	/* the second tenant reuses the image of the first */
+	assert(host.GetImageCache()->GetMissCount() == 2);
+	assert(host.GetImageCache()->GetHitCount() == 1);
+
+	/* each kernel counts its own calls */
+	for (size_t i = 0; i < host.GetTenantCount(); i++) {
+		auto kernel = host.GetKernel(i);
+		assert(kernel->GetLiveCount() == 0);
+		auto calls = kernel->GetSyscallStats()->GetCallCount(syscalls::exit);
+		assert(calls == ((i < 2) ? 1 : 0));
+	}
+}
+
+void TestMissingInit() {
+
+	Host host(1);
+
+	/* a tenant without a root file system
+	 * fails without stopping the others */
+	host.AddTenant();
+	host.AddTenant()->SetRootFS(MakeFS(exitProgram));
+
+	assert(host.Run() == 1);
+	assert(host.GetFault(0) != nullptr);
+	assert(host.GetFault(1) == nullptr);
+}
+
+void TestKill() {
+
+	Scheduler scheduler(1);
+
+	auto blocked = MakeTestProcess(blockProgram, dataAddress, 0x1000);
+	scheduler.Add(blocked);
+
+	for (auto i = 0; (i < 5000) && (scheduler.GetParkedCount() == 0); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	assert(scheduler.GetParkedCount() == 1);
+
+	/* a parked process is woken up to exit */
+	blocked->Kill();
+
+	SchedulerEvent event;
+	scheduler.WaitEvent(event);
+	assert(event.type == SchedulerEventType::Exited);
+	assert(event.process == blocked);
+	assert(blocked->Exited());
+	assert(blocked->GetExitCode() == (128 + 9));
+	assert(scheduler.GetParkedCount() == 0);
+}
+
+} // namespace
+
+void TestHost() {
+	TestTenants();
+	TestMissingInit();
+	TestKill();
+}
+
+} // namespace swanson::tests
@@ -0,0 +1,145 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/host.hpp>
+
+#include <swanson/block-ring.hpp>
+#include <swanson/image-cache.hpp>
+#include <swanson/kernel.hpp>
+#include <swanson/process.hpp>
+#include <swanson/scheduler.hpp>
+
+#include <chrono>
+
+namespace swanson {
+
+Host::Host(unsigned int workerCount) {
+	scheduler = std::make_shared<Scheduler>(workerCount);
+	imageCache = std::make_shared<ImageCache>();
+}
+
+Host::~Host() {
+
+}
+
+void Host::AddDisk(std::shared_ptr<Disk> disk) {
+	blockRings.emplace_back(std::make_shared<BlockRing>(disk, true));
+}
+
+std::shared_ptr<Kernel> Host::AddTenant() {
+
+	auto kernel = std::make_shared<Kernel>();
+	kernel->SetScheduler(scheduler);
+	kernel->SetImageCache(imageCache);
+
+	if (initramfs != nullptr)
+		kernel->SetInitRamfs(initramfs);
+
+	for (auto &blockRing : blockRings)
+		kernel->AddBlockRing(blockRing);
+
+	Tenant tenant;
+	tenant.kernel = kernel;
+	tenant.running = false;
+	tenant.exitCode = ExitCode::Success;
+	tenants.emplace_back(std::move(tenant));
+
+	return kernel;
+}
+
+std::exception_ptr Host::GetFault(size_t index) const {
+	return tenants.at(index).fault;
+}
+
+std::shared_ptr<Kernel> Host::GetKernel(size_t index) const {
+	return tenants.at(index).kernel;
+}
+
+void Host::LoadInitRamfs(const void *addr, uintmax_t size) {
+	initramfs = Kernel::DecodeInitRamfs(addr, size);
+}
+
+size_t Host::Run() {
+
+	for (auto &tenant : tenants) {
+		try {
+			tenant.exitCode = tenant.kernel->Start();
+			tenant.running = (tenant.exitCode == ExitCode::Success);
+		} catch (...) {
+			tenant.fault = std::current_exception();
+		}
+	}
+
+	// The wait times out now and then, so
+	// that the tenants with page compressors
+	// or snapshots aren't held up.
+
+	while (HasLiveTenants()) {
+
+		SchedulerEvent event;
+
+		if (scheduler->WaitEvent(event, std::chrono::milliseconds(10)))
+			Dispatch(event);
+
+		for (auto &tenant : tenants) {
+			if (tenant.running)
+				tenant.kernel->Poll();
+		}
+	}
+
+	size_t failures = 0;
+
+	for (const auto &tenant : tenants) {
+		if ((tenant.exitCode != ExitCode::Success) || tenant.fault)
+			failures++;
+	}
+
+	return failures;
+}
+
+void Host::Dispatch(const SchedulerEvent &event) {
+
+	for (auto &tenant : tenants) {
+
+		if (!tenant.kernel->Owns(*event.process))
+			continue;
+
+		// The processes that the first one
+		// leaves behind are killed, which the
+		// scheduler reports like any exit.
+
+		if (tenant.kernel->HandleEvent(event) && tenant.running) {
+			tenant.running = false;
+			tenant.fault = event.fault;
+			tenant.kernel->Stop();
+		}
+
+		return;
+	}
+}
+
+bool Host::HasLiveTenants() const noexcept {
+
+	for (const auto &tenant : tenants) {
+		if (tenant.running || (tenant.kernel->GetLiveCount() > 0))
+			return true;
+	}
+
+	return false;
+}
+
+} // namespace swanson
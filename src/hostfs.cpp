@@ -19,6 +19,7 @@
 #include <swanson/hostfs.hpp>
 
 #include <swanson/exception.hpp>
+#include <swanson/host-mapping.hpp>
 #include <swanson/stream.hpp>
 
 #include <fstream>
@@ -28,20 +29,53 @@ namespace {
 
 class FileStream : public swanson::Stream {
 	std::fstream file;
+	std::string path;
 public:
 	FileStream() { }
 	~FileStream() { }
-	bool Open(const std::string &path) {
-		file.open(path);
+	bool Open(const std::string &path_, std::ios::openmode openMode) {
+		path = path_;
+		file.open(path, openMode);
 		return file.good();
 	}
+	uint64_t GetPosition() override {
+		auto position = file.rdbuf()->pubseekoff(0, std::ios::cur);
+		if (position == std::streampos(-1))
+			throw swanson::Exception("Failed to get file position.");
+		return (uint64_t) position;
+	}
+	uint64_t GetSize() override {
+		// Writes that are still buffered
+		// may have made the file larger.
+		file.flush();
+		return std_fs::file_size(path);
+	}
+	std::shared_ptr<swanson::HostMapping> Map(uint64_t offset, uint32_t size, bool writable, bool shared) override {
+		// Make sure that shared writes made through
+		// the stream are visible to the mapping.
+		file.flush();
+		return swanson::HostMapping::MapFile(path, offset, size, writable, shared);
+	}
 	void Write(const void *buf, uint64_t bufSize) override {
 		file.write((const char *) buf, bufSize);
 	}
 	void Read(void *buf, uint64_t bufSize) override {
 		file.read((char *) buf, bufSize);
 	}
+	uint64_t ReadSome(void *buf, uint64_t bufSize) override {
+		file.read((char *) buf, bufSize);
+		auto readSize = file.gcount();
+		// A short read sets the end of file
+		// flag, which would fail the next call.
+		if (file.eof())
+			file.clear();
+		return readSize;
+	}
 	void SetPosition(uint64_t position) override {
+		// A read that reached the end leaves
+		// the stream failed, which would make
+		// the seek do nothing.
+		file.clear();
 		file.seekp(position);
 	}
 };
@@ -78,7 +112,7 @@ std::shared_ptr<vfs::Directory> FS::GetRoot() {
 #endif
 }
 
-ExitCode FS::OpenFile(const std::string &path_string, std::shared_ptr<Stream> &stream) {
+ExitCode FS::OpenFile(const std::string &path_string, uint32_t mode, std::shared_ptr<Stream> &stream) {
 
 	std_fs::path path = path_string;
 
@@ -95,13 +129,43 @@ ExitCode FS::OpenFile(const std::string &path_string, std::shared_ptr<Stream> &s
 		abs_path_string += name;
 	}
 
-	auto fileStream = new ::FileStream();
+	std::error_code errorCode;
+
+	auto exists = std_fs::exists(abs_path_string, errorCode);
+
+	if (exists && (mode & vfs::modes::create) && (mode & vfs::modes::exclusive))
+		return ExitCode::EntryExists;
+	else if (!exists && !(mode & vfs::modes::create))
+		return ExitCode::EntryMissing;
+	else if (exists && std_fs::is_directory(abs_path_string, errorCode))
+		return ExitCode::InvalidArgument;
+
+	// The file is created and truncated up
+	// front, so that it's always opened for
+	// reading too. Opened for writing alone,
+	// it would be truncated regardless.
+
+	auto writable = (mode & vfs::modes::write) != 0;
+
+	if (!exists || (writable && !(mode & vfs::modes::notrunc))) {
+		std::ofstream created(abs_path_string, std::ios::out | std::ios::trunc);
+		if (!created.good())
+			return ExitCode::EntryMissing;
+	}
+
+	auto openMode = std::ios::in | std::ios::binary;
+	if (writable)
+		openMode |= std::ios::out;
+	if (mode & vfs::modes::append)
+		openMode |= std::ios::app;
+
+	auto fileStream = std::make_shared<::FileStream>();
 
-	if (!fileStream->Open(abs_path_string)) {
+	if (!fileStream->Open(abs_path_string, openMode)) {
 		return ExitCode::EntryMissing;
 	}
 
-	stream = std::shared_ptr<Stream>(fileStream);
+	stream = fileStream;
 
 	return ExitCode::Success;
 }
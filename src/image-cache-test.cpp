@@ -0,0 +1,287 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "image-cache-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/elf.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/image-cache.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/memory-usage.hpp>
+#include <swanson/process.hpp>
+#include <swanson/thread.hpp>
+#include <swanson/vfs.hpp>
+
+#include "assert.h"
+#include "elf-data.h"
+#include "test-process.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the read-only
+/// segment in the test ELF file.
+constexpr uint32_t segmentAddress = 0xfac;
+
+/// Calls execve on '/bin/tool',
+/// with the arguments "tool" and "-v".
+const std::vector<unsigned char> execProgram {
+	0x01, 0x20, 0x00, 0x01, 0x00, 0x40, /* ldi.l $r0, path */
+	0x01, 0x30, 0x00, 0x01, 0x00, 0x20, /* ldi.l $r1, argv */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r2, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x16, /* swi execve */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* argv */
+	0x00, 0x01, 0x00, 0x30, 0x00, 0x01, 0x00, 0x38,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* "tool" */
+	't', 'o', 'o', 'l', 0x00, 0x00, 0x00, 0x00,
+	/* "-v" */
+	'-', 'v', 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* "/bin/tool" */
+	'/', 'b', 'i', 'n', '/', 't', 'o', 'o', 'l', 0x00
+};
+
+std::vector<unsigned char> GetELFData() {
+	auto data = (const unsigned char *) elf_data;
+	return std::vector<unsigned char>(data, data + elf_data_size);
+}
+
+std::shared_ptr<Process> MakeExecProcess(std::shared_ptr<vfs::FS> fs,
+                                         std::shared_ptr<ImageCache> imageCache) {
+	auto process = MakeTestProcess(execProgram);
+	process->SetRootFS(fs);
+	process->SetImageCache(imageCache);
+	return process;
+}
+
+void TestLoad() {
+
+	ImageCache imageCache;
+
+	auto contents = GetELFData();
+
+	MemoryStream stream(contents);
+
+	auto image = imageCache.Load("/bin/tool", stream);
+	assert(image != nullptr);
+	assert(image->GetEntryPoint() == 0x1000);
+	assert(imageCache.GetMissCount() == 1);
+
+	/* the same contents decode once */
+	MemoryStream sameStream(contents);
+	assert(imageCache.Load("/bin/tool", sameStream) == image);
+	assert(imageCache.GetHitCount() == 1);
+	assert(imageCache.GetMissCount() == 1);
+
+	/* changed contents decode again */
+	contents[0x54] ^= 0xff;
+	MemoryStream changedStream(contents);
+	auto changedImage = imageCache.Load("/bin/tool", changedStream);
+	assert(changedImage != nullptr);
+	assert(changedImage != image);
+	assert(imageCache.GetMissCount() == 2);
+	assert(imageCache.GetSize() == 1);
+
+	/* other paths have their own image */
+	MemoryStream otherStream(contents);
+	assert(imageCache.Load("/bin/other", otherStream) != changedImage);
+	assert(imageCache.GetSize() == 2);
+
+	/* files that aren't ELF files aren't cached */
+	MemoryStream badStream(std::string("not elf"));
+	assert(imageCache.Load("/bin/bad", badStream) == nullptr);
+	assert(imageCache.GetSize() == 2);
+
+	/* nor are headers that reach past the
+	 * end of the file */
+	auto longContents = GetELFData();
+	longContents[0x1c] = 0x7f;
+	MemoryStream longStream(longContents);
+	assert(imageCache.Load("/bin/long", longStream) == nullptr);
+	assert(imageCache.GetSize() == 2);
+
+	/* nor are huge program header tables,
+	 * which are never read all at once */
+	auto tinyContents = GetELFData();
+	tinyContents.resize(0x34);
+	tinyContents[0x2a] = 0xff;
+	tinyContents[0x2b] = 0xff;
+	tinyContents[0x2c] = 0xff;
+	tinyContents[0x2d] = 0xff;
+	MemoryStream tinyStream(tinyContents);
+	assert(imageCache.Load("/bin/tiny", tinyStream) == nullptr);
+	assert(tinyStream.GetLargestRead() <= 0x34);
+	assert(imageCache.GetSize() == 2);
+
+	imageCache.Clear();
+	assert(imageCache.GetSize() == 0);
+}
+
+void TestShare() {
+
+	ImageCache imageCache;
+
+	auto contents = GetELFData();
+	MemoryStream stream(contents);
+
+	auto image = imageCache.Load("/bin/tool", stream);
+	assert(image != nullptr);
+
+	auto process1 = std::make_shared<Process>();
+	auto process2 = std::make_shared<Process>();
+	process1->Load(image);
+	process2->Load(image);
+
+	/* the read-only segment isn't copied */
+	auto segment = *image->begin();
+	auto section1 = process1->GetMemoryMap()->FindSection(segmentAddress);
+	auto section2 = process2->GetMemoryMap()->FindSection(segmentAddress);
+	assert(section1 != nullptr);
+	assert(section2 != nullptr);
+	assert(section1->GetData() == segment->GetData());
+	assert(section2->GetData() == segment->GetData());
+	assert(!section1->WriteAllowed());
+	assert(process1->GetMemoryUsage()->GetShared() == segment->GetSize());
+
+	/* the image outlives the cache */
+	imageCache.Clear();
+	image.reset();
+	assert(process1->GetMemoryMap()->Read8(segmentAddress + 0x54) == ((const unsigned char *) elf_data)[0x54]);
+}
+
+void TestExecve() {
+
+	auto fs = std::make_shared<MemoryFS>();
+	fs->files["/bin/tool"] = GetELFData();
+
+	auto imageCache = std::make_shared<ImageCache>();
+
+	auto process1 = MakeExecProcess(fs, imageCache);
+	auto process2 = MakeExecProcess(fs, imageCache);
+
+	/* three loads and the call */
+	process1->Step(4);
+	process2->Step(4);
+
+	assert(imageCache->GetMissCount() == 1);
+	assert(imageCache->GetHitCount() == 1);
+
+	assert(process1->GetThreadCount() == 1);
+
+	auto cpu = process1->GetThread(0)->GetCPU();
+	assert(cpu->GetInstructionPointer() == 0x1000);
+	assert(cpu->GetRegister(2) == 0);
+
+	/* the old program is gone */
+	auto memoryMap = process1->GetMemoryMap();
+	assert(memoryMap->FindSection(codeAddress) == nullptr);
+
+	/* both processes view the same segment */
+	auto section1 = memoryMap->FindSection(segmentAddress);
+	auto section2 = process2->GetMemoryMap()->FindSection(segmentAddress);
+	assert(section1 != nullptr);
+	assert(section1->GetData() == section2->GetData());
+
+	/* argc and argv */
+	assert(memoryMap->Read32(0x04) == 2);
+	auto argv = memoryMap->Read32(0x08);
+	auto arg0 = memoryMap->Read32(argv);
+	auto arg1 = memoryMap->Read32(argv + 4);
+	assert(memoryMap->Read32(argv + 8) == 0);
+	assert(memoryMap->Read8(arg0 + 0) == 't');
+	assert(memoryMap->Read8(arg0 + 3) == 'l');
+	assert(memoryMap->Read8(arg0 + 4) == 0);
+	assert(memoryMap->Read8(arg1 + 0) == '-');
+	assert(memoryMap->Read8(arg1 + 1) == 'v');
+	assert(memoryMap->Read8(arg1 + 2) == 0);
+
+	/* a missing file fails the call, and the
+	 * program continues after it */
+	fs->files.clear();
+	auto process3 = MakeExecProcess(fs, imageCache);
+	process3->Step(4);
+	cpu = process3->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::noent));
+	assert(cpu->GetInstructionPointer() == (codeAddress + 24));
+
+	/* so does a file that isn't an ELF file */
+	fs->files["/bin/tool"] = { 'n', 'o', 't', ' ', 'e', 'l', 'f' };
+	auto process4 = MakeExecProcess(fs, imageCache);
+	process4->Step(4);
+	cpu = process4->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::noexec));
+
+	/* an image that doesn't fit in the memory
+	 * limit fails the call before the old
+	 * program is released */
+	fs->files["/bin/tool"] = GetELFData();
+	auto process5 = MakeExecProcess(fs, imageCache);
+	auto committed = process5->GetMemoryUsage()->GetCommitted();
+	process5->SetMemoryLimits(0, committed + 0x1000);
+	process5->SetDefaultStackSize(0x100000);
+	process5->Step(4);
+	cpu = process5->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::nomem));
+	assert(cpu->GetInstructionPointer() == (codeAddress + 24));
+	assert(process5->GetMemoryMap()->FindSection(codeAddress) != nullptr);
+
+	/* as does a tiny file that claims a
+	 * huge program header table */
+	fs->files["/bin/tool"] = GetELFData();
+	fs->files["/bin/tool"].resize(0x34);
+	fs->files["/bin/tool"][0x2b] = 0xff;
+	fs->files["/bin/tool"][0x2d] = 0xff;
+	auto process6 = MakeExecProcess(fs, imageCache);
+	process6->Step(4);
+	cpu = process6->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::noexec));
+
+	/* host errors fail the call with
+	 * the I/O error */
+	fs->files["/bin/tool"] = GetELFData();
+	fs->failRead = true;
+	auto process7 = MakeExecProcess(fs, imageCache);
+	process7->Step(4);
+	cpu = process7->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::io));
+	assert(cpu->GetInstructionPointer() == (codeAddress + 24));
+
+	fs->failRead = false;
+	fs->failOpen = true;
+	auto process8 = MakeExecProcess(fs, imageCache);
+	process8->Step(4);
+	cpu = process8->GetThread(0)->GetCPU();
+	assert(cpu->GetRegister(2) == errors::ToResult(errors::io));
+}
+
+} // namespace
+
+void TestImageCache() {
+	TestLoad();
+	TestShare();
+	TestExecve();
+}
+
+} // namespace swanson::tests
@@ -0,0 +1,260 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/image-cache.hpp>
+
+#include <swanson/elf.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/stream.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+#include <cstring>
+
+namespace {
+
+/// The size of a 32-bit ELF header.
+constexpr uint32_t headerSize = 0x34;
+
+/// The most bytes of an image that
+/// are read from the stream at once.
+constexpr uint64_t readChunkSize = 0x10000;
+
+/// Reads the contents of a file that
+/// were already read into memory.
+class BufferStream final : public swanson::Stream {
+	const std::vector<unsigned char> &data;
+	uint64_t offset;
+public:
+	BufferStream(const std::vector<unsigned char> &data_) noexcept : data(data_), offset(0) { }
+	~BufferStream() { }
+	void Read(void *buf, uint64_t bufSize) override {
+
+		// Bytes past the end read as zeros,
+		// like they do from a ram file.
+
+		auto buf8 = (unsigned char *) buf;
+
+		uint64_t available = 0;
+		if (offset < data.size())
+			available = std::min<uint64_t>(data.size() - offset, bufSize);
+
+		if (available > 0)
+			std::memcpy(buf8, data.data() + offset, available);
+
+		std::memset(buf8 + available, 0, bufSize - available);
+
+		offset += bufSize;
+	}
+	void SetPosition(uint64_t position) override {
+		offset = position;
+	}
+	void Write(const void *, uint64_t) override {
+		throw swanson::Exception("Cannot write to read-only stream.");
+	}
+};
+
+uint16_t Load16(const unsigned char *data) noexcept {
+	return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+uint32_t Load32(const unsigned char *data) noexcept {
+	return (((uint32_t) data[0]) << 24)
+	     | (((uint32_t) data[1]) << 16)
+	     | (((uint32_t) data[2]) << 8)
+	     | (((uint32_t) data[3]) << 0);
+}
+
+/// Computes the number of bytes at the start
+/// of an ELF file that contain its headers and
+/// loadable data, from its header and program
+/// headers. This is what's hashed, so that the
+/// size of the file doesn't need to be known.
+/// @param streamSize The size of the stream, or
+/// UINT64_MAX if it isn't known. Program headers
+/// past it aren't read.
+/// @returns The size of the file, or zero if
+/// it isn't a valid ELF file.
+uint64_t GetExtent(swanson::Stream &stream, uint64_t streamSize) {
+
+	unsigned char header[headerSize] = { 0 };
+
+	stream.SetPosition(0);
+	stream.Read(header, sizeof(header));
+
+	if ((header[0] != 0x7f)
+	 || (header[1] != 'E')
+	 || (header[2] != 'L')
+	 || (header[3] != 'F'))
+		return 0;
+
+	uint64_t phOffset = Load32(header + 0x1c);
+	uint64_t shOffset = Load32(header + 0x20);
+	uint64_t phSize = Load16(header + 0x2a);
+	uint64_t phCount = Load16(header + 0x2c);
+	uint64_t shSize = Load16(header + 0x2e);
+	uint64_t shCount = Load16(header + 0x30);
+
+	uint64_t extent = headerSize;
+	extent = std::max(extent, phOffset + (phSize * phCount));
+	extent = std::max(extent, shOffset + (shSize * shCount));
+
+	// The offset and file size of a
+	// segment are the second and fifth
+	// fields of its program header.
+
+	if ((phSize < 0x14) || (extent > streamSize))
+		return extent;
+
+	// The counts come from the file, so the
+	// headers are read one at a time, instead
+	// of allocating for all of them at once.
+
+	unsigned char programHeader[0x14];
+
+	for (uint64_t i = 0; i < phCount; i++) {
+		stream.SetPosition(phOffset + (i * phSize));
+		stream.Read(programHeader, sizeof(programHeader));
+		uint64_t segmentOffset = Load32(programHeader + 0x04);
+		uint64_t segmentSize = Load32(programHeader + 0x10);
+		extent = std::max(extent, segmentOffset + segmentSize);
+	}
+
+	return extent;
+}
+
+/// Hashes file contents with 64-bit FNV-1a.
+uint64_t Hash(const std::vector<unsigned char> &data) noexcept {
+
+	uint64_t hash = 0xcbf29ce484222325;
+
+	for (auto byte : data) {
+		hash ^= byte;
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+} // namespace
+
+namespace swanson {
+
+ImageCache::ImageCache() noexcept {
+	hitCount = 0;
+	missCount = 0;
+}
+
+std::shared_ptr<const elf::File> ImageCache::Load(const std::string &path, Stream &stream) {
+
+	// The extent comes from the headers, so it's
+	// checked against the size of the stream before
+	// anything is allocated for it, where that's known.
+
+	uint64_t streamSize = UINT64_MAX;
+
+	try {
+		streamSize = stream.GetSize();
+	} catch (const Exception &) {
+	} catch (const std::exception &) {
+	}
+
+	auto extent = GetExtent(stream, streamSize);
+	if ((extent == 0) || (extent > UINT32_MAX) || (extent > streamSize))
+		return nullptr;
+
+	// Otherwise the buffer grows as the data is
+	// read, so that a short stream doesn't cost
+	// the whole extent.
+
+	std::vector<unsigned char> contents;
+
+	stream.SetPosition(0);
+
+	while (contents.size() < extent) {
+
+		auto offset = contents.size();
+		auto chunkSize = std::min<uint64_t>(extent - offset, readChunkSize);
+
+		contents.resize(offset + chunkSize);
+
+		auto readSize = stream.ReadSome(contents.data() + offset, chunkSize);
+		if (readSize == 0)
+			return nullptr;
+
+		contents.resize(offset + readSize);
+	}
+
+	auto hash = Hash(contents);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = entries.find(path);
+		if ((it != entries.end())
+		 && (it->second.hash == hash)
+		 && (it->second.size == extent)) {
+			hitCount++;
+			return it->second.image;
+		}
+
+		missCount++;
+	}
+
+	// Decoding is done without the lock,
+	// so that loads of other images aren't
+	// held up by it.
+
+	BufferStream bufferStream(contents);
+
+	auto image = std::make_shared<elf::File>();
+	if (image->Decode(bufferStream) != 0)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto &entry = entries[path];
+	entry.hash = hash;
+	entry.size = extent;
+	entry.image = image;
+
+	return image;
+}
+
+void ImageCache::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+}
+
+uint64_t ImageCache::GetHitCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return hitCount;
+}
+
+uint64_t ImageCache::GetMissCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return missCount;
+}
+
+size_t ImageCache::GetSize() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+} // namespace swanson
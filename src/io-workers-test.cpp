@@ -0,0 +1,181 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "io-workers-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/io-workers.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/process.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the buffer
+/// that the program reads into.
+constexpr uint32_t bufferAddress = 0x20000;
+
+/// Reads five bytes from descriptor three,
+/// writes them to descriptor four and exits
+/// with the result of the write.
+const std::vector<unsigned char> copyProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r0, 3 */
+	0x01, 0x30, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r1, 0x20000 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x05, /* ldi.l $r2, 5 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x02, 0x42,                         /* mov $r2, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x04, /* ldi.l $r0, 4 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x05, /* swi write */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+auto MakeProcess() {
+	return MakeTestProcess(copyProgram, bufferAddress, 0x1000);
+}
+
+void TestOrder() {
+
+	IOWorkers workers(4);
+
+	assert(workers.GetWorkerCount() == 4);
+
+	std::mutex mutex;
+
+	std::vector<int> first;
+	std::vector<int> second;
+
+	int firstKey = 0;
+	int secondKey = 0;
+
+	/* jobs with the same key run one
+	 * at a time, in order */
+	std::atomic<int> running(0);
+	std::atomic<bool> overlapped(false);
+
+	for (int i = 0; i < 100; i++) {
+		workers.Submit(&firstKey, [&, i] {
+			if (running.fetch_add(1) != 0)
+				overlapped = true;
+			first.push_back(i);
+			running.fetch_sub(1);
+		});
+		workers.Submit(&secondKey, [&, i] {
+			std::unique_lock<std::mutex> lock(mutex);
+			second.push_back(i);
+		});
+	}
+
+	/* exceptions don't stop the pool */
+	workers.Submit(&firstKey, [] { throw Exception("Job failed."); });
+
+	workers.Wait();
+
+	assert(!overlapped);
+	assert(first.size() == 100);
+	assert(second.size() == 100);
+
+	for (int i = 0; i < 100; i++) {
+		assert(first[i] == i);
+		assert(second[i] == i);
+	}
+}
+
+void TestOffload() {
+
+	auto process = MakeProcess();
+
+	auto workers = std::make_shared<IOWorkers>(2);
+	process->SetIOWorkers(workers);
+
+	auto input = std::make_shared<MemoryStream>(std::vector<unsigned char> { 'h', 'e', 'l', 'l', 'o', '!' });
+	auto output = std::make_shared<MemoryStream>();
+
+	assert(process->AddStream(input) == 3);
+	assert(process->AddStream(output) == 4);
+
+	auto thread = process->GetThread(0);
+
+	/* the read blocks the thread,
+	 * until a worker finishes it */
+	process->Step(100);
+	assert(thread->IsBlocked() || process->IsRunnable());
+
+	auto steps = 0;
+
+	while (!process->Exited()) {
+		workers->Wait();
+		process->Step(100);
+		assert(++steps < 10);
+	}
+
+	assert(process->GetExitCode() == 5);
+	assert(process->GetMemoryMap()->Read8(bufferAddress + 4) == 'o');
+	assert(output->GetData().size() == 5);
+	assert(std::memcmp(output->GetData().data(), "hello", 5) == 0);
+}
+
+void TestInline() {
+
+	/* without workers, the same calls
+	 * finish on the calling thread */
+	auto process = MakeProcess();
+
+	auto output = std::make_shared<MemoryStream>();
+
+	process->AddStream(std::make_shared<MemoryStream>(std::vector<unsigned char> { 'h', 'i' }));
+	process->AddStream(output);
+
+	process->Step(4);
+
+	auto cpu = process->GetThread(0)->GetCPU();
+	assert(!process->GetThread(0)->IsBlocked());
+	assert(cpu->GetRegister(2) == 2);
+
+	while (!process->Exited())
+		process->Step(100);
+
+	assert(process->GetExitCode() == 2);
+	assert(output->GetData().size() == 2);
+
+	/* descriptors that aren't open */
+	process = MakeProcess();
+	process->Step(4);
+	assert(process->GetThread(0)->GetCPU()->GetRegister(2) == errors::ToResult(errors::badf));
+}
+
+} // namespace
+
+void TestIOWorkers() {
+	TestOrder();
+	TestOffload();
+	TestInline();
+}
+
+} // namespace swanson::tests
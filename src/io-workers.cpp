@@ -0,0 +1,120 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/io-workers.hpp>
+
+namespace swanson {
+
+IOWorkers::IOWorkers(unsigned int workerCount) : stopping(false) {
+
+	if (workerCount == 0)
+		workerCount = std::thread::hardware_concurrency();
+
+	if (workerCount == 0)
+		workerCount = 1;
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back([this] { Work(); });
+}
+
+IOWorkers::~IOWorkers() {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	jobReady.notify_all();
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+void IOWorkers::Submit(const void *key, std::function<void()> function) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto it = busyKeys.find(key);
+	if (it != busyKeys.end()) {
+		it->second.emplace_back(std::move(function));
+		return;
+	}
+
+	busyKeys.emplace(key, std::deque<std::function<void()>>());
+
+	Job job;
+	job.key = key;
+	job.function = std::move(function);
+	jobs.emplace_back(std::move(job));
+
+	jobReady.notify_one();
+}
+
+void IOWorkers::Wait() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	idle.wait(lock, [this] { return busyKeys.empty(); });
+}
+
+void IOWorkers::Work() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+
+		jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+		// Jobs that are still queued
+		// are finished before stopping.
+
+		if (jobs.empty())
+			break;
+
+		auto job = std::move(jobs.front());
+		jobs.pop_front();
+
+		lock.unlock();
+
+		try {
+			job.function();
+		} catch (...) {
+		}
+
+		lock.lock();
+
+		// The next job with the same key,
+		// if there is one, is ready now.
+
+		auto it = busyKeys.find(job.key);
+
+		if (it->second.empty()) {
+			busyKeys.erase(it);
+			if (busyKeys.empty())
+				idle.notify_all();
+		} else {
+			Job next;
+			next.key = job.key;
+			next.function = std::move(it->second.front());
+			it->second.pop_front();
+			jobs.emplace_back(std::move(next));
+			jobReady.notify_one();
+		}
+	}
+}
+
+} // namespace swanson
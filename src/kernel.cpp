@@ -19,22 +19,133 @@
 #include <swanson/kernel.hpp>
 
 #include <swanson/bad-instruction.hpp>
+#include <swanson/block-ring.hpp>
+#include <swanson/console.hpp>
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
 #include <swanson/exception.hpp>
 #include <swanson/elf.hpp>
+#include <swanson/host-mapping.hpp>
+#include <swanson/image-cache.hpp>
+#include <swanson/io-workers.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/page-compressor.hpp>
 #include <swanson/process.hpp>
+#include <swanson/scheduler.hpp>
+#include <swanson/segfault.hpp>
 #include <swanson/stream.hpp>
+#include <swanson/syscall-stats.hpp>
+#include <swanson/syscalls.hpp>
 
 #include "fs/ramfs/file.h"
 #include "debug.h"
 #include "disk.h"
 #include "gpt.h"
 #include "rstream.h"
+#include "stream.h"
+
+#include <fstream>
+#include <sstream>
 
 #include <cstdlib>
 #include <cstring>
 
 namespace {
 
+/// Identifies a kernel snapshot.
+/// These are the bytes "SWKS".
+constexpr uint32_t snapshotMagic = 0x534b5753;
+
+/// The version of the snapshot format.
+constexpr uint32_t snapshotVersion = 1;
+
+/// Marks a snapshot that has no init process.
+constexpr uint32_t noInit = UINT32_MAX;
+
+/// The header of a snapshot file. The memory of
+/// the processes follows it, starting on the next
+/// host page, and the process records come last.
+class SnapshotHeader final {
+public:
+	/// The number of processes in the snapshot.
+	uint32_t processCount = 0;
+	/// The index of the init process among
+	/// the process records, or @ref noInit.
+	uint32_t initIndex = noInit;
+	/// The offset of the encoded ram file system.
+	uint64_t ramfsOffset = 0;
+	/// The size of the encoded ram file system.
+	uint64_t ramfsSize = 0;
+	/// The offset of the process records.
+	uint64_t recordOffset = 0;
+};
+
+void WriteU32(std::ostream &stream, uint32_t value) {
+	unsigned char buf[4];
+	buf[0] = (value >> 0x00) & 0xff;
+	buf[1] = (value >> 0x08) & 0xff;
+	buf[2] = (value >> 0x10) & 0xff;
+	buf[3] = (value >> 0x18) & 0xff;
+	stream.write((const char *) buf, sizeof(buf));
+}
+
+void WriteU64(std::ostream &stream, uint64_t value) {
+	WriteU32(stream, (uint32_t) (value & 0xffffffff));
+	WriteU32(stream, (uint32_t) (value >> 32));
+}
+
+uint32_t ReadU32(std::istream &stream) {
+	unsigned char buf[4];
+	if (!stream.read((char *) buf, sizeof(buf)))
+		throw swanson::Exception("Snapshot is truncated.");
+	uint32_t value = 0;
+	value |= ((uint32_t) buf[0]) << 0x00;
+	value |= ((uint32_t) buf[1]) << 0x08;
+	value |= ((uint32_t) buf[2]) << 0x10;
+	value |= ((uint32_t) buf[3]) << 0x18;
+	return value;
+}
+
+uint64_t ReadU64(std::istream &stream) {
+	uint64_t low = ReadU32(stream);
+	uint64_t high = ReadU32(stream);
+	return low | (high << 32);
+}
+
+void WriteHeader(std::ostream &stream, const SnapshotHeader &header) {
+	WriteU32(stream, snapshotMagic);
+	WriteU32(stream, snapshotVersion);
+	WriteU32(stream, header.processCount);
+	WriteU32(stream, header.initIndex);
+	WriteU64(stream, header.ramfsOffset);
+	WriteU64(stream, header.ramfsSize);
+	WriteU64(stream, header.recordOffset);
+}
+
+SnapshotHeader ReadHeader(std::istream &stream) {
+
+	if ((ReadU32(stream) != snapshotMagic)
+	 || (ReadU32(stream) != snapshotVersion))
+		throw swanson::Exception("Snapshot is not valid.");
+
+	SnapshotHeader header;
+	header.processCount = ReadU32(stream);
+	header.initIndex = ReadU32(stream);
+	header.ramfsOffset = ReadU64(stream);
+	header.ramfsSize = ReadU64(stream);
+	header.recordOffset = ReadU64(stream);
+	return header;
+}
+
+/// The write callback of a stream
+/// that appends to a byte vector.
+uint64_t WriteVector(void *data, const void *buf, uint64_t bufSize) {
+	auto vector = (std::vector<unsigned char> *) data;
+	auto buf8 = (const unsigned char *) buf;
+	vector->insert(vector->end(), buf8, buf8 + bufSize);
+	return bufSize;
+}
+
 class InitStream final : public swanson::Stream{
 	const void *data;
 	uint64_t size;
@@ -67,23 +178,41 @@ public:
 	}
 };
 
+/// Make an empty ram file system,
+/// which is freed with its pointer.
+std::shared_ptr<ramfs> MakeRamfs() {
+
+	auto fs = std::shared_ptr<ramfs>(new ramfs, [](ramfs *fs) {
+		ramfs_free(fs);
+		delete fs;
+	});
+
+	ramfs_init(fs.get());
+
+	return fs;
+}
+
 } // namespace
 
 namespace swanson {
 
-Kernel::Kernel() noexcept {
-	ramfs_init(&initramfs);
+Kernel::Kernel() {
+	initramfs = MakeRamfs();
+	removedCPUTime = 0;
+	softMemoryLimit = 0;
+	hardMemoryLimit = 0;
+	sweepStepCount = 0;
+	imageCache = std::make_shared<ImageCache>();
+	syscallStats = std::make_shared<SyscallStats>();
 }
 
 Kernel::~Kernel() {
-	ramfs_free(&initramfs);
-}
 
-void Kernel::AddDisk(std::shared_ptr<Disk> disk) {
-	disks.emplace_back(disk);
 }
 
-void Kernel::LoadInitRamfs(const void *buf, uintmax_t buf_size) {
+std::shared_ptr<const ramfs> Kernel::DecodeInitRamfs(const void *buf, uintmax_t buf_size) {
+
+	auto fs = MakeRamfs();
 
 	struct rstream rstream;
 	struct stream *stream;
@@ -98,59 +227,442 @@ void Kernel::LoadInitRamfs(const void *buf, uintmax_t buf_size) {
 
 	stream = rstream_to_stream(&rstream);
 
-	ramfs_decode(&initramfs, stream);
+	ramfs_decode(fs.get(), stream);
+
+	return fs;
 }
 
-ExitCode Kernel::Main() {
+void Kernel::AddBlockRing(std::shared_ptr<BlockRing> blockRing) {
+	blockRings.emplace_back(blockRing);
+}
+
+void Kernel::AddDisk(std::shared_ptr<Disk> disk) {
+	disks.emplace_back(disk);
+	AddBlockRing(std::make_shared<BlockRing>(disk));
+}
+
+uint64_t Kernel::GetCPUTime() const noexcept {
+
+	auto cpuTime = removedCPUTime;
+
+	for (const auto &process : processes)
+		cpuTime += process->GetCPUTime();
+
+	return cpuTime;
+}
+
+void Kernel::LoadInitRamfs(const void *buf, uintmax_t buf_size) {
+	initramfs = DecodeInitRamfs(buf, buf_size);
+}
+
+void Kernel::LoadSnapshot(const std::string &path) {
 
-	std::shared_ptr<Stream> initStream;
+	if (processes.GetCount() > 0)
+		throw Exception("Snapshots may only be loaded before processes are started.");
 
-	if (root_fs == nullptr) {
-		throw Exception("Root file system not mounted.");
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		throw Exception("Failed to open snapshot.");
+
+	auto header = ReadHeader(file);
+
+	if (header.ramfsSize > 0) {
+
+		std::vector<unsigned char> ramfsData(header.ramfsSize);
+
+		file.seekg(header.ramfsOffset);
+		if (!file.read((char *) ramfsData.data(), ramfsData.size()))
+			throw Exception("Snapshot is truncated.");
+
+		LoadInitRamfs(ramfsData.data(), ramfsData.size());
+	}
+
+	file.seekg(header.recordOffset);
+
+	for (uint32_t i = 0; i < header.processCount; i++) {
+
+		auto process = std::make_shared<Process>();
+
+		process->RestoreSnapshot(file, path);
+
+		AddProcess(process);
+
+		if (i == header.initIndex)
+			init = process;
 	}
+}
+
+ExitCode Kernel::Main() {
 
-	auto exitCode = root_fs->OpenFile("/bin/init", initStream);
+	auto exitCode = Start();
 	if (exitCode != ExitCode::Success)
 		return exitCode;
 
-	elf::File elfFile;
+	// Run until the first process exits. With
+	// a page compressor, or with snapshots, the
+	// wait times out now and then so that sweeps
+	// and snapshots aren't held up. Otherwise this
+	// thread sleeps until a process exits or faults.
 
-	elfFile.Decode(*initStream);
+	for (;;) {
 
-	auto process = std::make_shared<Process>();
+		SchedulerEvent event;
 
-	process->Load(elfFile);
+		auto received = true;
 
-	AddProcess(process);
+		if ((pageCompressor != nullptr) || !snapshotPath.empty())
+			received = scheduler->WaitEvent(event, std::chrono::milliseconds(10));
+		else
+			scheduler->WaitEvent(event);
 
-	// Run until the first process
-	// exits.
-	while (!process->Exited()) {
-		Step(100);
+		if (received && HandleEvent(event)) {
+			scheduler->Pause();
+			if (event.fault)
+				std::rethrow_exception(event.fault);
+			break;
+		}
+
+		Poll();
 	}
 
 	return ExitCode::Success;
 }
 
+bool Kernel::Owns(const Process &process) const noexcept {
+	return processes.Find(process.GetID()).get() == &process;
+}
+
+void Kernel::Poll() {
+
+	SweepScheduled();
+
+	TakeSnapshot();
+}
+
+void Kernel::SaveSnapshot(const std::string &path) {
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw Exception("Failed to create snapshot.");
+
+	// The header is written again once
+	// the offsets that it holds are known.
+
+	SnapshotHeader header;
+
+	WriteHeader(file, header);
+
+	std::vector<unsigned char> ramfsData;
+
+	struct stream ramfsStream;
+	stream_init(&ramfsStream);
+	ramfsStream.data = &ramfsData;
+	ramfsStream.write = WriteVector;
+
+	ramfs_encode(initramfs.get(), &ramfsStream);
+
+	header.ramfsOffset = file.tellp();
+	header.ramfsSize = ramfsData.size();
+
+	file.write((const char *) ramfsData.data(), ramfsData.size());
+
+	// The memory of each process is written as
+	// its record is made, and the records go at
+	// the end, past the last page of memory.
+
+	std::ostringstream records;
+
+	for (auto &process : processes) {
+
+		if (process == init)
+			header.initIndex = header.processCount;
+
+		process->SaveSnapshot(records, file);
+
+		header.processCount++;
+	}
+
+	uint64_t pageSize = HostMapping::GetPageSize();
+	uint64_t recordOffset = file.tellp();
+
+	header.recordOffset = ((recordOffset + (pageSize - 1)) / pageSize) * pageSize;
+
+	file.seekp(header.recordOffset);
+	file << records.str();
+
+	file.seekp(0);
+	WriteHeader(file, header);
+
+	if (!file.good())
+		throw Exception("Failed to write snapshot.");
+}
+
+void Kernel::SetConsole(std::shared_ptr<Console> console_) noexcept {
+	console = console_;
+}
+
+void Kernel::SetImageCache(std::shared_ptr<ImageCache> imageCache_) noexcept {
+	imageCache = imageCache_;
+}
+
+void Kernel::SetInitRamfs(std::shared_ptr<const ramfs> initramfs_) noexcept {
+	initramfs = initramfs_;
+}
+
+void Kernel::SetIOWorkers(std::shared_ptr<IOWorkers> ioWorkers_) noexcept {
+	ioWorkers = ioWorkers_;
+}
+
+void Kernel::SetMemoryLimits(uint64_t softLimit, uint64_t hardLimit) noexcept {
+	softMemoryLimit = softLimit;
+	hardMemoryLimit = hardLimit;
+}
+
+void Kernel::SetPageCompressor(std::shared_ptr<PageCompressor> pageCompressor_) noexcept {
+	pageCompressor = pageCompressor_;
+}
+
+void Kernel::SetThreadPool(std::shared_ptr<ThreadPool> threadPool_) noexcept {
+	threadPool = threadPool_;
+}
+
+void Kernel::SetScheduler(std::shared_ptr<Scheduler> scheduler_) noexcept {
+	scheduler = scheduler_;
+}
+
+void Kernel::SetSnapshotPath(const std::string &path) {
+	snapshotPath = path;
+}
+
 void Kernel::SetRootFS(std::shared_ptr<vfs::FS> root_fs_) {
 	root_fs = root_fs_;
 }
 
+ExitCode Kernel::Start() {
+
+	if (init == nullptr) {
+
+		std::shared_ptr<Stream> initStream;
+
+		if (root_fs == nullptr) {
+			throw Exception("Root file system not mounted.");
+		}
+
+		auto exitCode = root_fs->OpenFile("/bin/init", vfs::modes::read, initStream);
+		if (exitCode != ExitCode::Success)
+			return exitCode;
+
+		auto image = imageCache->Load("/bin/init", *initStream);
+		if (image == nullptr)
+			throw Exception("'/bin/init' is not a valid ELF file.");
+
+		auto process = std::make_shared<Process>();
+
+		process->SetMemoryLimits(softMemoryLimit, hardMemoryLimit);
+
+		process->Load(image);
+
+		AddProcess(process);
+
+		init = process;
+	}
+
+	if (scheduler == nullptr)
+		scheduler = std::make_shared<Scheduler>();
+
+	sweepStepCount = scheduler->GetStepCount();
+
+	// After a snapshot is loaded, every process
+	// in it resumes, not just the init process.
+
+	for (auto &process : processes)
+		scheduler->Add(process);
+
+	return ExitCode::Success;
+}
+
+void Kernel::Stop() {
+	for (auto &process : processes)
+		process->Kill();
+}
+
 void Kernel::Step(uint32_t steps) {
-	auto processID = 0UL;
+
+	std::vector<std::shared_ptr<Process>> exited;
+
 	for (auto &process : processes) {
 		try {
 			process->Step(steps);
 		} catch (BadInstruction &badInstruction) {
-			badInstruction.SetProcessID(processID);
+			badInstruction.SetProcessID(process->GetID());
 			throw;
 		}
-		processID++;
+		if (process->Exited())
+			exited.emplace_back(process);
+	}
+
+	for (auto &process : exited)
+		RemoveProcess(process);
+
+	TakeSnapshot();
+
+	if ((pageCompressor != nullptr) && pageCompressor->Advance(steps)) {
+		pageCompressor->BeginSweep();
+		for (auto &process : processes)
+			pageCompressor->Sweep(*process->GetMemoryMap());
 	}
 }
 
 void Kernel::AddProcess(std::shared_ptr<Process> &process) {
-	processes.emplace_back(process);
+	process->SetThreadPool(threadPool);
+	process->SetRootFS(root_fs);
+	process->SetImageCache(imageCache);
+	process->SetSyscallStats(syscallStats);
+	process->SetIOWorkers(ioWorkers);
+	process->SetSyscallHandler(syscalls::block_ring, BlockRing::MakeHandler(blockRings));
+	process->MapTimePage();
+
+	if (console != nullptr) {
+		process->SetStream(1, console->Open(1));
+		process->SetStream(2, console->Open(2));
+	}
+
+	if (!snapshotPath.empty()) {
+		process->SetSnapshotHandler([this](Process &process, CPU &cpu) {
+			RequestSnapshot(process, cpu);
+		});
+	}
+
+	processes.Add(process);
+}
+
+bool Kernel::HandleEvent(const SchedulerEvent &event) {
+
+	RemoveProcess(event.process);
+
+	auto isInit = (event.process == init);
+
+	if (!event.fault)
+		return isInit;
+
+	// Faults are given the ID of the
+	// process before they're passed on.
+
+	try {
+		std::rethrow_exception(event.fault);
+	} catch (Segfault &segfault) {
+		segfault.SetProcessID(event.process->GetID());
+	} catch (BadInstruction &badInstruction) {
+		badInstruction.SetProcessID(event.process->GetID());
+	} catch (...) {
+	}
+
+	return isInit;
+}
+
+void Kernel::RemoveProcess(const std::shared_ptr<Process> &process) {
+	// A process that faulted never called exit,
+	// so its output may still be buffered.
+	process->FlushStreams();
+
+	removedCPUTime += process->GetCPUTime();
+
+	processes.Exit(process->GetID());
+	processes.Reap(process->GetID());
+}
+
+void Kernel::RequestSnapshot(Process &process, CPU &cpu) {
+
+	std::unique_lock<std::mutex> lock(snapshotMutex);
+
+	snapshotRequests.emplace_back(&cpu);
+
+	process.Block(cpu, snapshotQueue);
+}
+
+void Kernel::TakeSnapshot() {
+
+	// The lock isn't held while the scheduler is
+	// paused, since a slice that's running may be
+	// waiting on it to ask for a snapshot.
+
+	std::vector<CPU *> requests;
+
+	{
+		std::unique_lock<std::mutex> lock(snapshotMutex);
+		requests.swap(snapshotRequests);
+	}
+
+	if (requests.empty())
+		return;
+
+	// The threads that asked are blocked, and
+	// the rest are paused, so nothing changes
+	// while the snapshot is written. The result
+	// of the call is one in the snapshot.
+
+	if (scheduler != nullptr)
+		scheduler->Pause();
+
+	for (auto cpu : requests)
+		cpu->SetRegister(2, 1);
+
+	uint32_t result = 0;
+
+	try {
+		SaveSnapshot(snapshotPath);
+	} catch (const Exception &) {
+		result = errors::ToResult(errors::io);
+	}
+
+	for (auto cpu : requests)
+		cpu->SetRegister(2, result);
+
+	if (scheduler != nullptr)
+		scheduler->Resume();
+
+	// The threads that asked are the oldest
+	// on the queue, since they're added to it
+	// in the order of the requests.
+
+	std::unique_lock<std::mutex> lock(snapshotMutex);
+
+	for (size_t i = 0; i < requests.size(); i++)
+		snapshotQueue.Wake();
+}
+
+void Kernel::SweepScheduled() {
+
+	if ((pageCompressor == nullptr) || (processes.GetLiveCount() == 0))
+		return;
+
+	// The compressor counts instructions per
+	// thread, so the instructions that were
+	// executed are spread over the processes.
+
+	auto stepCount = scheduler->GetStepCount();
+	auto steps = (stepCount - sweepStepCount) / processes.GetLiveCount();
+	if (steps == 0)
+		return;
+
+	sweepStepCount = stepCount;
+
+	if (steps > UINT32_MAX)
+		steps = UINT32_MAX;
+
+	if (!pageCompressor->Advance((uint32_t) steps))
+		return;
+
+	// Sections are only compressed while
+	// none of their threads are running.
+
+	scheduler->Pause();
+
+	pageCompressor->BeginSweep();
+	for (auto &process : processes)
+		pageCompressor->Sweep(*process->GetMemoryMap());
+
+	scheduler->Resume();
 }
 
 } // namespace swanson
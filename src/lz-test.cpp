@@ -0,0 +1,89 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "lz-test.hpp"
+
+#include <swanson/exception.hpp>
+#include <swanson/lz.hpp>
+
+#include "assert.h"
+
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+void TestRoundTrip(const std::vector<unsigned char> &data) {
+
+	auto packed = lz::Compress(data.data(), data.size());
+
+	std::vector<unsigned char> unpacked(data.size());
+
+	lz::Decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+
+	assert(unpacked == data);
+}
+
+} // namespace
+
+void TestLZ() {
+
+	TestRoundTrip({});
+	TestRoundTrip({ 1, 2, 3 });
+
+	/* zeros compress well */
+
+	std::vector<unsigned char> zeros(0x1000);
+
+	TestRoundTrip(zeros);
+
+	auto packed = lz::Compress(zeros.data(), zeros.size());
+	assert(packed.size() < 0x40);
+
+	/* long literal runs and short repeats */
+
+	std::vector<unsigned char> mixed(0x3000);
+
+	uint32_t seed = 1;
+
+	for (decltype(mixed.size()) i = 0; i < mixed.size(); i++) {
+		seed = (seed * 1103515245) + 12345;
+		if ((i % 0x400) < 0x200)
+			mixed[i] = (unsigned char) (seed >> 16);
+		else
+			mixed[i] = (unsigned char) (i % 7);
+	}
+
+	TestRoundTrip(mixed);
+
+	/* bad data is rejected */
+
+	std::vector<unsigned char> unpacked(0x1000);
+
+	auto failed = false;
+
+	try {
+		lz::Decompress(packed.data(), packed.size(), unpacked.data(), 0x800);
+	} catch (const Exception &) {
+		failed = true;
+	}
+
+	assert(failed);
+}
+
+} // namespace swanson::tests
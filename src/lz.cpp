@@ -0,0 +1,216 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/lz.hpp>
+
+#include <swanson/exception.hpp>
+
+#include <cstring>
+
+namespace swanson::lz {
+
+namespace {
+
+/// The shortest match that is encoded.
+constexpr uint32_t minMatch = 4;
+
+/// The farthest back that a match may start.
+constexpr uint32_t maxOffset = 0xffff;
+
+/// The number of bits in a hash table index.
+constexpr uint32_t hashBits = 12;
+
+uint32_t Load32(const unsigned char *ptr) noexcept {
+	uint32_t value;
+	std::memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+uint32_t Hash(uint32_t value) noexcept {
+	return (value * 2654435761U) >> (32 - hashBits);
+}
+
+/// Write the part of a length that
+/// doesn't fit in its token nibble.
+void PutLength(std::vector<unsigned char> &out, uint32_t length) {
+	while (length >= 0xff) {
+		out.push_back(0xff);
+		length -= 0xff;
+	}
+	out.push_back((unsigned char) length);
+}
+
+/// Read the part of a length that
+/// doesn't fit in its token nibble.
+uint32_t GetLength(const unsigned char *&ptr, const unsigned char *end) {
+
+	uint32_t length = 0;
+
+	for (;;) {
+
+		if (ptr >= end)
+			throw Exception("Compressed data is truncated.");
+
+		auto byte = *ptr++;
+
+		length += byte;
+
+		if (byte != 0xff)
+			break;
+	}
+
+	return length;
+}
+
+/// Write a sequence of literals followed by a match.
+/// If the match length is zero, this is the last
+/// sequence and no match is written.
+void PutSequence(std::vector<unsigned char> &out,
+                 const unsigned char *literals,
+                 uint32_t literalLength,
+                 uint32_t offset,
+                 uint32_t matchLength) {
+
+	auto literalNibble = (literalLength < 0x0f) ? literalLength : 0x0f;
+
+	uint32_t matchNibble = 0;
+	if (matchLength > 0) {
+		matchLength -= minMatch;
+		matchNibble = (matchLength < 0x0f) ? matchLength : 0x0f;
+	}
+
+	out.push_back((unsigned char) ((literalNibble << 4) | matchNibble));
+
+	if (literalNibble == 0x0f)
+		PutLength(out, literalLength - 0x0f);
+
+	out.insert(out.end(), literals, literals + literalLength);
+
+	if (offset == 0)
+		return;
+
+	out.push_back((unsigned char) (offset & 0xff));
+	out.push_back((unsigned char) (offset >> 8));
+
+	if (matchNibble == 0x0f)
+		PutLength(out, matchLength - 0x0f);
+}
+
+} // namespace
+
+std::vector<unsigned char> Compress(const void *src_, uint32_t size) {
+
+	auto src = (const unsigned char *) src_;
+
+	std::vector<unsigned char> out;
+	out.reserve((size / 2) + 16);
+
+	// Positions are stored plus one, so
+	// that zero marks an empty slot.
+	uint32_t table[1 << hashBits];
+	std::memset(table, 0, sizeof(table));
+
+	uint32_t anchor = 0;
+	uint32_t pos = 0;
+
+	while ((size >= minMatch) && (pos <= (size - minMatch))) {
+
+		auto value = Load32(src + pos);
+		auto hash = Hash(value);
+		auto candidate = table[hash];
+
+		table[hash] = pos + 1;
+
+		if ((candidate != 0)
+		 && ((pos - (candidate - 1)) <= maxOffset)
+		 && (Load32(src + (candidate - 1)) == value)) {
+
+			candidate--;
+
+			auto length = minMatch;
+			while (((pos + length) < size) && (src[candidate + length] == src[pos + length]))
+				length++;
+
+			PutSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+
+			pos += length;
+			anchor = pos;
+		} else {
+			pos++;
+		}
+	}
+
+	PutSequence(out, src + anchor, size - anchor, 0, 0);
+
+	return out;
+}
+
+void Decompress(const void *src, uint32_t srcSize, void *dst_, uint32_t dstSize) {
+
+	auto ptr = (const unsigned char *) src;
+	auto end = ptr + srcSize;
+	auto dst = (unsigned char *) dst_;
+
+	uint32_t pos = 0;
+
+	for (;;) {
+
+		if (ptr >= end)
+			throw Exception("Compressed data is truncated.");
+
+		auto token = *ptr++;
+
+		uint32_t literalLength = token >> 4;
+		if (literalLength == 0x0f)
+			literalLength += GetLength(ptr, end);
+
+		if ((literalLength > (uint32_t) (end - ptr)) || (literalLength > (dstSize - pos)))
+			throw Exception("Compressed data is not valid.");
+
+		std::memcpy(dst + pos, ptr, literalLength);
+		ptr += literalLength;
+		pos += literalLength;
+
+		// The last sequence has no match.
+		if (ptr == end)
+			break;
+
+		if ((end - ptr) < 2)
+			throw Exception("Compressed data is truncated.");
+
+		uint32_t offset = ptr[0] | (((uint32_t) ptr[1]) << 8);
+		ptr += 2;
+
+		uint32_t matchLength = token & 0x0f;
+		if (matchLength == 0x0f)
+			matchLength += GetLength(ptr, end);
+		matchLength += minMatch;
+
+		if ((offset == 0) || (offset > pos) || (matchLength > (dstSize - pos)))
+			throw Exception("Compressed data is not valid.");
+
+		// Matches may overlap the bytes they
+		// produce, so they're copied in order.
+		for (uint32_t i = 0; i < matchLength; i++, pos++)
+			dst[pos] = dst[pos - offset];
+	}
+
+	if (pos != dstSize)
+		throw Exception("Compressed data does not match its size.");
+}
+
+} // namespace swanson::lz
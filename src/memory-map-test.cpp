@@ -17,14 +17,23 @@
 
 #include "memory-map-test.hpp"
 
+#include <swanson/access-profile.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/host-mapping.hpp>
+#include <swanson/memory-limit.hpp>
 #include <swanson/memory-map.hpp>
 #include <swanson/memory-section.hpp>
+#include <swanson/memory-usage.hpp>
+#include <swanson/page-compressor.hpp>
 #include <swanson/segfault.hpp>
+#include <swanson/thread-pool.hpp>
 
 #include "assert.h"
 
 #include "debug.h"
 
+#include <atomic>
+
 namespace swanson::tests {
 
 auto MakeSection() {
@@ -35,8 +44,472 @@ auto MakeMap() {
 	return std::make_shared<MemoryMap>();
 }
 
+namespace {
+
+void TestMappedSection() {
+
+	auto buffer = std::make_shared<std::vector<unsigned char>>(0x20);
+
+	auto readOnly = HostMapping::Borrow(buffer->data(), buffer->size(), false, buffer);
+
+	auto section = MakeSection();
+	section->SetAddress(0x4000);
+	section->Map(readOnly);
+
+	assert(section->OwnsBytes() == false);
+	assert(section->GetSize() == 0x20);
+	assert(section->WriteAllowed() == false);
+
+	auto map = MakeMap();
+	map->AddSection(section);
+
+	/* the section views the buffer without copying it */
+
+	(*buffer)[0x10] = 0x42;
+
+	assert(map->Read8(0x4010) == 0x42);
+
+	auto faultFlag = false;
+
+	try {
+		map->Write8(0x4010, 0x00);
+	} catch (const Segfault &) {
+		faultFlag = true;
+	}
+
+	assert(faultFlag == true);
+
+	/* new sections are placed around the mapping */
+
+	assert(map->Overlaps(0x4000, 0x20) == true);
+	assert(map->Overlaps(0x4020, 0x20) == false);
+
+	auto stack = map->AddSection(0x4000);
+
+	assert(map->Overlaps(stack->GetAddress(), stack->GetSize()) == true);
+	assert((stack->GetAddress() >= 0x4020) || ((stack->GetAddress() + 0x4000) <= 0x4000));
+
+	assert(map->FindSection(0x4008) == section);
+	assert(map->RemoveSection(section) == true);
+	assert(map->FindSection(0x4008) == nullptr);
+	assert(map->RemoveSection(section) == false);
+}
+
+void TestReservedSection() {
+
+	auto section = MakeSection();
+	section->SetAddress(0x10000);
+	section->Map(HostMapping::Reserve(0x10000));
+
+	assert(section->GetSize() == 0);
+	assert(section->GetCapacity() == 0x10000);
+
+	auto map = MakeMap();
+	map->AddSection(section);
+
+	/* the reserved range is kept free */
+
+	assert(map->Overlaps(0x18000, 0x100) == true);
+
+	auto base = section->GetMapping()->GetData();
+
+	section->Resize(0x10);
+	map->Write32(0x1000c, 0x31415926);
+
+	/* growing keeps the data in place */
+
+	section->Resize(0x8000);
+
+	assert(section->GetMapping()->GetData() == base);
+	assert(map->Read32(0x1000c) == 0x31415926);
+
+	map->Write32(0x17ffc, 0x27182818);
+	assert(map->Read32(0x17ffc) == 0x27182818);
+
+	auto faultFlag = false;
+
+	try {
+		section->Resize(0x10001);
+	} catch (const Exception &) {
+		faultFlag = true;
+	}
+
+	assert(faultFlag == true);
+}
+
+void TestMemoryUsage() {
+
+	auto map = MakeMap();
+
+	auto usage = map->GetUsage();
+	usage->SetSoftLimit(0x2000);
+	usage->SetHardLimit(0x4000);
+
+	auto first = map->AddSection(0x1000);
+
+	assert(usage->GetCommitted() == 0x1000);
+	assert(usage->GetPrivate() == 0x1000);
+	assert(usage->GetShared() == 0x0000);
+	assert(map->GetSize() == 0x1000);
+
+	auto buffer = std::make_shared<std::vector<unsigned char>>(0x1000);
+
+	auto shared = MakeSection();
+	shared->SetAddress(0x100000);
+	shared->Map(HostMapping::Borrow(buffer->data(), buffer->size(), true, buffer));
+	map->AddSection(shared);
+
+	assert(usage->GetCommitted() == 0x2000);
+	assert(usage->GetShared() == 0x1000);
+	assert(usage->OverSoftLimit() == false);
+
+	/* growing a section is counted */
+
+	first->Resize(0x2000);
+
+	assert(usage->GetCommitted() == 0x3000);
+	assert(usage->OverSoftLimit() == true);
+	assert(usage->GetSoftLimitCount() == 1);
+
+	/* the hard limit can't be crossed */
+
+	auto limitFlag = false;
+
+	try {
+		first->Resize(0x4000);
+	} catch (const MemoryLimit &) {
+		limitFlag = true;
+	}
+
+	assert(limitFlag == true);
+	assert(first->GetSize() == 0x2000);
+	assert(usage->GetCommitted() == 0x3000);
+
+	limitFlag = false;
+
+	try {
+		map->AddSection(0x2000);
+	} catch (const MemoryLimit &) {
+		limitFlag = true;
+	}
+
+	assert(limitFlag == true);
+
+	/* removing a section releases it */
+
+	map->RemoveSection(shared);
+
+	assert(usage->GetCommitted() == 0x2000);
+	assert(usage->GetShared() == 0x0000);
+}
+
+void TestAccessProfile() {
+
+	auto section = MakeSection();
+	section->SetAddress(0x2000);
+	section->Resize(0x3000);
+
+	auto map = MakeMap();
+	map->AddSection(section);
+
+	auto profile = std::make_shared<AccessProfile>();
+	map->SetProfile(profile);
+
+	map->Write32(0x2000, 0x00);
+	map->Read32(0x2004);
+	map->Read8(0x4010);
+
+	assert(profile->GetWorkingSet() == 2);
+
+	profile->EndWindow();
+
+	map->Read8(0x4010);
+
+	assert(profile->GetWorkingSet() == 1);
+	assert(profile->GetWorkingSets().size() == 1);
+	assert(profile->GetWorkingSets()[0] == 2);
+
+	auto heatmap = profile->GetHeatmap(*section);
+
+	assert(heatmap.size() == 2);
+	assert(heatmap[0].address == 0x2000);
+	assert(heatmap[0].reads == 1);
+	assert(heatmap[0].writes == 1);
+	assert(heatmap[1].address == 0x4000);
+	assert(heatmap[1].reads == 2);
+
+	/* only one in every four accesses is sampled */
+
+	profile->SetSampleInterval(4);
+
+	for (int i = 0; i < 8; i++)
+		map->Read8(0x3000);
+
+	heatmap = profile->GetHeatmap(*section);
+
+	assert(heatmap.size() == 3);
+	assert(heatmap[1].address == 0x3000);
+	assert(heatmap[1].reads == 2);
+}
+
+void TestDirtyPages() {
+
+	auto section = MakeSection();
+	section->SetAddress(0x1000);
+	section->Resize(0x3000);
+
+	// Pages that the section grows
+	// into start out as dirty.
+
+	assert(section->GetDirtyPages().size() == 3);
+
+	section->ClearDirtyPages();
+
+	assert(section->GetDirtyPages().empty());
+
+	section->Write8(0x1010, 0x01);
+	section->Write32(0x2ffe, 0x01020304);
+
+	auto pages = section->GetDirtyPages();
+	assert(pages.size() == 3);
+	assert(pages[0] == 0x0000);
+	assert(pages[1] == 0x1000);
+	assert(pages[2] == 0x2000);
+
+	section->ClearDirtyPages();
+
+	unsigned char data[4] = { 1, 2, 3, 4 };
+	section->CopyData(0x2004, data, sizeof(data));
+
+	assert(section->IsDirty(0x2000));
+	assert(!section->IsDirty(0x1000));
+
+	section->ClearDirtyPages();
+	section->Resize(0x3800);
+
+	pages = section->GetDirtyPages();
+	assert(pages.size() == 1);
+	assert(pages[0] == 0x3000);
+}
+
+void TestBlockAccess() {
+
+	auto first = MakeSection();
+	first->SetAddress(0x1000);
+	first->Resize(0x1000);
+
+	auto second = MakeSection();
+	second->SetAddress(0x2000);
+	second->Resize(0x1000);
+
+	auto map = MakeMap();
+	map->AddSection(first);
+	map->AddSection(second);
+
+	const unsigned char data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+	map->WriteBlock(0x1ffc, data, sizeof(data));
+
+	assert(map->Read32(0x1ffc) == 0x01020304);
+	assert(map->Read32(0x2000) == 0x05060708);
+
+	auto spans = map->GetReadSpans(0x1ffe, 4);
+	assert(spans.size() == 2);
+	assert(spans[0].address == 0x1ffe);
+	assert(spans[0].size == 2);
+	assert(spans[1].address == 0x2000);
+	assert(spans[1].size == 2);
+
+	unsigned char buf[8];
+	map->ReadBlock(0x1ffc, buf, sizeof(buf));
+	for (unsigned int i = 0; i < sizeof(buf); i++)
+		assert(buf[i] == data[i]);
+
+	// A block that runs past the mapped
+	// memory isn't written at all.
+
+	second->ClearDirtyPages();
+
+	auto faulted = false;
+
+	try {
+		map->WriteBlock(0x2ffc, data, sizeof(data));
+	} catch (const Segfault &) {
+		faulted = true;
+	}
+
+	assert(faulted);
+	assert(map->Read32(0x2ffc) == 0x00);
+	assert(second->GetDirtyPages().empty());
+
+	second->AllowRead(false);
+
+	faulted = false;
+
+	try {
+		map->ReadBlock(0x1ffc, buf, sizeof(buf));
+	} catch (const Segfault &) {
+		faulted = true;
+	}
+
+	assert(faulted);
+}
+
+void TestPageCompression() {
+
+	auto section = MakeSection();
+	section->SetAddress(0x10000);
+	section->Map(HostMapping::MapAnonymous(0x4000));
+
+	auto map = MakeMap();
+	map->AddSection(section);
+
+	map->Write32(0x10000, 0x01020304);
+	map->Write32(0x12ffc, 0x05060708);
+
+	/* the last page doesn't compress */
+
+	uint32_t seed = 1;
+
+	for (uint32_t i = 0; i < 0x1000; i++) {
+		seed = (seed * 1103515245) + 12345;
+		map->Write8(0x13000 + i, (uint8_t) (seed >> 16));
+	}
+
+	PageCompressor compressor;
+	compressor.SetIdleThreshold(1);
+
+	/* the section was just accessed */
+
+	compressor.BeginSweep();
+	assert(compressor.Sweep(*map) == 0);
+
+	compressor.BeginSweep();
+	assert(compressor.Sweep(*map) == 3);
+	assert(section->GetCompressedPages() == 3);
+
+	auto stats = compressor.GetStats();
+	assert(stats->GetCompressedPages() == 3);
+	assert(stats->GetRejectedPages() == 1);
+	assert(stats->GetRatio() > 4.0);
+
+	/* pages are decompressed on access */
+
+	assert(map->Read32(0x12ffc) == 0x05060708);
+	assert(section->GetCompressedPages() == 2);
+	assert(stats->GetDecompressedPages() == 1);
+
+	assert(map->Read32(0x10000) == 0x01020304);
+	assert(section->GetCompressedPages() == 1);
+
+	/* the page budget bounds a sweep */
+
+	compressor.SetPageBudget(1);
+
+	compressor.BeginSweep();
+	assert(compressor.Sweep(*map) == 0);
+	compressor.BeginSweep();
+	assert(compressor.Sweep(*map) == 1);
+	assert(section->GetCompressedPages() == 2);
+
+	map->RemoveSection(section);
+	section.reset();
+
+	assert(stats->GetStoredBytes() == 0);
+}
+
+void TestConcurrentAccess() {
+
+	auto section = MakeSection();
+	section->SetAddress(0x10000);
+	section->Map(HostMapping::MapAnonymous(0x4000));
+
+	auto map = MakeMap();
+	map->AddSection(section);
+
+	ThreadPool threadPool(4);
+
+	std::vector<std::function<void()>> tasks;
+
+	for (uint32_t i = 0; i < 8; i++) {
+		tasks.emplace_back([map, i] {
+			for (uint32_t j = 0; j < 0x200; j++) {
+				auto addr = 0x10000 + (((j * 8) + i) * 4);
+				map->Write32(addr, addr);
+				map->Write32(addr, map->Read32(addr) + 1);
+			}
+		});
+	}
+
+	threadPool.Run(tasks);
+
+	for (uint32_t addr = 0x10000; addr < 0x14000; addr += 4)
+		assert(map->Read32(addr) == (addr + 1));
+
+	assert(section->GetDirtyPages().size() == 4);
+
+	/* exceptions are passed to the caller */
+
+	tasks.clear();
+	tasks.emplace_back([map] { map->Read32(0x20000); });
+
+	auto faulted = false;
+
+	try {
+		threadPool.Run(tasks);
+	} catch (const Segfault &) {
+		faulted = true;
+	}
+
+	assert(faulted);
+}
+
+void TestConcurrentCommit() {
+
+	MemoryUsage usage;
+	usage.SetHardLimit(0x100000);
+
+	ThreadPool threadPool(4);
+
+	std::vector<std::function<void()>> tasks;
+
+	std::atomic<uint32_t> commits(0);
+
+	for (uint32_t i = 0; i < 8; i++) {
+		tasks.emplace_back([&usage, &commits] {
+			for (uint32_t j = 0; j < 0x100; j++) {
+				try {
+					usage.Commit(0x1000, false);
+					commits++;
+				} catch (const MemoryLimit &) {
+				}
+			}
+		});
+	}
+
+	threadPool.Run(tasks);
+
+	/* no more than the limit is
+	 * committed, however it races */
+	assert(commits == 0x100);
+	assert(usage.GetCommitted() == 0x100000);
+	assert(usage.GetPrivate() == 0x100000);
+}
+
+} // namespace
+
 void TestMemoryMap() {
 
+	TestMappedSection();
+	TestReservedSection();
+	TestMemoryUsage();
+	TestAccessProfile();
+	TestDirtyPages();
+	TestBlockAccess();
+	TestPageCompression();
+	TestConcurrentAccess();
+	TestConcurrentCommit();
+
 	auto code = MakeSection();
 	code->CopyData({
 		0x00, 0x11, 0x22, 0x33,
@@ -17,23 +17,143 @@
 
 #include <swanson/memory-map.hpp>
 
+#include <swanson/access-profile.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/memory-limit.hpp>
 #include <swanson/memory-section.hpp>
+#include <swanson/memory-usage.hpp>
 #include <swanson/segfault.hpp>
 
+#include <algorithm>
+
+#include <cstring>
+
 namespace swanson {
 
-uint32_t MemoryMap::GetSize() const noexcept {
+MemoryMap::MemoryMap() : usage(std::make_shared<MemoryUsage>()) {
 
-	uint32_t size = 0;
+}
 
+MemoryMap::~MemoryMap() {
 	for (auto &section : sections)
-		size += section->GetSize();
+		section->SetUsage(nullptr);
+}
 
-	return size;
+uint32_t MemoryMap::GetSize() const noexcept {
+	return (uint32_t) usage->GetCommitted();
+}
+
+std::vector<HostSpan> MemoryMap::GetReadSpans(uint32_t addr, uint32_t size) const {
+
+	std::vector<HostSpan> spans;
+
+	if (((uint64_t) addr + size) > ((uint64_t) UINT32_MAX + 1))
+		throw Segfault(addr);
+
+	RecordRange(addr, size, AccessType::Read);
+
+	uint64_t end = (uint64_t) addr + size;
+	uint64_t next = addr;
+
+	while (next < end) {
+
+		auto section = FindSection((uint32_t) next);
+		if (section == nullptr)
+			throw Segfault((uint32_t) next);
+
+		uint64_t sectionEnd = (uint64_t) section->GetAddress() + section->GetSize();
+
+		HostSpan span;
+		span.address = (uint32_t) next;
+		span.size = (uint32_t) (std::min(end, sectionEnd) - next);
+		span.data = const_cast<unsigned char *>(section->GetReadSpan(span.address, span.size));
+
+		spans.emplace_back(span);
+
+		next += span.size;
+	}
+
+	return spans;
+}
+
+std::vector<HostSpan> MemoryMap::GetWriteSpans(uint32_t addr, uint32_t size) {
+
+	std::vector<HostSpan> spans;
+
+	if (((uint64_t) addr + size) > ((uint64_t) UINT32_MAX + 1))
+		throw Segfault(addr);
+
+	RecordRange(addr, size, AccessType::Write);
+
+	uint64_t end = (uint64_t) addr + size;
+	uint64_t next = addr;
+
+	// Every section is checked before any of
+	// them are marked as written to, so that a
+	// fault leaves no pages falsely dirtied.
+
+	std::vector<std::shared_ptr<MemorySection>> spanSections;
+
+	while (next < end) {
+
+		auto section = FindSection((uint32_t) next);
+		if ((section == nullptr) || !section->WriteAllowed())
+			throw Segfault((uint32_t) next);
+
+		uint64_t sectionEnd = (uint64_t) section->GetAddress() + section->GetSize();
+
+		HostSpan span;
+		span.address = (uint32_t) next;
+		span.size = (uint32_t) (std::min(end, sectionEnd) - next);
+
+		spans.emplace_back(span);
+		spanSections.emplace_back(section);
+
+		next += span.size;
+	}
+
+	for (decltype(spans.size()) i = 0; i < spans.size(); i++)
+		spans[i].data = spanSections[i]->GetWriteSpan(spans[i].address, spans[i].size);
+
+	return spans;
+}
+
+void MemoryMap::ReadBlock(uint32_t addr, void *buf, uint32_t size) const {
+
+	auto dst = (unsigned char *) buf;
+
+	for (const auto &span : GetReadSpans(addr, size)) {
+		std::memcpy(dst, span.data, span.size);
+		dst += span.size;
+	}
+}
+
+void MemoryMap::WriteBlock(uint32_t addr, const void *buf, uint32_t size) {
+
+	auto src = (const unsigned char *) buf;
+
+	for (const auto &span : GetWriteSpans(addr, size)) {
+		std::memcpy(span.data, src, span.size);
+		src += span.size;
+	}
+}
+
+void MemoryMap::RecordRange(uint32_t addr, uint32_t size, AccessType type) const {
+
+	if ((profile == nullptr) || (size == 0))
+		return;
+
+	uint64_t last = ((uint64_t) addr + size - 1) / AccessProfile::pageSize;
+
+	for (uint64_t page = addr / AccessProfile::pageSize; page <= last; page++)
+		profile->Record((uint32_t) (page * AccessProfile::pageSize), type);
 }
 
 uint32_t MemoryMap::Exec32(uint32_t addr) const {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Execute);
+
 	for (const auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Exec32(addr);
@@ -44,6 +164,9 @@ uint32_t MemoryMap::Exec32(uint32_t addr) const {
 
 uint16_t MemoryMap::Exec16(uint32_t addr) const {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Execute);
+
 	for (const auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Exec16(addr);
@@ -54,6 +177,9 @@ uint16_t MemoryMap::Exec16(uint32_t addr) const {
 
 uint32_t MemoryMap::Read32(uint32_t addr) const {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Read);
+
 	for (const auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Read32(addr);
@@ -64,6 +190,9 @@ uint32_t MemoryMap::Read32(uint32_t addr) const {
 
 uint16_t MemoryMap::Read16(uint32_t addr) const {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Read);
+
 	for (const auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Read16(addr);
@@ -74,6 +203,9 @@ uint16_t MemoryMap::Read16(uint32_t addr) const {
 
 uint8_t MemoryMap::Read8(uint32_t addr) const {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Read);
+
 	for (const auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Read8(addr);
@@ -84,6 +216,9 @@ uint8_t MemoryMap::Read8(uint32_t addr) const {
 
 void MemoryMap::Write32(uint32_t addr, uint32_t value) {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Write);
+
 	for (auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Write32(addr, value);
@@ -94,6 +229,9 @@ void MemoryMap::Write32(uint32_t addr, uint32_t value) {
 
 void MemoryMap::Write16(uint32_t addr, uint16_t value) {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Write);
+
 	for (auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Write16(addr, value);
@@ -104,6 +242,9 @@ void MemoryMap::Write16(uint32_t addr, uint16_t value) {
 
 void MemoryMap::Write8(uint32_t addr, uint8_t value) {
 
+	if (profile != nullptr)
+		profile->Record(addr, AccessType::Write);
+
 	for (auto &section : sections) {
 		if (section->Exists(addr))
 			return section->Write8(addr, value);
@@ -117,20 +258,17 @@ void MemoryMap::AddSection(std::shared_ptr<MemorySection> &section) {
 	// TODO : ensure that the section does not
 	// overlap with another section.
 
+	section->SetUsage(usage);
+
 	sections.emplace_back(section);
 }
 
 std::shared_ptr<MemorySection> MemoryMap::AddSection(uint32_t size) {
 
-	uint32_t address = 0;
+	if (!usage->CanCommit(size))
+		throw MemoryLimit(usage->GetCommitted() + size, usage->GetHardLimit());
 
-	for (auto &existingSection : sections) {
-		if ((address + size) > existingSection->GetAddress()) {
-			address = existingSection->GetAddress() + existingSection->GetSize();
-			// align to 0x2000
-			address += 0x2000 - (address % 0x2000);
-		}
-	}
+	auto address = FindAddress(size);
 
 	auto section = std::make_shared<MemorySection>();
 	section->Resize(size);
@@ -141,4 +279,76 @@ std::shared_ptr<MemorySection> MemoryMap::AddSection(uint32_t size) {
 	return section;
 }
 
+uint32_t MemoryMap::FindAddress(uint32_t size) const {
+
+	uint64_t address = 0;
+
+	// Sections are not kept in order, so
+	// keep moving past the sections that
+	// overlap until none of them do.
+
+	auto moved = true;
+
+	while (moved) {
+
+		moved = false;
+
+		for (const auto &section : sections) {
+
+			uint64_t sectionStart = section->GetAddress();
+			uint64_t sectionEnd = sectionStart + section->GetCapacity();
+
+			if (((address + size) > sectionStart) && (address < sectionEnd)) {
+				address = sectionEnd;
+				// align to 0x2000
+				address += 0x2000 - (address % 0x2000);
+				moved = true;
+			}
+		}
+
+		if ((address + size) > UINT32_MAX)
+			throw Exception("Memory map has no room for section.");
+	}
+
+	return (uint32_t) address;
+}
+
+std::shared_ptr<MemorySection> MemoryMap::FindSection(uint32_t addr) const {
+
+	for (const auto &section : sections) {
+		if (section->Exists(addr))
+			return section;
+	}
+
+	return nullptr;
+}
+
+bool MemoryMap::Overlaps(uint32_t addr, uint32_t size) const noexcept {
+
+	uint64_t start = addr;
+	uint64_t end = start + size;
+
+	for (const auto &section : sections) {
+		uint64_t sectionStart = section->GetAddress();
+		uint64_t sectionEnd = sectionStart + section->GetCapacity();
+		if ((end > sectionStart) && (start < sectionEnd))
+			return true;
+	}
+
+	return false;
+}
+
+bool MemoryMap::RemoveSection(const std::shared_ptr<MemorySection> &section) {
+
+	for (auto it = sections.begin(); it != sections.end(); it++) {
+		if (*it == section) {
+			section->SetUsage(nullptr);
+			sections.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 } // namespace swanson
@@ -17,21 +17,310 @@
 
 #include <swanson/memory-section.hpp>
 
+#include <swanson/exception.hpp>
+#include <swanson/host-mapping.hpp>
+#include <swanson/lz.hpp>
+#include <swanson/memory-limit.hpp>
+#include <swanson/memory-usage.hpp>
+#include <swanson/page-compressor.hpp>
 #include <swanson/segfault.hpp>
 
+#include <chrono>
+
 #include <cstring>
 
+namespace {
+
+// Aligned 32-bit and 16-bit accesses are made
+// with single atomic loads and stores, so that
+// guest threads running on separate host threads
+// never see a value that is only partly written.
+
+uint32_t Load32(const unsigned char *ptr) noexcept {
+#ifdef __GNUC__
+	if ((((uintptr_t) ptr) % 4) == 0) {
+		auto value = __atomic_load_n((const uint32_t *) ptr, __ATOMIC_RELAXED);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		value = __builtin_bswap32(value);
+#endif
+		return value;
+	}
+#endif
+	uint32_t value = 0;
+	value |= ((uint32_t) ptr[0]) << 0x18;
+	value |= ((uint32_t) ptr[1]) << 0x10;
+	value |= ((uint32_t) ptr[2]) << 0x08;
+	value |= ((uint32_t) ptr[3]) << 0x00;
+	return value;
+}
+
+uint16_t Load16(const unsigned char *ptr) noexcept {
+#ifdef __GNUC__
+	if ((((uintptr_t) ptr) % 2) == 0) {
+		auto value = __atomic_load_n((const uint16_t *) ptr, __ATOMIC_RELAXED);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		value = __builtin_bswap16(value);
+#endif
+		return value;
+	}
+#endif
+	uint16_t value = 0;
+	value |= ((uint16_t) ptr[0]) << 0x08;
+	value |= ((uint16_t) ptr[1]) << 0x00;
+	return value;
+}
+
+void Store32(unsigned char *ptr, uint32_t value) noexcept {
+#ifdef __GNUC__
+	if ((((uintptr_t) ptr) % 4) == 0) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		value = __builtin_bswap32(value);
+#endif
+		__atomic_store_n((uint32_t *) ptr, value, __ATOMIC_RELAXED);
+		return;
+	}
+#endif
+	ptr[0] = (value >> 0x18) & 0xff;
+	ptr[1] = (value >> 0x10) & 0xff;
+	ptr[2] = (value >> 0x08) & 0xff;
+	ptr[3] = (value >> 0x00) & 0xff;
+}
+
+void Store16(unsigned char *ptr, uint16_t value) noexcept {
+#ifdef __GNUC__
+	if ((((uintptr_t) ptr) % 2) == 0) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		value = __builtin_bswap16(value);
+#endif
+		__atomic_store_n((uint16_t *) ptr, value, __ATOMIC_RELAXED);
+		return;
+	}
+#endif
+	ptr[0] = (value >> 0x08) & 0xff;
+	ptr[1] = (value >> 0x00) & 0xff;
+}
+
+} // namespace
+
 namespace swanson {
 
-void MemorySection::CopyData(const void *data, uint32_t size) {
-	Resize(size);
-	std::memcpy(bytes.data(), data, size);
+MemorySection::~MemorySection() {
+	if (usage != nullptr)
+		usage->Release(size, IsShared());
+	DropCompressed();
+}
+
+bool MemorySection::IsShared() const noexcept {
+	return (mapping != nullptr) && mapping->IsShared();
+}
+
+void MemorySection::AllowWrite(bool state) {
+
+	if (state && (mapping != nullptr) && !mapping->IsWritable())
+		throw Exception("Memory section views a read-only host mapping.");
+
+	writePermission = state;
+}
+
+void MemorySection::CopyData(const void *src, uint32_t srcSize) {
+	DropCompressed();
+	Resize(srcSize);
+	if (srcSize > 0) {
+		std::memcpy(data, src, srcSize);
+		MarkDirty(0, srcSize);
+	}
+}
+
+void MemorySection::CopyData(const std::vector<unsigned char> &bytes_) {
+	CopyData(bytes_.data(), bytes_.size());
+}
+
+void MemorySection::CopyData(uint32_t offset, const void *src, uint32_t srcSize) {
+
+	OverwriteData(offset, src, srcSize);
+
+	if (srcSize > 0)
+		MarkDirty(offset, srcSize);
+}
+
+void MemorySection::OverwriteData(uint32_t offset, const void *src, uint32_t srcSize) {
+
+	if ((offset > size) || (srcSize > (size - offset)))
+		throw Exception("Data does not fit in memory section.");
+
+	if (srcSize == 0)
+		return;
+
+	Touch(offset, srcSize);
+
+	std::memcpy(data + offset, src, srcSize);
+}
+
+std::vector<uint32_t> MemorySection::GetDirtyPages() const {
+
+	std::vector<uint32_t> offsets;
+
+	if (dirtyCount.load(std::memory_order_relaxed) == 0)
+		return offsets;
+
+	offsets.reserve(dirtyCount.load(std::memory_order_relaxed));
+
+	for (uint32_t i = 0; i < ((dirtyPageCount + 63) / 64); i++) {
+
+		auto word = dirtyWords[i].load(std::memory_order_relaxed);
+
+		for (uint32_t bit = 0; word != 0; bit++, word >>= 1) {
+			if (word & 1)
+				offsets.emplace_back(((i * 64) + bit) * pageSize);
+		}
+	}
+
+	return offsets;
+}
+
+bool MemorySection::IsDirty(uint32_t offset) const noexcept {
+
+	auto page = offset / pageSize;
+
+	if (page >= dirtyPageCount)
+		return false;
+
+	auto bit = ((uint64_t) 1) << (page % 64);
+
+	return (dirtyWords[page / 64].load(std::memory_order_relaxed) & bit) != 0;
+}
+
+void MemorySection::ClearDirtyPages() noexcept {
+
+	if (dirtyCount.load(std::memory_order_relaxed) == 0)
+		return;
+
+	for (uint32_t i = 0; i < ((dirtyPageCount + 63) / 64); i++)
+		dirtyWords[i].store(0, std::memory_order_relaxed);
+
+	dirtyCount.store(0, std::memory_order_relaxed);
+}
+
+uint32_t MemorySection::Compress(uint32_t maxPages, std::shared_ptr<CompressionStats> stats) {
+
+	if ((mapping == nullptr) || !mapping->CanDiscard())
+		return 0;
+
+	compressionStats = stats;
+
+	// Only whole pages are compressed, since
+	// host memory is released a page at a time.
+
+	uint32_t pageCount = size / pageSize;
+
+	if (compressedPages.size() < pageCount)
+		compressedPages.resize(pageCount);
+
+	uint32_t compressed = 0;
+
+	for (; (compressCursor < pageCount) && (compressed < maxPages); compressCursor++) {
+
+		auto &page = compressedPages[compressCursor];
+		if (!page.empty())
+			continue;
+
+		auto pageData = data + (compressCursor * pageSize);
+
+		auto packed = lz::Compress(pageData, pageSize);
+
+		// Keeping a page that doesn't compress
+		// well isn't worth the decompression cost.
+
+		if (packed.size() > ((pageSize * 3) / 4)) {
+			stats->CountRejected();
+			continue;
+		}
+
+		if (!mapping->Discard(compressCursor * pageSize, pageSize))
+			break;
+
+		stats->CountCompressed(pageSize, packed.size());
+
+		page = std::move(packed);
+
+		compressedCount.fetch_add(1, std::memory_order_release);
+
+		compressed++;
+	}
+
+	return compressed;
+}
+
+void MemorySection::Decompress() const {
+	if (compressedCount.load(std::memory_order_acquire) != 0)
+		DecompressRange(0, size);
+}
+
+void MemorySection::DecompressRange(uint32_t offset, uint32_t length) const {
+
+	if (length == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(compressionMutex);
+
+	auto last = (offset + length - 1) / pageSize;
+
+	if (last >= compressedPages.size())
+		last = compressedPages.size() - 1;
+
+	for (auto index = offset / pageSize; index <= last; index++) {
+
+		auto &page = compressedPages[index];
+		if (page.empty())
+			continue;
+
+		auto start = std::chrono::steady_clock::now();
+
+		lz::Decompress(page.data(), page.size(), data + (index * pageSize), pageSize);
+
+		auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+		if (compressionStats != nullptr)
+			compressionStats->CountDecompressed(page.size(), time.count());
+
+		std::vector<unsigned char>().swap(page);
+
+		compressedCount.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void MemorySection::DropCompressed() noexcept {
+
+	if ((compressionStats != nullptr) && (compressedCount.load(std::memory_order_relaxed) != 0)) {
+		for (const auto &page : compressedPages) {
+			if (!page.empty())
+				compressionStats->CountDropped(page.size());
+		}
+	}
+
+	std::vector<std::vector<unsigned char>>().swap(compressedPages);
+
+	compressedCount.store(0, std::memory_order_relaxed);
+	compressCursor = 0;
+}
+
+const unsigned char *MemorySection::GetData() const {
+	Decompress();
+	return data;
+}
+
+uint32_t MemorySection::GetCapacity() const noexcept {
+
+	if (mapping != nullptr)
+		return mapping->GetCapacity();
+	else
+		return size;
 }
 
 bool MemorySection::Exists(uint32_t addr) const noexcept {
 	if (addr < address)
 		return false;
-	else if (addr >= (address + bytes.size()))
+	else if (addr >= (address + size))
 		return false;
 	else
 		return true;
@@ -60,16 +349,12 @@ uint32_t MemorySection::Read32(uint32_t addr) const {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 4) > bytes.size())
+	if ((offset + 4) > size)
 		throw Segfault(addr);
 
-	uint32_t value = 0;
-	value |= ((uint32_t) bytes[offset + 0]) << 0x18;
-	value |= ((uint32_t) bytes[offset + 1]) << 0x10;
-	value |= ((uint32_t) bytes[offset + 2]) << 0x08;
-	value |= ((uint32_t) bytes[offset + 3]) << 0x00;
+	Touch(offset, 4);
 
-	return value;
+	return Load32(data + offset);
 }
 
 uint16_t MemorySection::Read16(uint32_t addr) const {
@@ -79,14 +364,12 @@ uint16_t MemorySection::Read16(uint32_t addr) const {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 2) > bytes.size())
+	if ((offset + 2) > size)
 		throw Segfault(addr);
 
-	uint16_t value = 0;
-	value |= ((uint16_t) bytes[offset + 0]) << 0x08;
-	value |= ((uint16_t) bytes[offset + 1]) << 0x00;
+	Touch(offset, 2);
 
-	return value;
+	return Load16(data + offset);
 }
 
 uint8_t MemorySection::Read8(uint32_t addr) const {
@@ -96,10 +379,45 @@ uint8_t MemorySection::Read8(uint32_t addr) const {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 1) > bytes.size())
+	if ((offset + 1) > size)
 		throw Segfault(addr);
 
-	return (uint8_t) bytes[offset];
+	Touch(offset, 1);
+
+	return (uint8_t) data[offset];
+}
+
+const unsigned char *MemorySection::GetReadSpan(uint32_t addr, uint32_t length) const {
+
+	if ((addr < address) || (!readPermission))
+		throw Segfault(addr);
+
+	uint32_t offset = addr - address;
+
+	if ((offset > size) || (length > (size - offset)))
+		throw Segfault(addr);
+
+	Touch(offset, length);
+
+	return data + offset;
+}
+
+unsigned char *MemorySection::GetWriteSpan(uint32_t addr, uint32_t length) {
+
+	if ((addr < address) || (!writePermission))
+		throw Segfault(addr);
+
+	uint32_t offset = addr - address;
+
+	if ((offset > size) || (length > (size - offset)))
+		throw Segfault(addr);
+
+	Touch(offset, length);
+
+	if (length > 0)
+		MarkDirty(offset, length);
+
+	return data + offset;
 }
 
 void MemorySection::Write32(uint32_t addr, uint32_t value) {
@@ -109,13 +427,14 @@ void MemorySection::Write32(uint32_t addr, uint32_t value) {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 4) > bytes.size())
+	if ((offset + 4) > size)
 		throw Segfault(addr);
 
-	bytes[offset + 0] = (value >> 0x18) & 0xff;
-	bytes[offset + 1] = (value >> 0x10) & 0xff;
-	bytes[offset + 2] = (value >> 0x08) & 0xff;
-	bytes[offset + 3] = (value >> 0x00) & 0xff;
+	Touch(offset, 4);
+
+	Store32(data + offset, value);
+
+	MarkDirty(offset, 4);
 }
 
 void MemorySection::Write16(uint32_t addr, uint16_t value) {
@@ -125,11 +444,14 @@ void MemorySection::Write16(uint32_t addr, uint16_t value) {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 2) > bytes.size())
+	if ((offset + 2) > size)
 		throw Segfault(addr);
 
-	bytes[offset + 0] = (value >> 0x08) & 0xff;
-	bytes[offset + 1] = (value >> 0x00) & 0xff;
+	Touch(offset, 2);
+
+	Store16(data + offset, value);
+
+	MarkDirty(offset, 2);
 }
 
 void MemorySection::Write8(uint32_t addr, uint8_t value) {
@@ -139,14 +461,163 @@ void MemorySection::Write8(uint32_t addr, uint8_t value) {
 
 	uint32_t offset = addr - address;
 
-	if ((offset + 1) > bytes.size())
+	if ((offset + 1) > size)
 		throw Segfault(addr);
 
-	bytes[offset] = value;
+	Touch(offset, 1);
+
+	data[offset] = value;
+
+	MarkDirty(offset, 1);
 }
 
-void MemorySection::Resize(uint32_t size) {
-	bytes.resize(size);
+void MemorySection::Map(std::shared_ptr<HostMapping> mapping_) {
+
+	if (mapping_ == nullptr)
+		throw Exception("Memory section mapping is null.");
+
+	if (usage != nullptr) {
+
+		// Only the growth of the section
+		// counts against the hard limit.
+
+		auto newSize = mapping_->GetSize();
+		if ((newSize > size) && !usage->CanCommit(newSize - size))
+			throw MemoryLimit(usage->GetCommitted() + (newSize - size), usage->GetHardLimit());
+
+		usage->Release(size, IsShared());
+		usage->Commit(newSize, mapping_->IsShared());
+	}
+
+	if (writePermission && !mapping_->IsWritable())
+		writePermission = false;
+
+	mapping = mapping_;
+	data = mapping->GetData();
+	size = mapping->GetSize();
+
+	std::vector<unsigned char>().swap(bytes);
+
+	DropCompressed();
+
+	// The contents of the section are
+	// replaced, so every page is dirty.
+
+	dirtyPageCount = 0;
+	dirtyCount.store(0, std::memory_order_relaxed);
+
+	ResizeDirtyPages(size);
+
+	if (size > 0)
+		MarkDirty(0, size);
+}
+
+void MemorySection::Resize(uint32_t size_) {
+
+	// Resizing is rare enough that the
+	// section is simply decompressed first.
+	Decompress();
+
+	if ((usage != nullptr) && (size_ > size))
+		usage->Commit(size_ - size, IsShared());
+
+	try {
+		ResizeStorage(size_);
+	} catch (...) {
+		if ((usage != nullptr) && (size_ > size))
+			usage->Release(size_ - size, IsShared());
+		throw;
+	}
+
+	if ((usage != nullptr) && (size_ < size))
+		usage->Release(size - size_, IsShared());
+
+	ResizeDirtyPages(size_);
+
+	size = size_;
+}
+
+void MemorySection::SetUsage(std::shared_ptr<MemoryUsage> usage_) {
+
+	if (usage_ != nullptr)
+		usage_->Commit(size, IsShared());
+
+	if (usage != nullptr)
+		usage->Release(size, IsShared());
+
+	usage = usage_;
+}
+
+void MemorySection::ResizeStorage(uint32_t size_) {
+
+	if (mapping != nullptr) {
+		if (size_ > mapping->GetCapacity())
+			throw Exception("Memory section cannot grow past its host mapping.");
+		if (size_ > mapping->GetSize())
+			mapping->Resize(size_);
+		return;
+	}
+
+	bytes.resize(size_);
+	data = bytes.data();
+}
+
+void MemorySection::ResizeDirtyPages(uint32_t size_) {
+
+	uint32_t pageCount = (size_ + (pageSize - 1)) / pageSize;
+
+	auto wordCount = (pageCount + 63) / 64;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+
+	if (wordCount > 0)
+		words.reset(new std::atomic<uint64_t>[wordCount]);
+
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; i < wordCount; i++) {
+
+		uint64_t word = 0;
+
+		if (i < ((dirtyPageCount + 63) / 64))
+			word = dirtyWords[i].load(std::memory_order_relaxed);
+
+		// Flags past the new end are dropped.
+		if (((i + 1) * 64) > pageCount)
+			word &= (((uint64_t) 1) << (pageCount % 64)) - 1;
+
+		words[i].store(word, std::memory_order_relaxed);
+
+		for (; word != 0; word &= word - 1)
+			count++;
+	}
+
+	dirtyWords = std::move(words);
+	dirtyPageCount = pageCount;
+	dirtyCount.store(count, std::memory_order_relaxed);
+
+	// Pages that the section grows into may
+	// contain bytes that were written before
+	// the section last shrunk, so they're
+	// counted as dirty. This includes the
+	// partial page at the old end.
+
+	if (size_ > size)
+		MarkDirty(size, size_ - size);
+}
+
+uint32_t MemorySection::Sweep() noexcept {
+
+	if (accessed.exchange(false, std::memory_order_relaxed)) {
+		// Pages may have been written to,
+		// so they're all looked at again.
+		idleSweeps = 0;
+		compressCursor = 0;
+	} else if (idleSweeps < UINT32_MAX) {
+		idleSweeps++;
+	}
+
+	return idleSweeps;
 }
 
 void MemorySection::SetAddress(uint32_t addr) noexcept {
@@ -0,0 +1,84 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+//  This file is part of Swanson.
+//
+//  Swanson is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Swanson is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/memory-usage.hpp>
+
+#include <swanson/memory-limit.hpp>
+
+namespace swanson {
+
+MemoryUsage::MemoryUsage() noexcept {
+	committed = 0;
+	privateBytes = 0;
+	shared = 0;
+	softLimit = 0;
+	hardLimit = 0;
+	softLimitCount = 0;
+}
+
+bool MemoryUsage::CanCommit(uint64_t bytes) const noexcept {
+
+	auto limit = GetHardLimit();
+
+	if (limit == 0)
+		return true;
+
+	return (GetCommitted() + bytes) <= limit;
+}
+
+void MemoryUsage::Commit(uint64_t bytes, bool isShared) {
+
+	// The check and the count are one step,
+	// so that threads committing at the same
+	// time can't both pass the hard limit.
+
+	auto previous = committed.load(std::memory_order_relaxed);
+
+	do {
+		auto limit = GetHardLimit();
+		if ((limit != 0) && ((previous + bytes) > limit))
+			throw MemoryLimit(previous + bytes, limit);
+	} while (!committed.compare_exchange_weak(previous, previous + bytes, std::memory_order_relaxed));
+
+	if (isShared)
+		shared.fetch_add(bytes, std::memory_order_relaxed);
+	else
+		privateBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+	auto limit = GetSoftLimit();
+	if ((limit != 0) && (previous <= limit) && ((previous + bytes) > limit))
+		softLimitCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryUsage::Release(uint64_t bytes, bool isShared) noexcept {
+
+	committed.fetch_sub(bytes, std::memory_order_relaxed);
+
+	if (isShared)
+		shared.fetch_sub(bytes, std::memory_order_relaxed);
+	else
+		privateBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool MemoryUsage::OverSoftLimit() const noexcept {
+
+	auto limit = GetSoftLimit();
+
+	return (limit != 0) && (GetCommitted() > limit);
+}
+
+} // namespace swanson
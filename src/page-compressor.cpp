@@ -0,0 +1,126 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/page-compressor.hpp>
+
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+
+namespace swanson {
+
+CompressionStats::CompressionStats() noexcept
+  : compressedPages(0),
+    decompressedPages(0),
+    rejectedPages(0),
+    originalBytes(0),
+    packedBytes(0),
+    storedBytes(0),
+    decompressTime(0),
+    maxDecompressTime(0) {
+
+}
+
+void CompressionStats::CountCompressed(uint32_t size, uint32_t packedSize) noexcept {
+	compressedPages.fetch_add(1, std::memory_order_relaxed);
+	originalBytes.fetch_add(size, std::memory_order_relaxed);
+	packedBytes.fetch_add(packedSize, std::memory_order_relaxed);
+	storedBytes.fetch_add(packedSize, std::memory_order_relaxed);
+}
+
+void CompressionStats::CountDecompressed(uint32_t packedSize, uint64_t time) noexcept {
+
+	decompressedPages.fetch_add(1, std::memory_order_relaxed);
+	storedBytes.fetch_sub(packedSize, std::memory_order_relaxed);
+	decompressTime.fetch_add(time, std::memory_order_relaxed);
+
+	auto maxTime = maxDecompressTime.load(std::memory_order_relaxed);
+	while ((time > maxTime) && !maxDecompressTime.compare_exchange_weak(maxTime, time, std::memory_order_relaxed)) {
+	}
+}
+
+void CompressionStats::CountDropped(uint32_t packedSize) noexcept {
+	storedBytes.fetch_sub(packedSize, std::memory_order_relaxed);
+}
+
+double CompressionStats::GetRatio() const noexcept {
+
+	auto packed = packedBytes.load(std::memory_order_relaxed);
+	if (packed == 0)
+		return 0.0;
+
+	return ((double) originalBytes.load(std::memory_order_relaxed)) / packed;
+}
+
+uint64_t CompressionStats::GetAverageDecompressTime() const noexcept {
+
+	auto count = decompressedPages.load(std::memory_order_relaxed);
+	if (count == 0)
+		return 0;
+
+	return decompressTime.load(std::memory_order_relaxed) / count;
+}
+
+PageCompressor::PageCompressor() : stats(std::make_shared<CompressionStats>()) {
+	idleThreshold = 8;
+	pageBudget = 256;
+	pagesLeft = pageBudget;
+	storeBudget = 0;
+	sweepInterval = 1000000;
+	sinceSweep = 0;
+}
+
+bool PageCompressor::Advance(uint32_t steps) noexcept {
+
+	sinceSweep += steps;
+
+	if (sinceSweep < sweepInterval)
+		return false;
+
+	sinceSweep = 0;
+
+	return true;
+}
+
+uint32_t PageCompressor::Sweep(MemoryMap &memoryMap) {
+
+	uint32_t compressed = 0;
+
+	for (auto &section : memoryMap) {
+
+		// The idle count of every section is
+		// kept up to date, even if the budget
+		// has run out for this sweep.
+
+		auto idleSweeps = section->Sweep();
+
+		if ((idleSweeps < idleThreshold) || (pagesLeft == 0))
+			continue;
+
+		if ((storeBudget != 0) && (stats->GetStoredBytes() >= storeBudget))
+			continue;
+
+		auto count = section->Compress(pagesLeft, stats);
+
+		pagesLeft -= count;
+
+		compressed += count;
+	}
+
+	return compressed;
+}
+
+} // namespace swanson
@@ -0,0 +1,263 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "pipe-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/pipe.hpp>
+#include <swanson/process.hpp>
+#include <swanson/syscalls.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the data
+/// of the test programs.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// The number of bytes of data.
+constexpr uint32_t dataSize = 0x20000;
+
+/// Makes a pipe, writes five bytes to
+/// it, reads them back and exits with the
+/// result of the read.
+const std::vector<unsigned char> pipeProgram {
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r0, 0x20000 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x1f, /* swi pipe */
+	0x08, 0x20, 0x00, 0x02, 0x00, 0x04, /* lda.l $r0, 0x20004 */
+	0x01, 0x30, 0x00, 0x02, 0x01, 0x00, /* ldi.l $r1, 0x20100 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x05, /* ldi.l $r2, 5 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x05, /* swi write */
+	0x08, 0x20, 0x00, 0x02, 0x00, 0x00, /* lda.l $r0, 0x20000 */
+	0x01, 0x30, 0x00, 0x02, 0x02, 0x00, /* ldi.l $r1, 0x20200 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x10, /* ldi.l $r2, 16 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Make a program that makes one system
+/// call and exits with its result.
+std::vector<unsigned char> MakeProgram(uint32_t type, uint32_t fd, uint32_t address, uint32_t size) {
+
+	std::vector<unsigned char> program;
+
+	auto loadImmediate = [&program](unsigned char reg, uint32_t value) {
+		program.insert(program.end(), {
+			0x01, (unsigned char) (reg << 4),
+			(unsigned char) (value >> 24),
+			(unsigned char) (value >> 16),
+			(unsigned char) (value >> 8),
+			(unsigned char) value
+		});
+	};
+
+	loadImmediate(2, fd);
+	loadImmediate(3, address);
+	loadImmediate(4, size);
+
+	program.insert(program.end(), { 0x30, 0x00, 0x00, 0x00, 0x00, (unsigned char) type });
+	program.insert(program.end(), { 0x30, 0x00, 0x00, 0x00, 0x00, 0x01 });
+
+	return program;
+}
+
+auto MakeProcess(const std::vector<unsigned char> &program) {
+	return MakeTestProcess(program, dataAddress, dataSize);
+}
+
+void Run(Process &process) {
+	for (auto steps = 0; !process.Exited(); steps++) {
+		assert(steps < 10);
+		assert(!process.GetThread(0)->IsBlocked());
+		process.Step(100);
+	}
+}
+
+void TestSyscall() {
+
+	auto process = MakeProcess(pipeProgram);
+
+	auto &memoryMap = *process->GetMemoryMap();
+
+	memoryMap.WriteBlock(dataAddress + 0x100, "hello", 5);
+
+	Run(*process);
+
+	assert(process->GetExitCode() == 5);
+	assert(memoryMap.Read32(dataAddress) == 3);
+	assert(memoryMap.Read32(dataAddress + 4) == 4);
+	assert(std::memcmp(memoryMap.GetReadSpans(dataAddress + 0x200, 5)[0].data, "hello", 5) == 0);
+}
+
+void TestPipeline() {
+
+	auto ends = Pipe::Create();
+
+	/* the producer writes to its standard output,
+	 * and the consumer reads its standard input */
+	auto producer = MakeProcess(MakeProgram(syscalls::write, 1, dataAddress, 0x1000));
+	auto consumer = MakeProcess(MakeProgram(syscalls::read, 0, dataAddress, dataSize));
+
+	producer->SetStream(1, ends.second);
+	consumer->SetStream(0, ends.first);
+
+	std::vector<unsigned char> data(0x1000);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (unsigned char) (i * 7);
+
+	producer->GetMemoryMap()->WriteBlock(dataAddress, data.data(), data.size());
+
+	/* the consumer waits for data */
+	consumer->Step(100);
+	assert(consumer->GetThread(0)->IsBlocked());
+
+	/* and the producer gives it
+	 * straight to the consumer */
+	Run(*producer);
+	assert(producer->GetExitCode() == 0x1000);
+	assert(!consumer->GetThread(0)->IsBlocked());
+	assert(ends.first->ReadSome(data.data(), 1) == 0);
+
+	Run(*consumer);
+	assert(consumer->GetExitCode() == 0x1000);
+
+	auto spans = consumer->GetMemoryMap()->GetReadSpans(dataAddress, 0x1000);
+	for (uint32_t i = 0; i < 0x1000; i++)
+		assert(spans[0].data[i] == (unsigned char) (i * 7));
+}
+
+void TestFull() {
+
+	auto ends = Pipe::Create();
+
+	auto producer = MakeProcess(MakeProgram(syscalls::write, 1, dataAddress, 0x100));
+
+	producer->SetStream(1, ends.second);
+
+	std::vector<unsigned char> data(Pipe::capacity, 'a');
+	assert(ends.second->GetPipe()->WriteSome(data.data(), data.size()) == Pipe::capacity);
+
+	/* the writer waits for room */
+	producer->Step(100);
+	assert(producer->GetThread(0)->IsBlocked());
+	assert(!producer->Exited());
+
+	/* and only gets what's made room for */
+	assert(ends.first->ReadSome(data.data(), 0x10) == 0x10);
+	assert(!producer->GetThread(0)->IsBlocked());
+
+	Run(*producer);
+	assert(producer->GetExitCode() == 0x10);
+
+	/* the data stays in order */
+	assert(ends.first->ReadSome(data.data(), data.size()) == Pipe::capacity);
+	assert(data.back() == 0);
+}
+
+void TestClose() {
+
+	auto ends = Pipe::Create();
+
+	auto consumer = MakeProcess(MakeProgram(syscalls::read, 0, dataAddress, 0x10));
+
+	consumer->SetStream(0, ends.first);
+
+	/* closing the last write end
+	 * wakes readers with the end
+	 * of the file */
+	consumer->Step(100);
+	assert(consumer->GetThread(0)->IsBlocked());
+	ends.second.reset();
+	Run(*consumer);
+	assert(consumer->GetExitCode() == 0);
+
+	/* writes to a pipe without
+	 * a read end are refused */
+	ends = Pipe::Create();
+	auto producer = MakeProcess(MakeProgram(syscalls::write, 1, dataAddress, 0x10));
+	producer->SetStream(1, ends.second);
+	ends.first.reset();
+	Run(*producer);
+	assert((uint32_t) producer->GetExitCode() == errors::ToResult(errors::pipe));
+}
+
+void TestDeliver() {
+
+	constexpr uint32_t mappingAddress = 0x100000;
+
+	auto ends = Pipe::Create();
+
+	auto consumer = MakeProcess(MakeProgram(syscalls::read, 0, mappingAddress, 0x10));
+
+	consumer->SetStream(0, ends.first);
+
+	auto &memoryMap = *consumer->GetMemoryMap();
+
+	auto mapping = std::make_shared<MemorySection>();
+	mapping->SetAddress(mappingAddress);
+	mapping->Resize(0x1000);
+	consumer->AddMapping(mapping);
+
+	/* the data is copied by the reader
+	 * when it resumes, not by the writer */
+	consumer->Step(100);
+	assert(consumer->GetThread(0)->IsBlocked());
+	assert(ends.second->GetPipe()->WriteSome("hello", 5) == 5);
+	assert(memoryMap.Read8(mappingAddress) == 0);
+	Run(*consumer);
+	assert(consumer->GetExitCode() == 5);
+	assert(std::memcmp(memoryMap.GetReadSpans(mappingAddress, 5)[0].data, "hello", 5) == 0);
+
+	/* a buffer that's unmapped
+	 * in the meantime faults */
+	consumer = MakeProcess(MakeProgram(syscalls::read, 0, mappingAddress, 0x10));
+	consumer->SetStream(0, ends.first);
+	mapping = std::make_shared<MemorySection>();
+	mapping->SetAddress(mappingAddress);
+	mapping->Resize(0x1000);
+	consumer->AddMapping(mapping);
+	consumer->Step(100);
+	assert(consumer->GetThread(0)->IsBlocked());
+	assert(consumer->RemoveMapping(mappingAddress, 0x1000));
+	assert(ends.second->GetPipe()->WriteSome("hello", 5) == 5);
+	Run(*consumer);
+	assert((uint32_t) consumer->GetExitCode() == errors::ToResult(errors::fault));
+}
+
+} // namespace
+
+void TestPipe() {
+	TestSyscall();
+	TestPipeline();
+	TestFull();
+	TestClose();
+	TestDeliver();
+}
+
+} // namespace swanson::tests
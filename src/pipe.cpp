@@ -0,0 +1,410 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/pipe.hpp>
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/process.hpp>
+#include <swanson/segfault.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace swanson {
+
+namespace {
+
+/// Copy part of one set of spans to another.
+/// @param src The spans to copy from.
+/// @param srcOffset The offset into the
+/// source spans to start at.
+/// @param dst The spans to copy to. All
+/// of them are filled.
+void CopySpans(const std::vector<HostSpan> &src, uint32_t srcOffset, const std::vector<HostSpan> &dst) {
+
+	size_t srcIndex = 0;
+
+	while ((srcIndex < src.size()) && (srcOffset >= src[srcIndex].size))
+		srcOffset -= src[srcIndex++].size;
+
+	for (const auto &span : dst) {
+
+		uint32_t dstOffset = 0;
+
+		while (dstOffset < span.size) {
+
+			auto length = std::min(span.size - dstOffset, src[srcIndex].size - srcOffset);
+
+			std::memcpy(span.data + dstOffset, src[srcIndex].data + srcOffset, length);
+
+			dstOffset += length;
+			srcOffset += length;
+
+			if (srcOffset == src[srcIndex].size) {
+				srcIndex++;
+				srcOffset = 0;
+			}
+		}
+	}
+}
+
+/// Get the total size of a set of spans.
+uint32_t GetSize(const std::vector<HostSpan> &spans) noexcept {
+
+	uint32_t size = 0;
+
+	for (const auto &span : spans)
+		size += span.size;
+
+	return size;
+}
+
+/// Wake each of a set of wait queues.
+void WakeAll(const std::vector<std::shared_ptr<WaitQueue>> &waitQueues) {
+	for (const auto &waitQueue : waitQueues)
+		waitQueue->WakeAll();
+}
+
+} // namespace
+
+std::pair<std::shared_ptr<PipeEnd>, std::shared_ptr<PipeEnd>> Pipe::Create() {
+
+	auto pipe = std::make_shared<Pipe>();
+
+	return { std::make_shared<PipeEnd>(pipe, false), std::make_shared<PipeEnd>(pipe, true) };
+}
+
+Pipe::Pipe() : buffer(capacity), readOffset(0), used(0), readEnds(1), writeEnds(1) {
+
+}
+
+void Pipe::Close(bool writeEnd) {
+
+	std::vector<Reader> finished;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (writeEnd) {
+			if ((--writeEnds == 0) && !readers.empty()) {
+				finished.assign(readers.begin(), readers.end());
+				readers.clear();
+			}
+		} else {
+			readEnds--;
+		}
+	}
+
+	// Readers that are left waiting read the
+	// end of the file, and writers that are left
+	// waiting make their call again and find that
+	// the pipe is broken.
+
+	for (auto &reader : finished) {
+		auto process = reader.process.lock();
+		if (process != nullptr)
+			process->CompleteIO(reader.thread, 0, 0, {}, reader.generation);
+		reader.waitQueue->Wake();
+	}
+
+	if (!writeEnd)
+		writeQueue.WakeAll();
+}
+
+bool Pipe::Read(Process &process,
+                CPU &cpu,
+                MemoryMap &memoryMap,
+                uint32_t address,
+                uint32_t size,
+                bool mayBlock,
+                uint32_t &result) {
+
+	uint32_t readSize = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		try {
+
+			if (used > 0) {
+				readSize = ReadSpans(memoryMap.GetWriteSpans(address, std::min(size, used)));
+				result = readSize;
+			} else if ((writeEnds == 0) || (size == 0)) {
+				result = 0;
+			} else if (!mayBlock) {
+				result = errors::ToResult(errors::again);
+			} else {
+
+				// The buffer is checked now, so that a
+				// bad one fails right away. The data is
+				// copied to it once the thread resumes,
+				// which faults if it was unmapped since.
+
+				memoryMap.GetWriteSpans(address, size);
+
+				Reader reader;
+				reader.process = process.shared_from_this();
+				reader.thread = process.FindThread(cpu);
+				reader.address = address;
+				reader.size = size;
+				reader.waitQueue = std::make_shared<WaitQueue>();
+				reader.generation = process.GetGeneration();
+
+				process.Block(cpu, *reader.waitQueue);
+
+				readers.emplace_back(std::move(reader));
+
+				return false;
+			}
+
+		} catch (const Segfault &) {
+			result = errors::ToResult(errors::fault);
+		}
+	}
+
+	// Writers wait on the pipe instead of
+	// on a queue of their own, since the call
+	// is made again once they're woken.
+
+	if (readSize > 0)
+		writeQueue.WakeAll();
+
+	return true;
+}
+
+uint64_t Pipe::ReadSome(void *buf, uint64_t bufSize) {
+
+	uint32_t readSize = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		HostSpan span;
+		span.data = (unsigned char *) buf;
+		span.size = (uint32_t) std::min<uint64_t>(bufSize, used);
+
+		readSize = ReadSpans({ span });
+	}
+
+	if (readSize > 0)
+		writeQueue.WakeAll();
+
+	return readSize;
+}
+
+bool Pipe::Write(Process &process,
+                 CPU &cpu,
+                 MemoryMap &memoryMap,
+                 uint32_t address,
+                 uint32_t size,
+                 bool mayBlock,
+                 uint32_t &result) {
+
+	std::vector<std::shared_ptr<WaitQueue>> wakes;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (readEnds == 0) {
+			result = errors::ToResult(errors::pipe);
+			return true;
+		}
+
+		std::vector<HostSpan> spans;
+
+		try {
+			spans = memoryMap.GetReadSpans(address, size);
+		} catch (const Segfault &) {
+			result = errors::ToResult(errors::fault);
+			return true;
+		}
+
+		result = WriteSpans(spans, wakes);
+
+		if ((result == 0) && (size > 0)) {
+
+			if (!mayBlock) {
+				result = errors::ToResult(errors::again);
+			} else {
+
+				// The call is made again once there's
+				// room, so that it starts over with the
+				// state of the pipe at that time.
+
+				cpu.SetInstructionPointer(cpu.GetInstructionPointer() - 6);
+
+				process.Block(cpu, writeQueue);
+
+				return false;
+			}
+		}
+	}
+
+	WakeAll(wakes);
+
+	return true;
+}
+
+uint64_t Pipe::WriteSome(const void *buf, uint64_t bufSize) {
+
+	std::vector<std::shared_ptr<WaitQueue>> wakes;
+
+	uint32_t writeSize = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		HostSpan span;
+		span.data = (unsigned char *) buf;
+		span.size = (uint32_t) std::min<uint64_t>(bufSize, UINT32_MAX);
+
+		writeSize = WriteSpans({ span }, wakes);
+	}
+
+	WakeAll(wakes);
+
+	return writeSize;
+}
+
+uint32_t Pipe::ReadSpans(const std::vector<HostSpan> &spans) {
+
+	uint32_t readSize = 0;
+
+	for (const auto &span : spans) {
+
+		uint32_t spanOffset = 0;
+
+		while (spanOffset < span.size) {
+
+			auto length = std::min(span.size - spanOffset, capacity - readOffset);
+
+			std::memcpy(span.data + spanOffset, buffer.data() + readOffset, length);
+
+			spanOffset += length;
+
+			readOffset = (readOffset + length) % capacity;
+		}
+
+		readSize += span.size;
+	}
+
+	used -= readSize;
+
+	return readSize;
+}
+
+uint32_t Pipe::WriteSpans(const std::vector<HostSpan> &spans,
+                          std::vector<std::shared_ptr<WaitQueue>> &wakes) {
+
+	auto size = GetSize(spans);
+
+	uint32_t written = 0;
+
+	// Readers only wait while the buffer is empty,
+	// so the data goes to them first. It's copied to
+	// their memory by their own threads, when they
+	// resume, since guest memory may only be changed
+	// inside the world lock of its process.
+
+	while (!readers.empty() && (written < size)) {
+
+		auto reader = std::move(readers.front());
+
+		readers.pop_front();
+
+		// The thread of a reader whose process was
+		// rolled back may not exist anymore, and
+		// the data is left for the next reader.
+
+		auto process = reader.process.lock();
+		if ((process == nullptr) || process->Exited() || (process->GetGeneration() != reader.generation))
+			continue;
+
+		auto length = std::min(size - written, reader.size);
+
+		std::vector<unsigned char> data(length);
+
+		HostSpan span;
+		span.data = data.data();
+		span.size = length;
+
+		CopySpans(spans, written, { span });
+
+		written += length;
+
+		process->CompleteIO(reader.thread, length, reader.address, std::move(data), reader.generation);
+
+		wakes.emplace_back(reader.waitQueue);
+	}
+
+	// The rest goes into the buffer,
+	// as much as there's room for.
+
+	auto length = std::min(size - written, capacity - used);
+
+	uint32_t writeOffset = (readOffset + used) % capacity;
+
+	HostSpan first;
+	first.data = buffer.data() + writeOffset;
+	first.size = std::min(length, capacity - writeOffset);
+
+	HostSpan second;
+	second.data = buffer.data();
+	second.size = length - first.size;
+
+	if (length > 0)
+		CopySpans(spans, written, { first, second });
+
+	used += length;
+
+	return written + length;
+}
+
+PipeEnd::~PipeEnd() {
+	pipe->Close(writeEnd);
+}
+
+void PipeEnd::Read(void *buf, uint64_t bufSize) {
+	if (ReadSome(buf, bufSize) != bufSize)
+		throw Exception("Pipe does not have enough data.");
+}
+
+uint64_t PipeEnd::ReadSome(void *buf, uint64_t bufSize) {
+
+	if (writeEnd)
+		throw Exception("Pipe end may not be read from.");
+
+	return pipe->ReadSome(buf, bufSize);
+}
+
+void PipeEnd::SetPosition(uint64_t) {
+	throw Exception("Pipes do not have a position.");
+}
+
+void PipeEnd::Write(const void *buf, uint64_t bufSize) {
+
+	if (!writeEnd)
+		throw Exception("Pipe end may not be written to.");
+
+	if (pipe->WriteSome(buf, bufSize) != bufSize)
+		throw Exception("Pipe does not have room for the data.");
+}
+
+} // namespace swanson
@@ -0,0 +1,97 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "process-table-test.hpp"
+
+#include <swanson/exception.hpp>
+#include <swanson/process.hpp>
+#include <swanson/process-table.hpp>
+
+#include "assert.h"
+
+#include <memory>
+#include <vector>
+
+namespace swanson::tests {
+
+void TestProcessTable() {
+
+	ProcessTable table(4);
+
+	auto process1 = std::make_shared<Process>();
+	auto process2 = std::make_shared<Process>();
+	auto process3 = std::make_shared<Process>();
+
+	assert(table.Add(process1) == 1);
+	assert(table.Add(process2) == 2);
+	assert(table.Add(process3) == 3);
+	assert(process2->GetID() == 2);
+
+	assert(table.Find(2) == process2);
+	assert(table.Find(0) == nullptr);
+	assert(table.Find(5) == nullptr);
+	assert(table.GetLiveCount() == 3);
+
+	/* exited processes leave the live set,
+	 * but keep their ID until they're reaped */
+
+	assert(table.Exit(1));
+	assert(!table.Exit(1));
+	assert(table.GetLiveCount() == 2);
+	assert(table.GetCount() == 3);
+	assert(table.Find(1) == process1);
+
+	size_t liveCount = 0;
+	for (auto &process : table) {
+		assert(process != process1);
+		liveCount++;
+	}
+	assert(liveCount == 2);
+
+	/* reaping releases the process */
+
+	std::weak_ptr<Process> weakProcess1 = process1;
+	process1.reset();
+
+	assert(table.Reap(1));
+	assert(!table.Reap(1));
+	assert(weakProcess1.expired());
+	assert(table.Find(1) == nullptr);
+	assert(table.GetCount() == 2);
+
+	/* freed IDs are recycled before
+	 * the table grows */
+
+	assert(table.Add(std::make_shared<Process>()) == 1);
+	assert(table.Add(std::make_shared<Process>()) == 4);
+
+	auto full = false;
+	try {
+		table.Add(std::make_shared<Process>());
+	} catch (const Exception &) {
+		full = true;
+	}
+	assert(full);
+
+	/* live processes may be reaped too */
+
+	assert(table.Reap(3));
+	assert(table.GetLiveCount() == 3);
+	assert(table.Find(2) == process2);
+}
+
+} // namespace swanson::tests
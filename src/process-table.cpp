@@ -0,0 +1,107 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/process-table.hpp>
+
+#include <swanson/exception.hpp>
+#include <swanson/process.hpp>
+
+namespace swanson {
+
+ProcessTable::ProcessTable(int maxID_) : maxID(maxID_) {
+	slots.resize(1);
+	slots[0].liveIndex = notLive;
+}
+
+int ProcessTable::Add(std::shared_ptr<Process> process) {
+
+	int id = 0;
+
+	if (!freeIDs.empty()) {
+		id = freeIDs.front();
+		freeIDs.pop_front();
+	} else if (slots.size() <= (size_t) maxID) {
+		id = (int) slots.size();
+		slots.emplace_back();
+	} else {
+		throw Exception("No process IDs are left.");
+	}
+
+	auto &slot = slots[id];
+	slot.process = process;
+	slot.liveIndex = live.size();
+
+	live.emplace_back(process);
+
+	process->SetID(id);
+
+	return id;
+}
+
+bool ProcessTable::Exit(int id) {
+
+	if ((id <= 0) || ((size_t) id >= slots.size()))
+		return false;
+
+	auto &slot = slots[id];
+	if ((slot.process == nullptr) || (slot.liveIndex == notLive))
+		return false;
+
+	// The last live process takes the
+	// place of the one that exited.
+
+	auto index = slot.liveIndex;
+
+	if ((index + 1) < live.size()) {
+		live[index] = std::move(live.back());
+		slots[live[index]->GetID()].liveIndex = index;
+	}
+
+	live.pop_back();
+
+	slot.liveIndex = notLive;
+
+	return true;
+}
+
+std::shared_ptr<Process> ProcessTable::Find(int id) const noexcept {
+
+	if ((id <= 0) || ((size_t) id >= slots.size()))
+		return nullptr;
+
+	return slots[id].process;
+}
+
+size_t ProcessTable::GetCount() const noexcept {
+	return (slots.size() - 1) - freeIDs.size();
+}
+
+bool ProcessTable::Reap(int id) {
+
+	if ((id <= 0) || ((size_t) id >= slots.size()) || (slots[id].process == nullptr))
+		return false;
+
+	Exit(id);
+
+	slots[id].process = nullptr;
+
+	freeIDs.push_back(id);
+
+	return true;
+}
+
+} // namespace swanson
@@ -19,214 +19,2981 @@
 #include <swanson/process.hpp>
 
 #include <swanson/bad-instruction.hpp>
+#include <swanson/console.hpp>
 #include <swanson/cpu.hpp>
 #include <swanson/elf.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/host-mapping.hpp>
+#include <swanson/image-cache.hpp>
 #include <swanson/interrupt-handler.hpp>
+#include <swanson/io-workers.hpp>
+#include <swanson/memory-limit.hpp>
 #include <swanson/memory-map.hpp>
 #include <swanson/memory-section.hpp>
+#include <swanson/memory-usage.hpp>
+#include <swanson/mman.hpp>
+#include <swanson/pipe.hpp>
 #include <swanson/segfault.hpp>
+#include <swanson/stream.hpp>
+#include <swanson/syscall-stats.hpp>
 #include <swanson/syscalls.hpp>
 #include <swanson/thread.hpp>
+#include <swanson/thread-pool.hpp>
+#include <swanson/vfs.hpp>
+#include <swanson/wait-queue.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 namespace {
 
+/// Identifies a checkpoint record.
+/// These are the bytes "SWCP".
+constexpr uint32_t checkpointMagic = 0x50435753;
+
+/// The version of the checkpoint format.
+constexpr uint32_t checkpointVersion = 1;
+
+/// The role of a memory section, as
+/// stored in a checkpoint record.
+enum class SectionKind : uint8_t {
+	Other = 0,
+	Arguments = 1,
+	Heap = 2,
+	Mapping = 3,
+	Time = 4
+};
+
+void WriteU8(std::ostream &stream, uint8_t value) {
+	stream.put((char) value);
+}
+
+void WriteU32(std::ostream &stream, uint32_t value) {
+	unsigned char buf[4];
+	buf[0] = (value >> 0x00) & 0xff;
+	buf[1] = (value >> 0x08) & 0xff;
+	buf[2] = (value >> 0x10) & 0xff;
+	buf[3] = (value >> 0x18) & 0xff;
+	stream.write((const char *) buf, sizeof(buf));
+}
+
+void WriteU64(std::ostream &stream, uint64_t value) {
+	WriteU32(stream, (uint32_t) (value & 0xffffffff));
+	WriteU32(stream, (uint32_t) (value >> 32));
+}
+
+void ReadBytes(std::istream &stream, void *buf, uint32_t size) {
+	if (!stream.read((char *) buf, size))
+		throw swanson::Exception("Checkpoint is truncated.");
+}
+
+uint8_t ReadU8(std::istream &stream) {
+	uint8_t value = 0;
+	ReadBytes(stream, &value, 1);
+	return value;
+}
+
+uint32_t ReadU32(std::istream &stream) {
+	unsigned char buf[4];
+	ReadBytes(stream, buf, sizeof(buf));
+	uint32_t value = 0;
+	value |= ((uint32_t) buf[0]) << 0x00;
+	value |= ((uint32_t) buf[1]) << 0x08;
+	value |= ((uint32_t) buf[2]) << 0x10;
+	value |= ((uint32_t) buf[3]) << 0x18;
+	return value;
+}
+
+uint64_t ReadU64(std::istream &stream) {
+	uint64_t low = ReadU32(stream);
+	uint64_t high = ReadU32(stream);
+	return low | (high << 32);
+}
+
+/// Indicates whether or not a range
+/// of memory contains only zeros.
+bool IsZero(const unsigned char *data, uint32_t size) noexcept {
+	for (uint32_t i = 0; i < size; i++) {
+		if (data[i] != 0)
+			return false;
+	}
+	return true;
+}
+
+/// Rounds a size up to a multiple
+/// of the guest page size.
+uint64_t PageAlign(uint64_t size) noexcept {
+	auto pageSize = swanson::mman::page_size;
+	return ((size + (pageSize - 1)) / pageSize) * pageSize;
+}
+
+/// Reads the contents of a mapping from a
+/// stream that can't be mapped. Reads stop
+/// at the end of the stream, which leaves the
+/// rest of the buffer as it was (zero filled.)
+/// The position of the stream is put back, since
+/// mapping a file doesn't move its offset.
+/// @returns False if the stream failed.
+bool ReadMapping(swanson::Stream &stream, uint64_t offset, std::vector<unsigned char> &contents) {
+
+	// Streams without a position,
+	// like pipes, are just read.
+
+	auto hasPosition = false;
+
+	uint64_t position = 0;
+
+	try {
+		position = stream.GetPosition();
+		hasPosition = true;
+	} catch (...) {
+	}
+
+	auto succeeded = true;
+
+	try {
+
+		stream.SetPosition(offset);
+
+		uint64_t readSize = 0;
+
+		while (readSize < contents.size()) {
+			auto n = stream.ReadSome(contents.data() + readSize, contents.size() - readSize);
+			if (n == 0)
+				break;
+			readSize += n;
+		}
+
+	} catch (...) {
+		succeeded = false;
+	}
+
+	if (hasPosition) {
+		try {
+			stream.SetPosition(position);
+		} catch (...) {
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
+
+/// The address of the command line
+/// arguments. They're at the bottom of
+/// memory, below the program image.
+constexpr uint32_t argumentAddress = 0x04;
+
+/// The most bytes of command line arguments
+/// that execve accepts, strings included.
+constexpr uint32_t maxArgumentSize = 128 * 1024;
+
+/// Computes the size of the section that
+/// holds a list of command line arguments.
+uint64_t GetArgumentSize(const std::vector<std::string> &args) noexcept {
+
+	/* argc, argv, argv[0..argc] */
+	uint64_t size = 4 + 4 + ((args.size() + 1) * 4);
+
+	for (const auto &arg : args)
+		size += arg.size() + 1;
+
+	return size;
+}
+
+/// Creates the section that holds the command
+/// line arguments. It starts with argc and argv,
+/// followed by the argv array and then the strings
+/// that the array points to.
+std::shared_ptr<swanson::MemorySection> MakeArgumentSection(const std::vector<std::string> &args) {
+
+	auto section = std::make_shared<swanson::MemorySection>();
+	section->Resize(GetArgumentSize(args));
+	section->SetAddress(argumentAddress);
+
+	uint32_t argvAddress = argumentAddress + 8;
+	uint32_t stringAddress = argvAddress + ((args.size() + 1) * 4);
+
+	section->Write32(argumentAddress, args.size());
+	section->Write32(argumentAddress + 4, argvAddress);
+
+	for (decltype(args.size()) i = 0; i < args.size(); i++) {
+		section->Write32(argvAddress + (i * 4), stringAddress);
+		section->CopyData(stringAddress - argumentAddress, args[i].data(), args[i].size());
+		stringAddress += args[i].size() + 1;
+	}
+
+	section->Write32(argvAddress + (args.size() * 4), 0x00);
+
+	section->AllowRead(true);
+	section->AllowWrite(true);
+	section->AllowExecute(false);
+
+	return section;
+}
+
+/// Gets the role of a memory section, for
+/// writing it to a checkpoint or a snapshot.
+SectionKind GetSectionKind(const std::shared_ptr<swanson::MemorySection> &section,
+                           const std::shared_ptr<swanson::MemorySection> &argumentSection,
+                           const std::shared_ptr<swanson::MemorySection> &heapSection,
+                           const std::shared_ptr<swanson::MemorySection> &timeSection,
+                           const std::vector<std::shared_ptr<swanson::MemorySection>> &mappings) {
+
+	if (section == argumentSection)
+		return SectionKind::Arguments;
+	else if (section == heapSection)
+		return SectionKind::Heap;
+	else if (section == timeSection)
+		return SectionKind::Time;
+	else if (std::find(mappings.begin(), mappings.end(), section) != mappings.end())
+		return SectionKind::Mapping;
+	else
+		return SectionKind::Other;
+}
+
+/// Gets the permissions of a memory section,
+/// for writing it to a checkpoint or a snapshot.
+uint8_t GetPermissions(const swanson::MemorySection &section) noexcept {
+
+	uint8_t permissions = 0;
+
+	if (section.ReadAllowed())
+		permissions |= swanson::mman::prot_read;
+	if (section.WriteAllowed())
+		permissions |= swanson::mman::prot_write;
+	if (section.ExecuteAllowed())
+		permissions |= swanson::mman::prot_exec;
+
+	return permissions;
+}
+
+/// Gets the time of day from the host.
+/// @param seconds Set to the seconds since the epoch.
+/// @param microseconds Set to the microseconds
+/// within the current second.
+void GetHostTime(uint32_t &seconds, uint32_t &microseconds) {
+
+	auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+
+	auto totalMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count();
+
+	seconds = (uint32_t) (totalMicroseconds / 1000000);
+	microseconds = (uint32_t) (totalMicroseconds % 1000000);
+}
+
+/// Writes the state of a thread's CPU.
+void WriteCPU(std::ostream &stream, const swanson::CPU &cpu) {
+
+	for (uint32_t i = 0; i < 18; i++)
+		WriteU32(stream, cpu.GetRegister(i));
+
+	for (uint32_t i = 0; i < 256; i++)
+		WriteU32(stream, cpu.GetSpecialRegister(i));
+
+	WriteU32(stream, cpu.GetCondition());
+	WriteU64(stream, cpu.GetInstructionCount());
+}
+
+/// Reads the state of a thread's CPU.
+void ReadCPU(std::istream &stream, swanson::CPU &cpu) {
+
+	for (uint32_t i = 0; i < 18; i++)
+		cpu.SetRegister(i, ReadU32(stream));
+
+	for (uint32_t i = 0; i < 256; i++)
+		cpu.SetSpecialRegister(i, ReadU32(stream));
+
+	cpu.SetCondition(ReadU32(stream));
+	cpu.SetInstructionCount(ReadU64(stream));
+}
+
 class InterruptHandler final : public swanson::InterruptHandler {
 	swanson::Process &process;
+	/// Set while a batch of calls is run. I/O
+	/// isn't given to the I/O workers then, since
+	/// the batch writes each result as it goes.
+	bool inBatch;
 public:
-	InterruptHandler(swanson::Process &process_) noexcept : process(process_) {
+	InterruptHandler(swanson::Process &process_) noexcept : process(process_), inBatch(false) {
 	}
 	~InterruptHandler() {
 	}
-	void HandleSyscall(swanson::CPU &cpu, uint32_t type) {
+	/// Indicates whether or not a batch
+	/// of calls is being run.
+	bool InBatch() const noexcept { return inBatch; }
+	void HandleSyscall(swanson::CPU &cpu, uint32_t type);
+	/// Handles one kind of system call.
+	using Method = void (InterruptHandler::*)(swanson::CPU &, swanson::MemoryMap &);
+	/// Run the handler of a system call and count
+	/// it. The system call mutex must be held.
+	/// @param cpu The CPU of the calling thread.
+	/// @param memoryMap The memory map of the process.
+	/// @param type The system call number.
+	/// @returns False if the number has no handler.
+	bool Dispatch(swanson::CPU &cpu, swanson::MemoryMap &memoryMap, uint32_t type);
+	/// Build the table of built in system
+	/// call handlers, indexed by system call
+	/// number. Unknown numbers are left empty.
+	/// @returns The table of handlers.
+	static constexpr std::array<Method, swanson::syscalls::tableSize> MakeSyscallTable() {
+
+		using namespace swanson;
+
+		std::array<Method, syscalls::tableSize> table { };
+
+		table[syscalls::exit] = &InterruptHandler::HandleExit;
+		table[syscalls::open] = &InterruptHandler::HandleOpen;
+		table[syscalls::close] = &InterruptHandler::HandleClose;
+		table[syscalls::read] = &InterruptHandler::HandleRead;
+		table[syscalls::write] = &InterruptHandler::HandleWrite;
+		table[syscalls::lseek] = &InterruptHandler::HandleLseek;
+		table[syscalls::fstat] = &InterruptHandler::HandleFstat;
+		table[syscalls::sbrk] = &InterruptHandler::HandleSbrk;
+		table[syscalls::time] = &InterruptHandler::HandleTime;
+		table[syscalls::gettimeofday] = &InterruptHandler::HandleGettimeofday;
+		table[syscalls::times] = &InterruptHandler::HandleTimes;
+		table[syscalls::execve] = &InterruptHandler::HandleExecve;
+		table[syscalls::fork] = &InterruptHandler::HandleFork;
+		table[syscalls::mmap] = &InterruptHandler::HandleMmap;
+		table[syscalls::munmap] = &InterruptHandler::HandleMunmap;
+		table[syscalls::mprotect] = &InterruptHandler::HandleMprotect;
+		table[syscalls::snapshot] = &InterruptHandler::HandleSnapshot;
+		table[syscalls::batch] = &InterruptHandler::HandleBatch;
+		table[syscalls::pipe] = &InterruptHandler::HandlePipe;
+
+		return table;
+	}
+protected:
+	void HandleBatch(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		auto addr = cpu.GetRegister(2);
+		auto count = cpu.GetRegister(3);
+		auto flags = cpu.GetRegister(4);
+
+		if ((count > syscalls::batch_max) || ((flags & ~syscalls::batch_stop_on_error) != 0)) {
+			cpu.SetRegister(2, errors::ToResult(errors::inval));
+			return;
+		}
+
+		// The calls take their arguments from
+		// the registers, so the ones that the
+		// batch doesn't return in are put back.
+
+		uint32_t savedRegisters[5];
+		for (uint32_t i = 0; i < 5; i++)
+			savedRegisters[i] = cpu.GetRegister(i + 3);
+
+		auto thread = process.FindThread(cpu);
+
+		uint32_t result = 0;
+
+		inBatch = true;
+
+		try {
+
+			for (uint32_t i = 0; i < count; i++) {
+
+				auto entry = addr + (i * syscalls::batch_entry_words * 4);
+
+				auto type = memoryMap.Read32(entry);
+
+				for (uint32_t arg = 0; arg < 6; arg++)
+					cpu.SetRegister(arg + 2, memoryMap.Read32(entry + ((arg + 1) * 4)));
+
+				if ((type == syscalls::batch)
+				 || (type == syscalls::execve)
+				 || (type == syscalls::fork)
+				 || (type == syscalls::snapshot))
+					cpu.SetRegister(2, errors::ToResult(errors::inval));
+				else if (!Dispatch(cpu, memoryMap, type))
+					cpu.SetRegister(2, errors::ToResult(errors::nosys));
+
+				auto callResult = cpu.GetRegister(2);
+
+				memoryMap.Write32(entry + 28, callResult);
+
+				result = i + 1;
+
+				if (process.Exited() || ((thread != nullptr) && thread->IsBlocked()))
+					break;
+
+				if ((flags & syscalls::batch_stop_on_error) && errors::IsError(callResult))
+					break;
+			}
+
+		} catch (const Segfault &) {
+			result = errors::ToResult(errors::fault);
+		} catch (...) {
+			inBatch = false;
+			throw;
+		}
+
+		inBatch = false;
+
+		for (uint32_t i = 0; i < 5; i++)
+			cpu.SetRegister(i + 3, savedRegisters[i]);
+
+		cpu.SetRegister(2, result);
+	}
+	void HandleClose(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		auto fd = cpu.GetRegister(2);
+
+		// The standard streams have
+		// nothing to close, currently.
+		if (fd <= 2) {
+			cpu.SetRegister(2, 0);
+			return;
+		}
+
+		if (!process.RemoveStream(fd))
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::badf));
+		else
+			cpu.SetRegister(2, 0);
+	}
+	void HandleFstat(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		auto fd = cpu.GetRegister(2);
+		auto addr = cpu.GetRegister(3);
+
+		auto stream = process.GetStream(fd);
+
+		if ((stream == nullptr) && (fd > 2)) {
+			cpu.SetRegister(2, errors::ToResult(errors::badf));
+			return;
+		}
+
+		// Streams without a size are described as
+		// character devices, like the host's streams.
+
+		uint32_t mode = syscalls::stat_type_character | 0666;
+		uint64_t size = 0;
+
+		if (std::dynamic_pointer_cast<PipeEnd>(stream) != nullptr) {
+			mode = syscalls::stat_type_fifo | 0600;
+		} else if ((stream != nullptr) && (std::dynamic_pointer_cast<ConsoleStream>(stream) == nullptr)) {
+			try {
+				size = stream->GetSize();
+				mode = syscalls::stat_type_regular | 0644;
+			} catch (const Exception &) {
+			} catch (...) {
+				cpu.SetRegister(2, errors::ToResult(errors::io));
+				return;
+			}
+		}
+
+		try {
+			memoryMap.GetWriteSpans(addr, syscalls::stat_words * 4);
+			memoryMap.Write32(addr, mode);
+			memoryMap.Write32(addr + 4, (uint32_t) (size >> 32));
+			memoryMap.Write32(addr + 8, (uint32_t) size);
+			memoryMap.Write32(addr + 12, syscalls::stat_block_size);
+		} catch (const Segfault &) {
+			cpu.SetRegister(2, errors::ToResult(errors::fault));
+			return;
+		}
+
+		cpu.SetRegister(2, 0);
+	}
+	void HandleLseek(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		using namespace swanson;
+
+		auto fd = cpu.GetRegister(2);
+		auto offset = (int32_t) cpu.GetRegister(3);
+		auto whence = cpu.GetRegister(4);
+
+		auto stream = process.GetStream(fd);
+
+		if ((stream == nullptr) && (fd > 2)) {
+			cpu.SetRegister(2, errors::ToResult(errors::badf));
+			return;
+		} else if ((stream == nullptr)
+		        || (std::dynamic_pointer_cast<PipeEnd>(stream) != nullptr)
+		        || (std::dynamic_pointer_cast<ConsoleStream>(stream) != nullptr)) {
+			cpu.SetRegister(2, errors::ToResult(errors::spipe));
+			return;
+		}
+
+		uint32_t result = 0;
+
+		try {
+
+			int64_t origin = 0;
+
+			if (whence == syscalls::seek_cur)
+				origin = (int64_t) stream->GetPosition();
+			else if (whence == syscalls::seek_end)
+				origin = (int64_t) stream->GetSize();
+			else if (whence != syscalls::seek_set)
+				origin = -1;
+
+			auto position = origin + offset;
+
+			if ((origin < 0) || (position < 0)) {
+				result = errors::ToResult(errors::inval);
+			} else if (position > INT32_MAX) {
+				result = errors::ToResult(errors::overflow);
+			} else {
+				stream->SetPosition((uint64_t) position);
+				result = (uint32_t) position;
+			}
+		} catch (const Exception &) {
+			// Only seekable streams
+			// have a position.
+			result = errors::ToResult(errors::spipe);
+		} catch (...) {
+			result = errors::ToResult(errors::io);
+		}
+
+		cpu.SetRegister(2, result);
+	}
+	void HandleOpen(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		std::string path;
+
+		uint32_t pathSize = 0;
+
+		auto error = ReadString(memoryMap, cpu.GetRegister(2), path, pathSize);
+		if (error != 0) {
+			cpu.SetRegister(2, errors::ToResult(error));
+			return;
+		}
+
+		auto flags = cpu.GetRegister(3);
+
+		auto access = flags & syscalls::open_access_mask;
+		if (access == syscalls::open_access_mask) {
+			cpu.SetRegister(2, errors::ToResult(errors::inval));
+			return;
+		}
+
+		uint32_t mode = 0;
+
+		if (access != syscalls::open_write_only)
+			mode |= vfs::modes::read;
+		if (access != syscalls::open_read_only)
+			mode |= vfs::modes::write;
+		if (flags & syscalls::open_append)
+			mode |= vfs::modes::append;
+		if (!(flags & syscalls::open_truncate))
+			mode |= vfs::modes::notrunc;
+		if (flags & syscalls::open_create)
+			mode |= vfs::modes::create;
+		if (flags & syscalls::open_exclusive)
+			mode |= vfs::modes::exclusive;
+
+		auto fs = process.GetRootFS();
+		if (fs == nullptr) {
+			cpu.SetRegister(2, errors::ToResult(errors::noent));
+			return;
+		}
+
+		std::shared_ptr<Stream> stream;
+
+		ExitCode exitCode = ExitCode::EntryMissing;
+
+		try {
+			exitCode = fs->OpenFile(path, mode, stream);
+		} catch (...) {
+			cpu.SetRegister(2, errors::ToResult(errors::io));
+			return;
+		}
+
+		if ((exitCode == ExitCode::Success) && (stream != nullptr))
+			cpu.SetRegister(2, (uint32_t) process.AddStream(stream));
+		else if (exitCode == ExitCode::EntryExists)
+			cpu.SetRegister(2, errors::ToResult(errors::exist));
+		else if (exitCode == ExitCode::InvalidArgument)
+			cpu.SetRegister(2, errors::ToResult(errors::inval));
+		else
+			cpu.SetRegister(2, errors::ToResult(errors::noent));
+	}
+	void HandleExecve(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		// The environment isn't passed on,
+		// since processes don't have one yet.
+
+		std::string path;
+		std::vector<std::string> args;
+
+		uint32_t argumentSize = 0;
+
+		auto error = ReadString(memoryMap, cpu.GetRegister(2), path, argumentSize);
+		if (error == 0)
+			error = ReadArguments(memoryMap, cpu.GetRegister(3), args, argumentSize);
+
+		if (error != 0) {
+			cpu.SetRegister(2, errors::ToResult(error));
+			return;
+		}
+
+		// Threads can only be added by the host,
+		// so only processes with one thread exec.
+
+		if (process.GetThreadCount() != 1) {
+			cpu.SetRegister(2, errors::ToResult(errors::inval));
+			return;
+		}
+
+		auto fs = process.GetRootFS();
+		if (fs == nullptr) {
+			cpu.SetRegister(2, errors::ToResult(errors::noent));
+			return;
+		}
+
+		std::shared_ptr<Stream> stream;
+
+		ExitCode exitCode = ExitCode::EntryMissing;
+
+		try {
+			exitCode = fs->OpenFile(path, vfs::modes::read, stream);
+		} catch (...) {
+			cpu.SetRegister(2, errors::ToResult(errors::io));
+			return;
+		}
+
+		if ((exitCode != ExitCode::Success) || (stream == nullptr)) {
+			cpu.SetRegister(2, errors::ToResult(errors::noent));
+			return;
+		}
+
+		auto imageCache = process.GetImageCache();
+		if (imageCache == nullptr)
+			imageCache = std::make_shared<ImageCache>();
+
+		std::shared_ptr<const elf::File> image;
+
+		try {
+			image = imageCache->Load(path, *stream);
+		} catch (...) {
+			cpu.SetRegister(2, errors::ToResult(errors::io));
+			return;
+		}
+
+		if (image == nullptr) {
+			cpu.SetRegister(2, errors::ToResult(errors::noexec));
+			return;
+		}
+
+		WorldStop worldStop(process.GetWorldLock(), true);
+
+		// There's nothing to return to
+		// once the new image is running.
+
+		auto execError = process.Exec(image, args, cpu);
+		if (execError != 0)
+			cpu.SetRegister(2, errors::ToResult(execError));
+	}
+	void HandleExit(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		// exit code in r0
+		auto exitCode = cpu.GetRegister(2);
+
+		process.Exit(exitCode);
+	}
+	void HandleFork(swanson::CPU &, swanson::MemoryMap &) {
+		throw swanson::Exception("Syscall 'fork' not implemented");
+	}
+	void HandleSbrk(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		auto increment = (int32_t) cpu.GetRegister(2);
+
+		swanson::WorldStop worldStop(process.GetWorldLock(), true);
+
+		auto programBreak = process.GetProgramBreak();
+
+		if (!process.SetProgramBreak(programBreak + increment)) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nomem));
+			return;
+		}
+
+		// return the previous break
+		cpu.SetRegister(2, programBreak);
+	}
+	void HandleMmap(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson::mman;
+
+		auto addr = cpu.GetRegister(2);
+		auto length = PageAlign(cpu.GetRegister(3));
+		auto prot = cpu.GetRegister(4);
+		auto flags = cpu.GetRegister(5);
+		auto fd = cpu.GetRegister(6);
+		auto offset = cpu.GetRegister(7);
+
+		auto shared = (flags & map_shared) != 0;
+		auto writable = (prot & prot_write) != 0;
+
+		if ((length == 0)
+		 || (length > UINT32_MAX)
+		 || (shared == ((flags & map_private) != 0))
+		 || ((offset % page_size) != 0)) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::inval));
+			return;
+		}
+
+		swanson::WorldStop worldStop(process.GetWorldLock(), true);
+
+		if (!memoryMap.GetUsage()->CanCommit(length)) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nomem));
+			return;
+		}
+
+		if (flags & map_fixed) {
+			if (((addr % page_size) != 0)
+			 || ((addr + length) > (UINT64_C(1) << 32))
+			 || memoryMap.Overlaps(addr, length)) {
+				cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::inval));
+				return;
+			}
+		} else {
+			try {
+				addr = memoryMap.FindAddress(length);
+			} catch (...) {
+				cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nomem));
+				return;
+			}
+		}
+
+		auto section = std::make_shared<swanson::MemorySection>();
+		section->SetAddress(addr);
+
+		// Nothing is mapped for the guest until
+		// the section is added, so a failure part
+		// of the way through is reported as an
+		// error instead of faulting the process.
+
+		try {
+			if (flags & map_anonymous) {
+				// Host pages are only committed
+				// once the guest touches them.
+				section->Map(swanson::HostMapping::MapAnonymous(length));
+			} else {
+
+				auto stream = process.GetStream(fd);
+				if (stream == nullptr) {
+					cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::badf));
+					return;
+				}
+
+				std::shared_ptr<swanson::HostMapping> mapping;
+
+				try {
+					mapping = stream->Map(offset, length, writable, shared);
+				} catch (...) {
+					// The host refused to map
+					// the file the way it was asked.
+					cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::acces));
+					return;
+				}
+
+				if (mapping != nullptr) {
+					section->Map(mapping);
+				} else if (shared && writable) {
+					// Without a host mapping, writes
+					// can't be carried through to the stream.
+					cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nodev));
+					return;
+				} else {
+					// Streams that can't be mapped have
+					// their contents copied instead. The
+					// part past the end of the stream
+					// reads as zeros.
+					std::vector<unsigned char> contents(length);
+					if (!ReadMapping(*stream, offset, contents)) {
+						cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::io));
+						return;
+					}
+					section->CopyData(contents);
+				}
+			}
+
+			section->AllowRead((prot & prot_read) != 0);
+			section->AllowWrite(writable);
+			section->AllowExecute((prot & prot_exec) != 0);
+
+			process.AddMapping(section);
+
+		} catch (...) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nomem));
+			return;
+		}
+
+		cpu.SetRegister(2, addr);
+	}
+	void HandleMunmap(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		auto addr = cpu.GetRegister(2);
+		auto length = PageAlign(cpu.GetRegister(3));
+
+		swanson::WorldStop worldStop(process.GetWorldLock(), true);
+
+		if ((length > UINT32_MAX) || !process.RemoveMapping(addr, length))
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::inval));
+		else
+			cpu.SetRegister(2, 0);
+	}
+	void HandleMprotect(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson::mman;
+
+		auto addr = cpu.GetRegister(2);
+		auto length = PageAlign(cpu.GetRegister(3));
+		auto prot = cpu.GetRegister(4);
+
+		swanson::WorldStop worldStop(process.GetWorldLock(), true);
+
+		auto section = memoryMap.FindSection(addr);
+
+		// The protection of part of a
+		// section can't be changed.
+
+		if ((section == nullptr)
+		 || (section->GetAddress() != addr)
+		 || (PageAlign(section->GetSize()) != length)) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::inval));
+			return;
+		}
+
+		auto mapping = section->GetMapping();
+
+		if ((prot & prot_write) && (mapping != nullptr) && !mapping->IsWritable()) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::acces));
+			return;
+		}
+
+		section->AllowRead((prot & prot_read) != 0);
+		section->AllowWrite((prot & prot_write) != 0);
+		section->AllowExecute((prot & prot_exec) != 0);
+
+		cpu.SetRegister(2, 0);
+	}
+	void HandleSnapshot(swanson::CPU &cpu, swanson::MemoryMap &) {
+
+		// The kernel sets the result to one
+		// in the snapshot, and back to zero
+		// once it's written.
+
+		cpu.SetRegister(2, 0);
+
+		if (!process.RequestSnapshot(cpu))
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::nosys));
+	}
+	void HandleTime(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		uint32_t seconds = 0;
+		uint32_t microseconds = 0;
+
+		GetHostTime(seconds, microseconds);
+
+		auto addr = cpu.GetRegister(2);
+
+		try {
+			if (addr != 0)
+				memoryMap.Write32(addr, seconds);
+		} catch (const swanson::Segfault &) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::fault));
+			return;
+		}
+
+		cpu.SetRegister(2, seconds);
+	}
+	void HandleGettimeofday(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		uint32_t seconds = 0;
+		uint32_t microseconds = 0;
+
+		GetHostTime(seconds, microseconds);
+
+		// The time zone argument is obsolete,
+		// so it's left alone.
+
+		auto addr = cpu.GetRegister(2);
+
+		try {
+			if (addr != 0) {
+				memoryMap.Write32(addr, seconds);
+				memoryMap.Write32(addr + 4, microseconds);
+			}
+		} catch (const swanson::Segfault &) {
+			cpu.SetRegister(2, swanson::errors::ToResult(swanson::errors::fault));
+			return;
+		}
+
+		cpu.SetRegister(2, 0);
+	}
+	void HandleTimes(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		uint32_t seconds = 0;
+		uint32_t microseconds = 0;
+
+		GetHostTime(seconds, microseconds);
+
+		// All of the time spent running the process
+		// is counted as user time, and the time of
+		// child processes isn't known here.
+
+		uint64_t nanosecondsPerTick = 1000000000 / syscalls::times_ticks_per_second;
+
+		auto userTicks = (uint32_t) (process.GetCPUTime() / nanosecondsPerTick);
+
+		auto addr = cpu.GetRegister(2);
+
+		try {
+			memoryMap.Write32(addr, userTicks);
+			memoryMap.Write32(addr + 4, 0);
+			memoryMap.Write32(addr + 8, 0);
+			memoryMap.Write32(addr + 12, 0);
+		} catch (const Segfault &) {
+			cpu.SetRegister(2, errors::ToResult(errors::fault));
+			return;
+		}
+
+		uint64_t ticks = ((uint64_t) seconds * syscalls::times_ticks_per_second)
+		               + (microseconds / (1000000 / syscalls::times_ticks_per_second));
+
+		cpu.SetRegister(2, (uint32_t) ticks);
+	}
+	void HandlePipe(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		auto addr = cpu.GetRegister(2);
+
+		// The array is checked before the
+		// pipe is opened, so that a bad address
+		// doesn't leave descriptors behind.
+
+		try {
+			memoryMap.GetWriteSpans(addr, 8);
+		} catch (const Segfault &) {
+			cpu.SetRegister(2, errors::ToResult(errors::fault));
+			return;
+		}
+
+		auto ends = Pipe::Create();
+
+		memoryMap.Write32(addr, (uint32_t) process.AddStream(ends.first));
+		memoryMap.Write32(addr + 4, (uint32_t) process.AddStream(ends.second));
+
+		cpu.SetRegister(2, 0);
+	}
+	void HandleRead(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		auto fd = cpu.GetRegister(2);
+		auto bufAddr = cpu.GetRegister(3);
+		auto bufSize = cpu.GetRegister(4);
+
+		if (bufSize > INT32_MAX)
+			bufSize = INT32_MAX;
+
+		auto stream = process.GetStream(fd);
+		if (stream == nullptr) {
+			cpu.SetRegister(2, errors::ToResult(errors::badf));
+			return;
+		}
+
+		// Pipes are read straight into guest
+		// memory, and wait on the scheduler
+		// instead of on an I/O worker.
+
+		auto pipeEnd = std::dynamic_pointer_cast<PipeEnd>(stream);
+		if (pipeEnd != nullptr) {
+
+			uint32_t result = errors::ToResult(errors::badf);
+
+			if (!pipeEnd->IsWriteEnd() && !pipeEnd->GetPipe()->Read(process, cpu, memoryMap, bufAddr, bufSize, !inBatch, result))
+				return;
+
+			cpu.SetRegister(2, result);
+			return;
+		}
+
+		// The buffer is checked up front, which
+		// also bounds what's allocated on the host
+		// by the memory that the guest has.
+
+		std::vector<HostSpan> spans;
+
+		try {
+			spans = memoryMap.GetWriteSpans(bufAddr, bufSize);
+		} catch (const Segfault &) {
+			cpu.SetRegister(2, errors::ToResult(errors::fault));
+			return;
+		}
+
+		if (process.CanOffloadIO()) {
+
+			// The guest memory may change while the
+			// read is in progress, so the worker reads
+			// into a buffer that's copied in afterwards.
+
+			auto readStream = [stream, bufSize](std::vector<unsigned char> &data) {
+				data.resize(bufSize);
+				data.resize(stream->ReadSome(data.data(), bufSize));
+				return (uint32_t) data.size();
+			};
+
+			process.SubmitIO(cpu, stream, bufAddr, readStream);
+			return;
+		}
+
+		// Otherwise, the stream reads straight
+		// into guest memory. A short read ends it.
+
+		uint32_t result = 0;
+
+		try {
+			for (const auto &span : spans) {
+				auto readSize = stream->ReadSome(span.data, span.size);
+				result += (uint32_t) readSize;
+				if (readSize < span.size)
+					break;
+			}
+		} catch (...) {
+			result = errors::ToResult(errors::io);
+		}
+
+		cpu.SetRegister(2, result);
+	}
+	void HandleWrite(swanson::CPU &cpu, swanson::MemoryMap &memoryMap) {
+
+		using namespace swanson;
+
+		auto fd = cpu.GetRegister(2);
+		auto bufAddr = cpu.GetRegister(3);
+		auto bufSize = cpu.GetRegister(4);
+
+		if (bufSize > INT32_MAX)
+			bufSize = INT32_MAX;
+
+		// The standard streams go to the host's,
+		// unless the host opened something else there.
+
+		auto stream = process.GetStream(fd);
+
+		if ((stream == nullptr) && (fd == 1)) {
+			WriteStdout(memoryMap, bufAddr, bufSize);
+			// return bytes written
+			cpu.SetRegister(2, bufSize);
+			return;
+		} else if ((stream == nullptr) && (fd == 2)) {
+			WriteStderr(memoryMap, bufAddr, bufSize);
+			// return bytes written
+			cpu.SetRegister(2, bufSize);
+			return;
+		} else if (stream == nullptr) {
+			cpu.SetRegister(2, errors::ToResult(errors::badf));
+			return;
+		}
+
+		auto pipeEnd = std::dynamic_pointer_cast<PipeEnd>(stream);
+		if (pipeEnd != nullptr) {
+
+			uint32_t result = errors::ToResult(errors::badf);
+
+			if (pipeEnd->IsWriteEnd() && !pipeEnd->GetPipe()->Write(process, cpu, memoryMap, bufAddr, bufSize, !inBatch, result))
+				return;
+
+			cpu.SetRegister(2, result);
+			return;
+		}
+
+		// Console streams only add to a buffer,
+		// so they're written straight from guest
+		// memory and never given to the I/O workers.
+
+		auto consoleStream = std::dynamic_pointer_cast<ConsoleStream>(stream);
+		if (consoleStream != nullptr) {
+			try {
+				for (const auto &span : memoryMap.GetReadSpans(bufAddr, bufSize))
+					consoleStream->Write(span.data, span.size);
+			} catch (const Segfault &) {
+				cpu.SetRegister(2, errors::ToResult(errors::fault));
+				return;
+			}
+			cpu.SetRegister(2, bufSize);
+			return;
+		}
+
+		std::vector<HostSpan> spans;
+
+		try {
+			spans = memoryMap.GetReadSpans(bufAddr, bufSize);
+		} catch (const Segfault &) {
+			cpu.SetRegister(2, errors::ToResult(errors::fault));
+			return;
+		}
+
+		if (process.CanOffloadIO()) {
+
+			// The data is copied out of guest memory
+			// now, since the guest may change it while
+			// the write is in progress.
+
+			auto data = std::make_shared<std::vector<unsigned char>>();
+			data->reserve(bufSize);
+
+			for (const auto &span : spans)
+				data->insert(data->end(), span.data, span.data + span.size);
+
+			auto writeStream = [stream, data](std::vector<unsigned char> &) {
+				stream->Write(data->data(), data->size());
+				return (uint32_t) data->size();
+			};
+
+			process.SubmitIO(cpu, stream, bufAddr, writeStream);
+			return;
+		}
+
+		// Otherwise, the stream is written
+		// straight from guest memory.
+
+		try {
+			for (const auto &span : spans)
+				stream->Write(span.data, span.size);
+			cpu.SetRegister(2, bufSize);
+		} catch (...) {
+			cpu.SetRegister(2, errors::ToResult(errors::io));
+		}
+	}
+	/// Read the argv array of execve. Each string
+	/// is added to the size of the arguments.
+	/// @returns Zero on success, or an error number.
+	uint32_t ReadArguments(swanson::MemoryMap &memoryMap, uint32_t addr, std::vector<std::string> &args, uint32_t &argumentSize) {
+
+		for (;;) {
+
+			uint32_t argAddress = 0;
+
+			try {
+				argAddress = memoryMap.Read32(addr);
+			} catch (const swanson::Segfault &) {
+				return swanson::errors::fault;
+			}
+
+			if (argAddress == 0)
+				return 0;
+
+			std::string arg;
+
+			auto error = ReadString(memoryMap, argAddress, arg, argumentSize);
+			if (error != 0)
+				return error;
+
+			args.emplace_back(std::move(arg));
+
+			addr += 4;
+		}
+	}
+	/// Read a null terminated string from
+	/// guest memory, for execve. The string is
+	/// added to the size of the arguments.
+	/// @returns Zero on success, or an error number.
+	uint32_t ReadString(swanson::MemoryMap &memoryMap, uint32_t addr, std::string &str, uint32_t &argumentSize) {
+
+		try {
+			for (;;) {
+
+				if (argumentSize >= maxArgumentSize)
+					return swanson::errors::toobig;
+
+				argumentSize++;
+
+				auto c = memoryMap.Read8(addr++);
+				if (c == 0)
+					return 0;
+
+				str.push_back((char) c);
+			}
+		} catch (const swanson::Segfault &) {
+			return swanson::errors::fault;
+		}
+	}
+	void WriteStdout(swanson::MemoryMap &memoryMap, uint32_t addr, uint32_t size) {
+
+		for (const auto &span : memoryMap.GetReadSpans(addr, size))
+			std::cout.write((const char *) span.data, span.size);
+	}
+	void WriteStderr(swanson::MemoryMap &memoryMap, uint32_t addr, uint32_t size) {
+
+		for (const auto &span : memoryMap.GetReadSpans(addr, size))
+			std::cerr.write((const char *) span.data, span.size);
+	}
+};
+
+/// The built in system call handlers,
+/// indexed by system call number.
+constexpr auto syscallTable = InterruptHandler::MakeSyscallTable();
+
+void InterruptHandler::HandleSyscall(swanson::CPU &cpu, uint32_t type) {
+
+	// Only one thread handles a system call at
+	// a time. Waiting threads are parked, so that
+	// the thread handling a call may stop the world.
+
+	auto &worldLock = process.GetWorldLock();
+
+	worldLock.Park();
+
+	std::unique_lock<std::mutex> lock(process.GetSyscallMutex());
+
+	worldLock.Unpark();
+
+	if (!Dispatch(cpu, *process.GetMemoryMap(), type))
+		throw swanson::Exception("System call type is unknown.");
+}
+
+bool InterruptHandler::Dispatch(swanson::CPU &cpu, swanson::MemoryMap &memoryMap, uint32_t type) {
+
+	// Handlers registered by the host
+	// come before the built in ones.
+
+	auto handler = process.FindSyscallHandler(type);
+
+	Method method = nullptr;
+
+	if (handler == nullptr) {
+		if (type < syscallTable.size())
+			method = syscallTable[type];
+		if (method == nullptr)
+			return false;
+	}
+
+	auto &stats = process.GetSyscallStats();
+
+	if (stats == nullptr) {
+		if (handler != nullptr)
+			(*handler)(process, cpu, memoryMap);
+		else
+			(this->*method)(cpu, memoryMap);
+		return true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (handler != nullptr)
+		(*handler)(process, cpu, memoryMap);
+	else
+		(this->*method)(cpu, memoryMap);
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	stats->Record(type, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+	return true;
+}
+
+} // namespace
+
+namespace swanson {
+
+struct Process::CaptureState final {
+	/// Marks a page that was zeroed
+	/// when the process was captured.
+	static constexpr uint32_t zeroPage = 0xffffffff;
+	/// The state of a thread.
+	struct ThreadState final {
+		/// The thread that the state belongs to.
+		std::shared_ptr<Thread> thread;
+		/// The general purpose registers.
+		uint32_t registers[18];
+		/// The special registers.
+		uint32_t specialRegisters[256];
+		/// The condition register.
+		uint32_t condition;
+		/// The number of instructions executed.
+		uint64_t instructionCount;
+	};
+	/// The state of an open stream.
+	struct StreamState final {
+		/// The stream, or nullptr if
+		/// the descriptor wasn't open.
+		std::shared_ptr<Stream> stream;
+		/// Whether or not the stream has a
+		/// position, which pipes and the
+		/// console don't.
+		bool hasPosition;
+		/// The position of the stream.
+		uint64_t position;
+	};
+	/// The state of a memory section.
+	struct SectionState final {
+		/// The section that the state belongs to.
+		std::shared_ptr<MemorySection> section;
+		/// The size of the section.
+		uint32_t size;
+		/// The permissions of the section.
+		uint8_t permissions;
+		/// For each page of the section, the index
+		/// of its copy in @ref pages, or @ref zeroPage.
+		std::vector<uint32_t> pageIndices;
+		/// The copies of the pages that weren't
+		/// zeroed. Each is a whole page long, padded
+		/// with zeros past the end of the section.
+		std::vector<unsigned char> pages;
+	};
+	/// The threads of the process.
+	std::vector<ThreadState> threads;
+	/// The sections of the memory map.
+	std::vector<SectionState> sections;
+	/// The section of command line arguments.
+	std::shared_ptr<MemorySection> argumentSection;
+	/// The section of the heap.
+	std::shared_ptr<MemorySection> heapSection;
+	/// The time page.
+	std::shared_ptr<MemorySection> timeSection;
+	/// The sections created by calls to mmap.
+	std::vector<std::shared_ptr<MemorySection>> mappings;
+	/// The open streams, indexed
+	/// by file descriptor.
+	std::vector<StreamState> streams;
+	/// The entry point of the program.
+	uint32_t entryPoint;
+	/// The end of the loaded ELF segments.
+	uint32_t loadEnd;
+};
+
+Process::Process() {
+
+	/* create memory that will contain the
+	 * command line arguments, of which
+	 * there are none */
+	argumentSection = MakeArgumentSection({});
+
+	/* create memory map */
+	memoryMap = std::make_shared<MemoryMap>();
+	/* add command line argument section */
+	memoryMap->AddSection(argumentSection);
+
+	interruptHandler = std::make_shared<::InterruptHandler>(*this);
+
+	id = 0;
+
+	entryPoint = 0;
+
+	exited = false;
+	exitCode = 0;
+
+	priority = 0;
+	weight = defaultWeight;
+	quantum = 0;
+
+	parked = false;
+
+	ioPending = 0;
+	ioInFlight = 0;
+	generation = 0;
+
+	cpuTime = 0;
+
+	// default stack size is 8MiB
+	defaultStackSize = 8 * 1024 * 1024;
+
+	// default heap size is 64MiB
+	maxHeapSize = 64 * 1024 * 1024;
+
+	loadEnd = 0;
+}
+
+Process::~Process() {
+
+}
+
+void Process::Exit(int exitCode_) {
+	FlushStreams();
+	exited = true;
+	exitCode = exitCode_;
+	Preempt();
+}
+
+uint32_t Process::Exec(std::shared_ptr<const elf::File> image,
+                       const std::vector<std::string> &args,
+                       CPU &cpu) {
+
+	if ((threads.size() != 1) || (threads[0]->GetCPU() != &cpu))
+		throw Exception("Only the thread of a single threaded process may exec.");
+
+	auto thread = threads[0];
+
+	uint64_t argumentSize = GetArgumentSize(args);
+	uint64_t argumentEnd = argumentAddress + argumentSize;
+
+	uint64_t newLoadSize = argumentSize + GetDefaultStackSize();
+	uint64_t newLoadEnd = 0;
+
+	for (auto &segment : *image) {
+		uint64_t segmentStart = segment->GetAddress();
+		uint64_t segmentEnd = segmentStart + segment->GetSize();
+		if ((segmentStart < argumentEnd) && (segmentEnd > argumentAddress))
+			return errors::toobig;
+		newLoadSize += segment->GetSize();
+		newLoadEnd = std::max(newLoadEnd, segmentEnd);
+	}
+
+	// Everything that could fail to load is checked
+	// before the old program is released, so that
+	// the call can still return an error.
+
+	uint64_t heapStart = PageAlign(newLoadEnd);
+	if (heapStart >= UINT32_MAX)
+		return errors::nomem;
+
+	auto heapSize = maxHeapSize;
+
+	if ((heapStart + heapSize) > UINT32_MAX)
+		heapSize = (uint32_t) (UINT32_MAX - heapStart);
+
+	auto heapOverlaps = [heapStart, heapSize](uint64_t start, uint64_t size) {
+		return ((start + size) > heapStart) && (start < (heapStart + heapSize));
+	};
+
+	if ((heapSize == 0) || heapOverlaps(argumentAddress, argumentSize))
+		return errors::nomem;
+
+	if ((timeSection != nullptr) && heapOverlaps(timeSection->GetAddress(), timeSection->GetCapacity()))
+		return errors::nomem;
+
+	for (auto &segment : *image) {
+		if (heapOverlaps(segment->GetAddress(), segment->GetSize()))
+			return errors::nomem;
+	}
+
+	// The time page is the only section
+	// that the new program keeps.
+
+	uint64_t oldLoadSize = 0;
+
+	for (auto &section : *memoryMap) {
+		if (section != timeSection)
+			oldLoadSize += section->GetSize();
+	}
+
+	auto usage = memoryMap->GetUsage();
+	auto hardLimit = usage->GetHardLimit();
+
+	auto committed = usage->GetCommitted();
+	if (committed >= oldLoadSize)
+		committed -= oldLoadSize;
+	else
+		committed = 0;
+
+	if ((hardLimit != 0) && ((committed + newLoadSize) > hardLimit))
+		return errors::nomem;
+
+	// Past this point, the old program is gone.
+
+	std::vector<std::shared_ptr<MemorySection>> oldSections(memoryMap->begin(), memoryMap->end());
+
+	for (auto &section : oldSections)
+		memoryMap->RemoveSection(section);
+
+	mappings.clear();
+	heapSection = nullptr;
+	loadEnd = 0;
+
+	argumentSection = MakeArgumentSection(args);
+
+	memoryMap->AddSection(argumentSection);
+
+	if (timeSection != nullptr)
+		memoryMap->AddSection(timeSection);
+
+	LoadImage(image);
+
+	CreateHeap();
+
+	entryPoint = image->GetEntryPoint();
+
+	// The thread starts over, as
+	// if it had just been created.
+
+	for (uint32_t i = 0; i < 18; i++)
+		cpu.SetRegister(i, 0);
+
+	for (uint32_t i = 0; i < 256; i++)
+		cpu.SetSpecialRegister(i, 0);
+
+	cpu.SetCondition(0);
+
+	CreateStack(*thread);
+
+	thread->SetInstructionPointer(entryPoint);
+
+	return 0;
+}
+
+void Process::Block(CPU &cpu, WaitQueue &waitQueue) {
+
+	for (auto &thread : threads) {
+		if (thread->GetCPU() != &cpu)
+			continue;
+		thread->SetBlocked(true);
+		waitQueue.Add(shared_from_this(), thread, GetGeneration());
+		cpu.Yield();
+		return;
+	}
+
+	throw Exception("CPU does not belong to the process.");
+}
+
+bool Process::CanOffloadIO() const noexcept {
+	return (ioWorkers != nullptr) && !std::static_pointer_cast<::InterruptHandler>(interruptHandler)->InBatch();
+}
+
+void Process::CancelPark() {
+	std::unique_lock<std::mutex> lock(wakeMutex);
+	parked = false;
+	wakeHandler = nullptr;
+}
+
+void Process::Capture() {
+
+	// A blocked thread can't be put back, since
+	// what it waits on isn't part of the capture.
+
+	for (auto &thread : threads) {
+		if (thread->IsBlocked())
+			throw Exception("Process with blocked threads can't be captured.");
+	}
+
+	auto state = std::make_unique<CaptureState>();
+
+	for (auto &thread : threads) {
+
+		CaptureState::ThreadState threadState;
+
+		auto cpu = thread->GetCPU();
+
+		threadState.thread = thread;
+
+		for (uint32_t i = 0; i < 18; i++)
+			threadState.registers[i] = cpu->GetRegister(i);
+
+		for (uint32_t i = 0; i < 256; i++)
+			threadState.specialRegisters[i] = cpu->GetSpecialRegister(i);
+
+		threadState.condition = cpu->GetCondition();
+		threadState.instructionCount = cpu->GetInstructionCount();
+
+		state->threads.emplace_back(threadState);
+	}
+
+	for (auto &section : *memoryMap) {
+
+		CaptureState::SectionState sectionState;
+
+		auto size = section->GetSize();
+		auto data = section->GetData();
+
+		sectionState.section = section;
+		sectionState.size = size;
+		sectionState.permissions = GetPermissions(*section);
+
+		// Zeroed pages aren't copied, which
+		// leaves out most of the stack and any
+		// heap that's reserved but unused.
+
+		auto pageCount = (size + (MemorySection::pageSize - 1)) / MemorySection::pageSize;
+
+		sectionState.pageIndices.resize(pageCount, CaptureState::zeroPage);
+
+		for (uint32_t page = 0; page < pageCount; page++) {
+
+			auto offset = page * MemorySection::pageSize;
+			auto length = std::min(size - offset, MemorySection::pageSize);
+
+			if (IsZero(data + offset, length))
+				continue;
+
+			auto &pages = sectionState.pages;
+
+			sectionState.pageIndices[page] = pages.size() / MemorySection::pageSize;
+
+			pages.insert(pages.end(), data + offset, data + offset + length);
+			pages.resize(pages.size() + (MemorySection::pageSize - length), 0);
+		}
+
+		state->sections.emplace_back(std::move(sectionState));
+	}
+
+	state->argumentSection = argumentSection;
+	state->heapSection = heapSection;
+	state->timeSection = timeSection;
+	state->mappings = mappings;
+	state->entryPoint = entryPoint;
+
+	for (auto &stream : streams) {
+
+		CaptureState::StreamState streamState;
+		streamState.stream = stream;
+		streamState.hasPosition = false;
+		streamState.position = 0;
+
+		if (stream != nullptr) {
+			try {
+				streamState.position = stream->GetPosition();
+				streamState.hasPosition = true;
+			} catch (const Exception &) {
+				// Only seekable streams
+				// have a position.
+			}
+		}
+
+		state->streams.emplace_back(std::move(streamState));
+	}
+
+	state->loadEnd = loadEnd;
+
+	for (auto &section : *memoryMap)
+		section->ClearDirtyPages();
+
+	captureState = std::move(state);
+}
+
+uint32_t Process::Rollback() {
+
+	if (captureState == nullptr)
+		throw Exception("Process has not been captured.");
+
+	auto &state = *captureState;
+
+	// What's left of the run is dropped before
+	// anything is put back. I/O on the workers is
+	// waited for, since it may still move a stream
+	// or finish a call. Once the generation changes,
+	// finished I/O and wakes from before are ignored.
+
+	{
+		std::unique_lock<std::mutex> lock(ioMutex);
+
+		ioDrained.wait(lock, [this]() { return ioInFlight == 0; });
+
+		generation.fetch_add(1, std::memory_order_release);
+
+		ioCompletions.clear();
+
+		ioPending.store(0, std::memory_order_relaxed);
+	}
+
+	// Sections added since the capture are removed
+	// first, so that the captured sections that were
+	// removed can't overlap them when they're put back.
+
+	std::vector<std::shared_ptr<MemorySection>> current(memoryMap->begin(), memoryMap->end());
+
+	auto isCaptured = [&state](const std::shared_ptr<MemorySection> &section) {
+		for (auto &sectionState : state.sections) {
+			if (sectionState.section == section)
+				return true;
+		}
+		return false;
+	};
+
+	for (auto &section : current) {
+		if (!isCaptured(section))
+			memoryMap->RemoveSection(section);
+	}
+
+	static const unsigned char zeros[MemorySection::pageSize] = { };
+
+	uint32_t restored = 0;
+
+	for (auto &sectionState : state.sections) {
+
+		auto &section = sectionState.section;
+
+		// A section that shrank grows back first, so
+		// that the pages it grows into are dirty. One that
+		// grew is zeroed past its captured size before it
+		// shrinks, in case it views a host mapping that
+		// keeps the old contents around.
+
+		if (section->GetSize() < sectionState.size)
+			section->Resize(sectionState.size);
+
+		auto size = section->GetSize();
+
+		for (auto offset : section->GetDirtyPages()) {
+
+			if (offset >= size)
+				break;
+
+			auto page = offset / MemorySection::pageSize;
+
+			const unsigned char *src = zeros;
+
+			if ((offset < sectionState.size) && (sectionState.pageIndices[page] != CaptureState::zeroPage))
+				src = sectionState.pages.data() + (sectionState.pageIndices[page] * MemorySection::pageSize);
+
+			section->CopyData(offset, src, std::min(size - offset, MemorySection::pageSize));
+
+			restored++;
+		}
+
+		if (section->GetSize() > sectionState.size)
+			section->Resize(sectionState.size);
+
+		section->AllowRead((sectionState.permissions & mman::prot_read) != 0);
+		section->AllowWrite((sectionState.permissions & mman::prot_write) != 0);
+		section->AllowExecute((sectionState.permissions & mman::prot_exec) != 0);
+
+		section->ClearDirtyPages();
+
+		if (std::find(current.begin(), current.end(), section) == current.end())
+			memoryMap->AddSection(section);
+	}
+
+	argumentSection = state.argumentSection;
+	heapSection = state.heapSection;
+	timeSection = state.timeSection;
+	mappings = state.mappings;
+	entryPoint = state.entryPoint;
+
+	streams.clear();
+
+	for (auto &streamState : state.streams) {
+		if (streamState.hasPosition)
+			streamState.stream->SetPosition(streamState.position);
+		streams.emplace_back(streamState.stream);
+	}
+
+	loadEnd = state.loadEnd;
+
+	threads.clear();
+
+	for (auto &threadState : state.threads) {
+
+		auto cpu = threadState.thread->GetCPU();
+
+		for (uint32_t i = 0; i < 18; i++)
+			cpu->SetRegister(i, threadState.registers[i]);
+
+		for (uint32_t i = 0; i < 256; i++)
+			cpu->SetSpecialRegister(i, threadState.specialRegisters[i]);
+
+		cpu->SetCondition(threadState.condition);
+		cpu->SetInstructionCount(threadState.instructionCount);
+
+		threadState.thread->SetBlocked(false);
+
+		threads.emplace_back(threadState.thread);
+	}
+
+	exited = false;
+	exitCode = 0;
+
+	return restored;
+}
+
+const Process::SyscallHandler *Process::FindSyscallHandler(uint32_t type) const noexcept {
+
+	if ((type >= syscallHandlers.size()) || !syscallHandlers[type])
+		return nullptr;
+
+	return &syscallHandlers[type];
+}
+
+Thread *Process::FindThread(const CPU &cpu) const noexcept {
+
+	for (auto &thread : threads) {
+		if (thread->GetCPU() == &cpu)
+			return thread.get();
+	}
+
+	return nullptr;
+}
+
+void Process::FlushStreams() {
+
+	for (auto &stream : streams) {
+		if (stream == nullptr)
+			continue;
+		try {
+			stream->Flush();
+		} catch (...) {
+			// A stream that fails to flush
+			// doesn't stop the others.
+		}
+	}
+}
+
+std::shared_ptr<Thread> Process::GetThread(size_t index) const {
+	if (index >= threads.size())
+		return nullptr;
+	else
+		return threads[index];
+}
+
+void Process::Kill() {
+
+	std::function<void()> handler;
+
+	{
+		std::unique_lock<std::mutex> lock(wakeMutex);
+
+		if (!exited) {
+			// The status that a shell reports
+			// for a process killed by SIGKILL.
+			exitCode = 128 + 9;
+			exited = true;
+		}
+
+		if (parked) {
+			parked = false;
+			handler = std::move(wakeHandler);
+			wakeHandler = nullptr;
+		}
+	}
+
+	Preempt();
+
+	if (handler)
+		handler();
+}
+
+bool Process::IsRunnable() const noexcept {
+
+	if (exited)
+		return false;
+
+	for (auto &thread : threads) {
+		if (!thread->IsBlocked())
+			return true;
+	}
+
+	return false;
+}
+
+bool Process::Park(std::function<void()> wakeHandler_) {
+
+	// Threads are unblocked before the mutex
+	// is locked to wake them, so either the
+	// check below sees the thread, or the wake
+	// sees the parked flag.
+
+	std::unique_lock<std::mutex> lock(wakeMutex);
+
+	// A process that was killed isn't parked,
+	// so that the scheduler runs it and reports it.
+
+	if (exited || IsRunnable())
+		return false;
+
+	parked = true;
+	wakeHandler = std::move(wakeHandler_);
+	return true;
+}
+
+bool Process::Wake(Thread &thread, uint32_t generation_) {
+
+	// The wait belongs to a run that was rolled
+	// back, and the thread may be waiting on
+	// something else in this one.
+
+	if (generation_ != GetGeneration())
+		return false;
+
+	thread.SetBlocked(false);
+
+	std::function<void()> handler;
+
+	{
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		if (!parked)
+			return true;
+		parked = false;
+		handler = std::move(wakeHandler);
+		wakeHandler = nullptr;
+	}
+
+	if (handler)
+		handler();
+
+	return true;
+}
+
+void Process::Preempt() noexcept {
+	for (auto &thread : threads)
+		thread->GetCPU()->Yield();
+}
+
+uint64_t Process::GetInstructionCount() const noexcept {
+	uint64_t count = 0;
+	for (auto &thread : threads)
+		count += thread->GetCPU()->GetInstructionCount();
+	return count;
+}
+
+std::shared_ptr<MemoryUsage> Process::GetMemoryUsage() const noexcept {
+	return memoryMap->GetUsage();
+}
+
+void Process::Load(const elf::File &file) {
+
+	CheckLoadSize(file);
+
+	for (auto &segment : file)
+		Load(*segment);
+
+	CreateHeap();
+
+	entryPoint = file.GetEntryPoint();
+
+	auto mainThread = std::make_shared<Thread>();
+
+	mainThread->SetInstructionPointer(entryPoint);
+
+	AddThread(mainThread);
+}
+
+void Process::Load(std::shared_ptr<const elf::File> image) {
+
+	CheckLoadSize(*image);
+
+	LoadImage(image);
+
+	CreateHeap();
+
+	entryPoint = image->GetEntryPoint();
+
+	auto mainThread = std::make_shared<Thread>();
+
+	mainThread->SetInstructionPointer(entryPoint);
+
+	AddThread(mainThread);
+}
+
+void Process::Load(const elf::Segment &segment) {
+
+	auto memorySection = std::make_shared<MemorySection>();
+	memorySection->SetAddress(segment.GetAddress());
+	memorySection->CopyData(segment.GetData(), segment.GetSize());
+	memorySection->AllowRead(segment.ReadAllowed());
+	memorySection->AllowWrite(segment.WriteAllowed());
+	memorySection->AllowExecute(segment.ExecuteAllowed());
+
+	memoryMap->AddSection(memorySection);
+
+	uint64_t segmentEnd = segment.GetAddress() + segment.GetSize();
+	if (segmentEnd > loadEnd)
+		loadEnd = segmentEnd;
+}
+
+void Process::MapTimePage() {
+
+	if (timeSection != nullptr)
+		return;
+
+	uint64_t start = syscalls::time_page;
+	uint64_t end = start + MemorySection::pageSize;
+
+	for (const auto &section : *memoryMap) {
+		uint64_t sectionStart = section->GetAddress();
+		uint64_t sectionEnd = sectionStart + std::max(section->GetSize(), section->GetCapacity());
+		if ((sectionStart < end) && (sectionEnd > start))
+			throw Exception("Time page address is already in use.");
+	}
+
+	auto section = std::make_shared<MemorySection>();
+	section->SetAddress(syscalls::time_page);
+	section->Map(HostMapping::MapAnonymous(MemorySection::pageSize));
+	section->AllowRead(true);
+	section->AllowWrite(false);
+	section->AllowExecute(false);
+
+	memoryMap->AddSection(section);
+
+	timeSection = section;
+
+	UpdateTimePage();
+}
+
+uint32_t Process::GetProgramBreak() const noexcept {
+
+	if (heapSection == nullptr)
+		return loadEnd;
+
+	return heapSection->GetAddress() + heapSection->GetSize();
+}
+
+bool Process::SetProgramBreak(uint32_t addr) {
+
+	if (heapSection == nullptr)
+		return false;
+
+	auto heapStart = heapSection->GetAddress();
+
+	if ((addr < heapStart) || ((addr - heapStart) > heapSection->GetCapacity()))
+		return false;
+
+	try {
+		heapSection->Resize(addr - heapStart);
+	} catch (const MemoryLimit &) {
+		return false;
+	}
+
+	return true;
+}
+
+void Process::CheckLoadSize(const elf::File &file) {
+
+	// The limit is checked up front, so that a file
+	// that doesn't fit leaves nothing half-loaded.
+
+	uint64_t loadSize = 0;
+
+	for (auto &segment : file)
+		loadSize += segment->GetSize();
+
+	auto usage = memoryMap->GetUsage();
+	if (!usage->CanCommit(loadSize))
+		throw MemoryLimit(usage->GetCommitted() + loadSize, usage->GetHardLimit());
+}
+
+void Process::LoadImage(const std::shared_ptr<const elf::File> &image) {
+
+	// Images are never modified once they're
+	// cached, so the segments that the process
+	// can't write to view the image directly.
+
+	auto owner = std::const_pointer_cast<elf::File>(image);
+
+	for (auto &segment : *image) {
+
+		if (segment->WriteAllowed() || (segment->GetSize() == 0)) {
+			Load(*segment);
+			continue;
+		}
+
+		auto memorySection = std::make_shared<MemorySection>();
+		memorySection->SetAddress(segment->GetAddress());
+		memorySection->Map(HostMapping::Borrow(segment->GetData(), segment->GetSize(), false, owner));
+		memorySection->AllowRead(segment->ReadAllowed());
+		memorySection->AllowWrite(false);
+		memorySection->AllowExecute(segment->ExecuteAllowed());
+
+		memoryMap->AddSection(memorySection);
+
+		uint64_t segmentEnd = segment->GetAddress() + segment->GetSize();
+		if (segmentEnd > loadEnd)
+			loadEnd = segmentEnd;
+	}
+}
+
+void Process::CreateHeap() {
+
+	uint64_t heapStart = PageAlign(loadEnd);
+
+	auto heapSize = maxHeapSize;
+
+	if ((heapStart + heapSize) > UINT32_MAX)
+		heapSize = (uint32_t) (UINT32_MAX - heapStart);
+
+	if ((heapSize == 0) || memoryMap->Overlaps(heapStart, heapSize))
+		throw Exception("No room for the process heap.");
+
+	heapSection = std::make_shared<MemorySection>();
+	heapSection->SetAddress(heapStart);
+	heapSection->Map(HostMapping::Reserve(heapSize));
+	heapSection->AllowRead(true);
+	heapSection->AllowWrite(true);
+	heapSection->AllowExecute(false);
+
+	memoryMap->AddSection(heapSection);
+}
+
+void Process::AddMapping(std::shared_ptr<MemorySection> section) {
+
+	memoryMap->AddSection(section);
+
+	mappings.emplace_back(section);
+}
+
+bool Process::RemoveMapping(uint32_t addr, uint32_t size) {
+
+	for (auto it = mappings.begin(); it != mappings.end(); it++) {
+
+		auto &section = *it;
+
+		if ((section->GetAddress() != addr) || (PageAlign(section->GetSize()) != size))
+			continue;
+
+		memoryMap->RemoveSection(section);
+
+		mappings.erase(it);
+
+		return true;
+	}
+
+	return false;
+}
+
+int32_t Process::AddStream(std::shared_ptr<Stream> stream) {
+
+	// The first three descriptors are
+	// reserved for the standard streams.
+
+	for (decltype(streams.size()) i = 3; i < streams.size(); i++) {
+		if (streams[i] == nullptr) {
+			streams[i] = stream;
+			return (int32_t) i;
+		}
+	}
+
+	if (streams.size() < 3)
+		streams.resize(3);
+
+	streams.emplace_back(stream);
+
+	return (int32_t) (streams.size() - 1);
+}
+
+std::shared_ptr<Stream> Process::GetStream(uint32_t fd) const {
+
+	if (fd >= streams.size())
+		return nullptr;
+	else
+		return streams[fd];
+}
+
+bool Process::RemoveStream(uint32_t fd) {
+
+	if ((fd >= streams.size()) || (streams[fd] == nullptr))
+		return false;
+
+	streams[fd] = nullptr;
+
+	return true;
+}
+
+void Process::Restore(std::istream &stream) {
+
+	auto first = true;
+
+	while (stream.peek() != std::char_traits<char>::eof()) {
+		RestoreRecord(stream, first);
+		first = false;
+	}
+
+	if (first)
+		throw Exception("Checkpoint is empty.");
+
+	// The restored pages are only dirty
+	// relative to the next checkpoint taken.
+
+	for (auto &section : *memoryMap)
+		section->ClearDirtyPages();
+}
+
+void Process::RestoreRecord(std::istream &stream, bool first) {
+
+	if ((ReadU32(stream) != checkpointMagic)
+	 || (ReadU32(stream) != checkpointVersion))
+		throw Exception("Checkpoint record is not valid.");
+
+	auto full = ReadU8(stream) != 0;
+
+	if (first && !full)
+		throw Exception("Checkpoint does not start with a full image.");
+
+	if (full) {
+
+		// A full image replaces all of memory.
+
+		std::vector<std::shared_ptr<MemorySection>> oldSections(memoryMap->begin(), memoryMap->end());
+
+		for (auto &section : oldSections)
+			memoryMap->RemoveSection(section);
+
+		mappings.clear();
+		argumentSection = nullptr;
+		heapSection = nullptr;
+		timeSection = nullptr;
+	}
+
+	entryPoint = ReadU32(stream);
+	loadEnd = ReadU32(stream);
+	maxHeapSize = ReadU32(stream);
+	defaultStackSize = ReadU32(stream);
+	exited = ReadU8(stream) != 0;
+	exitCode = (int32_t) ReadU32(stream);
+
+	// Thread state is small, so it's
+	// written whole in every record.
+
+	threads.clear();
+
+	auto threadCount = ReadU32(stream);
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+
+		auto thread = std::make_shared<Thread>();
+
+		ReadCPU(stream, *thread->GetCPU());
+
+		thread->SetMemoryBus(memoryMap);
+		thread->SetInterruptHandler(interruptHandler);
+
+		threads.emplace_back(thread);
+	}
+
+	std::vector<std::shared_ptr<MemorySection>> restored;
+	std::vector<std::shared_ptr<MemorySection>> restoredMappings;
+
+	auto isRestored = [&restored](const std::shared_ptr<MemorySection> &section) {
+		return std::find(restored.begin(), restored.end(), section) != restored.end();
+	};
+
+	auto sectionCount = ReadU32(stream);
+
+	for (uint32_t i = 0; i < sectionCount; i++) {
+
+		auto address = ReadU32(stream);
+		auto size = ReadU32(stream);
+		auto permissions = ReadU8(stream);
+		auto kind = (SectionKind) ReadU8(stream);
+
+		uint64_t extent = size;
+		if (kind == SectionKind::Heap)
+			extent = maxHeapSize;
+
+		// Sections from the previous record that
+		// are in the way of this one have been
+		// removed or moved since then.
+
+		std::shared_ptr<MemorySection> section;
+		std::vector<std::shared_ptr<MemorySection>> stale;
+
+		for (auto &other : *memoryMap) {
+
+			if (isRestored(other))
+				continue;
+
+			uint64_t otherStart = other->GetAddress();
+			uint64_t otherEnd = otherStart + std::max(other->GetSize(), other->GetCapacity());
+
+			auto otherKind = GetSectionKind(other, argumentSection, heapSection, timeSection, mappings);
 
-		auto memoryMap = process.GetMemoryMap();
+			if ((otherStart == address) && (otherKind == kind) && (section == nullptr))
+				section = other;
+			else if ((otherStart < (address + extent)) && (otherEnd > address))
+				stale.emplace_back(other);
+		}
+
+		for (auto &other : stale)
+			memoryMap->RemoveSection(other);
+
+		if (section == nullptr) {
+
+			section = std::make_shared<MemorySection>();
+			section->SetAddress(address);
 
-		if (type == swanson::syscalls::exit) {
-			HandleExit(cpu);
-		} else if (type == swanson::syscalls::close) {
-			HandleClose(cpu);
-		} else if (type == swanson::syscalls::write) {
-			HandleWrite(cpu);
-		} else if (type == swanson::syscalls::execve) {
-			throw swanson::Exception("Syscall 'execve' not implemented");
-		} else if (type == swanson::syscalls::fork) {
-			throw swanson::Exception("Syscall 'fork' not implemented");
+			if (kind == SectionKind::Heap)
+				section->Map(HostMapping::Reserve(maxHeapSize));
+
+			section->Resize(size);
+
+			memoryMap->AddSection(section);
 		} else {
-			throw swanson::Exception("System call type is unknown.");
+			section->Resize(size);
 		}
+
+		section->AllowRead((permissions & mman::prot_read) != 0);
+		section->AllowWrite((permissions & mman::prot_write) != 0);
+		section->AllowExecute((permissions & mman::prot_exec) != 0);
+
+		auto pageCount = ReadU32(stream);
+
+		std::vector<unsigned char> page(MemorySection::pageSize);
+
+		for (uint32_t j = 0; j < pageCount; j++) {
+
+			auto offset = ReadU32(stream);
+			if (offset >= size)
+				throw Exception("Checkpoint page is outside of its section.");
+
+			auto length = std::min(size - offset, MemorySection::pageSize);
+
+			ReadBytes(stream, page.data(), length);
+
+			section->CopyData(offset, page.data(), length);
+		}
+
+		if (kind == SectionKind::Arguments)
+			argumentSection = section;
+		else if (kind == SectionKind::Heap)
+			heapSection = section;
+		else if (kind == SectionKind::Time)
+			timeSection = section;
+		else if (kind == SectionKind::Mapping)
+			restoredMappings.emplace_back(section);
+
+		restored.emplace_back(section);
 	}
-protected:
-	void HandleClose(swanson::CPU &) {
-		// nothing to do here, currently.
-	}
-	void HandleExit(swanson::CPU &cpu) {
 
-		// exit code in r0
-		auto exitCode = cpu.GetRegister(2);
+	// Anything that wasn't in the
+	// record has since been removed.
 
-		process.Exit(exitCode);
+	std::vector<std::shared_ptr<MemorySection>> removed;
+
+	for (auto &section : *memoryMap) {
+		if (!isRestored(section))
+			removed.emplace_back(section);
 	}
-	void HandleWrite(swanson::CPU &cpu) {
 
-		auto memoryMap = process.GetMemoryMap();
+	for (auto &section : removed)
+		memoryMap->RemoveSection(section);
 
-		auto fd = cpu.GetRegister(2);
-		auto bufAddr = cpu.GetRegister(3);
-		auto bufSize = cpu.GetRegister(4);
+	if ((argumentSection != nullptr) && !isRestored(argumentSection))
+		argumentSection = nullptr;
 
-		if (bufSize > INT32_MAX)
-			bufSize = INT32_MAX;
+	if ((heapSection != nullptr) && !isRestored(heapSection))
+		heapSection = nullptr;
 
-		if (fd == 1) {
-			WriteStdout(bufAddr, bufSize);
-			// return bytes written
-			cpu.SetRegister(2, bufSize);
-		} else if (fd == 2) {
-			WriteStderr(bufAddr, bufSize);
-			// return bytes written
-			cpu.SetRegister(2, bufSize);
+	if ((timeSection != nullptr) && !isRestored(timeSection))
+		timeSection = nullptr;
+
+	mappings = restoredMappings;
+}
+
+void Process::SaveCheckpoint(std::ostream &stream, bool full) {
+
+	WriteU32(stream, checkpointMagic);
+	WriteU32(stream, checkpointVersion);
+	WriteU8(stream, full ? 1 : 0);
+
+	WriteU32(stream, entryPoint);
+	WriteU32(stream, loadEnd);
+	WriteU32(stream, maxHeapSize);
+	WriteU32(stream, defaultStackSize);
+	WriteU8(stream, exited ? 1 : 0);
+	WriteU32(stream, (uint32_t) exitCode);
+
+	WriteU32(stream, threads.size());
+
+	for (auto &thread : threads)
+		WriteCPU(stream, *thread->GetCPU());
+
+	WriteU32(stream, std::distance(memoryMap->begin(), memoryMap->end()));
+
+	for (auto &section : *memoryMap) {
+
+		auto kind = GetSectionKind(section, argumentSection, heapSection, timeSection, mappings);
+
+		auto permissions = GetPermissions(*section);
+
+		auto size = section->GetSize();
+		auto data = section->GetData();
+
+		WriteU32(stream, section->GetAddress());
+		WriteU32(stream, size);
+		WriteU8(stream, permissions);
+		WriteU8(stream, (uint8_t) kind);
+
+		// A full image starts from zeroed
+		// sections, so zeroed pages are left
+		// out. Otherwise, only the pages written
+		// to since the last record are needed.
+
+		std::vector<uint32_t> pages;
+
+		if (full) {
+			for (uint32_t offset = 0; offset < size; offset += MemorySection::pageSize) {
+				if (!IsZero(data + offset, std::min(size - offset, MemorySection::pageSize)))
+					pages.emplace_back(offset);
+			}
 		} else {
-			// not a valid file descriptor
+			pages = section->GetDirtyPages();
 		}
+
+		WriteU32(stream, pages.size());
+
+		for (auto offset : pages) {
+			WriteU32(stream, offset);
+			stream.write((const char *) data + offset, std::min(size - offset, MemorySection::pageSize));
+		}
+	}
+
+	if (!stream.good())
+		throw Exception("Failed to write checkpoint.");
+
+	for (auto &section : *memoryMap)
+		section->ClearDirtyPages();
+}
+
+bool Process::RequestSnapshot(CPU &cpu) {
+
+	if (!snapshotHandler)
+		return false;
+
+	snapshotHandler(*this, cpu);
+
+	return true;
+}
+
+void Process::RestoreSnapshot(std::istream &stream, const std::string &path) {
+
+	priority = (int) ReadU32(stream);
+	weight = ReadU32(stream);
+	quantum = ReadU32(stream);
+
+	auto softLimit = ReadU64(stream);
+	auto hardLimit = ReadU64(stream);
+
+	entryPoint = ReadU32(stream);
+	loadEnd = ReadU32(stream);
+	maxHeapSize = ReadU32(stream);
+	defaultStackSize = ReadU32(stream);
+	exited = ReadU8(stream) != 0;
+	exitCode = (int32_t) ReadU32(stream);
+
+	// Everything that the process had
+	// before is replaced by the snapshot.
+
+	std::vector<std::shared_ptr<MemorySection>> oldSections(memoryMap->begin(), memoryMap->end());
+
+	for (auto &section : oldSections)
+		memoryMap->RemoveSection(section);
+
+	mappings.clear();
+	argumentSection = nullptr;
+	heapSection = nullptr;
+	timeSection = nullptr;
+	streams.clear();
+	threads.clear();
+
+	auto threadCount = ReadU32(stream);
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+
+		auto thread = std::make_shared<Thread>();
+
+		ReadCPU(stream, *thread->GetCPU());
+
+		thread->SetMemoryBus(memoryMap);
+		thread->SetInterruptHandler(interruptHandler);
+
+		threads.emplace_back(thread);
 	}
-	void WriteStdout(uint32_t addr, uint32_t size) {
 
-		auto memoryMap = process.GetMemoryMap();
+	uint64_t pageSize = HostMapping::GetPageSize();
+
+	// Only a snapshot from a host with a larger
+	// page size has to be read instead of mapped.
+
+	std::ifstream file;
+
+	auto sectionCount = ReadU32(stream);
+
+	for (uint32_t i = 0; i < sectionCount; i++) {
+
+		auto address = ReadU32(stream);
+		auto size = ReadU32(stream);
+		auto permissions = ReadU8(stream);
+		auto kind = (SectionKind) ReadU8(stream);
+		auto dataOffset = ReadU64(stream);
+
+		uint64_t capacity = size;
 
-		for (decltype(size) i = 0; i < size; i++) {
-			std::cout.put((char) memoryMap->Read8(addr + i));
+		if (kind == SectionKind::Heap) {
+			capacity = std::max<uint64_t>(size, std::min<uint64_t>(maxHeapSize, UINT32_MAX - address));
+			if (capacity == 0)
+				capacity = pageSize;
 		}
+
+		auto section = std::make_shared<MemorySection>();
+		section->SetAddress(address);
+
+		if ((dataOffset % pageSize) == 0) {
+			if (kind == SectionKind::Heap)
+				section->Map(HostMapping::MapFilePrivate(path, dataOffset, size, capacity));
+			else if (size > 0)
+				section->Map(HostMapping::MapFile(path, dataOffset, size, true, false));
+		} else if (size > 0) {
+
+			if (kind == SectionKind::Heap)
+				section->Map(HostMapping::Reserve(capacity));
+
+			section->Resize(size);
+
+			if (!file.is_open())
+				file.open(path, std::ios::in | std::ios::binary);
+
+			std::vector<unsigned char> contents(size);
+
+			file.seekg(dataOffset);
+			ReadBytes(file, contents.data(), size);
+
+			section->CopyData(0, contents.data(), size);
+		} else if (kind == SectionKind::Heap) {
+			section->Map(HostMapping::Reserve(capacity));
+		}
+
+		section->AllowRead((permissions & mman::prot_read) != 0);
+		section->AllowWrite((permissions & mman::prot_write) != 0);
+		section->AllowExecute((permissions & mman::prot_exec) != 0);
+
+		memoryMap->AddSection(section);
+
+		if (kind == SectionKind::Arguments)
+			argumentSection = section;
+		else if (kind == SectionKind::Heap)
+			heapSection = section;
+		else if (kind == SectionKind::Time)
+			timeSection = section;
+		else if (kind == SectionKind::Mapping)
+			mappings.emplace_back(section);
 	}
-	void WriteStderr(uint32_t addr, uint32_t size) {
 
-		auto memoryMap = process.GetMemoryMap();
+	SetMemoryLimits(softLimit, hardLimit);
+
+	for (auto &section : *memoryMap)
+		section->ClearDirtyPages();
+}
+
+void Process::SaveSnapshot(std::ostream &stream, std::ostream &data) {
+
+	auto usage = memoryMap->GetUsage();
 
-		for (decltype(size) i = 0; i < size; i++) {
-			std::cerr.put((char) memoryMap->Read8(addr + i));
+	WriteU32(stream, (uint32_t) priority);
+	WriteU32(stream, weight);
+	WriteU32(stream, quantum);
+
+	WriteU64(stream, usage->GetSoftLimit());
+	WriteU64(stream, usage->GetHardLimit());
+
+	WriteU32(stream, entryPoint);
+	WriteU32(stream, loadEnd);
+	WriteU32(stream, maxHeapSize);
+	WriteU32(stream, defaultStackSize);
+	WriteU8(stream, exited ? 1 : 0);
+	WriteU32(stream, (uint32_t) exitCode);
+
+	WriteU32(stream, threads.size());
+
+	for (auto &thread : threads)
+		WriteCPU(stream, *thread->GetCPU());
+
+	WriteU32(stream, std::distance(memoryMap->begin(), memoryMap->end()));
+
+	uint64_t pageSize = HostMapping::GetPageSize();
+
+	for (auto &section : *memoryMap) {
+
+		auto size = section->GetSize();
+		auto contents = section->GetData();
+
+		// Section data starts on a host page, so
+		// that it may be mapped back. Zeroed pages
+		// are skipped over instead of written, which
+		// leaves holes in the file that cost nothing.
+
+		uint64_t dataOffset = data.tellp();
+		dataOffset = ((dataOffset + (pageSize - 1)) / pageSize) * pageSize;
+
+		for (uint32_t offset = 0; offset < size; offset += MemorySection::pageSize) {
+
+			auto length = std::min(size - offset, MemorySection::pageSize);
+			if (IsZero(contents + offset, length))
+				continue;
+
+			data.seekp(dataOffset + offset);
+			data.write((const char *) contents + offset, length);
 		}
+
+		data.seekp(dataOffset + size);
+
+		WriteU32(stream, section->GetAddress());
+		WriteU32(stream, size);
+		WriteU8(stream, GetPermissions(*section));
+		WriteU8(stream, (uint8_t) GetSectionKind(section, argumentSection, heapSection, timeSection, mappings));
+		WriteU64(stream, dataOffset);
 	}
-};
 
-} // namespace
+	if (!stream.good() || !data.good())
+		throw Exception("Failed to write snapshot.");
+}
 
-namespace swanson {
+void Process::SetMemoryLimits(uint64_t softLimit, uint64_t hardLimit) noexcept {
+	auto usage = memoryMap->GetUsage();
+	usage->SetSoftLimit(softLimit);
+	usage->SetHardLimit(hardLimit);
+}
 
-Process::Process() {
+void Process::SetSnapshotHandler(std::function<void(Process &, CPU &)> snapshotHandler_) {
+	snapshotHandler = std::move(snapshotHandler_);
+}
 
-	/* create memory that will contain the
-	 * command line arguments */
-	argumentSection = std::make_shared<MemorySection>();
-	/* argc, argv, argv[0] */
-	argumentSection->Resize(4 + 4 + 4);
-	argumentSection->SetAddress(0x04);
-	/* argc = 0 */
-	argumentSection->Write32(0x04, 0x00);
-	/* argv = argv[0] */
-	argumentSection->Write32(0x08, 0x0c);
-	/* argv[0] = NULL */
-	argumentSection->Write32(0x0c, 0x00);
-	/* set permissions */
-	argumentSection->AllowRead(true);
-	argumentSection->AllowWrite(true);
-	argumentSection->AllowExecute(false);
+void Process::SetStream(uint32_t fd, std::shared_ptr<Stream> stream) {
 
-	/* create memory map */
-	memoryMap = std::make_shared<MemoryMap>();
-	/* add command line argument section */
-	memoryMap->AddSection(argumentSection);
+	if (streams.size() <= fd)
+		streams.resize(fd + 1);
 
-	interruptHandler = std::make_shared<::InterruptHandler>(*this);
+	streams[fd] = stream;
+}
 
-	entryPoint = 0;
+void Process::SetIOWorkers(std::shared_ptr<IOWorkers> ioWorkers_) noexcept {
+	ioWorkers = ioWorkers_;
+}
 
-	exited = false;
-	exitCode = 0;
+void Process::SetImageCache(std::shared_ptr<ImageCache> imageCache_) noexcept {
+	imageCache = imageCache_;
+}
 
-	// default stack size is 8MiB
-	defaultStackSize = 8 * 1024 * 1024;
+void Process::SetRootFS(std::shared_ptr<vfs::FS> root_fs_) {
+	root_fs = root_fs_;
 }
 
-std::shared_ptr<MemoryMap> Process::GetMemoryMap() {
-	return memoryMap;
+void Process::SetSyscallHandler(uint32_t type, SyscallHandler handler) {
+
+	if (type >= syscalls::tableSize)
+		throw Exception("System call number is out of range.");
+
+	if (syscallHandlers.size() <= type)
+		syscallHandlers.resize(type + 1);
+
+	syscallHandlers[type] = handler;
 }
 
-void Process::Exit(int exitCode_) {
-	exited = true;
-	exitCode = exitCode_;
+void Process::SetSyscallStats(std::shared_ptr<SyscallStats> syscallStats_) noexcept {
+	syscallStats = syscallStats_;
 }
 
-void Process::Load(const elf::File &file) {
+void Process::SetThreadPool(std::shared_ptr<ThreadPool> threadPool_) noexcept {
+	threadPool = threadPool_;
+}
 
-	for (auto &segment : file)
-		Load(*segment);
+uint64_t Process::Step(uint32_t steps) {
 
-	auto mainThread = std::make_shared<Thread>();
+	uint64_t executed = 0;
 
-	mainThread->SetInstructionPointer(file.GetEntryPoint());
+	if (exited)
+		return executed;
 
-	AddThread(mainThread);
+	if (timeSection != nullptr)
+		UpdateTimePage();
+
+	// The time is counted here, instead of
+	// around each thread, so that it's only
+	// read from the clock twice per slice.
+
+	auto start = std::chrono::steady_clock::now();
+
+	executed = RunThreads(steps);
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	cpuTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+
+	return executed;
 }
 
-void Process::Load(const elf::Segment &segment) {
+uint64_t Process::RunThreads(uint32_t steps) {
 
-	auto memorySection = std::make_shared<MemorySection>();
-	memorySection->SetAddress(segment.GetAddress());
-	memorySection->CopyData(segment.GetData(), segment.GetSize());
-	memorySection->AllowRead(segment.ReadAllowed());
-	memorySection->AllowWrite(segment.WriteAllowed());
-	memorySection->AllowExecute(segment.ExecuteAllowed());
+	uint64_t executed = 0;
+
+	// Access profiles count from one
+	// thread only, so profiled processes
+	// aren't run on the thread pool.
 
-	// TODO : remove this, it's a hack
-	// used to reserve enough space for
-	// a few changes to the heap from
-	// sbrk.
-	if (((memorySection->GetSize() % 0x2000) != 0) && segment.WriteAllowed()) {
-		memorySection->Resize(memorySection->GetSize() + (0x2000 - (memorySection->GetSize() % 0x2000)));
+	if ((threadPool == nullptr)
+	 || (threads.size() < 2)
+	 || (memoryMap->GetProfile() != nullptr)) {
+		for (decltype(threads.size()) threadID = 0; threadID < threads.size(); threadID++) {
+			if (threads[threadID]->IsBlocked())
+				continue;
+			executed += StepThread(threadID, steps);
+			/// The exit call may have occured
+			/// while executing the last thread.
+			/// Check before continuing.
+			if (Exited())
+				break;
+		}
+		return executed;
 	}
 
-	memoryMap->AddSection(memorySection);
+	// Threads that are still running when
+	// another one exits are preempted by it.
+
+	std::vector<uint32_t> counts(threads.size());
+
+	std::vector<std::function<void()>> tasks;
+
+	for (decltype(threads.size()) threadID = 0; threadID < threads.size(); threadID++) {
+		if (!threads[threadID]->IsBlocked())
+			tasks.emplace_back([this, threadID, steps, &counts] { counts[threadID] = StepThread(threadID, steps); });
+	}
+
+	threadPool->Run(tasks);
+
+	for (auto count : counts)
+		executed += count;
+
+	return executed;
 }
 
-void Process::SetRootFS(std::shared_ptr<vfs::FS> root_fs_) {
-	root_fs = root_fs_;
+void Process::SubmitIO(CPU &cpu,
+                       std::shared_ptr<Stream> stream,
+                       uint32_t address,
+                       std::function<uint32_t(std::vector<unsigned char> &)> operation) {
+
+	SubmitIO(cpu, stream, [operation, address]() -> IOFinisher {
+
+		std::vector<unsigned char> data;
+
+		auto result = operation(data);
+
+		return [result, address, data = std::move(data)](MemoryMap &memoryMap) {
+			if (!data.empty())
+				memoryMap.WriteBlock(address, data.data(), data.size());
+			return result;
+		};
+	});
 }
 
-void Process::Step(uint32_t steps) {
-	auto threadID = 0UL;
-	for (auto &thread : threads) {
+void Process::SubmitIO(CPU &cpu,
+                       std::shared_ptr<Stream> stream,
+                       std::function<IOFinisher()> operation) {
+
+	if (ioWorkers == nullptr)
+		throw Exception("Process has no I/O workers.");
+
+	auto thread = FindThread(cpu);
+
+	// Each call waits on a queue of its own, so
+	// that the worker wakes the right thread. It
+	// blocks before the job is submitted, so the
+	// wake can't come first.
+
+	auto waitQueue = std::make_shared<WaitQueue>();
+
+	Block(cpu, *waitQueue);
+
+	auto self = shared_from_this();
+
+	auto jobGeneration = GetGeneration();
+
+	{
+		std::unique_lock<std::mutex> lock(ioMutex);
+		ioInFlight++;
+	}
+
+	ioWorkers->Submit(stream.get(), [self, thread, operation, waitQueue, jobGeneration]() {
+
+		IOFinisher finisher;
+
 		try {
-			thread->Step(steps);
-		} catch (Segfault &segfault) {
-			segfault.SetThreadID(threadID);
-			throw;
-		} catch (BadInstruction &badInstruction) {
-			badInstruction.SetThreadID(threadID);
-			throw;
+			finisher = operation();
+		} catch (...) {
+			finisher = nullptr;
+		}
+
+		if (!finisher) {
+			finisher = [](MemoryMap &) {
+				return errors::ToResult(errors::io);
+			};
 		}
-		threadID++;
-		/// The exit call may have occured
-		/// while executing the last thread.
-		/// Check before continuing.
-		if (Exited())
-			break;
+
+		self->CompleteIO(thread, std::move(finisher), jobGeneration);
+
+		waitQueue->Wake();
+
+		// A rollback waits for this, so that
+		// the job can't touch the process or
+		// its streams once it's rolled back.
+
+		std::unique_lock<std::mutex> lock(self->ioMutex);
+		if (--self->ioInFlight == 0)
+			self->ioDrained.notify_all();
+	});
+}
+
+void Process::CompleteIO(Thread *thread,
+                         uint32_t result,
+                         uint32_t address,
+                         std::vector<unsigned char> data,
+                         uint32_t generation_) {
+
+	CompleteIO(thread, [result, address, data = std::move(data)](MemoryMap &memoryMap) {
+		if (!data.empty())
+			memoryMap.WriteBlock(address, data.data(), data.size());
+		return result;
+	}, generation_);
+}
+
+void Process::CompleteIO(Thread *thread, IOFinisher finisher, uint32_t generation_) {
+
+	std::unique_lock<std::mutex> lock(ioMutex);
+
+	// The generation only changes with the
+	// mutex held, so a completion can't slip
+	// in after a rollback has dropped the rest.
+
+	if (generation_ != GetGeneration())
+		return;
+
+	IOCompletion completion;
+	completion.thread = thread;
+	completion.finisher = std::move(finisher);
+
+	ioCompletions.emplace_back(std::move(completion));
+
+	ioPending.fetch_add(1, std::memory_order_release);
+}
+
+void Process::DeliverIO(Thread &thread) {
+
+	IOCompletion completion;
+
+	{
+		std::unique_lock<std::mutex> lock(ioMutex);
+
+		auto it = std::find_if(ioCompletions.begin(), ioCompletions.end(), [&thread](const IOCompletion &completion) {
+			return completion.thread == &thread;
+		});
+
+		if (it == ioCompletions.end())
+			return;
+
+		completion = std::move(*it);
+
+		ioCompletions.erase(it);
+
+		ioPending.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// Guest memory may have been unmapped
+	// while the I/O was in progress.
+
+	uint32_t result = 0;
+
+	try {
+		result = completion.finisher(*memoryMap);
+	} catch (const Segfault &) {
+		result = errors::ToResult(errors::fault);
+	}
+
+	thread.GetCPU()->SetRegister(2, result);
+}
+
+uint32_t Process::StepThread(size_t threadID, uint32_t steps) {
+
+	uint32_t executed = 0;
+
+	worldLock.Enter();
+
+	try {
+		if (ioPending.load(std::memory_order_acquire) != 0)
+			DeliverIO(*threads[threadID]);
+		executed = threads[threadID]->Step(steps);
+	} catch (Segfault &segfault) {
+		worldLock.Leave();
+		segfault.SetThreadID(threadID);
+		throw;
+	} catch (BadInstruction &badInstruction) {
+		worldLock.Leave();
+		badInstruction.SetThreadID(threadID);
+		throw;
+	} catch (...) {
+		worldLock.Leave();
+		throw;
+	}
+
+	worldLock.Leave();
+
+	return executed;
+}
+
+void Process::UpdateTimePage() {
+
+	uint32_t seconds = 0;
+	uint32_t microseconds = 0;
+
+	GetHostTime(seconds, microseconds);
+
+	auto instructions = GetInstructionCount();
+
+	auto cpuMicroseconds = GetCPUTime() / 1000;
+
+	uint32_t words[syscalls::time_page_size / 4];
+	words[syscalls::time_page_seconds / 4] = seconds;
+	words[syscalls::time_page_microseconds / 4] = microseconds;
+	words[syscalls::time_page_instructions / 4] = (uint32_t) (instructions >> 32);
+	words[(syscalls::time_page_instructions / 4) + 1] = (uint32_t) instructions;
+	words[syscalls::time_page_cpu_time / 4] = (uint32_t) (cpuMicroseconds >> 32);
+	words[(syscalls::time_page_cpu_time / 4) + 1] = (uint32_t) cpuMicroseconds;
+
+	// Guest memory is big endian.
+
+	unsigned char bytes[syscalls::time_page_size];
+
+	for (uint32_t i = 0; i < (syscalls::time_page_size / 4); i++) {
+		bytes[(i * 4) + 0] = (unsigned char) (words[i] >> 24);
+		bytes[(i * 4) + 1] = (unsigned char) (words[i] >> 16);
+		bytes[(i * 4) + 2] = (unsigned char) (words[i] >> 8);
+		bytes[(i * 4) + 3] = (unsigned char) words[i];
 	}
+
+	// The page is rewritten before every slice,
+	// so it's left out of the dirty pages. Otherwise
+	// every checkpoint and rollback would copy it.
+
+	timeSection->OverwriteData(0, bytes, sizeof(bytes));
 }
 
 void Process::AddThread(std::shared_ptr<Thread> &thread) {
 
-	auto stack = memoryMap->AddSection(GetDefaultStackSize());
-	stack->AllowRead(true);
-	stack->AllowWrite(true);
-	stack->AllowExecute(false);
+	CreateStack(*thread);
 
 	thread->SetMemoryBus(memoryMap);
-	thread->SetFramePointer(0x00);
-	thread->SetStackPointer(stack->GetAddress() + stack->GetSize());
 	thread->SetInterruptHandler(interruptHandler);
 
 	threads.emplace_back(thread);
 }
 
+void Process::CreateStack(Thread &thread) {
+
+	// Stacks are mapped from the host, so that
+	// pages the thread never touches cost nothing
+	// and idle pages may be compressed.
+
+	auto stackSize = GetDefaultStackSize();
+
+	auto usage = memoryMap->GetUsage();
+	if (!usage->CanCommit(stackSize))
+		throw MemoryLimit(usage->GetCommitted() + stackSize, usage->GetHardLimit());
+
+	auto stack = std::make_shared<MemorySection>();
+	stack->SetAddress(memoryMap->FindAddress(stackSize));
+	stack->Map(HostMapping::MapAnonymous(stackSize));
+	stack->AllowRead(true);
+	stack->AllowWrite(true);
+	stack->AllowExecute(false);
+
+	memoryMap->AddSection(stack);
+
+	thread.SetFramePointer(0x00);
+	thread.SetStackPointer(stack->GetAddress() + stack->GetSize());
+}
+
 } // namespace swanson
@@ -0,0 +1,260 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "rollback-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/elf.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/io-workers.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/pipe.hpp>
+#include <swanson/process.hpp>
+#include <swanson/stream.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address of the writable
+/// data that the programs use.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// Exits with the value at the start of
+/// the data, after overwriting it and
+/// writing to the next page.
+const std::vector<unsigned char> counterProgram {
+	0x08, 0x20, 0x00, 0x02, 0x00, 0x00, /* lda.l $r0, 0x20000 */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x09, /* ldi.l $r1, 9 */
+	0x09, 0x30, 0x00, 0x02, 0x00, 0x00, /* sta.l 0x20000, $r1 */
+	0x09, 0x30, 0x00, 0x02, 0x10, 0x00, /* sta.l 0x21000, $r1 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Reads four bytes from descriptor
+/// three, and exits with them.
+const std::vector<unsigned char> readProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x03, /* ldi.l $r0, 3 */
+	0x01, 0x30, 0x00, 0x02, 0x00, 0x00, /* ldi.l $r1, 0x20000 */
+	0x01, 0x40, 0x00, 0x00, 0x00, 0x04, /* ldi.l $r2, 4 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x04, /* swi read */
+	0x08, 0x20, 0x00, 0x02, 0x00, 0x00, /* lda.l $r0, 0x20000 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// A stream that nothing
+/// is read from or written to.
+class NullStream final : public Stream {
+public:
+	void Write(const void *, uint64_t) override { }
+	void Read(void *, uint64_t) override { }
+	void SetPosition(uint64_t) override { }
+};
+
+auto MakeProcess(const std::vector<unsigned char> &program = counterProgram) {
+	auto image = MakeTestImage(program, dataAddress, 0x2000);
+	auto data = *std::next(image.begin());
+	((unsigned char *) data->GetData())[3] = 5;
+	return MakeTestProcess(image);
+}
+
+void TestRuns() {
+
+	auto process = MakeProcess();
+
+	auto memoryMap = process->GetMemoryMap();
+
+	process->Capture();
+	assert(process->HasCapture());
+
+	for (int i = 0; i < 3; i++) {
+
+		while (!process->Exited())
+			process->Step(100);
+
+		assert(process->GetExitCode() == 5);
+		assert(memoryMap->Read32(dataAddress + 0x1000) == 9);
+
+		/* both data pages were written,
+		 * and nothing else was */
+		assert(process->Rollback() == 2);
+
+		assert(!process->Exited());
+		assert(memoryMap->Read32(dataAddress) == 5);
+		assert(memoryMap->Read32(dataAddress + 0x1000) == 0);
+		assert(process->GetThread(0)->GetCPU()->GetInstructionPointer() == codeAddress);
+		assert(process->GetInstructionCount() == 0);
+	}
+}
+
+void TestLayout() {
+
+	auto process = MakeProcess();
+
+	auto memoryMap = process->GetMemoryMap();
+
+	auto heapStart = process->GetProgramBreak();
+	assert(process->SetProgramBreak(heapStart + 0x1800));
+	memoryMap->Write32(heapStart + 0x17fc, 0x1234);
+
+	auto mapping = std::make_shared<MemorySection>();
+	mapping->SetAddress(0x100000);
+	mapping->Resize(0x1000);
+	process->AddMapping(mapping);
+	memoryMap->Write32(0x100000, 0x5678);
+
+	process->AddStream(std::make_shared<NullStream>());
+
+	process->Capture();
+
+	/* the heap grows and shrinks, a
+	 * mapping comes and goes, and a
+	 * stream is opened */
+	assert(process->SetProgramBreak(heapStart + 0x4000));
+	memoryMap->Write32(heapStart + 0x3ffc, 0xdead);
+	memoryMap->Write32(heapStart + 0x17fc, 0xbeef);
+	assert(process->RemoveMapping(0x100000, 0x1000));
+
+	auto added = std::make_shared<MemorySection>();
+	added->SetAddress(0x200000);
+	added->Resize(0x1000);
+	process->AddMapping(added);
+
+	auto fd = process->AddStream(std::make_shared<NullStream>());
+	assert(process->GetStream(fd) != nullptr);
+
+	process->Rollback();
+
+	assert(process->GetProgramBreak() == (heapStart + 0x1800));
+	assert(memoryMap->Read32(heapStart + 0x17fc) == 0x1234);
+	assert(memoryMap->FindSection(0x200000) == nullptr);
+	assert(memoryMap->Read32(0x100000) == 0x5678);
+	assert(process->RemoveMapping(0x100000, 0x1000));
+	assert(process->GetStream(fd) == nullptr);
+	assert(process->GetStream(3) != nullptr);
+
+	/* the heap grows into zeros again */
+	assert(process->SetProgramBreak(heapStart + 0x4000));
+	assert(memoryMap->Read32(heapStart + 0x3ffc) == 0);
+
+	/* shrinking is undone too */
+	process->Rollback();
+	assert(process->SetProgramBreak(heapStart));
+	process->Rollback();
+	assert(process->GetProgramBreak() == (heapStart + 0x1800));
+	assert(memoryMap->Read32(heapStart + 0x17fc) == 0x1234);
+}
+
+/// Run a process until it exits, for
+/// at most about a second.
+bool RunToExit(Process &process) {
+
+	for (int i = 0; (i < 1000) && !process.Exited(); i++) {
+		if (process.Step(100) == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return process.Exited();
+}
+
+void TestStreams() {
+
+	auto process = MakeProcess(readProgram);
+	process->SetStream(3, std::make_shared<MemoryStream>(std::string("abcdefgh")));
+
+	process->Capture();
+
+	/* each run reads the same bytes */
+	for (int i = 0; i < 2; i++) {
+		assert(RunToExit(*process));
+		assert(process->GetExitCode() == 0x61626364);
+		process->Rollback();
+	}
+}
+
+void TestPendingIO() {
+
+	/* a reader that's blocked on a pipe when the
+	 * process is rolled back doesn't take the
+	 * data that's written afterwards */
+	auto pipe = Pipe::Create();
+
+	auto process1 = MakeProcess(readProgram);
+	process1->SetStream(3, pipe.first);
+	process1->Capture();
+	process1->Step(100);
+	assert(process1->GetThread(0)->IsBlocked());
+
+	process1->Rollback();
+	assert(!process1->GetThread(0)->IsBlocked());
+
+	pipe.second->Write("wxyz", 4);
+	assert(RunToExit(*process1));
+	assert(process1->GetExitCode() == 0x7778797a);
+
+	/* a read on an I/O worker finishes before the
+	 * rollback, and isn't delivered after it */
+	auto process2 = MakeProcess(readProgram);
+	process2->SetIOWorkers(std::make_shared<IOWorkers>(1));
+	auto stream = std::make_shared<MemoryStream>(std::string("abcdefgh"));
+	stream->SetDelay(std::chrono::milliseconds(20));
+	process2->SetStream(3, stream);
+	process2->Capture();
+	process2->Step(100);
+	assert(process2->GetThread(0)->IsBlocked());
+
+	process2->Rollback();
+
+	assert(RunToExit(*process2));
+	assert(process2->GetExitCode() == 0x61626364);
+
+	/* blocked threads can't be captured */
+	process1->Rollback();
+	process1->Step(100);
+	assert(process1->GetThread(0)->IsBlocked());
+
+	auto captured = true;
+	try {
+		process1->Capture();
+	} catch (const Exception &) {
+		captured = false;
+	}
+	assert(!captured);
+}
+
+} // namespace
+
+void TestRollback() {
+	TestRuns();
+	TestLayout();
+	TestStreams();
+	TestPendingIO();
+}
+
+} // namespace swanson::tests
@@ -0,0 +1,270 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "scheduler-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/process.hpp>
+#include <swanson/scheduler.hpp>
+#include <swanson/segfault.hpp>
+#include <swanson/thread.hpp>
+#include <swanson/wait-queue.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// Jumps to itself forever.
+const std::vector<unsigned char> loopProgram {
+	0x1a, 0x00, 0x00, 0x01, 0x00, 0x00 /* jmpa 0x10000 */
+};
+
+/// Exits with a code of seven.
+const std::vector<unsigned char> exitProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x07, /* ldi.l $r0, 7 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01, /* swi exit */
+	0x1a, 0x00, 0x00, 0x01, 0x00, 0x0c  /* jmpa 0x1000c */
+};
+
+/// Jumps to memory that isn't mapped.
+const std::vector<unsigned char> faultProgram {
+	0x1a, 0x00, 0x80, 0x00, 0x00, 0x00 /* jmpa 0x80000000 */
+};
+
+bool WaitSteps(Scheduler &scheduler, uint64_t stepCount) {
+	for (auto i = 0; i < 5000; i++) {
+		if (scheduler.GetStepCount() > stepCount)
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+void TestWeights() {
+
+	Scheduler scheduler(1);
+	scheduler.SetSliceSteps(1000);
+
+	auto lightProcess = MakeTestProcess(loopProgram);
+	auto heavyProcess = MakeTestProcess(loopProgram);
+	heavyProcess->SetWeight(Process::defaultWeight * 3);
+
+	scheduler.Add(lightProcess);
+	scheduler.Add(heavyProcess);
+
+	/* the light process may have run alone
+	 * before the heavy one was added, so only
+	 * the instructions afterwards are compared */
+
+	scheduler.Pause();
+	auto lightStart = lightProcess->GetInstructionCount();
+	auto heavyStart = heavyProcess->GetInstructionCount();
+	scheduler.Resume();
+
+	assert(WaitSteps(scheduler, scheduler.GetStepCount() + 400000));
+
+	scheduler.Pause();
+
+	/* instructions are shared in
+	 * proportion to the weights */
+
+	auto lightCount = lightProcess->GetInstructionCount() - lightStart;
+	auto heavyCount = heavyProcess->GetInstructionCount() - heavyStart;
+	assert(lightCount > 0);
+	assert((heavyCount * 10) >= (lightCount * 25));
+	assert((heavyCount * 10) <= (lightCount * 35));
+
+	scheduler.Resume();
+}
+
+void TestPriorities() {
+
+	Scheduler scheduler(1);
+	scheduler.SetSliceSteps(1000);
+
+	auto lowProcess = MakeTestProcess(loopProgram);
+	scheduler.Add(lowProcess);
+
+	assert(WaitSteps(scheduler, 0));
+
+	/* a process with a higher priority
+	 * preempts the running one and runs
+	 * until it exits */
+
+	auto highProcess = MakeTestProcess(loopProgram);
+	highProcess->SetPriority(1);
+	highProcess->SetQuantum(500);
+	scheduler.Add(highProcess);
+
+	assert(WaitSteps(scheduler, scheduler.GetStepCount() + 100000));
+
+	scheduler.Pause();
+	auto lowCount = lowProcess->GetInstructionCount();
+	auto highCount = highProcess->GetInstructionCount();
+	scheduler.Resume();
+
+	assert(WaitSteps(scheduler, scheduler.GetStepCount() + 100000));
+
+	scheduler.Pause();
+	assert(lowProcess->GetInstructionCount() == lowCount);
+	assert(highProcess->GetInstructionCount() > highCount);
+}
+
+void TestBlocking() {
+
+	Scheduler scheduler(2);
+	scheduler.SetSliceSteps(1000);
+
+	auto blockedProcess = MakeTestProcess(loopProgram);
+	auto runningProcess = MakeTestProcess(loopProgram);
+
+	/* a process whose threads are all
+	 * blocked is parked off of the queues */
+
+	WaitQueue waitQueue;
+
+	auto thread = blockedProcess->GetThread(0);
+	assert(thread != nullptr);
+	assert(blockedProcess->GetThread(1) == nullptr);
+
+	blockedProcess->Block(*thread->GetCPU(), waitQueue);
+	assert(thread->IsBlocked());
+	assert(!blockedProcess->IsRunnable());
+	assert(!waitQueue.IsEmpty());
+
+	scheduler.Add(blockedProcess);
+	scheduler.Add(runningProcess);
+
+	for (auto i = 0; (i < 5000) && (scheduler.GetParkedCount() == 0); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	assert(scheduler.GetParkedCount() == 1);
+
+	assert(WaitSteps(scheduler, scheduler.GetStepCount() + 10000));
+
+	scheduler.Pause();
+	auto blockedCount = blockedProcess->GetInstructionCount();
+	scheduler.Resume();
+
+	assert(blockedCount == 0);
+
+	/* waking the thread queues the process again */
+
+	waitQueue.WakeAll();
+	assert(waitQueue.IsEmpty());
+	assert(!thread->IsBlocked());
+	assert(scheduler.GetParkedCount() == 0);
+
+	for (auto i = 0; (i < 5000) && (blockedCount == 0); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		scheduler.Pause();
+		blockedCount = blockedProcess->GetInstructionCount();
+		scheduler.Resume();
+	}
+
+	assert(blockedCount > 0);
+}
+
+} // namespace
+
+void TestScheduler() {
+
+	TestWeights();
+	TestPriorities();
+	TestBlocking();
+
+	Scheduler scheduler(2);
+	scheduler.SetSliceSteps(1000);
+
+	assert(scheduler.GetWorkerCount() == 2);
+
+	auto loopProcess1 = MakeTestProcess(loopProgram);
+	auto loopProcess2 = MakeTestProcess(loopProgram);
+	auto exitProcess = MakeTestProcess(exitProgram);
+	auto faultProcess = MakeTestProcess(faultProgram);
+
+	scheduler.Add(loopProcess1);
+	scheduler.Add(exitProcess);
+	scheduler.Add(faultProcess);
+	scheduler.Add(loopProcess2);
+
+	/* exits and faults are reported without
+	 * stopping the other processes */
+
+	auto exited = false;
+	auto faulted = false;
+
+	for (auto i = 0; (i < 500) && !(exited && faulted); i++) {
+
+		SchedulerEvent event;
+		if (!scheduler.WaitEvent(event, std::chrono::milliseconds(10)))
+			continue;
+
+		if (event.type == SchedulerEventType::Exited) {
+			assert(event.process == exitProcess);
+			assert(!event.fault);
+			assert(exitProcess->GetExitCode() == 7);
+			exited = true;
+		} else {
+			assert(event.process == faultProcess);
+			assert(event.fault);
+			auto segfaulted = false;
+			try {
+				std::rethrow_exception(event.fault);
+			} catch (const Segfault &segfault) {
+				assert(segfault.GetAddress() == 0x80000000);
+				segfaulted = true;
+			}
+			assert(segfaulted);
+			faulted = true;
+		}
+	}
+
+	assert(exited && faulted);
+
+	assert(WaitSteps(scheduler, scheduler.GetStepCount()));
+
+	/* nothing runs while paused */
+
+	scheduler.Pause();
+
+	auto pausedStepCount = scheduler.GetStepCount();
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	assert(scheduler.GetStepCount() == pausedStepCount);
+
+	scheduler.Resume();
+
+	assert(WaitSteps(scheduler, pausedStepCount));
+
+	assert(!loopProcess1->Exited());
+	assert(!loopProcess2->Exited());
+
+	SchedulerEvent event;
+	assert(!scheduler.WaitEvent(event, std::chrono::milliseconds(0)));
+}
+
+} // namespace swanson::tests
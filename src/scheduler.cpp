@@ -0,0 +1,387 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/scheduler.hpp>
+
+#include <swanson/process.hpp>
+
+namespace swanson {
+
+Scheduler::Scheduler(unsigned int workerCount)
+	: queued(0),
+	  running(0),
+	  idle(0),
+	  nextQueue(0),
+	  nextSequence(0),
+	  sliceSteps(10000),
+	  stepCount(0),
+	  paused(false),
+	  stopping(false) {
+
+	if (workerCount == 0) {
+		workerCount = std::thread::hardware_concurrency();
+		if (workerCount == 0)
+			workerCount = 1;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		runQueues.emplace_back(new RunQueue);
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back([this, i] { Work(i); });
+}
+
+Scheduler::~Scheduler() {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	workQueued.notify_all();
+
+	for (auto &worker : workers)
+		worker.join();
+
+	// Parked processes would otherwise
+	// call back into the scheduler if
+	// they're woken later on.
+
+	for (auto &parkedEntry : parkedEntries)
+		parkedEntry.second.process->CancelPark();
+}
+
+void Scheduler::Add(std::shared_ptr<Process> process) {
+
+	auto &runQueue = *runQueues[nextQueue++ % runQueues.size()];
+
+	Entry entry;
+	entry.process = process;
+	entry.priority = process->GetPriority();
+
+	// New processes start at the queue's
+	// current virtual time, so they get
+	// their share from now on only.
+
+	{
+		std::unique_lock<std::mutex> lock(runQueue.mutex);
+		entry.virtualTime = runQueue.minVirtualTime;
+	}
+
+	Queue(runQueue, std::move(entry));
+
+	WakeIdle();
+}
+
+size_t Scheduler::GetParkedCount() {
+	std::unique_lock<std::mutex> lock(mutex);
+	return parkedEntries.size();
+}
+
+void Scheduler::Pause() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	paused = true;
+
+	slicesDone.wait(lock, [this] { return running == 0; });
+}
+
+void Scheduler::Resume() {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		paused = false;
+	}
+
+	workQueued.notify_all();
+}
+
+void Scheduler::WaitEvent(SchedulerEvent &event) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	eventQueued.wait(lock, [this] { return !events.empty(); });
+
+	event = std::move(events.front());
+
+	events.pop_front();
+}
+
+bool Scheduler::WaitEvent(SchedulerEvent &event, std::chrono::milliseconds timeout) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (!eventQueued.wait_for(lock, timeout, [this] { return !events.empty(); }))
+		return false;
+
+	event = std::move(events.front());
+
+	events.pop_front();
+
+	return true;
+}
+
+void Scheduler::Work(size_t index) {
+
+	for (;;) {
+
+		// The counter is raised before the pause
+		// flag is checked, so that a thread that's
+		// pausing either sees this slice or this
+		// thread sees the flag.
+
+		running++;
+
+		auto ran = false;
+
+		if (!paused && !stopping) {
+			Entry entry;
+			if (Take(index, entry)) {
+				RunSlice(index, entry);
+				ran = true;
+			}
+		}
+
+		running--;
+
+		if (paused) {
+			std::unique_lock<std::mutex> lock(mutex);
+			slicesDone.notify_all();
+		}
+
+		if (ran)
+			continue;
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		idle++;
+
+		workQueued.wait(lock, [this] { return stopping || (!paused && (queued > 0)); });
+
+		idle--;
+
+		if (stopping)
+			break;
+	}
+}
+
+size_t Scheduler::Queue(RunQueue &runQueue, Entry &&entry) {
+
+	entry.sequence = nextSequence++;
+
+	std::unique_lock<std::mutex> lock(runQueue.mutex);
+
+	if ((runQueue.current != nullptr) && (entry.priority > runQueue.currentPriority))
+		runQueue.current->Preempt();
+
+	runQueue.entries.emplace(std::move(entry));
+
+	queued++;
+
+	return runQueue.entries.size();
+}
+
+bool Scheduler::Take(size_t index, Entry &entry) {
+
+	auto &ownQueue = *runQueues[index];
+
+	auto count = runQueues.size();
+
+	for (size_t i = 0; i < count; i++) {
+
+		auto &runQueue = *runQueues[(index + i) % count];
+
+		std::unique_lock<std::mutex> lock(runQueue.mutex);
+
+		if (runQueue.entries.empty())
+			continue;
+
+		entry = std::move(runQueue.entries.extract(runQueue.entries.begin()).value());
+
+		queued--;
+
+		if (i == 0) {
+			if (entry.virtualTime > runQueue.minVirtualTime)
+				runQueue.minVirtualTime = entry.virtualTime;
+			ownQueue.current = entry.process;
+			ownQueue.currentPriority = entry.priority;
+			return true;
+		}
+
+		// Virtual times are only comparable
+		// within a queue, so a stolen process
+		// keeps its lead over the queue it
+		// came from on the thief's queue.
+
+		uint64_t lead = 0;
+		if (entry.virtualTime > runQueue.minVirtualTime)
+			lead = entry.virtualTime - runQueue.minVirtualTime;
+
+		lock.unlock();
+
+		std::unique_lock<std::mutex> ownLock(ownQueue.mutex);
+
+		entry.virtualTime = ownQueue.minVirtualTime + lead;
+
+		ownQueue.minVirtualTime = entry.virtualTime;
+
+		ownQueue.current = entry.process;
+		ownQueue.currentPriority = entry.priority;
+
+		return true;
+	}
+
+	return false;
+}
+
+void Scheduler::RunSlice(size_t index, Entry &entry) {
+
+	auto &process = entry.process;
+
+	uint32_t steps = process->GetQuantum();
+	if (steps == 0)
+		steps = sliceSteps;
+
+	uint64_t executed = 0;
+
+	std::exception_ptr fault;
+
+	try {
+		executed = process->Step(steps);
+	} catch (...) {
+		fault = std::current_exception();
+	}
+
+	auto &runQueue = *runQueues[index];
+
+	{
+		std::unique_lock<std::mutex> lock(runQueue.mutex);
+		runQueue.current = nullptr;
+	}
+
+	if (fault) {
+		Report(SchedulerEvent { SchedulerEventType::Faulted, process, fault });
+		return;
+	}
+
+	stepCount += executed;
+
+	if (process->Exited()) {
+		Report(SchedulerEvent { SchedulerEventType::Exited, process, nullptr });
+		return;
+	}
+
+	entry.virtualTime += (executed * Process::defaultWeight) / process->GetWeight();
+	entry.priority = process->GetPriority();
+
+	if (!process->IsRunnable()) {
+		Park(index, std::move(entry));
+		return;
+	}
+
+	// A process that's alone on the queue is
+	// taken again by this thread, so there's
+	// nothing for an idle thread to steal.
+
+	if (Queue(runQueue, std::move(entry)) > 1)
+		WakeIdle();
+}
+
+void Scheduler::Park(size_t index, Entry &&entry) {
+
+	// The entry is stored first, since the
+	// process may be woken on another thread
+	// as soon as it's parked.
+
+	auto process = entry.process.get();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		parkedEntries.emplace(process, std::move(entry));
+	}
+
+	if (process->Park([this, process] { Unpark(process); }))
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto node = parkedEntries.extract(process);
+
+	lock.unlock();
+
+	if (Queue(*runQueues[index], std::move(node.mapped())) > 1)
+		WakeIdle();
+}
+
+void Scheduler::Unpark(Process *process) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto node = parkedEntries.extract(process);
+	if (node.empty())
+		return;
+
+	lock.unlock();
+
+	auto &entry = node.mapped();
+
+	auto &runQueue = *runQueues[nextQueue++ % runQueues.size()];
+
+	// A process doesn't build up time while
+	// it's parked, so it starts no further
+	// ahead than the queue's current time.
+
+	{
+		std::unique_lock<std::mutex> queueLock(runQueue.mutex);
+		if (entry.virtualTime < runQueue.minVirtualTime)
+			entry.virtualTime = runQueue.minVirtualTime;
+	}
+
+	Queue(runQueue, std::move(entry));
+
+	WakeIdle();
+}
+
+void Scheduler::Report(SchedulerEvent &&event) {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		events.emplace_back(std::move(event));
+	}
+
+	eventQueued.notify_all();
+}
+
+void Scheduler::WakeIdle() {
+
+	// Idle threads raise the counter with the
+	// mutex held, before they check the queues,
+	// so holding it here means that a thread is
+	// either woken or sees the queued process.
+
+	if (idle == 0)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+	}
+
+	workQueued.notify_one();
+}
+
+} // namespace swanson
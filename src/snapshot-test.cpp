@@ -0,0 +1,153 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "snapshot-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/errors.hpp>
+#include <swanson/host-mapping.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/process.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The file that the tests
+/// write their snapshots to.
+const char snapshotPath[] = "snapshot-test.bin";
+
+/// Asks for a snapshot, then
+/// jumps to itself forever.
+const std::vector<unsigned char> snapshotProgram {
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x1c, /* swi snapshot */
+	0x1a, 0x00, 0x00, 0x01, 0x00, 0x06  /* jmpa 0x10006 */
+};
+
+void TestRoundTrip() {
+
+	auto process = MakeTestProcess(snapshotProgram);
+	process->SetPriority(3);
+	process->SetQuantum(500);
+
+	auto memoryMap = process->GetMemoryMap();
+
+	auto heapStart = process->GetProgramBreak();
+	assert(process->SetProgramBreak(heapStart + 0x2000));
+	memoryMap->Write32(heapStart + 0x1ffc, 0xdeadbeef);
+
+	auto cpu = process->GetThread(0)->GetCPU();
+	cpu->SetRegister(5, 0x1234);
+	cpu->SetSpecialRegister(4, 0x5678);
+
+	auto stackTop = cpu->GetRegister(1);
+	memoryMap->Write32(stackTop - 4, 0xcafe);
+
+	std::ostringstream records;
+
+	{
+		std::ofstream data(snapshotPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		/* like the kernel, memory
+		 * starts after a header */
+		data.write("header", 6);
+		process->SaveSnapshot(records, data);
+		/* the file has to cover the last page */
+		data.seekp(((uint64_t) data.tellp() + HostMapping::GetPageSize()) & ~((uint64_t) HostMapping::GetPageSize() - 1));
+		data.write("records", 7);
+	}
+
+	auto restored = std::make_shared<Process>();
+
+	std::istringstream recordStream(records.str());
+	restored->RestoreSnapshot(recordStream, snapshotPath);
+
+	/* scheduling parameters and threads */
+	assert(restored->GetPriority() == 3);
+	assert(restored->GetQuantum() == 500);
+	assert(restored->GetThreadCount() == 1);
+
+	auto restoredCPU = restored->GetThread(0)->GetCPU();
+	assert(restoredCPU->GetInstructionPointer() == codeAddress);
+	assert(restoredCPU->GetRegister(5) == 0x1234);
+	assert(restoredCPU->GetSpecialRegister(4) == 0x5678);
+	assert(restoredCPU->GetRegister(1) == stackTop);
+
+	/* memory is mapped from the file */
+	auto restoredMap = restored->GetMemoryMap();
+	assert(restoredMap->Read32(heapStart + 0x1ffc) == 0xdeadbeef);
+	assert(restoredMap->Read32(stackTop - 4) == 0xcafe);
+	assert(restoredMap->Read32(heapStart) == 0);
+	assert(restoredMap->FindSection(heapStart)->GetMapping() != nullptr);
+	assert(restored->GetProgramBreak() == (heapStart + 0x2000));
+
+	/* the heap still grows, with zeros */
+	assert(restored->SetProgramBreak(heapStart + 0x8000));
+	assert(restoredMap->Read32(heapStart + 0x7ffc) == 0);
+	restoredMap->Write32(heapStart + 0x7ffc, 1);
+
+	/* writes are private to the process */
+	restoredMap->Write32(heapStart + 0x1ffc, 0);
+	auto another = std::make_shared<Process>();
+	std::istringstream anotherStream(records.str());
+	another->RestoreSnapshot(anotherStream, snapshotPath);
+	assert(another->GetMemoryMap()->Read32(heapStart + 0x1ffc) == 0xdeadbeef);
+
+	/* without a snapshot handler,
+	 * the call isn't supported */
+	restored->Step(2);
+	assert(restoredCPU->GetRegister(2) == errors::ToResult(errors::nosys));
+	assert(restoredCPU->GetInstructionPointer() == (codeAddress + 6));
+
+	std::remove(snapshotPath);
+}
+
+void TestRequest() {
+
+	auto process = MakeTestProcess(snapshotProgram);
+
+	auto requests = 0;
+
+	process->SetSnapshotHandler([&requests](Process &, CPU &cpu) {
+		cpu.SetRegister(2, 1);
+		requests++;
+	});
+
+	process->Step(1);
+
+	assert(requests == 1);
+	assert(process->GetThread(0)->GetCPU()->GetRegister(2) == 1);
+}
+
+} // namespace
+
+void TestSnapshot() {
+	TestRoundTrip();
+	TestRequest();
+}
+
+} // namespace swanson::tests
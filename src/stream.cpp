@@ -17,8 +17,31 @@
 
 #include <swanson/stream.hpp>
 
+#include <swanson/exception.hpp>
+
 namespace swanson {
 
+void Stream::Flush() {
+
+}
+
+uint64_t Stream::GetPosition() {
+	throw Exception("Stream has no position.");
+}
+
+uint64_t Stream::GetSize() {
+	throw Exception("Stream has no size.");
+}
+
+std::shared_ptr<HostMapping> Stream::Map(uint64_t, uint32_t, bool, bool) {
+	return nullptr;
+}
+
+uint64_t Stream::ReadSome(void *buf, uint64_t bufSize) {
+	Read(buf, bufSize);
+	return bufSize;
+}
+
 void Stream::DecodeBE(uint64_t &n) {
 
 	unsigned char buf[8];
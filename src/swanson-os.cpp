@@ -17,8 +17,11 @@
  */
 
 #include <swanson/bad-instruction.hpp>
+#include <swanson/console.hpp>
 #include <swanson/disk.hpp>
+#include <swanson/host.hpp>
 #include <swanson/hostfs.hpp>
+#include <swanson/io-workers.hpp>
 #include <swanson/kernel.hpp>
 #include <swanson/segfault.hpp>
 
@@ -52,6 +55,18 @@ int Help() {
 	return EXIT_FAILURE;
 }
 
+int HelpRun() {
+	std::cout << "Options:" << std::endl;
+	std::cout << "\t--use-hostfs         : Use a host directory as the root file system." << std::endl;
+	std::cout << "\t--hostfs-path PATH   : Specify the host directory to use." << std::endl;
+	std::cout << "\t--snapshot PATH      : Write a snapshot when init asks for one." << std::endl;
+	std::cout << "\t--restore PATH       : Resume the system from a snapshot." << std::endl;
+	std::cout << "\t--io-threads N       : Do file I/O on N host threads, so processes don't wait on it." << std::endl;
+	std::cout << "\t--console MODE       : Buffer standard output by 'line' or 'block', or 'none'." << std::endl;
+	std::cout << "\t--tenants N          : Run N systems in this process, sharing what they load." << std::endl;
+	return EXIT_FAILURE;
+}
+
 int HelpInit() {
 	std::cout << "Options:" << std::endl;
 	std::cout << "\t-d, --disk PATH : Specify the path of the disk to use." << std::endl;
@@ -100,6 +115,67 @@ int Init(std::vector<std::string>::const_iterator begin,
 	return EXIT_SUCCESS;
 }
 
+/// Run several systems in one process. The initial
+/// ram file system and the programs are only decoded
+/// once, and the processes of every system share the
+/// host threads.
+int RunTenants(unsigned long int tenant_count,
+               bool use_hostfs,
+               const std::string &hostfs_path,
+               std::shared_ptr<swanson::Console> console,
+               std::shared_ptr<swanson::IOWorkers> io_workers) {
+
+	swanson::Host host;
+
+	std::shared_ptr<swanson::vfs::FS> root_fs;
+
+	if (use_hostfs)
+		root_fs = swanson::hostfs::FS::Create(hostfs_path);
+	else
+		host.LoadInitRamfs(initramfs_data, initramfs_data_size);
+
+	for (unsigned long int i = 0; i < tenant_count; i++) {
+
+		auto kernel = host.AddTenant();
+
+		if (root_fs != nullptr)
+			kernel->SetRootFS(root_fs);
+
+		if (console != nullptr)
+			kernel->SetConsole(console);
+
+		if (io_workers != nullptr)
+			kernel->SetIOWorkers(io_workers);
+	}
+
+	auto failures = host.Run();
+
+	if (console != nullptr)
+		console->Flush();
+
+	// Each tenant that failed is reported,
+	// without stopping the others from running.
+
+	for (size_t i = 0; i < host.GetTenantCount(); i++) {
+
+		auto fault = host.GetFault(i);
+		if (!fault)
+			continue;
+
+		std::cerr << "Tenant " << i << ": ";
+
+		try {
+			std::rethrow_exception(fault);
+		} catch (const swanson::Exception &exception) {
+			std::cerr << exception.What() << std::endl;
+		} catch (...) {
+			std::cerr << "An unknown error occured." << std::endl;
+		}
+	}
+
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int Run(std::vector<std::string>::const_iterator begin,
         std::vector<std::string>::const_iterator end) {
 
@@ -107,6 +183,16 @@ int Run(std::vector<std::string>::const_iterator begin,
 
 	std::string hostfs_path = std_fs::current_path();
 
+	std::string snapshot_path;
+
+	std::string restore_path;
+
+	unsigned long int io_threads = 0;
+
+	std::string console_mode;
+
+	unsigned long int tenant_count = 1;
+
 	for (auto it = begin; it != end; it++) {
 		if (*it == "--use-hostfs") {
 			use_hostfs = true;
@@ -115,22 +201,112 @@ int Run(std::vector<std::string>::const_iterator begin,
 				throw std::runtime_error("HostFS path not given");
 
 			hostfs_path = *(++it);
+		} else if (*it == "--snapshot") {
+			if ((it + 1) == end)
+				throw std::runtime_error("Snapshot path not given");
+
+			snapshot_path = *(++it);
+		} else if (*it == "--restore") {
+			if ((it + 1) == end)
+				throw std::runtime_error("Snapshot path not given");
+
+			restore_path = *(++it);
+		} else if (*it == "--io-threads") {
+			if ((it + 1) == end)
+				throw std::runtime_error("I/O thread count not given");
+
+			io_threads = std::stoul(*(++it));
+		} else if (*it == "--console") {
+			if ((it + 1) == end)
+				throw std::runtime_error("Console mode not given");
+
+			console_mode = *(++it);
+		} else if (*it == "--tenants") {
+			if ((it + 1) == end)
+				throw std::runtime_error("Tenant count not given");
+
+			tenant_count = std::stoul(*(++it));
+		} else if ((*it == "--help") || (*it == "-h")) {
+			return HelpRun();
 		} else {
 			std::cerr << "Unknown option: " << *it << std::endl;
 			return EXIT_FAILURE;
 		}
 	}
 
+	// The console is made before the kernel,
+	// so that it outlives the processes.
+
+	std::shared_ptr<swanson::Console> console;
+
+	if (console_mode == "line") {
+		console = std::make_shared<swanson::Console>();
+		console->SetMode(1, swanson::Console::Mode::Line);
+	} else if (console_mode == "block") {
+		console = std::make_shared<swanson::Console>();
+		console->SetMode(1, swanson::Console::Mode::Block);
+	} else if (console_mode == "none") {
+		console = std::make_shared<swanson::Console>();
+		console->SetMode(1, swanson::Console::Mode::Unbuffered);
+	} else if (!console_mode.empty()) {
+		std::cerr << "Unknown console mode: " << console_mode << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::shared_ptr<swanson::IOWorkers> io_workers;
+
+	if (io_threads > 0)
+		io_workers = std::make_shared<swanson::IOWorkers>(io_threads);
+
+	if (tenant_count != 1) {
+
+		if (!snapshot_path.empty() || !restore_path.empty()) {
+			std::cerr << "Snapshots aren't supported with more than one tenant." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		return RunTenants(tenant_count, use_hostfs, hostfs_path, console, io_workers);
+	}
+
 	swanson::Kernel kernel;
 
+	if (console != nullptr)
+		kernel.SetConsole(console);
+
 	if (use_hostfs) {
 		auto root_fs = swanson::hostfs::FS::Create(hostfs_path);
 		kernel.SetRootFS(root_fs);
-	} else {
+	} else if (restore_path.empty()) {
 		kernel.LoadInitRamfs(initramfs_data, initramfs_data_size);
 	}
 
-	auto exitCode = kernel.Main();
+	// Init writes the snapshot, with the
+	// snapshot system call, once it's booted.
+	// Restoring one skips straight to there.
+
+	if (!snapshot_path.empty())
+		kernel.SetSnapshotPath(snapshot_path);
+
+	if (io_workers != nullptr)
+		kernel.SetIOWorkers(io_workers);
+
+	if (!restore_path.empty())
+		kernel.LoadSnapshot(restore_path);
+
+	swanson::ExitCode exitCode;
+
+	try {
+		exitCode = kernel.Main();
+	} catch (...) {
+		// Output from before a fault is
+		// written before the fault is reported.
+		if (console != nullptr)
+			console->Flush();
+		throw;
+	}
+
+	if (console != nullptr)
+		console->Flush();
 
 	if (exitCode == swanson::ExitCode::Success)
 		return EXIT_SUCCESS;
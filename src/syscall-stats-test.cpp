@@ -0,0 +1,174 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "syscall-stats-test.hpp"
+
+#include <swanson/cpu.hpp>
+#include <swanson/exception.hpp>
+#include <swanson/memory-map.hpp>
+#include <swanson/process.hpp>
+#include <swanson/syscall-stats.hpp>
+#include <swanson/syscalls.hpp>
+#include <swanson/thread.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The system call that the
+/// test registers for itself.
+constexpr uint32_t customCall = 40;
+
+/// Grows the heap twice, makes the
+/// custom call and then exits with the
+/// result of the custom call.
+const std::vector<unsigned char> callProgram {
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x10, /* ldi.l $r0, 0x10 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x0b, /* swi sbrk */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x10, /* ldi.l $r0, 0x10 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x0b, /* swi sbrk */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x28, /* swi 40 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+void TestBuckets() {
+
+	assert(SyscallStats::GetBucket(0) == 0);
+	assert(SyscallStats::GetBucket(1) == 0);
+	assert(SyscallStats::GetBucket(2) == 1);
+	assert(SyscallStats::GetBucket(3) == 1);
+	assert(SyscallStats::GetBucket(1000) == 9);
+	assert(SyscallStats::GetBucket(UINT64_MAX) == (SyscallStats::bucketCount - 1));
+
+	SyscallStats stats;
+
+	assert(stats.GetPercentile(syscalls::write, 50) == 0);
+
+	for (int i = 0; i < 99; i++)
+		stats.Record(syscalls::write, 100);
+
+	stats.Record(syscalls::write, 5000);
+
+	/* out of range calls aren't counted */
+	stats.Record(syscalls::tableSize, 100);
+
+	assert(stats.GetCallCount(syscalls::write) == 100);
+	assert(stats.GetTotalTime(syscalls::write) == 14900);
+	assert(stats.GetBucketCount(syscalls::write, 6) == 99);
+	assert(stats.GetBucketCount(syscalls::write, 12) == 1);
+	assert(stats.GetPercentile(syscalls::write, 50) == 128);
+	assert(stats.GetPercentile(syscalls::write, 100) == 8192);
+	assert(stats.GetCallCount(syscalls::tableSize) == 0);
+
+	stats.Reset();
+
+	assert(stats.GetCallCount(syscalls::write) == 0);
+	assert(stats.GetBucketCount(syscalls::write, 6) == 0);
+}
+
+void TestDispatch() {
+
+	auto process = MakeTestProcess(callProgram);
+
+	auto stats = std::make_shared<SyscallStats>();
+
+	process->SetSyscallStats(stats);
+
+	/* the custom call sees the same memory
+	 * map that the process has */
+	auto memoryMap = process->GetMemoryMap().get();
+
+	process->SetSyscallHandler(customCall, [memoryMap](Process &process, CPU &cpu, MemoryMap &map) {
+		assert(&map == memoryMap);
+		cpu.SetRegister(2, process.GetProgramBreak());
+	});
+
+	auto heapStart = process->GetProgramBreak();
+
+	while (!process->Exited())
+		process->Step(100);
+
+	assert(process->GetExitCode() == (int32_t) (heapStart + 0x20));
+
+	assert(stats->GetCallCount(syscalls::sbrk) == 2);
+	assert(stats->GetCallCount(customCall) == 1);
+	assert(stats->GetCallCount(syscalls::exit) == 1);
+	assert(stats->GetCallCount(syscalls::write) == 0);
+
+	/* registered handlers replace
+	 * the built in ones */
+	process = MakeTestProcess(callProgram);
+
+	auto breaks = 0;
+
+	process->SetSyscallHandler(syscalls::sbrk, [&breaks](Process &, CPU &cpu, MemoryMap &) {
+		cpu.SetRegister(2, 0);
+		breaks++;
+	});
+
+	process->SetSyscallHandler(customCall, [](Process &process, CPU &cpu, MemoryMap &) {
+		cpu.SetRegister(2, process.GetProgramBreak());
+	});
+
+	heapStart = process->GetProgramBreak();
+
+	while (!process->Exited())
+		process->Step(100);
+
+	assert(breaks == 2);
+	assert(process->GetExitCode() == (int32_t) heapStart);
+
+	/* without a handler, the
+	 * number is unknown */
+	process = MakeTestProcess(callProgram);
+
+	auto caught = false;
+
+	try {
+		while (!process->Exited())
+			process->Step(100);
+	} catch (const Exception &) {
+		caught = true;
+	}
+
+	assert(caught);
+
+	caught = false;
+
+	try {
+		process->SetSyscallHandler(syscalls::tableSize, nullptr);
+	} catch (const Exception &) {
+		caught = true;
+	}
+
+	assert(caught);
+}
+
+} // namespace
+
+void TestSyscallStats() {
+	TestBuckets();
+	TestDispatch();
+}
+
+} // namespace swanson::tests
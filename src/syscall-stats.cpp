@@ -0,0 +1,118 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/syscall-stats.hpp>
+
+namespace swanson {
+
+SyscallStats::SyscallStats() noexcept {
+	Reset();
+}
+
+uint32_t SyscallStats::GetBucket(uint64_t nanoseconds) noexcept {
+
+	uint32_t bucket = 0;
+
+	while ((nanoseconds >= 2) && (bucket < (bucketCount - 1))) {
+		nanoseconds >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+uint64_t SyscallStats::GetCallCount(uint32_t type) const noexcept {
+
+	if (type >= syscalls::tableSize)
+		return 0;
+
+	return entries[type].calls.load(std::memory_order_relaxed);
+}
+
+uint64_t SyscallStats::GetBucketCount(uint32_t type, uint32_t bucket) const noexcept {
+
+	if ((type >= syscalls::tableSize) || (bucket >= bucketCount))
+		return 0;
+
+	return entries[type].buckets[bucket].load(std::memory_order_relaxed);
+}
+
+uint64_t SyscallStats::GetTotalTime(uint32_t type) const noexcept {
+
+	if (type >= syscalls::tableSize)
+		return 0;
+
+	return entries[type].totalTime.load(std::memory_order_relaxed);
+}
+
+uint64_t SyscallStats::GetPercentile(uint32_t type, double percentile) const noexcept {
+
+	if (type >= syscalls::tableSize)
+		return 0;
+
+	// The buckets are read one at a time, so
+	// their sum is used instead of the call
+	// count, which may have moved on since.
+
+	uint64_t counts[bucketCount];
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < bucketCount; i++) {
+		counts[i] = GetBucketCount(type, i);
+		total += counts[i];
+	}
+
+	if (total == 0)
+		return 0;
+
+	auto rank = (uint64_t) ((percentile / 100.0) * total);
+	if (rank >= total)
+		rank = total - 1;
+
+	uint64_t seen = 0;
+
+	for (uint32_t i = 0; i < bucketCount; i++) {
+		seen += counts[i];
+		if (seen > rank)
+			return ((uint64_t) 1) << (i + 1);
+	}
+
+	return ((uint64_t) 1) << bucketCount;
+}
+
+void SyscallStats::Record(uint32_t type, uint64_t nanoseconds) noexcept {
+
+	if (type >= syscalls::tableSize)
+		return;
+
+	auto &entry = entries[type];
+
+	entry.calls.fetch_add(1, std::memory_order_relaxed);
+	entry.totalTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+	entry.buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SyscallStats::Reset() noexcept {
+	for (auto &entry : entries) {
+		entry.calls.store(0, std::memory_order_relaxed);
+		entry.totalTime.store(0, std::memory_order_relaxed);
+		for (auto &bucket : entry.buckets)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+} // namespace swanson
@@ -0,0 +1,168 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "test-process.hpp"
+
+#include <swanson/elf.hpp>
+#include <swanson/process.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace swanson::tests {
+
+elf::File MakeTestImage(const std::vector<unsigned char> &program,
+                        uint32_t dataAddress,
+                        uint32_t dataSize) {
+
+	auto code = std::make_shared<elf::Segment>();
+	code->Resize(program.size());
+	code->SetVirtualAddress(codeAddress);
+	code->AllowRead(true);
+	code->AllowExecute(true);
+	std::memcpy(code->GetData(), program.data(), program.size());
+
+	elf::File file;
+	file.Push(code);
+	file.SetEntryPoint(codeAddress);
+
+	if (dataSize > 0) {
+		auto data = std::make_shared<elf::Segment>();
+		data->Resize(dataSize);
+		data->SetVirtualAddress(dataAddress);
+		data->AllowRead(true);
+		data->AllowWrite(true);
+		file.Push(data);
+	}
+
+	return file;
+}
+
+std::shared_ptr<Process> MakeTestProcess(const elf::File &image) {
+	auto process = std::make_shared<Process>();
+	process->SetDefaultStackSize(0x4000);
+	process->SetMaxHeapSize(0x10000);
+	process->Load(image);
+	return process;
+}
+
+std::shared_ptr<Process> MakeTestProcess(const std::vector<unsigned char> &program,
+                                         uint32_t dataAddress,
+                                         uint32_t dataSize) {
+	return MakeTestProcess(MakeTestImage(program, dataAddress, dataSize));
+}
+
+MemoryStream::MemoryStream(const std::vector<unsigned char> &data_)
+	: data(data_),
+	  offset(0),
+	  delay(0),
+	  held(false),
+	  reading(false),
+	  failing(false),
+	  largestRead(0) {
+
+}
+
+MemoryStream::MemoryStream(const std::string &data_)
+	: MemoryStream(std::vector<unsigned char>(data_.begin(), data_.end())) {
+
+}
+
+uint64_t MemoryStream::GetPosition() {
+	return offset;
+}
+
+uint64_t MemoryStream::GetSize() {
+	if (failing)
+		throw std::runtime_error("Host I/O error.");
+	return data.size();
+}
+
+void MemoryStream::Read(void *buf, uint64_t bufSize) {
+	ReadSome(buf, bufSize);
+}
+
+uint64_t MemoryStream::ReadSome(void *buf, uint64_t bufSize) {
+
+	if (failing)
+		throw std::runtime_error("Host I/O error.");
+
+	reading = true;
+
+	while (held)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	std::this_thread::sleep_for(delay);
+
+	largestRead = std::max(largestRead, bufSize);
+
+	auto readSize = std::min(bufSize, data.size() - std::min(offset, (uint64_t) data.size()));
+	if (readSize > 0)
+		std::memcpy(buf, data.data() + offset, readSize);
+
+	offset += readSize;
+
+	return readSize;
+}
+
+void MemoryStream::SetPosition(uint64_t position) {
+	offset = position;
+}
+
+void MemoryStream::Write(const void *buf, uint64_t bufSize) {
+
+	if (data.size() < (offset + bufSize))
+		data.resize(offset + bufSize);
+
+	if (bufSize > 0)
+		std::memcpy(data.data() + offset, buf, bufSize);
+
+	offset += bufSize;
+}
+
+std::shared_ptr<vfs::Directory> MemoryFS::GetRoot() {
+	return nullptr;
+}
+
+ExitCode MemoryFS::CreateFile(const std::string &) {
+	return ExitCode::InvalidArgument;
+}
+
+ExitCode MemoryFS::CreateDirectory(const std::string &) {
+	return ExitCode::InvalidArgument;
+}
+
+ExitCode MemoryFS::OpenFile(const std::string &path, uint32_t, std::shared_ptr<Stream> &stream) {
+
+	if (failOpen)
+		throw std::runtime_error("Host I/O error.");
+
+	auto it = files.find(path);
+	if (it == files.end())
+		return ExitCode::EntryMissing;
+
+	auto fileStream = std::make_shared<MemoryStream>(it->second);
+	fileStream->SetFailing(failRead);
+
+	stream = fileStream;
+
+	return ExitCode::Success;
+}
+
+} // namespace swanson::tests
@@ -0,0 +1,133 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SWANSON_TEST_PROCESS_HPP
+#define SWANSON_TEST_PROCESS_HPP
+
+#include <swanson/stream.hpp>
+#include <swanson/vfs.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace swanson {
+
+class Process;
+
+namespace elf {
+
+class File;
+
+} // namespace elf
+
+} // namespace swanson
+
+namespace swanson::tests {
+
+/// The address that the
+/// test programs are loaded at.
+constexpr uint32_t codeAddress = 0x10000;
+
+/// Make the image of a test program. The
+/// program starts at @ref codeAddress, and may
+/// be followed by a writable data segment.
+/// @param program The code of the program.
+/// @param dataAddress The address of the data.
+/// @param dataSize The size of the data, or
+/// zero if the program has no data segment.
+/// @returns The image of the program.
+elf::File MakeTestImage(const std::vector<unsigned char> &program,
+                        uint32_t dataAddress = 0,
+                        uint32_t dataSize = 0);
+
+/// Make a process with a test image loaded.
+/// Its stack and heap are kept small.
+/// @param image The image to load.
+/// @returns The new process.
+std::shared_ptr<Process> MakeTestProcess(const elf::File &image);
+
+/// Make a process that runs a test program,
+/// with the image made by @ref MakeTestImage.
+/// @returns The new process.
+std::shared_ptr<Process> MakeTestProcess(const std::vector<unsigned char> &program,
+                                         uint32_t dataAddress = 0,
+                                         uint32_t dataSize = 0);
+
+/// A stream of bytes in memory, used as a
+/// file or a disk. Reads stop at the end of the
+/// data, and writes grow it. Reads may be slowed
+/// down or held, to keep them on an I/O worker,
+/// or made to fail like a host file with an error.
+class MemoryStream final : public Stream {
+	std::vector<unsigned char> data;
+	uint64_t offset;
+	std::chrono::milliseconds delay;
+	std::atomic<bool> held;
+	std::atomic<bool> reading;
+	bool failing;
+	uint64_t largestRead;
+public:
+	MemoryStream(const std::vector<unsigned char> &data_ = {});
+	MemoryStream(const std::string &data_);
+	uint64_t GetPosition() override;
+	uint64_t GetSize() override;
+	void Read(void *buf, uint64_t bufSize) override;
+	uint64_t ReadSome(void *buf, uint64_t bufSize) override;
+	void SetPosition(uint64_t position) override;
+	void Write(const void *buf, uint64_t bufSize) override;
+	/// Get the data of the stream.
+	auto &GetData() const noexcept { return data; }
+	/// Get the most bytes asked for by one read.
+	auto GetLargestRead() const noexcept { return largestRead; }
+	/// Wait before each read.
+	void SetDelay(std::chrono::milliseconds delay_) noexcept { delay = delay_; }
+	/// Make reads and the size throw
+	/// a standard exception.
+	void SetFailing(bool failing_) noexcept { failing = failing_; }
+	/// Hold reads until @ref Release is called.
+	void Hold() noexcept { held = true; }
+	/// Let held reads finish.
+	void Release() noexcept { held = false; }
+	/// Indicates whether or not
+	/// a read has been started.
+	bool IsReading() const noexcept { return reading; }
+};
+
+/// A file system of files in memory.
+/// Each open gets a stream of its own.
+class MemoryFS final : public vfs::FS {
+public:
+	/// The contents of the files, by path.
+	std::map<std::string, std::vector<unsigned char>> files;
+	/// Opens throw, like a host file system error.
+	bool failOpen = false;
+	/// Streams that are opened fail.
+	bool failRead = false;
+	std::shared_ptr<vfs::Directory> GetRoot() override;
+	ExitCode CreateFile(const std::string &path) override;
+	ExitCode CreateDirectory(const std::string &path) override;
+	ExitCode OpenFile(const std::string &path, uint32_t mode, std::shared_ptr<Stream> &stream) override;
+};
+
+} // namespace swanson::tests
+
+#endif /* SWANSON_TEST_PROCESS_HPP */
@@ -18,10 +18,26 @@
 
 #include "test.hpp"
 
+#include "batch-test.hpp"
+#include "block-ring-test.hpp"
+#include "checkpoint-test.hpp"
+#include "console-test.hpp"
 #include "cpu-test.hpp"
 #include "elf-test.hpp"
+#include "file-syscalls-test.hpp"
 #include "fs-test.hpp"
+#include "host-test.hpp"
+#include "image-cache-test.hpp"
+#include "io-workers-test.hpp"
+#include "lz-test.hpp"
 #include "memory-map-test.hpp"
+#include "pipe-test.hpp"
+#include "process-table-test.hpp"
+#include "rollback-test.hpp"
+#include "scheduler-test.hpp"
+#include "snapshot-test.hpp"
+#include "syscall-stats-test.hpp"
+#include "time-page-test.hpp"
 
 #include "crc32-test.h"
 #include "gpt-test.h"
@@ -59,10 +75,26 @@ namespace swanson::tests {
 
 void RunTests() {
 	// C++ tests
+	TestBatch();
+	TestBlockRing();
+	TestCheckpoint();
+	TestConsole();
 	TestCPU();
 	TestELF();
+	TestFileSyscalls();
 	TestFS();
+	TestHost();
+	TestImageCache();
+	TestIOWorkers();
+	TestLZ();
 	TestMemoryMap();
+	TestPipe();
+	TestProcessTable();
+	TestRollback();
+	TestScheduler();
+	TestSnapshot();
+	TestSyscallStats();
+	TestTimePage();
 	// Standard C tests
 	crc32_test();
 	gpt_test();
@@ -0,0 +1,126 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/thread-pool.hpp>
+
+namespace swanson {
+
+ThreadPool::ThreadPool(unsigned int workerCount) : stopping(false) {
+
+	if (workerCount == 0) {
+		workerCount = std::thread::hardware_concurrency();
+		if (workerCount > 1)
+			workerCount--;
+		else
+			workerCount = 1;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back([this] { Work(); });
+}
+
+ThreadPool::~ThreadPool() {
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	taskQueued.notify_all();
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+void ThreadPool::Run(std::vector<std::function<void()>> &functions) {
+
+	if (functions.empty())
+		return;
+
+	Batch batch;
+	batch.remaining = functions.size();
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (auto &function : functions) {
+		Task task;
+		task.function = function;
+		task.batch = &batch;
+		tasks.emplace_back(std::move(task));
+	}
+
+	taskQueued.notify_all();
+
+	// Help with queued tasks, rather than
+	// only waiting, so that nested calls
+	// can't run out of threads.
+
+	while (batch.remaining > 0) {
+		if (!tasks.empty()) {
+			auto task = std::move(tasks.front());
+			tasks.pop_front();
+			RunTask(task, lock);
+		} else {
+			taskDone.wait(lock);
+		}
+	}
+
+	if (batch.error)
+		std::rethrow_exception(batch.error);
+}
+
+void ThreadPool::Work() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+
+		taskQueued.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+		if (tasks.empty())
+			break;
+
+		auto task = std::move(tasks.front());
+		tasks.pop_front();
+
+		RunTask(task, lock);
+	}
+}
+
+void ThreadPool::RunTask(Task &task, std::unique_lock<std::mutex> &lock) {
+
+	lock.unlock();
+
+	std::exception_ptr error;
+
+	try {
+		task.function();
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	lock.lock();
+
+	if (error && !task.batch->error)
+		task.batch->error = error;
+
+	task.batch->remaining--;
+
+	taskDone.notify_all();
+}
+
+} // namespace swanson
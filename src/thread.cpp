@@ -22,35 +22,35 @@
 
 namespace swanson {
 
-Thread::Thread() noexcept : cpu(new CPU()) {
+Thread::Thread() noexcept : blocked(false) {
 
 }
 
 void Thread::SetInstructionPointer(uint32_t addr) noexcept {
-	cpu->SetInstructionPointer(addr);
+	cpu.SetInstructionPointer(addr);
 }
 
 void Thread::SetStackPointer(uint32_t addr) noexcept {
-	cpu->SetStackPointer(addr);
+	cpu.SetStackPointer(addr);
 }
 
 void Thread::SetFramePointer(uint32_t addr) noexcept {
-	cpu->SetFramePointer(addr);
+	cpu.SetFramePointer(addr);
 }
 
 void Thread::SetMemoryBus(std::shared_ptr<MemoryBus> memoryBus) noexcept {
-	cpu->SetMemoryBus(memoryBus);
+	cpu.SetMemoryBus(memoryBus);
 }
 
 void Thread::SetInterruptHandler(std::shared_ptr<InterruptHandler> interruptHandler) noexcept {
-	cpu->SetInterruptHandler(interruptHandler);
+	cpu.SetInterruptHandler(interruptHandler);
 }
 
-void Thread::Step(uint32_t steps) {
+uint32_t Thread::Step(uint32_t steps) {
 	try {
-		cpu->Step(steps);
+		return cpu.Step(steps);
 	} catch (Segfault &segfault) {
-		segfault.SetInstructionPointer(cpu->GetInstructionPointer());
+		segfault.SetInstructionPointer(cpu.GetInstructionPointer());
 		throw;
 	}
 }
@@ -0,0 +1,160 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "time-page-test.hpp"
+
+#include <swanson/memory-map.hpp>
+#include <swanson/memory-section.hpp>
+#include <swanson/process.hpp>
+#include <swanson/segfault.hpp>
+#include <swanson/syscalls.hpp>
+
+#include "assert.h"
+#include "test-process.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace swanson::tests {
+
+namespace {
+
+/// The address that the
+/// results are stored at.
+constexpr uint32_t dataAddress = 0x20000;
+
+/// Reads the seconds from the time page,
+/// then gets the time with each of the
+/// time system calls.
+const std::vector<unsigned char> timeProgram {
+	0x08, 0x30, 0xff, 0xff, 0xe0, 0x00, /* lda.l $r1, time_page */
+	0x09, 0x30, 0x00, 0x02, 0x00, 0x00, /* sta.l 0x20000, $r1 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x12, /* swi time */
+	0x09, 0x20, 0x00, 0x02, 0x00, 0x04, /* sta.l 0x20004, $r0 */
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x08, /* ldi.l $r0, 0x20008 */
+	0x01, 0x30, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r1, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x13, /* swi gettimeofday */
+	0x01, 0x20, 0x00, 0x02, 0x00, 0x10, /* ldi.l $r0, 0x20010 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x14, /* swi times */
+	0x09, 0x20, 0x00, 0x02, 0x00, 0x20, /* sta.l 0x20020, $r0 */
+	0x01, 0x20, 0x00, 0x00, 0x00, 0x00, /* ldi.l $r0, 0 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+/// Writes to the time page.
+const std::vector<unsigned char> writeProgram {
+	0x09, 0x30, 0xff, 0xff, 0xe0, 0x00, /* sta.l time_page, $r1 */
+	0x30, 0x00, 0x00, 0x00, 0x00, 0x01  /* swi exit */
+};
+
+auto MakeProcess(const std::vector<unsigned char> &program) {
+	auto process = MakeTestProcess(program, dataAddress, 0x1000);
+	process->MapTimePage();
+	return process;
+}
+
+uint32_t GetHostSeconds() {
+	auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+	return (uint32_t) std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count();
+}
+
+void TestRead() {
+
+	auto before = GetHostSeconds();
+
+	auto process = MakeProcess(timeProgram);
+
+	/* mapping twice has no effect */
+	process->MapTimePage();
+
+	auto &memoryMap = *process->GetMemoryMap();
+
+	/* the accounting is published
+	 * before the next slice */
+	process->Step(3);
+	process->Step(1);
+
+	auto instructions = ((uint64_t) memoryMap.Read32(syscalls::time_page + syscalls::time_page_instructions) << 32)
+	                  | memoryMap.Read32(syscalls::time_page + syscalls::time_page_instructions + 4);
+
+	assert(instructions == 3);
+
+	while (!process->Exited())
+		process->Step(100);
+
+	auto after = GetHostSeconds();
+
+	auto pageSeconds = memoryMap.Read32(dataAddress);
+	auto timeSeconds = memoryMap.Read32(dataAddress + 4);
+	auto daySeconds = memoryMap.Read32(dataAddress + 8);
+	auto dayMicroseconds = memoryMap.Read32(dataAddress + 12);
+
+	assert(process->GetExitCode() == 0);
+	assert((pageSeconds >= before) && (pageSeconds <= after));
+	assert((timeSeconds >= pageSeconds) && (timeSeconds <= after));
+	assert((daySeconds >= timeSeconds) && (daySeconds <= after));
+	assert(dayMicroseconds < 1000000);
+
+	/* times only counts user time */
+	assert(process->GetCPUTime() > 0);
+	assert(memoryMap.Read32(dataAddress + 20) == 0);
+}
+
+void TestDirty() {
+
+	auto process = MakeProcess(timeProgram);
+
+	auto section = process->GetMemoryMap()->FindSection(syscalls::time_page);
+	assert(section != nullptr);
+
+	section->ClearDirtyPages();
+
+	/* updates before each slice
+	 * don't dirty the page */
+	process->Step(3);
+	process->Step(3);
+
+	assert(section->GetDirtyPages().empty());
+	assert(!section->IsDirty(0));
+}
+
+void TestReadOnly() {
+
+	auto process = MakeProcess(writeProgram);
+
+	auto faulted = false;
+
+	try {
+		process->Step(100);
+	} catch (const Segfault &) {
+		faulted = true;
+	}
+
+	assert(faulted);
+}
+
+} // namespace
+
+void TestTimePage() {
+	TestRead();
+	TestDirty();
+	TestReadOnly();
+}
+
+} // namespace swanson::tests
@@ -17,63 +17,131 @@
 
 #include <swanson/tmpfs.hpp>
 
+#include <swanson/host-mapping.hpp>
+#include <swanson/mman.hpp>
 #include <swanson/stream.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 namespace {
 
+/// Make room for the data of a file to reach
+/// a size. The bytes only move if the file was
+/// never mapped.
+/// @returns False if there isn't room.
+bool Reserve(swanson::tmpfs::FileData &data, uint64_t size) {
+
+	if (size <= data.capacity)
+		return true;
+
+	if (data.mapped || (size > UINT32_MAX))
+		return false;
+
+	auto pageSize = swanson::mman::page_size;
+
+	auto capacity = std::max<uint64_t>(size, data.capacity * 2);
+	capacity = ((capacity + (pageSize - 1)) / pageSize) * pageSize;
+
+	std::unique_ptr<unsigned char[]> bytes(new unsigned char[capacity]());
+
+	if (data.size > 0)
+		std::memcpy(bytes.get(), data.bytes.get(), data.size);
+
+	data.bytes = std::move(bytes);
+	data.capacity = capacity;
+
+	return true;
+}
+
 /// A stream used for reading and
 /// writing to an open temporary file.
 class TmpFileStream final : public swanson::Stream {
-	std::vector<unsigned char> &data;
+	std::shared_ptr<swanson::tmpfs::FileData> dataPtr;
+	swanson::tmpfs::FileData &data;
 	uint64_t offset;
 	uint32_t mode;
 public:
-	TmpFileStream(std::vector<unsigned char> &data_, uint32_t mode_) : data(data_), mode(mode_) {
+	TmpFileStream(std::shared_ptr<swanson::tmpfs::FileData> data_, uint32_t mode_) : dataPtr(data_), data(*data_), mode(mode_) {
 		offset = 0;
 	}
 	~TmpFileStream() {
 
 	}
 	void Read(void *buf, uint64_t bufSize) override {
+		ReadSome(buf, bufSize);
+	}
+	uint64_t ReadSome(void *buf, uint64_t bufSize) override {
 
 		// TODO : this should indicate
 		// that the read failed.
 		if (!(mode & swanson::vfs::modes::read))
-			return;
+			return 0;
 
-		auto buf8 = (unsigned char *) buf;
+		auto readSize = std::min(bufSize, data.size - offset);
 
-		auto i = offset;
+		if (readSize > 0)
+			std::memcpy(buf, data.bytes.get() + offset, readSize);
 
-		while ((i < data.size()) && ((i - offset) < bufSize)) {
-			buf8[i - offset] = data[i];
-			i++;
-		}
+		offset += readSize;
 
-		offset = i;
+		return readSize;
+	}
+	uint64_t GetPosition() override {
+		return offset;
+	}
+	uint64_t GetSize() override {
+		return data.size;
 	}
 	void SetPosition(uint64_t pos) override {
 
-		if (pos >= data.size())
-			pos = data.size();
+		if (pos >= data.size)
+			pos = data.size;
 
 		offset = pos;
 	}
+	std::shared_ptr<swanson::HostMapping> Map(uint64_t mapOffset, uint32_t size, bool writable, bool shared) override {
+
+		// The mapping views the file data directly,
+		// so private writable mappings can't be
+		// offered without a copy.
+
+		if (writable && (!shared || !(mode & swanson::vfs::modes::write)))
+			return nullptr;
+
+		if (mapOffset > data.size)
+			return nullptr;
+
+		// Guest mappings are whole pages, so they
+		// usually reach past the end of the file. That
+		// part views the zeroed capacity of the file.
+
+		if (!Reserve(data, mapOffset + size))
+			return nullptr;
+
+		data.mapped = true;
+
+		return swanson::HostMapping::Borrow(data.bytes.get() + mapOffset, size, writable, dataPtr);
+	}
 	void Write(const void *buf, uint64_t bufSize) override {
 
 		if (!(mode & swanson::vfs::modes::write))
 			return;
 
-		auto buf8 = (const unsigned char *) buf;
+		// Once the file is mapped, it
+		// can't grow past its capacity.
+
+		auto writeSize = bufSize;
+
+		if ((writeSize > (UINT64_MAX - offset)) || !Reserve(data, offset + writeSize))
+			writeSize = data.capacity - offset;
 
-		auto i = offset;
+		if (writeSize > 0)
+			std::memcpy(data.bytes.get() + offset, buf, writeSize);
 
-		while ((i < data.size()) && ((i - offset) < bufSize)) {
-			data[i] = buf8[i - offset];
-			i++;
-		}
+		offset += writeSize;
 
-		offset = i;
+		data.size = std::max(data.size, offset);
 	}
 };
 
@@ -0,0 +1,82 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/wait-queue.hpp>
+
+#include <swanson/process.hpp>
+#include <swanson/thread.hpp>
+
+namespace swanson {
+
+void WaitQueue::Add(std::weak_ptr<Process> process, std::weak_ptr<Thread> thread, uint32_t generation) {
+	std::unique_lock<std::mutex> lock(mutex);
+	waiters.emplace_back(Waiter { process, thread, generation });
+}
+
+bool WaitQueue::IsEmpty() {
+	std::unique_lock<std::mutex> lock(mutex);
+	return waiters.empty();
+}
+
+bool WaitQueue::Wake() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Waiters whose process has gone away,
+	// or was rolled back, are skipped, so that
+	// a live thread is woken if there is one.
+
+	while (!waiters.empty()) {
+
+		auto waiter = std::move(waiters.front());
+
+		waiters.pop_front();
+
+		auto process = waiter.process.lock();
+		auto thread = waiter.thread.lock();
+		if ((process == nullptr) || (thread == nullptr))
+			continue;
+
+		lock.unlock();
+
+		if (process->Wake(*thread, waiter.generation))
+			return true;
+
+		lock.lock();
+	}
+
+	return false;
+}
+
+void WaitQueue::WakeAll() {
+
+	std::deque<Waiter> woken;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		woken.swap(waiters);
+	}
+
+	for (auto &waiter : woken) {
+		auto process = waiter.process.lock();
+		auto thread = waiter.thread.lock();
+		if ((process != nullptr) && (thread != nullptr))
+			process->Wake(*thread, waiter.generation);
+	}
+}
+
+} // namespace swanson
@@ -0,0 +1,92 @@
+// Copyright (C) 2018 Taylor Holberton
+//
+// This file is part of Swanson.
+//
+// Swanson is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Swanson is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Swanson.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <swanson/world-lock.hpp>
+
+namespace swanson {
+
+void WorldLock::Enter() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	changed.wait(lock, [this] { return !stopped; });
+
+	running++;
+}
+
+void WorldLock::Leave() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	running--;
+
+	changed.notify_all();
+}
+
+void WorldLock::Park() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	parked++;
+
+	changed.notify_all();
+}
+
+void WorldLock::Unpark() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	changed.wait(lock, [this] { return !stopped; });
+
+	parked--;
+}
+
+void WorldLock::Stop(bool entered) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Another thread may have stopped the world
+	// first, in which case this one parks until
+	// it's resumed, so that the two don't wait
+	// on each other.
+
+	if (stopped && entered) {
+		parked++;
+		changed.notify_all();
+		changed.wait(lock, [this] { return !stopped; });
+		parked--;
+	} else {
+		changed.wait(lock, [this] { return !stopped; });
+	}
+
+	stopped = true;
+
+	unsigned int self = entered ? 1 : 0;
+
+	changed.wait(lock, [this, self] { return (running - parked) == self; });
+}
+
+void WorldLock::Resume() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	stopped = false;
+
+	changed.notify_all();
+}
+
+} // namespace swanson